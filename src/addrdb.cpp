@@ -27,17 +27,15 @@ class DbNotFoundError : public std::exception
     using std::exception::exception;
 };
 
-template <typename Stream, typename Data>
-bool SerializeDB(Stream& stream, const Data& data)
+template <typename Data>
+bool SerializeDB(CDataStream& stream, const Data& data)
 {
-    // Write and commit header, data
+    // Serialize header and data once, and checksum the serialized bytes
     try {
-        CHashWriter hasher(stream.GetType(), stream.GetVersion());
         stream << Params().MessageStart() << data;
-        hasher << Params().MessageStart() << data;
-        stream << hasher.GetHash();
+        stream << Hash(stream);
     } catch (const std::exception& e) {
-        return error("%s: Serialize or I/O error - %s", __func__, e.what());
+        return error("%s: Serialize error - %s", __func__, e.what());
     }
 
     return true;
@@ -46,6 +44,11 @@ bool SerializeDB(Stream& stream, const Data& data)
 template <typename Data>
 bool SerializeFileDB(const std::string& prefix, const fs::path& path, const Data& data, int version)
 {
+    // Serialize before opening the file, so that no I/O is done while data
+    // (e.g. addrman) is locked
+    CDataStream stream(SER_DISK, version);
+    if (!SerializeDB(stream, data)) return false;
+
     // Generate random temporary filename
     uint16_t randv = 0;
     GetRandBytes((unsigned char*)&randv, sizeof(randv));
@@ -61,11 +64,13 @@ bool SerializeFileDB(const std::string& prefix, const fs::path& path, const Data
         return error("%s: Failed to open file %s", __func__, fs::PathToString(pathTmp));
     }
 
-    // Serialize
-    if (!SerializeDB(fileout, data)) {
+    // Write
+    try {
+        fileout.write((const char*)stream.data(), stream.size());
+    } catch (const std::exception& e) {
         fileout.fclose();
         remove(pathTmp);
-        return false;
+        return error("%s: I/O error - %s", __func__, e.what());
     }
     if (!FileCommit(fileout.Get())) {
         fileout.fclose();
@@ -83,26 +88,32 @@ bool SerializeFileDB(const std::string& prefix, const fs::path& path, const Data
     return true;
 }
 
-template <typename Stream, typename Data>
-void DeserializeDB(Stream& stream, Data& data, bool fCheckSum = true)
+template <typename Data>
+void DeserializeDB(CDataStream& stream, Data& data, bool fCheckSum = true)
 {
-    CHashVerifier<Stream> verifier(&stream);
+    // The checksum covers everything up to the trailing checksum itself. Hash
+    // it in one pass over the buffer, before the data is parsed.
+    uint256 hash;
+    if (fCheckSum && stream.size() >= hash.size()) {
+        hash = Hash(MakeUCharSpan(stream).first(stream.size() - hash.size()));
+    }
+
     // de-serialize file header (network specific magic number) and ..
     unsigned char pchMsgTmp[4];
-    verifier >> pchMsgTmp;
+    stream >> pchMsgTmp;
     // ... verify the network matches ours
     if (memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp))) {
         throw std::runtime_error{"Invalid network magic number"};
     }
 
     // de-serialize data
-    verifier >> data;
+    stream >> data;
 
     // verify checksum
     if (fCheckSum) {
         uint256 hashTmp;
         stream >> hashTmp;
-        if (hashTmp != verifier.GetHash()) {
+        if (hashTmp != hash || !stream.empty()) {
             throw std::runtime_error{"Checksum mismatch, data corrupted"};
         }
     }
@@ -117,7 +128,11 @@ void DeserializeFileDB(const fs::path& path, Data& data, int version)
     if (filein.IsNull()) {
         throw DbNotFoundError{};
     }
-    DeserializeDB(filein, data);
+    // Read the whole file at once, rather than in many small reads
+    CDataStream stream(SER_DISK, version);
+    stream.resize(fs::file_size(path));
+    filein.read((char*)stream.data(), stream.size());
+    DeserializeDB(stream, data);
 }
 } // namespace
 
@@ -43,14 +43,14 @@ static constexpr size_t ADDRMAN_SET_TRIED_COLLISION_SIZE{10};
 /** The maximum time we'll spend trying to resolve a tried table collision, in seconds */
 static constexpr int64_t ADDRMAN_TEST_WINDOW{40*60}; // 40 minutes
 
-int AddrInfo::GetTriedBucket(const uint256& nKey, const std::vector<bool>& asmap) const
+int AddrInfo::GetTriedBucket(const uint256& nKey, const CompiledAsmap& asmap) const
 {
     uint64_t hash1 = (CHashWriter(SER_GETHASH, 0) << nKey << GetKey()).GetCheapHash();
     uint64_t hash2 = (CHashWriter(SER_GETHASH, 0) << nKey << GetGroup(asmap) << (hash1 % ADDRMAN_TRIED_BUCKETS_PER_GROUP)).GetCheapHash();
     return hash2 % ADDRMAN_TRIED_BUCKET_COUNT;
 }
 
-int AddrInfo::GetNewBucket(const uint256& nKey, const CNetAddr& src, const std::vector<bool>& asmap) const
+int AddrInfo::GetNewBucket(const uint256& nKey, const CNetAddr& src, const CompiledAsmap& asmap) const
 {
     std::vector<unsigned char> vchSourceGroupKey = src.GetGroup(asmap);
     uint64_t hash1 = (CHashWriter(SER_GETHASH, 0) << nKey << GetGroup(asmap) << vchSourceGroupKey).GetCheapHash();
@@ -99,11 +99,12 @@ double AddrInfo::GetChance(int64_t nNow) const
     return fChance;
 }
 
-AddrManImpl::AddrManImpl(std::vector<bool>&& asmap, bool deterministic, int32_t consistency_check_ratio)
+AddrManImpl::AddrManImpl(const std::vector<bool>& asmap, bool deterministic, int32_t consistency_check_ratio)
     : insecure_rand{deterministic}
     , nKey{deterministic ? uint256{1} : insecure_rand.rand256()}
     , m_consistency_check_ratio{consistency_check_ratio}
-    , m_asmap{std::move(asmap)}
+    , m_asmap{asmap}
+    , m_asmap_checksum{asmap.empty() ? uint256{} : SerializeHash(asmap)}
 {
     for (auto& bucket : vvNew) {
         for (auto& entry : bucket) {
@@ -125,7 +126,7 @@ AddrManImpl::~AddrManImpl()
 template <typename Stream>
 void AddrManImpl::Serialize(Stream& s_) const
 {
-    LOCK(cs);
+    READ_LOCK(cs);
 
     /**
      * Serialized format.
@@ -218,11 +219,7 @@ void AddrManImpl::Serialize(Stream& s_) const
     }
     // Store asmap checksum after bucket entries so that it
     // can be ignored by older clients for backward compatibility.
-    uint256 asmap_checksum;
-    if (m_asmap.size() != 0) {
-        asmap_checksum = SerializeHash(m_asmap);
-    }
-    s << asmap_checksum;
+    s << m_asmap_checksum;
 }
 
 template <typename Stream>
@@ -329,16 +326,12 @@ void AddrManImpl::Unserialize(Stream& s_)
     // If the bucket count and asmap checksum haven't changed, then attempt
     // to restore the entries to the buckets/positions they were in before
     // serialization.
-    uint256 supplied_asmap_checksum;
-    if (m_asmap.size() != 0) {
-        supplied_asmap_checksum = SerializeHash(m_asmap);
-    }
     uint256 serialized_asmap_checksum;
     if (format >= Format::V2_ASMAP) {
         s >> serialized_asmap_checksum;
     }
     const bool restore_bucketing{nUBuckets == ADDRMAN_NEW_BUCKET_COUNT &&
-        serialized_asmap_checksum == supplied_asmap_checksum};
+        serialized_asmap_checksum == m_asmap_checksum};
 
     if (!restore_bucketing) {
         LogPrint(BCLog::ADDRMAN, "Bucketing method was updated, re-bucketing addrman entries from disk\n");
@@ -426,7 +419,7 @@ AddrInfo* AddrManImpl::Create(const CAddress& addr, const CNetAddr& addrSource,
     return &mapInfo[nId];
 }
 
-void AddrManImpl::SwapRandom(unsigned int nRndPos1, unsigned int nRndPos2) const
+void AddrManImpl::SwapRandom(unsigned int nRndPos1, unsigned int nRndPos2)
 {
     AssertLockHeld(cs);
 
@@ -580,7 +573,7 @@ bool AddrManImpl::AddSingle(const CAddress& addr, const CNetAddr& source, int64_
         int nFactor = 1;
         for (int n = 0; n < pinfo->nRefCount; n++)
             nFactor *= 2;
-        if (nFactor > 1 && (insecure_rand.randrange(nFactor) != 0))
+        if (nFactor > 1 && (WITH_LOCK(m_rand_mutex, return insecure_rand.randrange(nFactor)) != 0))
             return false;
     } else {
         pinfo = Create(addr, source, &nId);
@@ -703,12 +696,16 @@ void AddrManImpl::Attempt_(const CService& addr, bool fCountFailure, int64_t nTi
 
 std::pair<CAddress, int64_t> AddrManImpl::Select_(bool newOnly) const
 {
-    AssertLockHeld(cs);
+    AssertSharedLockHeld(cs);
 
     if (vRandom.empty()) return {};
 
     if (newOnly && nNew == 0) return {};
 
+    // Only concurrent Select() calls wait for each other here, and only for
+    // as long as it takes to pick an entry.
+    LOCK(m_rand_mutex);
+
     // Use a 50% chance for choosing between tried and new table entries.
     if (!newOnly &&
        (nTried > 0 && (nNew == 0 || insecure_rand.randbool() == 0))) {
@@ -772,7 +769,7 @@ std::pair<CAddress, int64_t> AddrManImpl::Select_(bool newOnly) const
 
 std::vector<CAddress> AddrManImpl::GetAddr_(size_t max_addresses, size_t max_pct, std::optional<Network> network) const
 {
-    AssertLockHeld(cs);
+    AssertSharedLockHeld(cs);
 
     size_t nNodes = vRandom.size();
     if (max_pct != 0) {
@@ -782,16 +779,19 @@ std::vector<CAddress> AddrManImpl::GetAddr_(size_t max_addresses, size_t max_pct
         nNodes = std::min(nNodes, max_addresses);
     }
 
-    // gather a list of random nodes, skipping those of low quality
+    // gather a list of random nodes, skipping those of low quality, by
+    // shuffling a copy of vRandom as far as needed
+    FastRandomContext rng{WITH_LOCK(m_rand_mutex, return insecure_rand.rand256())};
+    std::vector<int> ids{vRandom};
     const int64_t now{GetAdjustedTime()};
     std::vector<CAddress> addresses;
-    for (unsigned int n = 0; n < vRandom.size(); n++) {
+    for (unsigned int n = 0; n < ids.size(); n++) {
         if (addresses.size() >= nNodes)
             break;
 
-        int nRndPos = insecure_rand.randrange(vRandom.size() - n) + n;
-        SwapRandom(n, nRndPos);
-        const auto it{mapInfo.find(vRandom[n])};
+        int nRndPos = rng.randrange(ids.size() - n) + n;
+        std::swap(ids[n], ids[nRndPos]);
+        const auto it{mapInfo.find(ids[n])};
         assert(it != mapInfo.end());
 
         const AddrInfo& ai{it->second};
@@ -912,7 +912,7 @@ std::pair<CAddress, int64_t> AddrManImpl::SelectTriedCollision_()
     std::set<int>::iterator it = m_tried_collisions.begin();
 
     // Selects a random element from m_tried_collisions
-    std::advance(it, insecure_rand.randrange(m_tried_collisions.size()));
+    std::advance(it, WITH_LOCK(m_rand_mutex, return insecure_rand.randrange(m_tried_collisions.size())));
     int id_new = *it;
 
     // If id_new not found in mapInfo remove it from m_tried_collisions
@@ -933,11 +933,11 @@ std::pair<CAddress, int64_t> AddrManImpl::SelectTriedCollision_()
 
 void AddrManImpl::Check() const
 {
-    AssertLockHeld(cs);
+    AssertSharedLockHeld(cs);
 
     // Run consistency checks 1 in m_consistency_check_ratio times if enabled
     if (m_consistency_check_ratio == 0) return;
-    if (insecure_rand.randrange(m_consistency_check_ratio) >= 1) return;
+    if (WITH_LOCK(m_rand_mutex, return insecure_rand.randrange(m_consistency_check_ratio)) >= 1) return;
 
     const int err{CheckAddrman()};
     if (err) {
@@ -948,7 +948,7 @@ void AddrManImpl::Check() const
 
 int AddrManImpl::CheckAddrman() const
 {
-    AssertLockHeld(cs);
+    AssertSharedLockHeld(cs);
 
     LOG_TIME_MILLIS_WITH_CATEGORY_MSG_ONCE(
         strprintf("new %i, tried %i, total %u", nNew, nTried, vRandom.size()), BCLog::ADDRMAN);
@@ -1036,7 +1036,7 @@ int AddrManImpl::CheckAddrman() const
 
 size_t AddrManImpl::size() const
 {
-    LOCK(cs); // TODO: Cache this in an atomic to avoid this overhead
+    READ_LOCK(cs); // TODO: Cache this in an atomic to avoid this overhead
     return vRandom.size();
 }
 
@@ -1084,7 +1084,7 @@ std::pair<CAddress, int64_t> AddrManImpl::SelectTriedCollision()
 
 std::pair<CAddress, int64_t> AddrManImpl::Select(bool newOnly) const
 {
-    LOCK(cs);
+    READ_LOCK(cs);
     Check();
     const auto addrRet = Select_(newOnly);
     Check();
@@ -1093,7 +1093,7 @@ std::pair<CAddress, int64_t> AddrManImpl::Select(bool newOnly) const
 
 std::vector<CAddress> AddrManImpl::GetAddr(size_t max_addresses, size_t max_pct, std::optional<Network> network) const
 {
-    LOCK(cs);
+    READ_LOCK(cs);
     Check();
     const auto addresses = GetAddr_(max_addresses, max_pct, network);
     Check();
@@ -1116,13 +1116,13 @@ void AddrManImpl::SetServices(const CService& addr, ServiceFlags nServices)
     Check();
 }
 
-const std::vector<bool>& AddrManImpl::GetAsmap() const
+const CompiledAsmap& AddrManImpl::GetAsmap() const
 {
     return m_asmap;
 }
 
 AddrMan::AddrMan(std::vector<bool> asmap, bool deterministic, int32_t consistency_check_ratio)
-    : m_impl(std::make_unique<AddrManImpl>(std::move(asmap), deterministic, consistency_check_ratio)) {}
+    : m_impl(std::make_unique<AddrManImpl>(asmap, deterministic, consistency_check_ratio)) {}
 
 AddrMan::~AddrMan() = default;
 
@@ -1197,7 +1197,7 @@ void AddrMan::SetServices(const CService& addr, ServiceFlags nServices)
     m_impl->SetServices(addr, nServices);
 }
 
-const std::vector<bool>& AddrMan::GetAsmap() const
+const CompiledAsmap& AddrMan::GetAsmap() const
 {
     return m_impl->GetAsmap();
 }
@@ -18,6 +18,7 @@
 #include <vector>
 
 class AddrManImpl;
+class CompiledAsmap;
 
 /** Default for -checkaddrman */
 static constexpr int32_t DEFAULT_ADDRMAN_CONSISTENCY_CHECKS{0};
@@ -135,7 +136,7 @@ public:
     //! Update an entry's service bits.
     void SetServices(const CService& addr, ServiceFlags nServices);
 
-    const std::vector<bool>& GetAsmap() const;
+    const CompiledAsmap& GetAsmap() const;
 };
 
 #endif // BITCOIN_ADDRMAN_H
@@ -12,6 +12,7 @@
 #include <serialize.h>
 #include <sync.h>
 #include <uint256.h>
+#include <util/asmap.h>
 
 #include <cstdint>
 #include <optional>
@@ -59,7 +60,7 @@ public:
     bool fInTried{false};
 
     //! position in vRandom
-    mutable int nRandomPos{-1};
+    int nRandomPos{-1};
 
     SERIALIZE_METHODS(AddrInfo, obj)
     {
@@ -76,13 +77,13 @@ public:
     }
 
     //! Calculate in which "tried" bucket this entry belongs
-    int GetTriedBucket(const uint256 &nKey, const std::vector<bool> &asmap) const;
+    int GetTriedBucket(const uint256 &nKey, const CompiledAsmap& asmap) const;
 
     //! Calculate in which "new" bucket this entry belongs, given a certain source
-    int GetNewBucket(const uint256 &nKey, const CNetAddr& src, const std::vector<bool> &asmap) const;
+    int GetNewBucket(const uint256 &nKey, const CNetAddr& src, const CompiledAsmap& asmap) const;
 
     //! Calculate in which "new" bucket this entry belongs, using its default source
-    int GetNewBucket(const uint256 &nKey, const std::vector<bool> &asmap) const
+    int GetNewBucket(const uint256 &nKey, const CompiledAsmap& asmap) const
     {
         return GetNewBucket(nKey, source, asmap);
     }
@@ -100,7 +101,7 @@ public:
 class AddrManImpl
 {
 public:
-    AddrManImpl(std::vector<bool>&& asmap, bool deterministic, int32_t consistency_check_ratio);
+    AddrManImpl(const std::vector<bool>& asmap, bool deterministic, int32_t consistency_check_ratio);
 
     ~AddrManImpl();
 
@@ -137,17 +138,21 @@ public:
     void SetServices(const CService& addr, ServiceFlags nServices)
         EXCLUSIVE_LOCKS_REQUIRED(!cs);
 
-    const std::vector<bool>& GetAsmap() const;
+    const CompiledAsmap& GetAsmap() const;
 
     friend class AddrManTest;
     friend class AddrManDeterministic;
 
 private:
-    //! A mutex to protect the inner data structures.
-    mutable Mutex cs;
+    //! A mutex to protect the inner data structures. Select() and GetAddr()
+    //! only take it shared, so that they can run at the same time.
+    mutable SharedMutex cs;
+
+    //! A mutex to protect insecure_rand, which readers share.
+    mutable Mutex m_rand_mutex;
 
     //! Source of random numbers for randomization in inner loops
-    mutable FastRandomContext insecure_rand GUARDED_BY(cs);
+    mutable FastRandomContext insecure_rand GUARDED_BY(m_rand_mutex);
 
     //! secret key to randomize bucket select with
     uint256 nKey;
@@ -185,9 +190,7 @@ private:
     std::unordered_map<CService, int, CServiceHash> mapAddr GUARDED_BY(cs);
 
     //! randomly-ordered vector of all nIds
-    //! This is mutable because it is unobservable outside the class, so any
-    //! changes to it (even in const methods) are also unobservable.
-    mutable std::vector<int> vRandom GUARDED_BY(cs);
+    std::vector<int> vRandom GUARDED_BY(cs);
 
     // number of "tried" entries
     int nTried GUARDED_BY(cs){0};
@@ -224,7 +227,9 @@ private:
     //
     // If a new asmap was provided, the existing records
     // would be re-bucketed accordingly.
-    const std::vector<bool> m_asmap;
+    const CompiledAsmap m_asmap;
+    //! Hash of the asmap file data, or zero if no asmap was provided
+    const uint256 m_asmap_checksum;
 
     //! Find an entry.
     AddrInfo* Find(const CService& addr, int* pnId = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs);
@@ -233,7 +238,7 @@ private:
     AddrInfo* Create(const CAddress& addr, const CNetAddr& addrSource, int* pnId = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs);
 
     //! Swap two elements in vRandom.
-    void SwapRandom(unsigned int nRandomPos1, unsigned int nRandomPos2) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+    void SwapRandom(unsigned int nRandomPos1, unsigned int nRandomPos2) EXCLUSIVE_LOCKS_REQUIRED(cs);
 
     //! Delete an entry. It must not be in tried, and have refcount 0.
     void Delete(int nId) EXCLUSIVE_LOCKS_REQUIRED(cs);
@@ -254,9 +259,9 @@ private:
 
     void Attempt_(const CService& addr, bool fCountFailure, int64_t nTime) EXCLUSIVE_LOCKS_REQUIRED(cs);
 
-    std::pair<CAddress, int64_t> Select_(bool newOnly) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+    std::pair<CAddress, int64_t> Select_(bool newOnly) const SHARED_LOCKS_REQUIRED(cs) EXCLUSIVE_LOCKS_REQUIRED(!m_rand_mutex);
 
-    std::vector<CAddress> GetAddr_(size_t max_addresses, size_t max_pct, std::optional<Network> network) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+    std::vector<CAddress> GetAddr_(size_t max_addresses, size_t max_pct, std::optional<Network> network) const SHARED_LOCKS_REQUIRED(cs);
 
     void Connected_(const CService& addr, int64_t nTime) EXCLUSIVE_LOCKS_REQUIRED(cs);
 
@@ -268,11 +273,11 @@ private:
 
     //! Consistency check, taking into account m_consistency_check_ratio.
     //! Will std::abort if an inconsistency is detected.
-    void Check() const EXCLUSIVE_LOCKS_REQUIRED(cs);
+    void Check() const SHARED_LOCKS_REQUIRED(cs);
 
     //! Perform consistency check, regardless of m_consistency_check_ratio.
     //! @returns an error code or zero.
-    int CheckAddrman() const EXCLUSIVE_LOCKS_REQUIRED(cs);
+    int CheckAddrman() const SHARED_LOCKS_REQUIRED(cs);
 };
 
 #endif // BITCOIN_ADDRMAN_IMPL_H
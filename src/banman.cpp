@@ -20,6 +20,9 @@ BanMan::BanMan(fs::path ban_file, CClientUIInterface* client_interface, int64_t
     int64_t n_start = GetTimeMillis();
     if (m_ban_db.Read(m_banned)) {
         SweepBanned(); // sweep out unused entries
+        for (const auto& [sub_net, ban_entry] : m_banned) {
+            m_banned_index.Insert(sub_net, ban_entry.nBanUntil);
+        }
 
         LogPrint(BCLog::NET, "Loaded %d banned node addresses/subnets  %dms\n", m_banned.size(),
                  GetTimeMillis() - n_start);
@@ -60,6 +63,7 @@ void BanMan::ClearBanned()
     {
         LOCK(m_cs_banned);
         m_banned.clear();
+        m_banned_index.Clear();
         m_is_dirty = true;
     }
     DumpBanlist(); //store banlist to disk
@@ -75,16 +79,12 @@ bool BanMan::IsDiscouraged(const CNetAddr& net_addr)
 bool BanMan::IsBanned(const CNetAddr& net_addr)
 {
     auto current_time = GetTime();
+    bool banned{false};
     LOCK(m_cs_banned);
-    for (const auto& it : m_banned) {
-        CSubNet sub_net = it.first;
-        CBanEntry ban_entry = it.second;
-
-        if (current_time < ban_entry.nBanUntil && sub_net.Match(net_addr)) {
-            return true;
-        }
-    }
-    return false;
+    m_banned_index.ForEachMatch(net_addr, [&](int64_t ban_until) {
+        if (current_time < ban_until) banned = true;
+    });
+    return banned;
 }
 
 bool BanMan::IsBanned(const CSubNet& sub_net)
@@ -129,6 +129,7 @@ void BanMan::Ban(const CSubNet& sub_net, int64_t ban_time_offset, bool since_uni
         LOCK(m_cs_banned);
         if (m_banned[sub_net].nBanUntil < ban_entry.nBanUntil) {
             m_banned[sub_net] = ban_entry;
+            m_banned_index.Insert(sub_net, ban_entry.nBanUntil);
             m_is_dirty = true;
         } else
             return;
@@ -150,6 +151,7 @@ bool BanMan::Unban(const CSubNet& sub_net)
     {
         LOCK(m_cs_banned);
         if (m_banned.erase(sub_net) == 0) return false;
+        m_banned_index.Erase(sub_net);
         m_is_dirty = true;
     }
     if (m_client_interface) m_client_interface->BannedListChanged();
@@ -176,6 +178,7 @@ void BanMan::SweepBanned()
             CSubNet sub_net = (*it).first;
             CBanEntry ban_entry = (*it).second;
             if (!sub_net.IsValid() || now > ban_entry.nBanUntil) {
+                m_banned_index.Erase(sub_net);
                 m_banned.erase(it++);
                 m_is_dirty = true;
                 notify_ui = true;
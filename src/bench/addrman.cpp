@@ -2,13 +2,19 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <addrdb.h>
 #include <addrman.h>
 #include <bench/bench.h>
 #include <random.h>
+#include <test/util/setup_common.h>
+#include <util/asmap.h>
 #include <util/check.h>
 #include <util/time.h>
+#include <util/translation.h>
 
+#include <atomic>
 #include <optional>
+#include <thread>
 #include <vector>
 
 /* A "source" is a source address from which we have received a bunch of other addresses. */
@@ -53,6 +59,81 @@ static void CreateAddresses()
     }
 }
 
+/** Append val in the encoding read by DecodeBits() in util/asmap.cpp. */
+static void EncodeAsmapBits(std::vector<bool>& out, uint32_t val, uint32_t minval, const std::vector<uint8_t>& bit_sizes)
+{
+    val -= minval;
+    for (size_t i = 0; i < bit_sizes.size(); ++i) {
+        const bool last{i + 1 == bit_sizes.size()};
+        if (!last && val >= (uint32_t{1} << bit_sizes[i])) {
+            out.push_back(true);
+            val -= uint32_t{1} << bit_sizes[i];
+            continue;
+        }
+        if (!last) out.push_back(false);
+        for (int bit = bit_sizes[i] - 1; bit >= 0; --bit) {
+            out.push_back((val >> bit) & 1);
+        }
+        return;
+    }
+}
+
+static void EncodeAsmapReturn(std::vector<bool>& out, uint32_t asn)
+{
+    EncodeAsmapBits(out, 0, 0, {0, 0, 1});
+    EncodeAsmapBits(out, asn, 1, {15, 16, 17, 18, 19, 20, 21, 22, 23, 24});
+}
+
+static void EncodeAsmapDefault(std::vector<bool>& out, uint32_t asn)
+{
+    EncodeAsmapBits(out, 3, 0, {0, 0, 1});
+    EncodeAsmapBits(out, asn, 1, {15, 16, 17, 18, 19, 20, 21, 22, 23, 24});
+}
+
+static void EncodeAsmapJump(std::vector<bool>& out, uint32_t jump)
+{
+    EncodeAsmapBits(out, 1, 0, {0, 0, 1});
+    EncodeAsmapBits(out, jump, 17, {5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30});
+}
+
+static void EncodeAsmapMatch(std::vector<bool>& out, uint8_t byte)
+{
+    EncodeAsmapBits(out, 2, 0, {0, 0, 1});
+    EncodeAsmapBits(out, 0x100 | byte, 2, {1, 2, 3, 4, 5, 6, 7, 8});
+}
+
+/**
+ * Append the asmap code for the IPs below a prefix of depth bits. Like the
+ * asmaps built from BGP data, it maps the IP space to ASes in prefixes of
+ * 12 to 24 bits, with more specific prefixes of other ASes within them.
+ */
+static void GenerateAsmap(FastRandomContext& rng, std::vector<bool>& out, int depth)
+{
+    if (depth >= 12 && (depth >= 24 || rng.randbool())) {
+        EncodeAsmapDefault(out, 1 + rng.randrange(1 << 20));
+        EncodeAsmapMatch(out, rng.randbits(8));
+        EncodeAsmapReturn(out, 1 + rng.randrange(1 << 20));
+        return;
+    }
+    std::vector<bool> zero_branch;
+    GenerateAsmap(rng, zero_branch, depth + 1);
+    EncodeAsmapJump(out, zero_branch.size());
+    out.insert(out.end(), zero_branch.begin(), zero_branch.end());
+    GenerateAsmap(rng, out, depth + 1);
+}
+
+static const std::vector<bool>& GetAsmap()
+{
+    static const std::vector<bool> asmap{[] {
+        FastRandomContext rng{/*fDeterministic=*/true};
+        std::vector<bool> asmap;
+        GenerateAsmap(rng, asmap, 0);
+        assert(SanityCheckASMap(asmap, 128));
+        return asmap;
+    }()};
+    return asmap;
+}
+
 static void AddAddressesToAddrMan(AddrMan& addrman)
 {
     for (size_t source_i = 0; source_i < NUM_SOURCES; ++source_i) {
@@ -79,6 +160,17 @@ static void AddrManAdd(benchmark::Bench& bench)
     });
 }
 
+static void AddrManAddAsmap(benchmark::Bench& bench)
+{
+    CreateAddresses();
+    const std::vector<bool>& asmap{GetAsmap()};
+
+    bench.run([&] {
+        AddrMan addrman{asmap, /*deterministic=*/false, /*consistency_check_ratio=*/0};
+        AddAddressesToAddrMan(addrman);
+    });
+}
+
 static void AddrManSelect(benchmark::Bench& bench)
 {
     AddrMan addrman(/* asmap */ std::vector<bool>(), /* deterministic */ false, /* consistency_check_ratio */ 0);
@@ -103,7 +195,65 @@ static void AddrManGetAddr(benchmark::Bench& bench)
     });
 }
 
-static void AddrManAddThenGood(benchmark::Bench& bench)
+/** Select() while other threads call Select() and GetAddr() as well, as the
+ *  connection and message handler threads do. */
+static void AddrManSelectConcurrent(benchmark::Bench& bench)
+{
+    AddrMan addrman(/*asmap=*/std::vector<bool>(), /*deterministic=*/false, /*consistency_check_ratio=*/0);
+
+    FillAddrMan(addrman);
+
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> threads;
+    threads.emplace_back([&] {
+        while (!stop) addrman.GetAddr(/*max_addresses=*/2500, /*max_pct=*/23, /*network=*/std::nullopt);
+    });
+    for (int i = 0; i < 2; ++i) {
+        threads.emplace_back([&] {
+            while (!stop) addrman.Select();
+        });
+    }
+
+    bench.run([&] {
+        const auto& address = addrman.Select();
+        assert(address.first.GetPort() > 0);
+    });
+
+    stop = true;
+    for (auto& thread : threads) thread.join();
+}
+
+static void AddrManDumpPeers(benchmark::Bench& bench)
+{
+    const auto testing_setup = MakeNoLogFileContext<const BasicTestingSetup>();
+    AddrMan addrman(/*asmap=*/std::vector<bool>(), /*deterministic=*/false, /*consistency_check_ratio=*/0);
+
+    FillAddrMan(addrman);
+
+    bench.run([&] {
+        const bool ok{DumpPeerAddresses(testing_setup->m_args, addrman)};
+        assert(ok);
+    });
+}
+
+static void AddrManLoadPeers(benchmark::Bench& bench)
+{
+    const auto testing_setup = MakeNoLogFileContext<const BasicTestingSetup>();
+    {
+        AddrMan addrman(/*asmap=*/std::vector<bool>(), /*deterministic=*/false, /*consistency_check_ratio=*/0);
+        FillAddrMan(addrman);
+        const bool ok{DumpPeerAddresses(testing_setup->m_args, addrman)};
+        assert(ok);
+    }
+
+    bench.run([&] {
+        std::unique_ptr<AddrMan> addrman;
+        const auto error{LoadAddrman(/*asmap=*/{}, testing_setup->m_args, addrman)};
+        assert(!error && addrman->size() > 0);
+    });
+}
+
+static void AddrManAddThenGoodCommon(benchmark::Bench& bench, const std::vector<bool>& asmap)
 {
     auto markSomeAsGood = [](AddrMan& addrman) {
         for (size_t source_i = 0; source_i < NUM_SOURCES; ++source_i) {
@@ -122,14 +272,29 @@ static void AddrManAddThenGood(benchmark::Bench& bench)
         //
         // This has some overhead (exactly the result of AddrManAdd benchmark), but that overhead is constant so improvements in
         // AddrMan::Good() will still be noticeable.
-        AddrMan addrman(/* asmap */ std::vector<bool>(), /* deterministic */ false, /* consistency_check_ratio */ 0);
+        AddrMan addrman{asmap, /*deterministic=*/false, /*consistency_check_ratio=*/0};
         AddAddressesToAddrMan(addrman);
 
         markSomeAsGood(addrman);
     });
 }
 
+static void AddrManAddThenGood(benchmark::Bench& bench)
+{
+    AddrManAddThenGoodCommon(bench, /*asmap=*/{});
+}
+
+static void AddrManAddThenGoodAsmap(benchmark::Bench& bench)
+{
+    AddrManAddThenGoodCommon(bench, GetAsmap());
+}
+
 BENCHMARK(AddrManAdd);
+BENCHMARK(AddrManAddAsmap);
 BENCHMARK(AddrManSelect);
 BENCHMARK(AddrManGetAddr);
+BENCHMARK(AddrManSelectConcurrent);
+BENCHMARK(AddrManDumpPeers);
+BENCHMARK(AddrManLoadPeers);
 BENCHMARK(AddrManAddThenGood);
+BENCHMARK(AddrManAddThenGoodAsmap);
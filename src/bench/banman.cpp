@@ -0,0 +1,73 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <addrdb.h>
+#include <banman.h>
+#include <bench/bench.h>
+#include <net_types.h>
+#include <netaddress.h>
+#include <random.h>
+#include <test/util/setup_common.h>
+#include <util/time.h>
+
+#include <cstring>
+#include <vector>
+
+static constexpr size_t NUM_BANNED{100000};
+static constexpr size_t NUM_LOOKUPS{1000};
+
+static CNetAddr RandomAddr(FastRandomContext& rng)
+{
+    if (rng.randbool()) {
+        in_addr ipv4_addr;
+        const std::vector<unsigned char> bytes{rng.randbytes(4)};
+        memcpy(&ipv4_addr, bytes.data(), bytes.size());
+        return CNetAddr{ipv4_addr};
+    }
+    // Global unicast, so that no address maps to another network.
+    std::vector<unsigned char> bytes{rng.randbytes(16)};
+    bytes[0] = 0x20 | (bytes[0] & 0x0F);
+    CNetAddr addr;
+    addr.SetLegacyIPv6(bytes);
+    return addr;
+}
+
+/**
+ * Look up random addresses in a banlist of NUM_BANNED single addresses and
+ * subnets, as done for every inbound connection and addr message.
+ */
+static void BanManIsBanned(benchmark::Bench& bench)
+{
+    const auto testing_setup = MakeNoLogFileContext<const BasicTestingSetup>();
+    const fs::path ban_file{testing_setup->m_args.GetDataDirBase() / "banlist"};
+    FastRandomContext rng{/*fDeterministic=*/true};
+
+    banmap_t banmap;
+    std::vector<CNetAddr> banned_addrs;
+    CBanEntry ban_entry{GetTime()};
+    ban_entry.nBanUntil = GetTime() + DEFAULT_MISBEHAVING_BANTIME;
+    while (banmap.size() < NUM_BANNED) {
+        const CNetAddr addr{RandomAddr(rng)};
+        const int max_bits{addr.IsIPv4() ? 32 : 128};
+        // Mostly single addresses, with some subnets of various sizes.
+        const int bits{rng.randrange(4) == 0 ? max_bits / 2 + (int)rng.randrange(max_bits / 2) : max_bits};
+        banmap.emplace(CSubNet{addr, (uint8_t)bits}, ban_entry);
+        if (bits == max_bits) banned_addrs.push_back(addr);
+    }
+    CBanDB{ban_file}.Write(banmap);
+    BanMan banman{ban_file, /*client_interface=*/nullptr, DEFAULT_MISBEHAVING_BANTIME};
+
+    std::vector<CNetAddr> addrs;
+    for (size_t i = 0; i < NUM_LOOKUPS; ++i) addrs.push_back(RandomAddr(rng));
+    // Some of the addresses are banned.
+    for (size_t i = 0; i < NUM_LOOKUPS; i += 10) addrs[i] = banned_addrs[rng.randrange(banned_addrs.size())];
+
+    bench.batch(addrs.size()).unit("lookup").run([&] {
+        bool banned{false};
+        for (const CNetAddr& addr : addrs) banned ^= banman.IsBanned(addr);
+        ankerl::nanobench::doNotOptimizeAway(banned);
+    });
+}
+
+BENCHMARK(BanManIsBanned);
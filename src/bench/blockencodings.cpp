@@ -0,0 +1,85 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <blockencodings.h>
+#include <consensus/amount.h>
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <random.h>
+#include <script/script.h>
+#include <test/util/setup_common.h>
+#include <txmempool.h>
+#include <validation.h>
+
+#include <algorithm>
+#include <vector>
+
+//! About the number of transactions in a full 300MB mempool
+static constexpr size_t MEMPOOL_TXS{100000};
+static constexpr size_t BLOCK_TXS{3000};
+//! Transactions of the block that are not in the mempool
+static constexpr size_t MISSING_TXS{10};
+//! As DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN
+static constexpr size_t EXTRA_TXS{100};
+
+static CTransactionRef MakeTx(FastRandomContext& rng)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(rng.rand256(), 0);
+    tx.vin[0].scriptWitness.stack.push_back(rng.randbytes(72));
+    tx.vout.resize(2);
+    for (auto& out : tx.vout) {
+        out.nValue = 10 * COIN;
+        out.scriptPubKey = CScript() << OP_0 << rng.randbytes(20);
+    }
+    return MakeTransactionRef(tx);
+}
+
+/** Reconstruct a block announced by compact block from a mempool of MEMPOOL_TXS
+ *  transactions, which has all but MISSING_TXS of the BLOCK_TXS transactions. */
+static void BlockEncodingsInitData(benchmark::Bench& bench)
+{
+    const auto testing_setup = MakeNoLogFileContext<const TestingSetup>(CBaseChainParams::MAIN);
+    FastRandomContext rng{/*fDeterministic=*/true};
+    CTxMemPool pool;
+    std::vector<CTransactionRef> mempool_txs;
+    {
+        LOCK2(cs_main, pool.cs);
+        for (size_t i = 0; i < MEMPOOL_TXS; ++i) {
+            mempool_txs.push_back(MakeTx(rng));
+            LockPoints lp;
+            pool.addUnchecked(CTxMemPoolEntry(mempool_txs.back(), /*fee=*/1000, /*time=*/0, /*entry_height=*/1,
+                                              /*spends_coinbase=*/false, /*sigops_cost=*/4, lp));
+        }
+    }
+    std::vector<std::pair<uint256, CTransactionRef>> extra_txn;
+    for (size_t i = 0; i < EXTRA_TXS; ++i) {
+        const CTransactionRef tx{MakeTx(rng)};
+        extra_txn.emplace_back(tx->GetWitnessHash(), tx);
+    }
+
+    CBlock block;
+    block.nVersion = 4;
+    block.nTime = 1231006505;
+    block.nBits = 0x1d00ffff;
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vout.resize(1);
+    block.vtx.push_back(MakeTransactionRef(coinbase));
+    Shuffle(mempool_txs.begin(), mempool_txs.end(), rng);
+    block.vtx.insert(block.vtx.end(), mempool_txs.begin(), mempool_txs.begin() + BLOCK_TXS - MISSING_TXS);
+    for (size_t i = 0; i < MISSING_TXS; ++i) block.vtx.push_back(MakeTx(rng));
+    const CBlockHeaderAndShortTxIDs cmpctblock{block, /*fUseWTXID=*/true};
+
+    bench.run([&] {
+        PartiallyDownloadedBlock partial_block{&pool};
+        const ReadStatus status{partial_block.InitData(cmpctblock, extra_txn)};
+        assert(status == READ_STATUS_OK);
+        assert(!partial_block.IsTxAvailable(BLOCK_TXS - 1));
+    });
+}
+
+BENCHMARK(BlockEncodingsInitData);
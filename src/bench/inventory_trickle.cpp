@@ -0,0 +1,103 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <consensus/amount.h>
+#include <net.h>
+#include <net_processing.h>
+#include <primitives/transaction.h>
+#include <random.h>
+#include <script/script.h>
+#include <test/util/net.h>
+#include <test/util/setup_common.h>
+#include <txmempool.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <memory>
+#include <vector>
+
+//! About INVENTORY_BROADCAST_PER_SECOND transactions per inbound trickle interval
+static constexpr size_t TXS_PER_TRICKLE{35};
+
+/**
+ * Relay TXS_PER_TRICKLE new mempool transactions to num_peers inbound peers and
+ * let SendMessages announce them to every peer, as on a trickle of the shared
+ * inbound timer.
+ */
+static void InventoryTrickle(benchmark::Bench& bench, int num_peers)
+{
+    const auto testing_setup = MakeNoLogFileContext<const TestingSetup>(CBaseChainParams::MAIN);
+    const NodeContext& node_context = testing_setup->m_node;
+    CTxMemPool& pool = *node_context.mempool;
+    SetMockTime(GetTime());
+
+    ConnmanTestMsg connman{/*nSeed0=*/0x1337, /*nSeed1=*/0x1337, *node_context.addrman};
+    auto peerman = PeerManager::make(Params(), connman, *node_context.addrman, /*banman=*/nullptr,
+                                     *node_context.chainman, pool, /*ignore_incoming_txs=*/false);
+    CConnman::Options options;
+    options.m_msgproc = peerman.get();
+    options.nSendBufferMaxSize = 1000 * DEFAULT_MAXSENDBUFFER;
+    options.nReceiveFloodSize = 1000 * DEFAULT_MAXRECEIVEBUFFER;
+    connman.Init(options);
+
+    std::vector<CNode*> nodes;
+    for (NodeId id = 0; id < num_peers; ++id) {
+        CNode* node = new CNode(id, ServiceFlags(NODE_NETWORK | NODE_WITNESS), INVALID_SOCKET, CAddress{}, /*nKeyedNetGroupIn=*/0,
+                                /*nLocalHostNonceIn=*/0, CAddress{}, /*addrNameIn=*/"", ConnectionType::INBOUND,
+                                /*inbound_onion=*/false);
+        node->SetCommonVersion(PROTOCOL_VERSION);
+        // Trickle on every SendMessages call, rather than on the random inbound timer.
+        node->m_permissionFlags = NetPermissionFlags::NoBan;
+        peerman->InitializeNode(node);
+        node->fSuccessfullyConnected = true;
+        WITH_LOCK(node->m_tx_relay->cs_filter, node->m_tx_relay->fRelayTxes = true);
+        connman.AddTestNode(*node);
+        nodes.push_back(node);
+    }
+    // Clear the messages of the connection setup.
+    for (CNode* node : nodes) {
+        WITH_LOCK(node->cs_sendProcessing, peerman->SendMessages(node));
+        LOCK(node->cs_vSend);
+        node->vSendMsg.clear();
+    }
+
+    FastRandomContext rng{/*fDeterministic=*/true};
+    bench.batch(num_peers).unit("peer").run([&] {
+        for (size_t i = 0; i < TXS_PER_TRICKLE; ++i) {
+            CMutableTransaction tx;
+            tx.vin.resize(1);
+            tx.vin[0].prevout = COutPoint(rng.rand256(), 0);
+            tx.vout.resize(1);
+            tx.vout[0].nValue = COIN;
+            tx.vout[0].scriptPubKey = CScript() << OP_0 << rng.randbytes(20);
+            const CTransactionRef tx_ref{MakeTransactionRef(tx)};
+            {
+                LOCK2(cs_main, pool.cs);
+                LockPoints lp;
+                pool.addUnchecked(CTxMemPoolEntry(tx_ref, /*fee=*/1000 + rng.randrange(100000), /*time=*/0, /*entry_height=*/1,
+                                                  /*spends_coinbase=*/false, /*sigops_cost=*/4, lp));
+            }
+            peerman->RelayTransaction(tx_ref->GetHash(), tx_ref->GetWitnessHash());
+        }
+        for (CNode* node : nodes) {
+            WITH_LOCK(node->cs_sendProcessing, peerman->SendMessages(node));
+            LOCK(node->cs_vSend);
+            assert(!node->vSendMsg.empty());
+            node->vSendMsg.clear();
+        }
+    });
+
+    for (CNode* node : nodes) peerman->FinalizeNode(*node);
+    connman.ClearTestNodes();
+    SetMockTime(0);
+}
+
+static void InventoryTrickle10Peers(benchmark::Bench& bench) { InventoryTrickle(bench, 10); }
+static void InventoryTrickle100Peers(benchmark::Bench& bench) { InventoryTrickle(bench, 100); }
+static void InventoryTrickle500Peers(benchmark::Bench& bench) { InventoryTrickle(bench, 500); }
+
+BENCHMARK(InventoryTrickle10Peers);
+BENCHMARK(InventoryTrickle100Peers);
+BENCHMARK(InventoryTrickle500Peers);
@@ -2,6 +2,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <arith_uint256.h>
 #include <bench/bench.h>
 #include <policy/policy.h>
 #include <test/util/setup_common.h>
@@ -132,4 +133,55 @@ static void MempoolEviction(benchmark::Bench& bench)
     });
 }
 
+/** A transaction spending the given outpoint, made unique by the counter */
+static CTransactionRef MakeEvictionTx(const COutPoint& prevout, uint64_t counter)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = prevout;
+    tx.vin[0].scriptSig = CScript() << CScriptNum(counter);
+    tx.vout.resize(2);
+    tx.vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+    tx.vout[0].nValue = 10 * COIN;
+    tx.vout[1].scriptPubKey = CScript() << OP_2 << OP_EQUAL;
+    tx.vout[1].nValue = 10 * COIN;
+    return MakeTransactionRef(tx);
+}
+
+// Trim a 500k entry mempool back to its size limit while new transactions
+// keep arriving. A quarter of the transactions spend an output of an earlier
+// one, so eviction also has to handle packages with descendants.
+static void MempoolEvictionSustainedInflow(benchmark::Bench& bench)
+{
+    const auto testing_setup = MakeNoLogFileContext<const TestingSetup>();
+    constexpr uint64_t POOL_SIZE{500000};
+    constexpr uint64_t INFLOW_PER_ROUND{1000};
+
+    FastRandomContext det_rand{true};
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+
+    uint64_t counter = 0;
+    CTransactionRef last;
+    auto add_next = [&]() EXCLUSIVE_LOCKS_REQUIRED(cs_main, pool.cs) {
+        ++counter;
+        COutPoint prevout;
+        if (last && pool.exists(GenTxid::Txid(last->GetHash())) && det_rand.randrange(4) == 0) {
+            prevout = COutPoint(last->GetHash(), 0);
+        } else {
+            prevout = COutPoint(ArithToUint256(arith_uint256(counter)), 0);
+        }
+        last = MakeEvictionTx(prevout, counter);
+        AddTx(last, 1000 + det_rand.randrange(100000), pool);
+    };
+    while (counter < POOL_SIZE) add_next();
+    const size_t size_limit = pool.DynamicMemoryUsage();
+
+    bench.batch(INFLOW_PER_ROUND).unit("tx").run([&]() NO_THREAD_SAFETY_ANALYSIS {
+        for (uint64_t i = 0; i < INFLOW_PER_ROUND; ++i) add_next();
+        pool.TrimToSize(size_limit);
+    });
+}
+
 BENCHMARK(MempoolEviction);
+BENCHMARK(MempoolEvictionSustainedInflow);
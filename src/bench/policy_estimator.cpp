@@ -0,0 +1,82 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <policy/fees.h>
+#include <policy/policy.h>
+#include <test/util/setup_common.h>
+#include <txmempool.h>
+
+#include <vector>
+
+/** Feed the estimator 200 blocks in which higher feerate transactions are
+ *  confirmed more often, like the policyestimator unit test does. */
+static void FillEstimator(CTxMemPool& pool, int& blocknum) EXCLUSIVE_LOCKS_REQUIRED(cs_main, pool.cs)
+{
+    TestMemPoolEntryHelper entry;
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].scriptSig = CScript() << std::vector<unsigned char>(128, 'X');
+    tx.vout.resize(1);
+
+    std::vector<uint256> tx_hashes[10];
+    std::vector<CTransactionRef> block;
+    while (blocknum < 200) {
+        for (int j = 0; j < 10; j++) {
+            for (int k = 0; k < 4; k++) {
+                tx.vin[0].prevout.n = 10000 * blocknum + 100 * j + k;
+                pool.addUnchecked(entry.Fee(2000 * (j + 1)).Time(GetTime()).Height(blocknum).FromTx(tx));
+                tx_hashes[j].push_back(tx.GetHash());
+            }
+        }
+        for (int h = 0; h <= blocknum % 10; h++) {
+            while (tx_hashes[9 - h].size()) {
+                CTransactionRef ptx = pool.get(tx_hashes[9 - h].back());
+                if (ptx) block.push_back(ptx);
+                tx_hashes[9 - h].pop_back();
+            }
+        }
+        pool.removeForBlock(block, ++blocknum);
+        block.clear();
+    }
+}
+
+static void EstimateSmartFee(benchmark::Bench& bench)
+{
+    const auto testing_setup = MakeNoLogFileContext<const TestingSetup>();
+    CBlockPolicyEstimator fee_estimator;
+    CTxMemPool pool(&fee_estimator);
+    LOCK2(cs_main, pool.cs);
+    int blocknum = 0;
+    FillEstimator(pool, blocknum);
+
+    // Wallets query the same few targets many times between blocks.
+    constexpr int MAX_TARGET{48};
+    bench.batch(MAX_TARGET).unit("estimate").run([&] {
+        for (int target = 1; target <= MAX_TARGET; ++target) {
+            FeeCalculation fee_calc;
+            (void)fee_estimator.estimateSmartFee(target, &fee_calc, /*conservative=*/target % 2 == 0);
+        }
+    });
+}
+
+static void BlockPolicyEstimatorEmptyBlock(benchmark::Bench& bench)
+{
+    const auto testing_setup = MakeNoLogFileContext<const TestingSetup>();
+    CBlockPolicyEstimator fee_estimator;
+    CTxMemPool pool(&fee_estimator);
+    LOCK2(cs_main, pool.cs);
+    int blocknum = 0;
+    FillEstimator(pool, blocknum);
+
+    // Decaying the moving averages dominates processing a block without
+    // tracked transactions.
+    std::vector<const CTxMemPoolEntry*> entries;
+    bench.run([&] {
+        fee_estimator.processBlock(++blocknum, entries);
+    });
+}
+
+BENCHMARK(EstimateSmartFee);
+BENCHMARK(BlockPolicyEstimatorEmptyBlock);
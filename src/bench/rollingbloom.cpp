@@ -5,10 +5,15 @@
 
 #include <bench/bench.h>
 #include <common/bloom.h>
+#include <random.h>
+#include <uint256.h>
 
-static void RollingBloom(benchmark::Bench& bench)
+#include <vector>
+
+template <typename Filter>
+static void RollingBloomCommon(benchmark::Bench& bench)
 {
-    CRollingBloomFilter filter(120000, 0.000001);
+    Filter filter(120000, 0.000001);
     std::vector<unsigned char> data(32);
     uint32_t count = 0;
     bench.run([&] {
@@ -27,13 +32,41 @@ static void RollingBloom(benchmark::Bench& bench)
     });
 }
 
-static void RollingBloomReset(benchmark::Bench& bench)
+/** Look up items that were not inserted, as is the case for most inventory. */
+template <typename Filter>
+static void RollingBloomContainsCommon(benchmark::Bench& bench)
+{
+    Filter filter(50000, 0.000001);
+    FastRandomContext rng{/*fDeterministic=*/true};
+    for (int i = 0; i < 75000; ++i) filter.insert(rng.rand256());
+    std::vector<uint256> keys;
+    for (int i = 0; i < 1000; ++i) keys.push_back(rng.rand256());
+    bench.batch(keys.size()).unit("lookup").run([&] {
+        bool found{false};
+        for (const uint256& key : keys) found ^= filter.contains(key);
+        ankerl::nanobench::doNotOptimizeAway(found);
+    });
+}
+
+template <typename Filter>
+static void RollingBloomResetCommon(benchmark::Bench& bench)
 {
-    CRollingBloomFilter filter(120000, 0.000001);
+    Filter filter(120000, 0.000001);
     bench.run([&] {
         filter.reset();
     });
 }
 
+static void RollingBloom(benchmark::Bench& bench) { RollingBloomCommon<CRollingBloomFilter>(bench); }
+static void RollingBloomBlocked(benchmark::Bench& bench) { RollingBloomCommon<CBlockedRollingBloomFilter>(bench); }
+static void RollingBloomContains(benchmark::Bench& bench) { RollingBloomContainsCommon<CRollingBloomFilter>(bench); }
+static void RollingBloomBlockedContains(benchmark::Bench& bench) { RollingBloomContainsCommon<CBlockedRollingBloomFilter>(bench); }
+static void RollingBloomReset(benchmark::Bench& bench) { RollingBloomResetCommon<CRollingBloomFilter>(bench); }
+static void RollingBloomBlockedReset(benchmark::Bench& bench) { RollingBloomResetCommon<CBlockedRollingBloomFilter>(bench); }
+
 BENCHMARK(RollingBloom);
+BENCHMARK(RollingBloomBlocked);
+BENCHMARK(RollingBloomContains);
+BENCHMARK(RollingBloomBlockedContains);
 BENCHMARK(RollingBloomReset);
+BENCHMARK(RollingBloomBlockedReset);
@@ -0,0 +1,112 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <addrman.h>
+#include <bench/bench.h>
+#include <compat.h>
+#include <net.h>
+#include <netmessagemaker.h>
+#include <protocol.h>
+#include <test/util/net.h>
+#include <test/util/setup_common.h>
+#include <version.h>
+
+#include <cassert>
+#include <limits>
+#include <vector>
+
+#ifndef WIN32
+#include <sys/socket.h>
+#include <unistd.h>
+
+/** Measure one iteration of the socket handler loop with num_peers connected
+ *  peers, one of which has a message to receive. */
+static void SocketHandlerCommon(benchmark::Bench& bench, int num_peers, bool use_epoll)
+{
+    const auto testing_setup = MakeNoLogFileContext<const BasicTestingSetup>();
+    AddrMan addrman{/*asmap=*/{}, /*deterministic=*/true, /*consistency_check_ratio=*/0};
+    ConnmanTestMsg connman{/*nSeed0=*/0x1337, /*nSeed1=*/0x1337, addrman};
+    connman.SetPeerConnectTimeout(std::numeric_limits<int64_t>::max() / 2);
+#ifdef USE_EPOLL
+    if (use_epoll) assert(connman.InitEpoll());
+#else
+    assert(!use_epoll);
+#endif
+
+    std::vector<CNode*> nodes;
+    std::vector<int> remote_sockets;
+    for (int i = 0; i < num_peers; ++i) {
+        int fds[2];
+        assert(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        CNode* node = new CNode(/*id=*/i, NODE_NETWORK, /*hSocketIn=*/fds[0], CAddress{}, /*nKeyedNetGroupIn=*/0,
+                                /*nLocalHostNonceIn=*/0, CAddress{}, /*addrNameIn=*/"", ConnectionType::INBOUND,
+                                /*inbound_onion=*/false);
+        connman.AddTestNode(*node);
+        nodes.push_back(node);
+        remote_sockets.push_back(fds[1]);
+    }
+
+    CSerializedNetMsg msg = CNetMsgMaker(PROTOCOL_VERSION).Make(NetMsgType::PING, uint64_t{0});
+    std::vector<unsigned char> wire;
+    V1TransportSerializer{}.prepareForTransport(msg, wire);
+    wire.insert(wire.end(), msg.data.begin(), msg.data.end());
+
+    int next = 0;
+    bench.unit("iteration").run([&] {
+        const int peer = next++ % num_peers;
+        assert(write(remote_sockets[peer], wire.data(), wire.size()) == ssize_t(wire.size()));
+        connman.SocketHandlerOnce();
+
+        // Hand the message over like the message handler would, so that the
+        // peer's receive buffer never fills up.
+        CNode& node = *nodes[peer];
+        LOCK(node.cs_vProcessMsg);
+        assert(node.vProcessMsg.size() == 1);
+        node.vProcessMsg.clear();
+        node.nProcessQueueSize = 0;
+        node.fPauseRecv = false;
+    });
+
+    connman.ClearTestNodes();
+    for (int socket : remote_sockets) {
+        close(socket);
+    }
+}
+
+static void SocketHandlerPoll10Peers(benchmark::Bench& bench)
+{
+    SocketHandlerCommon(bench, 10, /*use_epoll=*/false);
+}
+static void SocketHandlerPoll100Peers(benchmark::Bench& bench)
+{
+    SocketHandlerCommon(bench, 100, /*use_epoll=*/false);
+}
+static void SocketHandlerPoll1000Peers(benchmark::Bench& bench)
+{
+    SocketHandlerCommon(bench, 1000, /*use_epoll=*/false);
+}
+
+BENCHMARK(SocketHandlerPoll10Peers);
+BENCHMARK(SocketHandlerPoll100Peers);
+BENCHMARK(SocketHandlerPoll1000Peers);
+
+#ifdef USE_EPOLL
+static void SocketHandlerEpoll10Peers(benchmark::Bench& bench)
+{
+    SocketHandlerCommon(bench, 10, /*use_epoll=*/true);
+}
+static void SocketHandlerEpoll100Peers(benchmark::Bench& bench)
+{
+    SocketHandlerCommon(bench, 100, /*use_epoll=*/true);
+}
+static void SocketHandlerEpoll1000Peers(benchmark::Bench& bench)
+{
+    SocketHandlerCommon(bench, 1000, /*use_epoll=*/true);
+}
+
+BENCHMARK(SocketHandlerEpoll10Peers);
+BENCHMARK(SocketHandlerEpoll100Peers);
+BENCHMARK(SocketHandlerEpoll1000Peers);
+#endif
+#endif // WIN32
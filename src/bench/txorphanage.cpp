@@ -0,0 +1,124 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <random.h>
+#include <script/script.h>
+#include <txorphanage.h>
+
+#include <vector>
+
+static constexpr size_t NUM_ORPHANS{100000};
+static constexpr size_t NUM_PARENTS{1000};
+static constexpr uint32_t OUTPUTS_PER_PARENT{8};
+static constexpr NodeId NUM_PEERS{125};
+
+struct OrphanSet {
+    std::vector<CTransactionRef> parents;
+    std::vector<CTransactionRef> orphans;
+};
+
+/** Build NUM_ORPHANS orphans. Each spends an output of one of NUM_PARENTS
+ *  parents (so that reconsidering a parent yields ~100 children) and an
+ *  unrelated random outpoint. */
+static OrphanSet CreateOrphans()
+{
+    FastRandomContext rng{/*fDeterministic=*/true};
+    OrphanSet set;
+    set.parents.reserve(NUM_PARENTS);
+    for (size_t i = 0; i < NUM_PARENTS; ++i) {
+        CMutableTransaction parent;
+        parent.vin.resize(1);
+        parent.vin[0].prevout = COutPoint(rng.rand256(), 0);
+        parent.vout.resize(OUTPUTS_PER_PARENT);
+        for (auto& out : parent.vout) {
+            out.nValue = 1000;
+            out.scriptPubKey = CScript() << OP_TRUE;
+        }
+        set.parents.push_back(MakeTransactionRef(parent));
+    }
+    set.orphans.reserve(NUM_ORPHANS);
+    for (size_t i = 0; i < NUM_ORPHANS; ++i) {
+        CMutableTransaction tx;
+        tx.vin.resize(2);
+        tx.vin[0].prevout = COutPoint(set.parents[i % NUM_PARENTS]->GetHash(), (i / NUM_PARENTS) % OUTPUTS_PER_PARENT);
+        tx.vin[1].prevout = COutPoint(rng.rand256(), 0);
+        tx.vout.resize(1);
+        tx.vout[0].nValue = 500;
+        tx.vout[0].scriptPubKey = CScript() << OP_TRUE;
+        set.orphans.push_back(MakeTransactionRef(tx));
+    }
+    return set;
+}
+
+static void FillOrphanage(TxOrphanage& orphanage, const std::vector<CTransactionRef>& orphans) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans)
+{
+    for (size_t i = 0; i < orphans.size(); ++i) {
+        orphanage.AddTx(orphans[i], i % NUM_PEERS);
+    }
+}
+
+static void OrphanageAddTx(benchmark::Bench& bench)
+{
+    const OrphanSet set = CreateOrphans();
+    LOCK(g_cs_orphans);
+    bench.batch(NUM_ORPHANS).unit("orphan").run([&] {
+        TxOrphanage orphanage;
+        FillOrphanage(orphanage, set.orphans);
+    });
+}
+
+static void OrphanageEraseForBlock(benchmark::Bench& bench)
+{
+    const OrphanSet set = CreateOrphans();
+    TxOrphanage orphanage;
+    LOCK(g_cs_orphans);
+    FillOrphanage(orphanage, set.orphans);
+
+    // Each block conflicts with 100 orphans through their unrelated input;
+    // the erased orphans are re-added so the orphanage stays at NUM_ORPHANS.
+    constexpr size_t BLOCK_CONFLICTS{100};
+    size_t next = 0;
+    bench.batch(BLOCK_CONFLICTS).unit("orphan").run([&] {
+        CBlock block;
+        for (size_t i = 0; i < BLOCK_CONFLICTS; ++i) {
+            CMutableTransaction tx;
+            tx.vin.resize(1);
+            tx.vin[0].prevout = set.orphans[(next + i) % NUM_ORPHANS]->vin[1].prevout;
+            block.vtx.push_back(MakeTransactionRef(tx));
+        }
+        orphanage.EraseForBlock(block);
+        for (size_t i = 0; i < BLOCK_CONFLICTS; ++i) {
+            const size_t pos = (next + i) % NUM_ORPHANS;
+            orphanage.AddTx(set.orphans[pos], pos % NUM_PEERS);
+        }
+        next += BLOCK_CONFLICTS;
+    });
+}
+
+static void OrphanageReconsider(benchmark::Bench& bench)
+{
+    const OrphanSet set = CreateOrphans();
+    TxOrphanage orphanage;
+    LOCK(g_cs_orphans);
+    FillOrphanage(orphanage, set.orphans);
+
+    // Accepting a parent puts its children in the work set, which
+    // ProcessOrphanTx then looks up one by one.
+    size_t next = 0;
+    bench.run([&] {
+        std::set<uint256> orphan_work_set;
+        orphanage.AddChildrenToWorkSet(*set.parents[next++ % NUM_PARENTS], orphan_work_set);
+        for (const uint256& txid : orphan_work_set) {
+            const auto [tx, peer] = orphanage.GetTx(txid);
+            assert(tx != nullptr);
+        }
+    });
+}
+
+BENCHMARK(OrphanageAddTx);
+BENCHMARK(OrphanageEraseForBlock);
+BENCHMARK(OrphanageReconsider);
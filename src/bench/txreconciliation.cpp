@@ -0,0 +1,207 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <node/txreconciliation.h>
+#include <random.h>
+#include <serialize.h>
+#include <tinyformat.h>
+#include <uint256.h>
+#include <util/time.h>
+
+#include <cassert>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+namespace {
+
+/** Size of a message header, and of an entry of an inv message */
+constexpr size_t MESSAGE_HEADER_SIZE{24};
+constexpr size_t INV_ENTRY_SIZE{36};
+
+constexpr int NUM_NODES{40};
+constexpr int OUTBOUND_PEERS{8};
+constexpr int TXS_PER_ITERATION{200};
+constexpr int TX_ROUNDS_PER_ITERATION{10};
+/** Flooding is faster than reconciliation, as transactions are announced every few seconds */
+constexpr int FLOODS_PER_RECONCILIATION{3};
+
+struct SimNode {
+    TxReconciliationTracker tracker{TXRECONCILIATION_VERSION};
+    std::set<int> peers;
+    /** Peers this node connected to, and initiates reconciliations with */
+    std::set<int> outbound;
+    std::set<uint256> known;
+    /** Transactions to announce, with the peer they came from (-1 if created here) */
+    std::map<uint256, int> learned;
+};
+
+/**
+ * Relay transactions through a network of nodes, in steps in which each node
+ * announces the transactions it learned in the previous step to its peers. The
+ * nodes either flood inv messages to all their peers, or flood them to a few
+ * peers only and add the transactions to the reconciliation sets of the others,
+ * reconciling every connection after FLOODS_PER_RECONCILIATION steps.
+ *
+ * Only the messages that announce transactions are counted, as the
+ * transactions themselves are sent once to each node in either case.
+ */
+class RelaySimulation
+{
+    std::vector<std::unique_ptr<SimNode>> m_nodes;
+    const bool m_reconcile;
+    FastRandomContext m_rng{/*fDeterministic=*/true};
+    std::chrono::microseconds m_now{1s};
+
+public:
+    uint64_t m_announcement_bytes{0};
+    uint64_t m_txs{0};
+    uint64_t m_reconciliations{0};
+    uint64_t m_failures{0};
+
+    explicit RelaySimulation(bool reconcile) : m_reconcile{reconcile}
+    {
+        for (int i = 0; i < NUM_NODES; ++i) m_nodes.push_back(std::make_unique<SimNode>());
+        for (int i = 0; i < NUM_NODES; ++i) {
+            SimNode& node = *m_nodes[i];
+            while (node.outbound.size() < OUTBOUND_PEERS) {
+                const int peer = m_rng.randrange(NUM_NODES);
+                if (peer == i || node.peers.count(peer)) continue;
+                node.peers.insert(peer);
+                node.outbound.insert(peer);
+                m_nodes[peer]->peers.insert(i);
+                if (!m_reconcile) continue;
+                // Node ids are the indices of the nodes.
+                const uint64_t initiator_salt = node.tracker.PreRegisterPeer(peer);
+                const uint64_t responder_salt = m_nodes[peer]->tracker.PreRegisterPeer(i);
+                node.tracker.RegisterPeer(peer, /*is_peer_inbound=*/false, TXRECONCILIATION_VERSION, responder_salt);
+                m_nodes[peer]->tracker.RegisterPeer(i, /*is_peer_inbound=*/true, TXRECONCILIATION_VERSION, initiator_salt);
+                node.tracker.InitiateReconciliationRequest(peer, m_now);
+            }
+        }
+    }
+
+    /** Create transactions at random nodes over a few rounds, and relay them until every node knows them. */
+    void Run()
+    {
+        for (int round = 0; round < TX_ROUNDS_PER_ITERATION; ++round) {
+            for (int i = 0; i < TXS_PER_ITERATION / TX_ROUNDS_PER_ITERATION; ++i) {
+                SimNode& origin = *m_nodes[m_rng.randrange(NUM_NODES)];
+                const uint256 wtxid = m_rng.rand256();
+                origin.known.insert(wtxid);
+                origin.learned.emplace(wtxid, -1);
+            }
+            Round();
+        }
+        m_txs += TXS_PER_ITERATION;
+        bool relaying = true;
+        while (relaying) {
+            relaying = Round();
+        }
+    }
+
+private:
+    /** Announce transactions from one node to another. */
+    void Announce(int from, int to, const std::vector<uint256>& wtxids, std::map<uint256, int>& learned)
+    {
+        if (wtxids.empty()) return;
+        m_announcement_bytes += MESSAGE_HEADER_SIZE + GetSizeOfCompactSize(wtxids.size()) + INV_ENTRY_SIZE * wtxids.size();
+        SimNode& node = *m_nodes[to];
+        for (const uint256& wtxid : wtxids) {
+            if (m_reconcile) node.tracker.TryRemovingFromSet(from, wtxid);
+            if (node.known.insert(wtxid).second) learned.emplace(wtxid, from);
+        }
+    }
+
+    void Reconcile(int initiator, int responder)
+    {
+        const auto request = m_nodes[initiator]->tracker.InitiateReconciliationRequest(responder, m_now);
+        assert(request);
+        m_announcement_bytes += MESSAGE_HEADER_SIZE + 4;
+        m_nodes[responder]->tracker.HandleReconciliationRequest(initiator, request->m_set_size, request->m_q);
+        const auto sketch = m_nodes[responder]->tracker.RespondToReconciliationRequest(initiator);
+        m_announcement_bytes += MESSAGE_HEADER_SIZE + GetSizeOfCompactSize(sketch->size()) + sketch->size();
+        const auto result = m_nodes[initiator]->tracker.HandleSketch(responder, *sketch);
+        m_announcement_bytes += MESSAGE_HEADER_SIZE + 1 + GetSizeOfCompactSize(result->m_ask_shortids.size()) + 4 * result->m_ask_shortids.size();
+        ++m_reconciliations;
+        if (!result->m_success) ++m_failures;
+        const auto announce = m_nodes[responder]->tracker.HandleReconciliationDifference(initiator, result->m_success, result->m_ask_shortids);
+        Announce(initiator, responder, result->m_announce, m_nodes[responder]->learned);
+        Announce(responder, initiator, *announce, m_nodes[initiator]->learned);
+    }
+
+    /** Announce the transactions each node learned in the last step. Returns whether there were any. */
+    bool Flood()
+    {
+        std::vector<std::map<uint256, int>> learned(NUM_NODES);
+        bool any_new = false;
+        for (int i = 0; i < NUM_NODES; ++i) {
+            SimNode& node = *m_nodes[i];
+            any_new |= !node.learned.empty();
+            for (const int peer : node.peers) {
+                std::vector<uint256> flood;
+                for (const auto& [wtxid, source] : node.learned) {
+                    if (peer == source) continue;
+                    if (!m_reconcile || node.tracker.ShouldFanoutTo(wtxid, peer) || !node.tracker.AddToSet(peer, wtxid)) {
+                        flood.push_back(wtxid);
+                    }
+                }
+                Announce(i, peer, flood, learned[peer]);
+            }
+        }
+        for (int i = 0; i < NUM_NODES; ++i) {
+            m_nodes[i]->learned = std::move(learned[i]);
+        }
+        return any_new;
+    }
+
+    /** Returns whether any node learned a transaction. */
+    bool Round()
+    {
+        bool any_new = false;
+        for (int step = 0; step < FLOODS_PER_RECONCILIATION; ++step) {
+            any_new |= Flood();
+        }
+        if (m_reconcile) {
+            m_now += RECON_REQUEST_INTERVAL;
+            for (int i = 0; i < NUM_NODES; ++i) {
+                for (const int peer : m_nodes[i]->outbound) {
+                    Reconcile(i, peer);
+                }
+            }
+        }
+        return any_new;
+    }
+};
+
+void TxRelayCommon(benchmark::Bench& bench, bool reconcile)
+{
+    RelaySimulation sim{reconcile};
+    bench.batch(TXS_PER_ITERATION).unit("tx").run([&] {
+        sim.Run();
+    });
+    std::cout << strprintf("%s: %.1f bytes of announcements per transaction and node, %u of %u reconciliations failed\n",
+                           reconcile ? "TxRelayReconciliation" : "TxRelayFlooding",
+                           double(sim.m_announcement_bytes) / sim.m_txs / NUM_NODES, sim.m_failures, sim.m_reconciliations);
+}
+
+} // namespace
+
+/** Announce transactions by flooding inv messages, to compare with TxRelayReconciliation */
+static void TxRelayFlooding(benchmark::Bench& bench)
+{
+    TxRelayCommon(bench, /*reconcile=*/false);
+}
+
+/** Announce transactions by BIP330 set reconciliation */
+static void TxRelayReconciliation(benchmark::Bench& bench)
+{
+    TxRelayCommon(bench, /*reconcile=*/true);
+}
+
+BENCHMARK(TxRelayFlooding);
+BENCHMARK(TxRelayReconciliation);
@@ -0,0 +1,68 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <net.h>
+#include <primitives/transaction.h>
+#include <random.h>
+#include <txrequest.h>
+#include <uint256.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+static constexpr NodeId NUM_PEERS{125};
+static constexpr NodeId NUM_PREFERRED_PEERS{8};
+static constexpr size_t NUM_TXS{2000};
+static constexpr size_t TXS_PER_STEP{20};
+static constexpr std::chrono::milliseconds STEP{100};
+static constexpr std::chrono::seconds NONPREF_PEER_DELAY{2};
+static constexpr std::chrono::seconds REQUEST_EXPIRY{1};
+
+/**
+ * Every peer announces every transaction, TXS_PER_STEP new ones per STEP, and the
+ * tracker is asked what to request from each peer after each STEP. Requests are
+ * answered in the next STEP, except by every tenth peer, whose requests expire.
+ */
+static void TxRequestInvFlood(benchmark::Bench& bench)
+{
+    FastRandomContext rng{/*fDeterministic=*/true};
+    std::vector<GenTxid> txs;
+    for (size_t i = 0; i < NUM_TXS; ++i) txs.push_back(GenTxid::Wtxid(rng.rand256()));
+    std::vector<NodeId> peers;
+    for (NodeId peer = 0; peer < NUM_PEERS; ++peer) peers.push_back(peer);
+
+    bench.batch(NUM_TXS * NUM_PEERS).unit("announcement").run([&] {
+        TxRequestTracker tracker;
+        std::chrono::microseconds now{1s};
+        std::vector<std::pair<NodeId, uint256>> requested;
+        size_t announced{0};
+        while (announced < NUM_TXS || tracker.Size() > 0) {
+            for (const auto& [peer, txhash] : requested) {
+                if (peer % 10 != 9) tracker.ForgetTxHash(txhash);
+            }
+            requested.clear();
+            const size_t end{std::min(announced + TXS_PER_STEP, NUM_TXS)};
+            // Peers relay announcements in a random order.
+            Shuffle(peers.begin(), peers.end(), rng);
+            for (const NodeId peer : peers) {
+                const bool preferred{peer < NUM_PREFERRED_PEERS};
+                for (size_t i = announced; i < end; ++i) {
+                    tracker.ReceivedInv(peer, txs[i], preferred, preferred ? now : now + NONPREF_PEER_DELAY);
+                }
+            }
+            announced = end;
+            for (NodeId peer = 0; peer < NUM_PEERS; ++peer) {
+                for (const GenTxid& gtxid : tracker.GetRequestable(peer, now)) {
+                    tracker.RequestedTx(peer, gtxid.GetHash(), now + REQUEST_EXPIRY);
+                    requested.emplace_back(peer, gtxid.GetHash());
+                }
+            }
+            now += STEP;
+        }
+    });
+}
+
+BENCHMARK(TxRequestInvFlood);
@@ -14,7 +14,10 @@
 #include <validation.h>
 #include <util/system.h>
 
-#include <unordered_map>
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <vector>
 
 CBlockHeaderAndShortTxIDs::CBlockHeaderAndShortTxIDs(const CBlock& block, bool fUseWTXID) :
         nonce(GetRand(std::numeric_limits<uint64_t>::max())),
@@ -44,13 +47,78 @@ uint64_t CBlockHeaderAndShortTxIDs::GetShortID(const uint256& txhash) const {
     return SipHashUint256(shorttxidk0, shorttxidk1, txhash) & 0xffffffffffffL;
 }
 
+void CBlockHeaderAndShortTxIDs::GetShortIDs(const uint256* const* txhashes, size_t count, uint64_t* out) const {
+    SipHashUint256Batch(shorttxidk0, shorttxidk1, txhashes, count, out);
+    for (size_t i = 0; i < count; i++) out[i] &= 0xffffffffffffL;
+}
+
+namespace {
+
+/** Open-addressing map of the short IDs of a compact block to their index in the block.
+ *
+ *  Every slot packs a 48-bit short ID and a 16-bit index into one uint64_t, so that
+ *  looking up a transaction which is not in the block (the common case when scanning
+ *  the mempool) usually touches a single cache line, unlike std::unordered_map. */
+class ShortIdTable
+{
+    static constexpr uint64_t EMPTY{std::numeric_limits<uint64_t>::max()};
+    /** At a load factor of at most 1/4, the chance that any of up to 65535 short IDs
+     *  ends up further than this from its home slot is below one in a billion for
+     *  uniformly distributed short IDs, so exceeding it is treated as
+     *  READ_STATUS_FAILED, like any other highly-uneven distribution. */
+    static constexpr size_t MAX_DISPLACEMENT{48};
+
+    std::vector<uint64_t> m_slots;
+    uint64_t m_mask;
+
+public:
+    explicit ShortIdTable(size_t count)
+    {
+        size_t size{64};
+        while (size < 4 * count) size <<= 1;
+        m_slots.assign(size, EMPTY);
+        m_mask = size - 1;
+    }
+
+    /** Add a short ID. Returns false on a duplicate or overly displaced short ID. */
+    bool Insert(uint64_t shortid, uint16_t index)
+    {
+        for (size_t i = 0; i <= MAX_DISPLACEMENT; ++i) {
+            uint64_t& slot{m_slots[(shortid + i) & m_mask]};
+            if (slot == EMPTY) {
+                slot = (shortid << 16) | index;
+                return true;
+            }
+            if ((slot >> 16) == shortid) return false;
+        }
+        return false;
+    }
+
+    /** Look up the index of a short ID, or -1 if it is not in the block. */
+    int32_t Find(uint64_t shortid) const
+    {
+        for (size_t i = 0; i <= MAX_DISPLACEMENT; ++i) {
+            const uint64_t slot{m_slots[(shortid + i) & m_mask]};
+            if (slot == EMPTY) return -1;
+            if ((slot >> 16) == shortid) return slot & 0xffff;
+        }
+        return -1;
+    }
+};
 
+/** Number of mempool transactions whose short IDs are computed at once. */
+constexpr size_t SHORTID_BATCH_SIZE{256};
+
+} // namespace
 
 ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& cmpctblock, const std::vector<std::pair<uint256, CTransactionRef>>& extra_txn) {
     if (cmpctblock.header.IsNull() || (cmpctblock.shorttxids.empty() && cmpctblock.prefilledtxn.empty()))
         return READ_STATUS_INVALID;
     if (cmpctblock.shorttxids.size() + cmpctblock.prefilledtxn.size() > MAX_BLOCK_WEIGHT / MIN_SERIALIZABLE_TRANSACTION_WEIGHT)
         return READ_STATUS_INVALID;
+    // Deserialization already enforces this, and transaction indexes are stored in 16 bits below
+    if (cmpctblock.BlockTxCount() > std::numeric_limits<uint16_t>::max())
+        return READ_STATUS_INVALID;
 
     assert(header.IsNull() && txn_available.empty());
     header = cmpctblock.header;
@@ -78,66 +146,60 @@ ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& c
     // Because well-formed cmpctblock messages will have a (relatively) uniform distribution
     // of short IDs, any highly-uneven distribution of elements can be safely treated as a
     // READ_STATUS_FAILED.
-    std::unordered_map<uint64_t, uint16_t> shorttxids(cmpctblock.shorttxids.size());
+    ShortIdTable shorttxids(cmpctblock.shorttxids.size());
     uint16_t index_offset = 0;
     for (size_t i = 0; i < cmpctblock.shorttxids.size(); i++) {
         while (txn_available[i + index_offset])
             index_offset++;
-        shorttxids[cmpctblock.shorttxids[i]] = i + index_offset;
-        // To determine the chance that the number of entries in a bucket exceeds N,
-        // we use the fact that the number of elements in a single bucket is
-        // binomially distributed (with n = the number of shorttxids S, and p =
-        // 1 / the number of buckets), that in the worst case the number of buckets is
-        // equal to S (due to std::unordered_map having a default load factor of 1.0),
-        // and that the chance for any bucket to exceed N elements is at most
-        // buckets * (the chance that any given bucket is above N elements).
-        // Thus: P(max_elements_per_bucket > N) <= S * (1 - cdf(binomial(n=S,p=1/S), N)).
-        // If we assume blocks of up to 16000, allowing 12 elements per bucket should
-        // only fail once per ~1 million block transfers (per peer and connection).
-        if (shorttxids.bucket_size(shorttxids.bucket(cmpctblock.shorttxids[i])) > 12)
-            return READ_STATUS_FAILED;
+        // TODO: in the shortid-collision case, we should instead request both transactions
+        // which collided. Falling back to full-block-request here is overkill.
+        if (!shorttxids.Insert(cmpctblock.shorttxids[i], i + index_offset))
+            return READ_STATUS_FAILED; // Short ID collision or uneven distribution
     }
-    // TODO: in the shortid-collision case, we should instead request both transactions
-    // which collided. Falling back to full-block-request here is overkill.
-    if (shorttxids.size() != cmpctblock.shorttxids.size())
-        return READ_STATUS_FAILED; // Short ID collision
 
     std::vector<bool> have_txn(txn_available.size());
     {
     LOCK(pool->cs);
-    for (size_t i = 0; i < pool->vTxHashes.size(); i++) {
-        uint64_t shortid = cmpctblock.GetShortID(pool->vTxHashes[i].first);
-        std::unordered_map<uint64_t, uint16_t>::iterator idit = shorttxids.find(shortid);
-        if (idit != shorttxids.end()) {
-            if (!have_txn[idit->second]) {
-                txn_available[idit->second] = pool->vTxHashes[i].second->GetSharedTx();
-                have_txn[idit->second]  = true;
-                mempool_count++;
-            } else {
-                // If we find two mempool txn that match the short id, just request it.
-                // This should be rare enough that the extra bandwidth doesn't matter,
-                // but eating a round-trip due to FillBlock failure would be annoying
-                if (txn_available[idit->second]) {
-                    txn_available[idit->second].reset();
-                    mempool_count--;
+    std::array<const uint256*, SHORTID_BATCH_SIZE> batch_hashes;
+    std::array<uint64_t, SHORTID_BATCH_SIZE> batch_shortids;
+    for (size_t batch_start = 0; batch_start < pool->vTxHashes.size() && mempool_count < cmpctblock.shorttxids.size(); batch_start += SHORTID_BATCH_SIZE) {
+        const size_t batch_size = std::min(SHORTID_BATCH_SIZE, pool->vTxHashes.size() - batch_start);
+        for (size_t j = 0; j < batch_size; j++) {
+            batch_hashes[j] = &pool->vTxHashes[batch_start + j].first;
+        }
+        cmpctblock.GetShortIDs(batch_hashes.data(), batch_size, batch_shortids.data());
+        for (size_t j = 0; j < batch_size; j++) {
+            const int32_t index = shorttxids.Find(batch_shortids[j]);
+            if (index >= 0) {
+                if (!have_txn[index]) {
+                    txn_available[index] = pool->vTxHashes[batch_start + j].second->GetSharedTx();
+                    have_txn[index] = true;
+                    mempool_count++;
+                } else {
+                    // If we find two mempool txn that match the short id, just request it.
+                    // This should be rare enough that the extra bandwidth doesn't matter,
+                    // but eating a round-trip due to FillBlock failure would be annoying
+                    if (txn_available[index]) {
+                        txn_available[index].reset();
+                        mempool_count--;
+                    }
                 }
             }
+            // Though ideally we'd continue scanning for the two-txn-match-shortid case,
+            // the performance win of an early exit here is too good to pass up and worth
+            // the extra risk.
+            if (mempool_count == cmpctblock.shorttxids.size())
+                break;
         }
-        // Though ideally we'd continue scanning for the two-txn-match-shortid case,
-        // the performance win of an early exit here is too good to pass up and worth
-        // the extra risk.
-        if (mempool_count == shorttxids.size())
-            break;
     }
     }
 
     for (size_t i = 0; i < extra_txn.size(); i++) {
-        uint64_t shortid = cmpctblock.GetShortID(extra_txn[i].first);
-        std::unordered_map<uint64_t, uint16_t>::iterator idit = shorttxids.find(shortid);
-        if (idit != shorttxids.end()) {
-            if (!have_txn[idit->second]) {
-                txn_available[idit->second] = extra_txn[i].second;
-                have_txn[idit->second]  = true;
+        const int32_t index = shorttxids.Find(cmpctblock.GetShortID(extra_txn[i].first));
+        if (index >= 0) {
+            if (!have_txn[index]) {
+                txn_available[index] = extra_txn[i].second;
+                have_txn[index] = true;
                 mempool_count++;
                 extra_count++;
             } else {
@@ -147,9 +209,9 @@ ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& c
                 // but eating a round-trip due to FillBlock failure would be annoying
                 // Note that we don't want duplication between extra_txn and mempool to
                 // trigger this case, so we compare witness hashes first
-                if (txn_available[idit->second] &&
-                        txn_available[idit->second]->GetWitnessHash() != extra_txn[i].second->GetWitnessHash()) {
-                    txn_available[idit->second].reset();
+                if (txn_available[index] &&
+                        txn_available[index]->GetWitnessHash() != extra_txn[i].second->GetWitnessHash()) {
+                    txn_available[index].reset();
                     mempool_count--;
                     extra_count--;
                 }
@@ -158,7 +220,7 @@ ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& c
         // Though ideally we'd continue scanning for the two-txn-match-shortid case,
         // the performance win of an early exit here is too good to pass up and worth
         // the extra risk.
-        if (mempool_count == shorttxids.size())
+        if (mempool_count == cmpctblock.shorttxids.size())
             break;
     }
 
@@ -450,6 +450,7 @@ public:
                 {0, uint256S("0f9188f13cb7b2c71f2a335e3a4fc328bf5beb436012afca590b1a11466e2206")},
             }
         };
+        UpdateCheckpointsFromArgs(args);
 
         m_assumeutxo_data = MapAssumeutxo{
             {
@@ -487,6 +488,7 @@ public:
         consensus.vDeployments[d].min_activation_height = min_activation_height;
     }
     void UpdateActivationParametersFromArgs(const ArgsManager& args);
+    void UpdateCheckpointsFromArgs(const ArgsManager& args);
 };
 
 static void MaybeUpdateHeights(const ArgsManager& args, Consensus::Params& consensus)
@@ -556,6 +558,25 @@ void CRegTestParams::UpdateActivationParametersFromArgs(const ArgsManager& args)
     }
 }
 
+void CRegTestParams::UpdateCheckpointsFromArgs(const ArgsManager& args)
+{
+    for (const std::string& arg : args.GetArgs("-testcheckpoint")) {
+        const auto found{arg.find('@')};
+        if (found == std::string::npos) {
+            throw std::runtime_error(strprintf("Invalid format (%s) for -testcheckpoint=height@hash.", arg));
+        }
+        const auto hash{arg.substr(found + 1)};
+        int32_t height;
+        if (!ParseInt32(arg.substr(0, found), &height) || height < 0) {
+            throw std::runtime_error(strprintf("Invalid height value (%s) for -testcheckpoint=height@hash.", arg));
+        }
+        if (hash.size() != 64 || !IsHex(hash)) {
+            throw std::runtime_error(strprintf("Invalid hash value (%s) for -testcheckpoint=height@hash.", arg));
+        }
+        checkpointData.mapCheckpoints[height] = uint256S(hash);
+    }
+}
+
 static std::unique_ptr<const CChainParams> globalChainParams;
 
 const CChainParams &Params() {
@@ -16,6 +16,7 @@
 #include <cmath>
 #include <cstdlib>
 #include <limits>
+#include <numeric>
 #include <vector>
 
 static constexpr double LN2SQUARED = 0.4804530139182014246671025263266649717305529515945455;
@@ -251,3 +252,201 @@ void CRollingBloomFilter::reset()
     nGeneration = 1;
     std::fill(data.begin(), data.end(), 0);
 }
+
+/** Probability that i elements are in a block, with an average of load elements per block. */
+static double PoissonProbability(double load, int i)
+{
+    return std::exp(i * std::log(load) - load - std::lgamma(i + 1.0));
+}
+
+/**
+ * Approximate false positive rate of a full CBlockedRollingBloomFilter, using
+ * the expected fraction of set entries of a block with a given number of
+ * elements. This underestimates the rate somewhat, but is good enough to pick
+ * the number of hash functions.
+ */
+static double ApproxBlockedFpRate(double load, int hash_funcs, int block_entries)
+{
+    const double spread = 6 * std::sqrt(load) + 20;
+    // Chance that an entry is not set by one element of its block.
+    const double keep = std::pow(1.0 - 1.0 / block_entries, hash_funcs);
+    const int first = std::max(0, (int)(load - spread));
+    double p_elements = PoissonProbability(load, first);
+    double p_unset = std::pow(keep, first);
+    double rate = 0;
+    for (int i = first; i <= load + spread; ++i) {
+        rate += p_elements * std::pow(1.0 - p_unset, hash_funcs);
+        p_elements *= load / (i + 1);
+        p_unset *= keep;
+    }
+    return rate;
+}
+
+/**
+ * False positive rate of a block with 0..max_elements elements: the chance
+ * that all hash_funcs entries of a key are among those set, given the
+ * distribution of the number of set entries.
+ */
+static std::vector<double> BlockFpRates(int max_elements, int hash_funcs, int block_entries)
+{
+    // Distribution of the number of set entries, and the chances that another
+    // entry is or is not one of them.
+    std::vector<double> set_entries(block_entries + 1), hit(block_entries + 1), miss(block_entries + 1), hit_all(block_entries + 1);
+    set_entries[0] = 1;
+    for (int x = 0; x <= block_entries; ++x) {
+        hit[x] = (double)x / block_entries;
+        miss[x] = 1 - hit[x];
+        hit_all[x] = std::pow(hit[x], hash_funcs);
+    }
+    std::vector<double> rates;
+    // Numbers of set entries below min_set have become negligible.
+    int min_set = 0, draws = 0;
+    for (int i = 0; i <= max_elements; ++i) {
+        rates.push_back(std::inner_product(set_entries.begin(), set_entries.end(), hit_all.begin(), 0.0));
+        for (int n = 0; n < hash_funcs; ++n, ++draws) {
+            for (int x = std::min(block_entries - 1, draws); x >= min_set; --x) {
+                set_entries[x + 1] += set_entries[x] * miss[x];
+                set_entries[x] *= hit[x];
+            }
+            while (min_set < block_entries && set_entries[min_set] < 1e-100) set_entries[min_set++] = 0;
+        }
+    }
+    return rates;
+}
+
+CBlockedRollingBloomFilter::CBlockedRollingBloomFilter(const unsigned int nElements, const double fpRate)
+{
+    const double logFpRate = log(fpRate);
+    const int std_hash_funcs = std::max(1, std::min((int)round(logFpRate / log(0.5)), 50));
+    m_entries_per_generation = (nElements + 1) / 2;
+    const double max_elements = m_entries_per_generation * 3.0;
+    /* A blocked filter needs at least as many entries as a CRollingBloomFilter
+     * (see there), and fewer hash functions. */
+    const double std_bits = ceil(-1.0 * std_hash_funcs * max_elements / log(1.0 - exp(logFpRate / std_hash_funcs)));
+    const uint64_t min_blocks = std::max<uint64_t>(1, ceil(std_bits / BLOCK_ENTRIES));
+    const double max_load = max_elements / min_blocks;
+
+    // Pick the number of hash functions that allows the highest load.
+    double best_load = 0;
+    m_hash_funcs = std_hash_funcs;
+    for (int hash_funcs = (std_hash_funcs + 1) / 2; hash_funcs <= std_hash_funcs; ++hash_funcs) {
+        double lo = 0, hi = max_load;
+        for (int i = 0; i < 16; ++i) {
+            const double mid = (lo + hi) / 2;
+            (ApproxBlockedFpRate(mid, hash_funcs, BLOCK_ENTRIES) <= fpRate ? lo : hi) = mid;
+        }
+        if (lo > best_load) {
+            best_load = lo;
+            m_hash_funcs = hash_funcs;
+        }
+    }
+
+    // Find the least number of blocks for which the exact rate does not exceed fpRate.
+    const int max_block_elements = max_load + 6 * std::sqrt(max_load) + 20;
+    const std::vector<double> block_fp_rates{BlockFpRates(max_block_elements, m_hash_funcs, BLOCK_ENTRIES)};
+    const auto fits = [&](uint64_t blocks) {
+        const double load = max_elements / blocks;
+        // Blocks with fewer or more elements than accounted for are counted as false positives.
+        double rate = 1;
+        const int first = std::max(0, (int)(load - 6 * std::sqrt(load) - 20));
+        double p_elements = PoissonProbability(load, first);
+        for (int i = first; i <= max_block_elements; ++i) {
+            rate -= p_elements * (1 - block_fp_rates[i]);
+            p_elements *= load / (i + 1);
+        }
+        return rate <= fpRate;
+    };
+    uint64_t lo = min_blocks, hi = best_load > 0 ? std::max<uint64_t>(min_blocks, max_elements / best_load) : min_blocks;
+    if (fits(lo)) {
+        hi = lo;
+    } else {
+        while (!fits(hi)) {
+            lo = hi;
+            hi = hi * 9 / 8 + 1;
+        }
+        while (hi - lo > 1) {
+            const uint64_t mid = lo + (hi - lo) / 2;
+            (fits(mid) ? hi : lo) = mid;
+        }
+    }
+    m_blocks.resize(hi);
+    reset();
+}
+
+static inline uint64_t SplitMix64(uint64_t& state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+    return z ^ (z >> 31);
+}
+
+size_t CBlockedRollingBloomFilter::Locate(Span<const unsigned char> vKey, uint64_t (&masks)[BLOCK_ENTRIES / 64]) const
+{
+    /* Two hashes select the block, and seed the generator of the entries
+     * within it, instead of hashing the key once per hash function. */
+    const uint32_t h1 = RollingBloomHash(0, m_tweak, vKey);
+    const uint32_t h2 = RollingBloomHash(1, m_tweak, vKey);
+    uint64_t state = (uint64_t{h1} << 32) | h2;
+    uint64_t bits = 0;
+    std::fill(std::begin(masks), std::end(masks), 0);
+    for (int n = 0; n < m_hash_funcs; n++) {
+        if (n % 8 == 0) bits = SplitMix64(state);
+        const uint8_t entry = bits & 0xFF;
+        bits >>= 8;
+        masks[entry >> 6] |= uint64_t{1} << (entry & 63);
+    }
+    return FastMod(h1, m_blocks.size());
+}
+
+void CBlockedRollingBloomFilter::insert(Span<const unsigned char> vKey)
+{
+    if (m_entries_this_generation == m_entries_per_generation) {
+        m_entries_this_generation = 0;
+        m_generation++;
+        if (m_generation == 4) {
+            m_generation = 1;
+        }
+        uint64_t nGenerationMask1 = 0 - (uint64_t)(m_generation & 1);
+        uint64_t nGenerationMask2 = 0 - (uint64_t)(m_generation >> 1);
+        /* Wipe old entries that used this generation number. */
+        for (Block& block : m_blocks) {
+            for (int p = 0; p < BLOCK_ENTRIES / 32; p += 2) {
+                uint64_t p1 = block.words[p], p2 = block.words[p + 1];
+                uint64_t mask = (p1 ^ nGenerationMask1) | (p2 ^ nGenerationMask2);
+                block.words[p] = p1 & mask;
+                block.words[p + 1] = p2 & mask;
+            }
+        }
+    }
+    m_entries_this_generation++;
+
+    uint64_t masks[BLOCK_ENTRIES / 64];
+    Block& block = m_blocks[Locate(vKey, masks)];
+    const uint64_t generation1 = 0 - (uint64_t)(m_generation & 1);
+    const uint64_t generation2 = 0 - (uint64_t)(m_generation >> 1);
+    for (int i = 0; i < BLOCK_ENTRIES / 64; i++) {
+        block.words[2 * i] = (block.words[2 * i] & ~masks[i]) | (generation1 & masks[i]);
+        block.words[2 * i + 1] = (block.words[2 * i + 1] & ~masks[i]) | (generation2 & masks[i]);
+    }
+}
+
+bool CBlockedRollingBloomFilter::contains(Span<const unsigned char> vKey) const
+{
+    uint64_t masks[BLOCK_ENTRIES / 64];
+    const Block& block = m_blocks[Locate(vKey, masks)];
+    /* vKey is contained if all its entries are set in either word of their pair. */
+    uint64_t missing = 0;
+    for (int i = 0; i < BLOCK_ENTRIES / 64; i++) {
+        missing |= masks[i] & ~(block.words[2 * i] | block.words[2 * i + 1]);
+    }
+    return missing == 0;
+}
+
+void CBlockedRollingBloomFilter::reset()
+{
+    m_tweak = GetRand(std::numeric_limits<unsigned int>::max());
+    m_entries_this_generation = 0;
+    m_generation = 1;
+    std::fill(m_blocks.begin(), m_blocks.end(), Block{});
+}
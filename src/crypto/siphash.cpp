@@ -171,3 +171,61 @@ uint64_t SipHashUint256Extra(uint64_t k0, uint64_t k1, const uint256& val, uint3
     SIPROUND;
     return v0 ^ v1 ^ v2 ^ v3;
 }
+
+/* SIPROUND on two independent states, interleaved to expose instruction level parallelism. */
+#define SIPROUND2 do { \
+    a0 += a1; b0 += b1; a1 = ROTL(a1, 13); b1 = ROTL(b1, 13); a1 ^= a0; b1 ^= b0; \
+    a0 = ROTL(a0, 32); b0 = ROTL(b0, 32); \
+    a2 += a3; b2 += b3; a3 = ROTL(a3, 16); b3 = ROTL(b3, 16); a3 ^= a2; b3 ^= b2; \
+    a0 += a3; b0 += b3; a3 = ROTL(a3, 21); b3 = ROTL(b3, 21); a3 ^= a0; b3 ^= b0; \
+    a2 += a1; b2 += b1; a1 = ROTL(a1, 17); b1 = ROTL(b1, 17); a1 ^= a2; b1 ^= b2; \
+    a2 = ROTL(a2, 32); b2 = ROTL(b2, 32); \
+} while (0)
+
+void SipHashUint256Batch(uint64_t k0, uint64_t k1, const uint256* const* vals, size_t count, uint64_t* out)
+{
+    size_t pos = 0;
+    for (; pos + 2 <= count; pos += 2) {
+        const uint256& val_a = *vals[pos];
+        const uint256& val_b = *vals[pos + 1];
+        uint64_t da = val_a.GetUint64(0);
+        uint64_t db = val_b.GetUint64(0);
+
+        uint64_t a0 = 0x736f6d6570736575ULL ^ k0, b0 = a0;
+        uint64_t a1 = 0x646f72616e646f6dULL ^ k1, b1 = a1;
+        uint64_t a2 = 0x6c7967656e657261ULL ^ k0, b2 = a2;
+        uint64_t a3 = 0x7465646279746573ULL ^ k1, b3 = a3;
+        a3 ^= da; b3 ^= db;
+
+        SIPROUND2;
+        SIPROUND2;
+        a0 ^= da; b0 ^= db;
+        da = val_a.GetUint64(1); db = val_b.GetUint64(1);
+        a3 ^= da; b3 ^= db;
+        SIPROUND2;
+        SIPROUND2;
+        a0 ^= da; b0 ^= db;
+        da = val_a.GetUint64(2); db = val_b.GetUint64(2);
+        a3 ^= da; b3 ^= db;
+        SIPROUND2;
+        SIPROUND2;
+        a0 ^= da; b0 ^= db;
+        da = val_a.GetUint64(3); db = val_b.GetUint64(3);
+        a3 ^= da; b3 ^= db;
+        SIPROUND2;
+        SIPROUND2;
+        a0 ^= da; b0 ^= db;
+        a3 ^= ((uint64_t)4) << 59; b3 ^= ((uint64_t)4) << 59;
+        SIPROUND2;
+        SIPROUND2;
+        a0 ^= ((uint64_t)4) << 59; b0 ^= ((uint64_t)4) << 59;
+        a2 ^= 0xFF; b2 ^= 0xFF;
+        SIPROUND2;
+        SIPROUND2;
+        SIPROUND2;
+        SIPROUND2;
+        out[pos] = a0 ^ a1 ^ a2 ^ a3;
+        out[pos + 1] = b0 ^ b1 ^ b2 ^ b3;
+    }
+    if (pos < count) out[pos] = SipHashUint256(k0, k1, *vals[pos]);
+}
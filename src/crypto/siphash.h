@@ -44,4 +44,12 @@ public:
 uint64_t SipHashUint256(uint64_t k0, uint64_t k1, const uint256& val);
 uint64_t SipHashUint256Extra(uint64_t k0, uint64_t k1, const uint256& val, uint32_t extra);
 
+/** SipHashUint256 of count values under the same key, writing the results to out.
+ *
+ *  Several hashes are computed interleaved, which lets the CPU overlap their
+ *  otherwise strictly sequential rounds. Worthwhile when hashing many values,
+ *  e.g. when matching a whole mempool against the short IDs of a compact block.
+ */
+void SipHashUint256Batch(uint64_t k0, uint64_t k1, const uint256* const* vals, size_t count, uint64_t* out);
+
 #endif // BITCOIN_CRYPTO_SIPHASH_H
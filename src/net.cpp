@@ -46,6 +46,10 @@
 #include <poll.h>
 #endif
 
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#endif
+
 #include <algorithm>
 #include <array>
 #include <cstdint>
@@ -102,6 +106,14 @@ enum BindFlags {
 // The sleep time needs to be small to avoid new sockets stalling
 static const uint64_t SELECT_TIMEOUT_MILLISECONDS = 50;
 
+#ifdef USE_EPOLL
+/** Maximum number of ready sockets reported by one epoll_wait() call. Any others are reported by the next one. */
+static constexpr int MAX_EPOLL_EVENTS{1024};
+#endif
+
+/** Maximum number of queued buffers passed to one sendmsg() call. Well below IOV_MAX. */
+static constexpr size_t MAX_SEND_IOVECS{64};
+
 const std::string NET_MESSAGE_COMMAND_OTHER = "*other*";
 
 static const uint64_t RANDOMIZER_ID_NETGROUP = 0x6c0edd8036ef4036ULL; // SHA256("netgroup")[0:8]
@@ -505,7 +517,7 @@ CNode* CConnman::ConnectNode(CAddress addrConnect, const char *pszDest, bool fCo
     if (!addr_bind.IsValid()) {
         addr_bind = GetBindAddress(sock->Get());
     }
-    CNode* pnode = new CNode(id, nLocalServices, sock->Release(), addrConnect, CalculateKeyedNetGroup(addrConnect), nonce, addr_bind, pszDest ? pszDest : "", conn_type, /* inbound_onion */ false);
+    CNode* pnode = new CNode(id, nLocalServices, sock->Release(), addrConnect, CalculateKeyedNetGroup(addrConnect), nonce, addr_bind, pszDest ? pszDest : "", conn_type, /* inbound_onion */ false, m_recv_buffer_pool);
     pnode->AddRef();
 
     // We're making a new connection, harvest entropy from the time (and our peer count)
@@ -526,9 +538,9 @@ void CNode::CloseSocketDisconnect()
 }
 
 void CConnman::AddWhitelistPermissionFlags(NetPermissionFlags& flags, const CNetAddr &addr) const {
-    for (const auto& subnet : vWhitelistedRange) {
-        if (subnet.m_subnet.Match(addr)) NetPermissions::AddFlag(flags, subnet.m_flags);
-    }
+    m_whitelisted_ranges.ForEachMatch(addr, [&](NetPermissionFlags subnet_flags) {
+        NetPermissions::AddFlag(flags, subnet_flags);
+    });
 }
 
 std::string ConnectionTypeAsString(ConnectionType conn_type)
@@ -610,7 +622,12 @@ void CNode::CopyStats(CNodeStats& stats)
         LOCK(cs_vRecv);
         X(mapRecvBytesPerMsgCmd);
         X(nRecvBytes);
+        const TransportDeserializer::BufferStats buffer_stats = m_deserializer->GetBufferStats();
+        stats.m_recv_buffer_bytes = buffer_stats.m_bytes;
+        stats.m_recv_pool_hits = buffer_stats.m_pool_hits;
+        stats.m_recv_pool_misses = buffer_stats.m_pool_misses;
     }
+    stats.m_recv_queue_bytes = WITH_LOCK(cs_vProcessMsg, return nProcessQueueSize);
     X(m_permissionFlags);
     if (m_tx_relay != nullptr) {
         stats.minFeeFilter = m_tx_relay->minFeeFilter;
@@ -708,6 +725,19 @@ int V1TransportDeserializer::readHeader(Span<const uint8_t> msg_bytes)
         return -1;
     }
 
+    // Take the payload buffer from the pool. The whole buffer is reserved up front,
+    // which is no more than the allocation ahead readData() does for larger messages.
+    if (m_recv_pool && RecvBufferPool::BufferSize(hdr.nMessageSize) > 0) {
+        if (m_recv_pool->Acquire(hdr.nMessageSize, vRecv)) {
+            ++m_pool_hits;
+        } else {
+            ++m_pool_misses;
+        }
+        vRecv.SetType(hdrbuf.GetType());
+        vRecv.SetVersion(hdrbuf.GetVersion());
+        m_recv_pooled = true;
+    }
+
     // switch state to reading message data
     in_data = true;
 
@@ -745,6 +775,7 @@ CNetMessage V1TransportDeserializer::GetMessage(const std::chrono::microseconds
     reject_message = false;
     // decompose a single CNetMessage from the TransportDeserializer
     CNetMessage msg(std::move(vRecv));
+    if (m_recv_pooled) msg.m_recv_pool = m_recv_pool;
 
     // store command string, time, and sizes
     msg.m_command = hdr.GetCommand();
@@ -776,12 +807,79 @@ CNetMessage V1TransportDeserializer::GetMessage(const std::chrono::microseconds
     return msg;
 }
 
+TransportDeserializer::BufferStats V1TransportDeserializer::GetBufferStats() const
+{
+    BufferStats stats;
+    if (in_data) {
+        stats.m_bytes = m_recv_pooled ? RecvBufferPool::BufferSize(hdr.nMessageSize) : vRecv.size();
+    }
+    stats.m_pool_hits = m_pool_hits;
+    stats.m_pool_misses = m_pool_misses;
+    return stats;
+}
+
+size_t RecvBufferPool::ClassIndex(size_t payload_size)
+{
+    size_t index = 0;
+    while ((MIN_CLASS_SIZE << (2 * index)) < payload_size) ++index;
+    return index;
+}
+
+size_t RecvBufferPool::BufferSize(size_t payload_size)
+{
+    if (payload_size > MAX_CLASS_SIZE) return 0;
+    return MIN_CLASS_SIZE << (2 * ClassIndex(payload_size));
+}
+
+bool RecvBufferPool::Acquire(size_t payload_size, CDataStream& buffer)
+{
+    const size_t index = ClassIndex(payload_size);
+    assert(index < NUM_CLASSES);
+    bool reused{false};
+    {
+        LOCK(m_mutex);
+        auto& free = m_free[index];
+        if (!free.empty()) {
+            buffer = std::move(free.back());
+            free.pop_back();
+            m_pooled_bytes -= BufferSize(payload_size);
+            reused = true;
+        }
+    }
+    if (!reused) buffer = CDataStream{buffer.GetType(), buffer.GetVersion()};
+    buffer.reserve(BufferSize(payload_size));
+    return reused;
+}
+
+void RecvBufferPool::Release(size_t payload_size, CDataStream&& buffer)
+{
+    const size_t index = ClassIndex(payload_size);
+    assert(index < NUM_CLASSES);
+    const size_t buffer_size = BufferSize(payload_size);
+    buffer.clear();
+    LOCK(m_mutex);
+    if (m_pooled_bytes + buffer_size > m_max_bytes) return;
+    m_pooled_bytes += buffer_size;
+    m_free[index].push_back(std::move(buffer));
+}
+
+size_t RecvBufferPool::GetPooledBytes() const
+{
+    LOCK(m_mutex);
+    return m_pooled_bytes;
+}
+
+CNetMessage::~CNetMessage()
+{
+    if (m_recv_pool) m_recv_pool->Release(m_message_size, std::move(m_recv));
+}
+
 void V1TransportSerializer::prepareForTransport(CSerializedNetMsg& msg, std::vector<unsigned char>& header) {
     // create dbl-sha256 checksum
-    uint256 hash = Hash(msg.data);
+    uint256 hash = Hash(msg.Payload());
 
     // create header
-    CMessageHeader hdr(Params().MessageStart(), msg.m_type.c_str(), msg.data.size());
+    CMessageHeader hdr(Params().MessageStart(), msg.m_type.c_str(), msg.Payload().size());
     memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
 
     // serialize header
@@ -789,33 +887,65 @@ void V1TransportSerializer::prepareForTransport(CSerializedNetMsg& msg, std::vec
     CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, header, 0, hdr};
 }
 
-size_t CConnman::SocketSendData(CNode& node) const
+size_t CConnman::SocketSendData(CNode& node)
 {
     auto it = node.vSendMsg.begin();
     size_t nSentSize = 0;
 
     while (it != node.vSendMsg.end()) {
-        const auto& data = *it;
-        assert(data.size() > node.nSendOffset);
-        int nBytes = 0;
+        assert(it->size() > node.nSendOffset);
+        size_t nToSend = 0;
+        ssize_t nBytes = 0;
+#ifdef WIN32
+        const Span<const unsigned char> data = it->Bytes().subspan(node.nSendOffset);
+        nToSend = data.size();
+#else
+        // Gather the queued buffers, starting with the unsent part of the first one
+        std::array<iovec, MAX_SEND_IOVECS> iov;
+        size_t iov_count = 0;
+        for (auto gather = it; gather != node.vSendMsg.end() && iov_count < iov.size(); ++gather) {
+            Span<const unsigned char> data = gather->Bytes();
+            if (gather == it) data = data.subspan(node.nSendOffset);
+            iov[iov_count].iov_base = const_cast<unsigned char*>(data.data());
+            iov[iov_count].iov_len = data.size();
+            nToSend += data.size();
+            ++iov_count;
+        }
+#endif
         {
             LOCK(node.cs_hSocket);
             if (node.hSocket == INVALID_SOCKET)
                 break;
-            nBytes = send(node.hSocket, reinterpret_cast<const char*>(data.data()) + node.nSendOffset, data.size() - node.nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+#ifdef WIN32
+            nBytes = send(node.hSocket, reinterpret_cast<const char*>(data.data()), data.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+#else
+            msghdr msg{};
+            msg.msg_iov = iov.data();
+            msg.msg_iovlen = iov_count;
+            nBytes = sendmsg(node.hSocket, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+#endif
         }
+        ++m_send_syscalls;
         if (nBytes > 0) {
             node.nLastSend = GetTimeSeconds();
             node.nSendBytes += nBytes;
-            node.nSendOffset += nBytes;
             nSentSize += nBytes;
-            if (node.nSendOffset == data.size()) {
+            // Skip over the buffers that were sent completely
+            size_t nRemaining = nBytes;
+            while (nRemaining > 0) {
+                const size_t nLeft = it->size() - node.nSendOffset;
+                if (nRemaining < nLeft) {
+                    node.nSendOffset += nRemaining;
+                    break;
+                }
+                nRemaining -= nLeft;
                 node.nSendOffset = 0;
-                node.nSendSize -= data.size();
-                node.fPauseSend = node.nSendSize > nSendBufferMaxSize;
+                node.nSendSize -= it->size();
                 it++;
-            } else {
-                // could not send full message; stop sending more
+            }
+            node.fPauseSend = node.nSendSize > nSendBufferMaxSize;
+            if (size_t(nBytes) < nToSend) {
+                // could not send everything; stop sending more
                 break;
             }
         } else {
@@ -1202,7 +1332,7 @@ void CConnman::CreateNodeFromAcceptedSocket(SOCKET hSocket,
     }
 
     const bool inbound_onion = std::find(m_onion_binds.begin(), m_onion_binds.end(), addr_bind) != m_onion_binds.end();
-    CNode* pnode = new CNode(id, nodeServices, hSocket, addr, CalculateKeyedNetGroup(addr), nonce, addr_bind, "", ConnectionType::INBOUND, inbound_onion);
+    CNode* pnode = new CNode(id, nodeServices, hSocket, addr, CalculateKeyedNetGroup(addr), nonce, addr_bind, "", ConnectionType::INBOUND, inbound_onion, m_recv_buffer_pool);
     pnode->AddRef();
     pnode->m_permissionFlags = permissionFlags;
     pnode->m_prefer_evict = discouraged;
@@ -1210,10 +1340,12 @@ void CConnman::CreateNodeFromAcceptedSocket(SOCKET hSocket,
 
     LogPrint(BCLog::NET, "connection from %s accepted\n", addr.ToString());
 
+    AssignSocketThread(*pnode);
     {
         LOCK(m_nodes_mutex);
         m_nodes.push_back(pnode);
     }
+    WakeSocketThread(*m_socket_threads[pnode->m_socket_thread]);
 
     // We received a new connection, harvest entropy from the time (and our peer count)
     RandAddEvent((uint32_t)id);
@@ -1276,6 +1408,7 @@ void CConnman::DisconnectNodes()
             {
                 // remove from m_nodes
                 m_nodes.erase(remove(m_nodes.begin(), m_nodes.end(), pnode), m_nodes.end());
+                --m_socket_threads[pnode->m_socket_thread]->m_num_nodes;
 
                 // release outbound grant (if any)
                 pnode->grantOutbound.Release();
@@ -1355,12 +1488,15 @@ bool CConnman::InactivityCheck(const CNode& node) const
 }
 
 bool CConnman::GenerateSelectSet(const std::vector<CNode*>& nodes,
+                                 bool select_listening,
                                  std::set<SOCKET>& recv_set,
                                  std::set<SOCKET>& send_set,
                                  std::set<SOCKET>& error_set)
 {
-    for (const ListenSocket& hListenSocket : vhListenSocket) {
-        recv_set.insert(hListenSocket.socket);
+    if (select_listening) {
+        for (const ListenSocket& hListenSocket : vhListenSocket) {
+            recv_set.insert(hListenSocket.socket);
+        }
     }
 
     for (CNode* pnode : nodes) {
@@ -1400,13 +1536,14 @@ bool CConnman::GenerateSelectSet(const std::vector<CNode*>& nodes,
 }
 
 #ifdef USE_POLL
-void CConnman::SocketEvents(const std::vector<CNode*>& nodes,
+void CConnman::SocketEvents(const SocketThread& thread,
+                            const std::vector<CNode*>& nodes,
                             std::set<SOCKET>& recv_set,
                             std::set<SOCKET>& send_set,
                             std::set<SOCKET>& error_set)
 {
     std::set<SOCKET> recv_select_set, send_select_set, error_select_set;
-    if (!GenerateSelectSet(nodes, recv_select_set, send_select_set, error_select_set)) {
+    if (!GenerateSelectSet(nodes, /*select_listening=*/thread.m_index == 0, recv_select_set, send_select_set, error_select_set)) {
         interruptNet.sleep_for(std::chrono::milliseconds(SELECT_TIMEOUT_MILLISECONDS));
         return;
     }
@@ -1445,13 +1582,14 @@ void CConnman::SocketEvents(const std::vector<CNode*>& nodes,
     }
 }
 #else
-void CConnman::SocketEvents(const std::vector<CNode*>& nodes,
+void CConnman::SocketEvents(const SocketThread& thread,
+                            const std::vector<CNode*>& nodes,
                             std::set<SOCKET>& recv_set,
                             std::set<SOCKET>& send_set,
                             std::set<SOCKET>& error_set)
 {
     std::set<SOCKET> recv_select_set, send_select_set, error_select_set;
-    if (!GenerateSelectSet(nodes, recv_select_set, send_select_set, error_select_set)) {
+    if (!GenerateSelectSet(nodes, /*select_listening=*/thread.m_index == 0, recv_select_set, send_select_set, error_select_set)) {
         interruptNet.sleep_for(std::chrono::milliseconds(SELECT_TIMEOUT_MILLISECONDS));
         return;
     }
@@ -1523,30 +1661,38 @@ void CConnman::SocketEvents(const std::vector<CNode*>& nodes,
 }
 #endif
 
-void CConnman::SocketHandler()
+void CConnman::SocketHandler(SocketThread& thread)
 {
+#ifdef USE_EPOLL
+    if (thread.m_epoll_fd != -1) {
+        SocketHandlerEpoll(thread);
+        return;
+    }
+#endif
+
     std::set<SOCKET> recv_set;
     std::set<SOCKET> send_set;
     std::set<SOCKET> error_set;
 
     {
-        const NodesSnapshot snap{*this, /*shuffle=*/false};
+        const NodesSnapshot snap{*this, thread};
 
         // Check for the readiness of the already connected sockets and the
         // listening sockets in one call ("readiness" as in poll(2) or
         // select(2)). If none are ready, wait for a short while and return
         // empty sets.
-        SocketEvents(snap.Nodes(), recv_set, send_set, error_set);
+        SocketEvents(thread, snap.Nodes(), recv_set, send_set, error_set);
 
         // Service (send/receive) each of the already connected nodes.
-        SocketHandlerConnected(snap.Nodes(), recv_set, send_set, error_set);
+        SocketHandlerConnected(thread, snap.Nodes(), recv_set, send_set, error_set);
     }
 
     // Accept new connections from listening sockets.
-    SocketHandlerListening(recv_set);
+    if (thread.m_index == 0) SocketHandlerListening(recv_set);
 }
 
-void CConnman::SocketHandlerConnected(const std::vector<CNode*>& nodes,
+void CConnman::SocketHandlerConnected(SocketThread& thread,
+                                      const std::vector<CNode*>& nodes,
                                       const std::set<SOCKET>& recv_set,
                                       const std::set<SOCKET>& send_set,
                                       const std::set<SOCKET>& error_set)
@@ -1555,9 +1701,6 @@ void CConnman::SocketHandlerConnected(const std::vector<CNode*>& nodes,
         if (interruptNet)
             return;
 
-        //
-        // Receive
-        //
         bool recvSet = false;
         bool sendSet = false;
         bool errorSet = false;
@@ -1569,70 +1712,81 @@ void CConnman::SocketHandlerConnected(const std::vector<CNode*>& nodes,
             sendSet = send_set.count(pnode->hSocket) > 0;
             errorSet = error_set.count(pnode->hSocket) > 0;
         }
-        if (recvSet || errorSet)
+        if (recvSet || sendSet || errorSet) ++thread.m_events;
+        SocketHandlerNode(thread, *pnode, recvSet, sendSet, errorSet);
+
+        if (InactivityCheck(*pnode)) pnode->fDisconnect = true;
+    }
+}
+
+void CConnman::SocketHandlerNode(SocketThread& thread, CNode& node, bool recv_ready, bool send_ready, bool error)
+{
+    //
+    // Receive
+    //
+    if (recv_ready || error)
+    {
+        // typical socket buffer is 8K-64K
+        uint8_t pchBuf[0x10000];
+        int nBytes = 0;
         {
-            // typical socket buffer is 8K-64K
-            uint8_t pchBuf[0x10000];
-            int nBytes = 0;
-            {
-                LOCK(pnode->cs_hSocket);
-                if (pnode->hSocket == INVALID_SOCKET)
-                    continue;
-                nBytes = recv(pnode->hSocket, (char*)pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
+            LOCK(node.cs_hSocket);
+            if (node.hSocket == INVALID_SOCKET)
+                return;
+            nBytes = recv(node.hSocket, (char*)pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
+        }
+        if (nBytes > 0)
+        {
+            bool notify = false;
+            if (!node.ReceiveMsgBytes({pchBuf, (size_t)nBytes}, notify)) {
+                node.CloseSocketDisconnect();
             }
-            if (nBytes > 0)
-            {
-                bool notify = false;
-                if (!pnode->ReceiveMsgBytes({pchBuf, (size_t)nBytes}, notify)) {
-                    pnode->CloseSocketDisconnect();
+            RecordBytesRecv(nBytes);
+            thread.m_bytes_recv += nBytes;
+            if (notify) {
+                size_t nSizeAdded = 0;
+                auto it(node.vRecvMsg.begin());
+                for (; it != node.vRecvMsg.end(); ++it) {
+                    // vRecvMsg contains only completed CNetMessage
+                    // the single possible partially deserialized message are held by TransportDeserializer
+                    nSizeAdded += it->m_raw_message_size;
                 }
-                RecordBytesRecv(nBytes);
-                if (notify) {
-                    size_t nSizeAdded = 0;
-                    auto it(pnode->vRecvMsg.begin());
-                    for (; it != pnode->vRecvMsg.end(); ++it) {
-                        // vRecvMsg contains only completed CNetMessage
-                        // the single possible partially deserialized message are held by TransportDeserializer
-                        nSizeAdded += it->m_raw_message_size;
-                    }
-                    {
-                        LOCK(pnode->cs_vProcessMsg);
-                        pnode->vProcessMsg.splice(pnode->vProcessMsg.end(), pnode->vRecvMsg, pnode->vRecvMsg.begin(), it);
-                        pnode->nProcessQueueSize += nSizeAdded;
-                        pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
-                    }
-                    WakeMessageHandler();
+                {
+                    LOCK(node.cs_vProcessMsg);
+                    node.vProcessMsg.splice(node.vProcessMsg.end(), node.vRecvMsg, node.vRecvMsg.begin(), it);
+                    node.nProcessQueueSize += nSizeAdded;
+                    node.fPauseRecv = node.nProcessQueueSize > nReceiveFloodSize;
                 }
+                WakeMessageHandler();
             }
-            else if (nBytes == 0)
-            {
-                // socket closed gracefully
-                if (!pnode->fDisconnect) {
-                    LogPrint(BCLog::NET, "socket closed for peer=%d\n", pnode->GetId());
-                }
-                pnode->CloseSocketDisconnect();
+        }
+        else if (nBytes == 0)
+        {
+            // socket closed gracefully
+            if (!node.fDisconnect) {
+                LogPrint(BCLog::NET, "socket closed for peer=%d\n", node.GetId());
             }
-            else if (nBytes < 0)
+            node.CloseSocketDisconnect();
+        }
+        else if (nBytes < 0)
+        {
+            // error
+            int nErr = WSAGetLastError();
+            if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
             {
-                // error
-                int nErr = WSAGetLastError();
-                if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
-                {
-                    if (!pnode->fDisconnect) {
-                        LogPrint(BCLog::NET, "socket recv error for peer=%d: %s\n", pnode->GetId(), NetworkErrorString(nErr));
-                    }
-                    pnode->CloseSocketDisconnect();
+                if (!node.fDisconnect) {
+                    LogPrint(BCLog::NET, "socket recv error for peer=%d: %s\n", node.GetId(), NetworkErrorString(nErr));
                 }
+                node.CloseSocketDisconnect();
             }
         }
+    }
 
-        if (sendSet) {
-            // Send data
-            size_t bytes_sent = WITH_LOCK(pnode->cs_vSend, return SocketSendData(*pnode));
-            if (bytes_sent) RecordBytesSent(bytes_sent);
-        }
-
-        if (InactivityCheck(*pnode)) pnode->fDisconnect = true;
+    if (send_ready) {
+        // Send data
+        size_t bytes_sent = WITH_LOCK(node.cs_vSend, return SocketSendData(node));
+        if (bytes_sent) RecordBytesSent(bytes_sent);
+        thread.m_bytes_sent += bytes_sent;
     }
 }
 
@@ -1648,14 +1802,170 @@ void CConnman::SocketHandlerListening(const std::set<SOCKET>& recv_set)
     }
 }
 
-void CConnman::ThreadSocketHandler()
+void CConnman::AssignSocketThread(CNode& node)
+{
+    const auto least_loaded = std::min_element(m_socket_threads.begin(), m_socket_threads.end(),
+        [](const auto& a, const auto& b) { return a->m_num_nodes < b->m_num_nodes; });
+    node.m_socket_thread = (*least_loaded)->m_index;
+    ++(*least_loaded)->m_num_nodes;
+}
+
+void CConnman::WakeSocketThread(SocketThread& thread)
+{
+#ifdef USE_EPOLL
+    if (thread.m_wakeup_pipe[1] != -1) {
+        const uint8_t byte{0};
+        if (write(thread.m_wakeup_pipe[1], &byte, 1) != 1) {
+            // The pipe is full, so a wakeup is already pending.
+        }
+    }
+#endif
+}
+
+#ifdef USE_EPOLL
+bool CConnman::InitEpoll(SocketThread& thread)
+{
+    thread.m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (thread.m_epoll_fd == -1) {
+        LogPrintf("epoll_create1() failed, using poll() instead: %s\n", NetworkErrorString(WSAGetLastError()));
+        return false;
+    }
+    if (pipe2(thread.m_wakeup_pipe, O_CLOEXEC | O_NONBLOCK) != 0) {
+        LogPrintf("pipe2() failed, using poll() instead: %s\n", NetworkErrorString(WSAGetLastError()));
+        CloseEpoll(thread);
+        return false;
+    }
+    struct epoll_event wakeup_event{};
+    wakeup_event.events = EPOLLIN;
+    wakeup_event.data.ptr = &thread;
+    if (epoll_ctl(thread.m_epoll_fd, EPOLL_CTL_ADD, thread.m_wakeup_pipe[0], &wakeup_event) != 0) {
+        LogPrintf("epoll_ctl() failed for the wakeup pipe, using poll() instead: %s\n", NetworkErrorString(WSAGetLastError()));
+        CloseEpoll(thread);
+        return false;
+    }
+    if (thread.m_index != 0) return true;
+    for (ListenSocket& listen_socket : vhListenSocket) {
+        struct epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.ptr = &listen_socket;
+        if (epoll_ctl(thread.m_epoll_fd, EPOLL_CTL_ADD, listen_socket.socket, &event) != 0) {
+            LogPrintf("epoll_ctl() failed for a listening socket, using poll() instead: %s\n", NetworkErrorString(WSAGetLastError()));
+            CloseEpoll(thread);
+            return false;
+        }
+    }
+    return true;
+}
+
+void CConnman::CloseEpoll(SocketThread& thread)
+{
+    for (int* fd : {&thread.m_epoll_fd, &thread.m_wakeup_pipe[0], &thread.m_wakeup_pipe[1]}) {
+        if (*fd != -1) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+void CConnman::UpdateEpollRegistrations(SocketThread& thread, const std::vector<CNode*>& nodes)
+{
+    for (CNode* pnode : nodes) {
+        // As in GenerateSelectSet(), drain the send buffer before receiving more.
+        // Errors are always reported, EPOLLERR is only set to tell a registered
+        // socket from one that isn't.
+        const bool select_send = WITH_LOCK(pnode->cs_vSend, return !pnode->vSendMsg.empty());
+        uint32_t events = EPOLLERR;
+        if (select_send) {
+            events |= EPOLLOUT;
+        } else if (!pnode->fPauseRecv) {
+            events |= EPOLLIN;
+        }
+        if (events == pnode->m_epoll_events) continue;
+
+        // Closing a socket removes it from the epoll set, so nothing needs to be done on
+        // disconnection.
+        LOCK(pnode->cs_hSocket);
+        if (pnode->hSocket == INVALID_SOCKET) continue;
+        struct epoll_event event{};
+        event.events = events;
+        event.data.ptr = pnode;
+        const int op = pnode->m_epoll_events == 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+        if (epoll_ctl(thread.m_epoll_fd, op, pnode->hSocket, &event) != 0) {
+            LogPrint(BCLog::NET, "epoll_ctl() failed for peer=%d: %s\n", pnode->GetId(), NetworkErrorString(WSAGetLastError()));
+            pnode->fDisconnect = true;
+            continue;
+        }
+        pnode->m_epoll_events = events;
+    }
+}
+
+void CConnman::SocketHandlerEpoll(SocketThread& thread)
+{
+    // Listening sockets are registered with a pointer into vhListenSocket, the wakeup
+    // pipe with a pointer to the thread and nodes with a pointer to the CNode.
+    const auto listen_socket = [this](const struct epoll_event& event) -> const ListenSocket* {
+        const auto* ptr = static_cast<const ListenSocket*>(event.data.ptr);
+        const std::less<const ListenSocket*> less;
+        if (vhListenSocket.empty() || less(ptr, vhListenSocket.data()) || !less(ptr, vhListenSocket.data() + vhListenSocket.size())) {
+            return nullptr;
+        }
+        return ptr;
+    };
+
+    std::array<struct epoll_event, MAX_EPOLL_EVENTS> events;
+    int num_events;
+    {
+        const NodesSnapshot snap{*this, thread};
+
+        UpdateEpollRegistrations(thread, snap.Nodes());
+
+        num_events = epoll_wait(thread.m_epoll_fd, events.data(), events.size(), SELECT_TIMEOUT_MILLISECONDS);
+        if (interruptNet) return;
+
+        // Only nodes from m_nodes are registered, and a node's socket is closed (which
+        // removes it from the epoll set) before it is removed from m_nodes, so all nodes
+        // reported here are kept alive by the snapshot.
+        for (int i = 0; i < num_events; ++i) {
+            if (interruptNet) return;
+            if (events[i].data.ptr == &thread) {
+                uint8_t buf[64];
+                while (read(thread.m_wakeup_pipe[0], buf, sizeof(buf)) > 0) {}
+                continue;
+            }
+            if (listen_socket(events[i])) continue;
+            ++thread.m_events;
+            const uint32_t ready = events[i].events;
+            SocketHandlerNode(thread, *static_cast<CNode*>(events[i].data.ptr), ready & EPOLLIN, ready & EPOLLOUT, ready & (EPOLLERR | EPOLLHUP));
+        }
+
+        for (CNode* pnode : snap.Nodes()) {
+            if (InactivityCheck(*pnode)) pnode->fDisconnect = true;
+        }
+    }
+
+    // Accept new connections from listening sockets.
+    for (int i = 0; i < num_events; ++i) {
+        if (interruptNet) return;
+        if (const ListenSocket* socket = listen_socket(events[i])) {
+            AcceptConnection(*socket);
+        }
+    }
+}
+#endif
+
+void CConnman::ThreadSocketHandler(SocketThread& thread)
 {
     SetSyscallSandboxPolicy(SyscallSandboxPolicy::NET);
     while (!interruptNet)
     {
-        DisconnectNodes();
-        NotifyNumConnectionsChanged();
-        SocketHandler();
+        // Nodes of all threads are disconnected by thread 0, so that m_nodes_disconnected
+        // is only used by one thread.
+        if (thread.m_index == 0) {
+            DisconnectNodes();
+            NotifyNumConnectionsChanged();
+        }
+        SocketHandler(thread);
+        ++thread.m_iterations;
     }
 }
 
@@ -2250,10 +2560,12 @@ void CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
         grantOutbound->MoveTo(pnode->grantOutbound);
 
     m_msgproc->InitializeNode(pnode);
+    AssignSocketThread(*pnode);
     {
         LOCK(m_nodes_mutex);
         m_nodes.push_back(pnode);
     }
+    WakeSocketThread(*m_socket_threads[pnode->m_socket_thread]);
 }
 
 void CConnman::ThreadMessageHandler()
@@ -2269,24 +2581,36 @@ void CConnman::ThreadMessageHandler()
             // consecutive connections in the m_nodes list.
             const NodesSnapshot snap{*this, /*shuffle=*/true};
 
-            for (CNode* pnode : snap.Nodes()) {
-                if (pnode->fDisconnect)
-                    continue;
+            if (m_msghand_workers.empty()) {
+                for (CNode* pnode : snap.Nodes()) {
+                    if (pnode->fDisconnect)
+                        continue;
 
-                // Receive messages
-                bool fMoreNodeWork = m_msgproc->ProcessMessages(pnode, flagInterruptMsgProc);
-                fMoreWork |= (fMoreNodeWork && !pnode->fPauseSend);
-                if (flagInterruptMsgProc)
-                    return;
-                // Send messages
+                    fMoreWork |= ProcessNodeMessages(*pnode);
+                    if (flagInterruptMsgProc)
+                        return;
+                }
+            } else {
+                // Hand the nodes out to all message handler threads. Nodes that are still
+                // being processed since an earlier iteration are skipped, so that a slow
+                // peer only holds up the thread processing it.
                 {
-                    LOCK(pnode->cs_sendProcessing);
-                    m_msgproc->SendMessages(pnode);
+                    LOCK(m_msghand_queue_mutex);
+                    for (CNode* pnode : snap.Nodes()) {
+                        if (pnode->fDisconnect || pnode->m_msgproc_busy.exchange(true))
+                            continue;
+                        pnode->AddRef();
+                        m_msghand_queue.push_back(pnode);
+                    }
                 }
+                m_msghand_queue_cond.notify_all();
 
+                fMoreWork |= ProcessMessageHandlerQueue();
                 if (flagInterruptMsgProc)
                     return;
             }
+
+            m_msgproc->ProcessDeferredWork();
         }
 
         WAIT_LOCK(mutexMsgProc, lock);
@@ -2297,6 +2621,52 @@ void CConnman::ThreadMessageHandler()
     }
 }
 
+void CConnman::ThreadMessageHandlerWorker()
+{
+    SetSyscallSandboxPolicy(SyscallSandboxPolicy::MESSAGE_HANDLER);
+    while (!flagInterruptMsgProc) {
+        {
+            WAIT_LOCK(m_msghand_queue_mutex, lock);
+            m_msghand_queue_cond.wait(lock, [this]() EXCLUSIVE_LOCKS_REQUIRED(m_msghand_queue_mutex) {
+                return flagInterruptMsgProc || !m_msghand_queue.empty();
+            });
+        }
+        if (ProcessMessageHandlerQueue()) WakeMessageHandler();
+    }
+}
+
+bool CConnman::ProcessNodeMessages(CNode& node)
+{
+    // Receive messages
+    const bool more_work = m_msgproc->ProcessMessages(&node, flagInterruptMsgProc) && !node.fPauseSend;
+    if (flagInterruptMsgProc)
+        return more_work;
+    // Send messages
+    {
+        LOCK(node.cs_sendProcessing);
+        m_msgproc->SendMessages(&node);
+    }
+    return more_work;
+}
+
+bool CConnman::ProcessMessageHandlerQueue()
+{
+    bool more_work = false;
+    while (!flagInterruptMsgProc) {
+        CNode* pnode;
+        {
+            LOCK(m_msghand_queue_mutex);
+            if (m_msghand_queue.empty()) break;
+            pnode = m_msghand_queue.front();
+            m_msghand_queue.pop_front();
+        }
+        more_work |= ProcessNodeMessages(*pnode);
+        pnode->m_msgproc_busy = false;
+        pnode->Release();
+    }
+    return more_work;
+}
+
 void CConnman::ThreadI2PAcceptIncoming()
 {
     static constexpr auto err_wait_begin = 1s;
@@ -2584,7 +2954,15 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
     }
 
     // Send and receive from sockets, accept connections
-    threadSocketHandler = std::thread(&util::TraceThread, "net", [this] { ThreadSocketHandler(); });
+    for (const auto& thread : m_socket_threads) {
+#ifdef USE_EPOLL
+        InitEpoll(*thread);
+#endif
+        const std::string thread_name{thread->m_index == 0 ? "net" : strprintf("net.%d", thread->m_index)};
+        thread->m_thread = std::thread([this, &thread = *thread, thread_name] {
+            util::TraceThread(thread_name.c_str(), [&] { ThreadSocketHandler(thread); });
+        });
+    }
 
     if (!gArgs.GetBoolArg("-dnsseed", DEFAULT_DNSSEED))
         LogPrintf("DNS seeding disabled\n");
@@ -2610,6 +2988,11 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
 
     // Process messages
     threadMessageHandler = std::thread(&util::TraceThread, "msghand", [this] { ThreadMessageHandler(); });
+    for (int i = 1; i < m_num_msghand_threads; ++i) {
+        m_msghand_workers.emplace_back([this, i] {
+            util::TraceThread(strprintf("msghand.%d", i).c_str(), [this] { ThreadMessageHandlerWorker(); });
+        });
+    }
 
     if (connOptions.m_i2p_accept_incoming && m_i2p_sam_session.get() != nullptr) {
         threadI2PAcceptIncoming =
@@ -2644,8 +3027,16 @@ void CConnman::Interrupt()
         flagInterruptMsgProc = true;
     }
     condMsgProc.notify_all();
+    {
+        // Synchronize with message handler workers that are about to wait.
+        LOCK(m_msghand_queue_mutex);
+    }
+    m_msghand_queue_cond.notify_all();
 
     interruptNet();
+    for (const auto& thread : m_socket_threads) {
+        WakeSocketThread(*thread);
+    }
     InterruptSocks5(true);
 
     if (semOutbound) {
@@ -2668,14 +3059,28 @@ void CConnman::StopThreads()
     }
     if (threadMessageHandler.joinable())
         threadMessageHandler.join();
+    for (std::thread& worker : m_msghand_workers) {
+        worker.join();
+    }
+    m_msghand_workers.clear();
+    {
+        // Release the nodes that were handed out but not processed before the interrupt.
+        LOCK(m_msghand_queue_mutex);
+        for (CNode* pnode : m_msghand_queue) {
+            pnode->m_msgproc_busy = false;
+            pnode->Release();
+        }
+        m_msghand_queue.clear();
+    }
     if (threadOpenConnections.joinable())
         threadOpenConnections.join();
     if (threadOpenAddedConnections.joinable())
         threadOpenAddedConnections.join();
     if (threadDNSAddressSeed.joinable())
         threadDNSAddressSeed.join();
-    if (threadSocketHandler.joinable())
-        threadSocketHandler.join();
+    for (const auto& thread : m_socket_threads) {
+        if (thread->m_thread.joinable()) thread->m_thread.join();
+    }
 }
 
 void CConnman::StopNodes()
@@ -2711,6 +3116,13 @@ void CConnman::StopNodes()
         }
     }
 
+    for (const auto& thread : m_socket_threads) {
+#ifdef USE_EPOLL
+        CloseEpoll(*thread);
+#endif
+        thread->m_num_nodes = 0;
+    }
+
     for (CNode* pnode : m_nodes_disconnected) {
         DeleteNode(pnode);
     }
@@ -2752,6 +3164,7 @@ std::vector<CAddress> CConnman::GetAddresses(CNode& requestor, size_t max_addres
         .Write(local_socket_bytes.data(), local_socket_bytes.size())
         .Finalize();
     const auto current_time = GetTime<std::chrono::microseconds>();
+    LOCK(m_addr_response_caches_mutex);
     auto r = m_addr_response_caches.emplace(cache_id, CachedAddrResponse{});
     CachedAddrResponse& cache_entry = r.first->second;
     if (cache_entry.m_cache_entry_expiration < current_time) { // If emplace() added new one it has expiration 0.
@@ -2966,6 +3379,21 @@ uint64_t CConnman::GetTotalBytesSent() const
     return nTotalBytesSent;
 }
 
+CConnman::SendStats CConnman::GetSendStats() const
+{
+    return {m_send_syscalls.load(), m_send_bytes_copied.load(), m_send_bytes_shared.load()};
+}
+
+std::vector<CConnman::SocketThreadStats> CConnman::GetSocketThreadStats() const
+{
+    std::vector<SocketThreadStats> stats;
+    stats.reserve(m_socket_threads.size());
+    for (const auto& thread : m_socket_threads) {
+        stats.push_back({thread->m_num_nodes, thread->m_iterations, thread->m_events, thread->m_bytes_recv, thread->m_bytes_sent});
+    }
+    return stats;
+}
+
 ServiceFlags CConnman::GetLocalServices() const
 {
     return nLocalServices;
@@ -2973,7 +3401,7 @@ ServiceFlags CConnman::GetLocalServices() const
 
 unsigned int CConnman::GetReceiveFloodSize() const { return nReceiveFloodSize; }
 
-CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, SOCKET hSocketIn, const CAddress& addrIn, uint64_t nKeyedNetGroupIn, uint64_t nLocalHostNonceIn, const CAddress& addrBindIn, const std::string& addrNameIn, ConnectionType conn_type_in, bool inbound_onion)
+CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, SOCKET hSocketIn, const CAddress& addrIn, uint64_t nKeyedNetGroupIn, uint64_t nLocalHostNonceIn, const CAddress& addrBindIn, const std::string& addrNameIn, ConnectionType conn_type_in, bool inbound_onion, std::shared_ptr<RecvBufferPool> recv_buffer_pool)
     : nTimeConnected(GetTimeSeconds()),
       addr(addrIn),
       addrBind(addrBindIn),
@@ -3001,7 +3429,7 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, SOCKET hSocketIn, const
         LogPrint(BCLog::NET, "Added connection peer=%d\n", id);
     }
 
-    m_deserializer = std::make_unique<V1TransportDeserializer>(V1TransportDeserializer(Params(), id, SER_NETWORK, INIT_PROTO_VERSION));
+    m_deserializer = std::make_unique<V1TransportDeserializer>(Params(), id, SER_NETWORK, INIT_PROTO_VERSION, std::move(recv_buffer_pool));
     m_serializer = std::make_unique<V1TransportSerializer>(V1TransportSerializer());
 }
 
@@ -3017,10 +3445,11 @@ bool CConnman::NodeFullyConnected(const CNode* pnode)
 
 void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
 {
-    size_t nMessageSize = msg.data.size();
+    const Span<const unsigned char> payload = msg.Payload();
+    size_t nMessageSize = payload.size();
     LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n", msg.m_type, nMessageSize, pnode->GetId());
     if (gArgs.GetBoolArg("-capturemessages", false)) {
-        CaptureMessage(pnode->addr, msg.m_type, msg.data, /*is_incoming=*/false);
+        CaptureMessage(pnode->addr, msg.m_type, payload, /*is_incoming=*/false);
     }
 
     TRACE6(net, outbound_message,
@@ -3028,8 +3457,8 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
         pnode->m_addr_name.c_str(),
         pnode->ConnectionTypeAsString().c_str(),
         msg.m_type.c_str(),
-        msg.data.size(),
-        msg.data.data()
+        payload.size(),
+        payload.data()
     );
 
     // make sure we use the appropriate network transport format
@@ -3037,7 +3466,14 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
     pnode->m_serializer->prepareForTransport(msg, serializedHeader);
     size_t nTotalSize = nMessageSize + serializedHeader.size();
 
+    if (msg.m_shared_data) {
+        m_send_bytes_shared += nMessageSize;
+    } else {
+        m_send_bytes_copied += nMessageSize;
+    }
+
     size_t nBytesSent = 0;
+    bool wake_socket_thread = false;
     {
         LOCK(pnode->cs_vSend);
         bool optimisticSend(pnode->vSendMsg.empty());
@@ -3047,13 +3483,23 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
         pnode->nSendSize += nTotalSize;
 
         if (pnode->nSendSize > nSendBufferMaxSize) pnode->fPauseSend = true;
-        pnode->vSendMsg.push_back(std::move(serializedHeader));
-        if (nMessageSize) pnode->vSendMsg.push_back(std::move(msg.data));
+        pnode->vSendMsg.emplace_back(std::move(serializedHeader));
+        if (nMessageSize) {
+            if (msg.m_shared_data) {
+                pnode->vSendMsg.emplace_back(std::move(msg.m_shared_data));
+            } else {
+                pnode->vSendMsg.emplace_back(std::move(msg.data));
+            }
+        }
 
         // If write queue empty, attempt "optimistic write"
         if (optimisticSend) nBytesSent = SocketSendData(*pnode);
+        // If that did not send everything, let the socket handler thread start waiting
+        // for the socket to become writable.
+        wake_socket_thread = optimisticSend && !pnode->vSendMsg.empty();
     }
     if (nBytesSent) RecordBytesSent(nBytesSent);
+    if (wake_socket_thread) WakeSocketThread(*m_socket_threads[pnode->m_socket_thread]);
 }
 
 bool CConnman::ForNode(NodeId id, std::function<bool(CNode* pnode)> func)
@@ -21,11 +21,13 @@
 #include <random.h>
 #include <span.h>
 #include <streams.h>
+#include <subnettrie.h>
 #include <sync.h>
 #include <threadinterrupt.h>
 #include <uint256.h>
 #include <util/check.h>
 
+#include <array>
 #include <atomic>
 #include <condition_variable>
 #include <cstdint>
@@ -75,6 +77,14 @@ static const std::string DEFAULT_MAX_UPLOAD_TARGET{"0M"};
 static const bool DEFAULT_BLOCKSONLY = false;
 /** -peertimeout default */
 static const int64_t DEFAULT_PEER_CONNECT_TIMEOUT = 60;
+/** -socketthreads default */
+static const int DEFAULT_SOCKET_THREADS = 1;
+/** Maximum number of socket handler threads */
+static const int MAX_SOCKET_THREADS = 16;
+/** -msghandthreads default */
+static const int DEFAULT_MSGHAND_THREADS = 1;
+/** Maximum number of message handler threads */
+static const int MAX_MSGHAND_THREADS = 16;
 /** Number of file descriptors required for message capture **/
 static const int NUM_FDS_MESSAGE_CAPTURE = 1;
 
@@ -106,10 +116,60 @@ struct CSerializedNetMsg
     CSerializedNetMsg(const CSerializedNetMsg& msg) = delete;
     CSerializedNetMsg& operator=(const CSerializedNetMsg&) = delete;
 
+    /** Return a copy of this message. A shared payload is referenced, not copied. */
+    CSerializedNetMsg Copy() const
+    {
+        CSerializedNetMsg copy;
+        copy.data = data;
+        copy.m_shared_data = m_shared_data;
+        copy.m_type = m_type;
+        return copy;
+    }
+
+    /** Move the payload into an immutable buffer that copies of this message share,
+     *  so it can be queued for many peers without serializing or copying it again. */
+    CSerializedNetMsg& Share()
+    {
+        if (!m_shared_data) {
+            m_shared_data = std::make_shared<const std::vector<unsigned char>>(std::move(data));
+            data.clear();
+        }
+        return *this;
+    }
+
+    /** The payload, either data or the shared buffer. */
+    Span<const unsigned char> Payload() const
+    {
+        if (m_shared_data) return *m_shared_data;
+        return data;
+    }
+
     std::vector<unsigned char> data;
+    /** If set, the payload is this buffer and data is empty. */
+    std::shared_ptr<const std::vector<unsigned char>> m_shared_data;
     std::string m_type;
 };
 
+/** A buffer queued for sending to a peer. It either owns its bytes or references a
+ *  payload buffer shared with other peers' send queues. */
+class SendBuffer
+{
+public:
+    explicit SendBuffer(std::vector<unsigned char>&& data) : m_data{std::move(data)} {}
+    explicit SendBuffer(std::shared_ptr<const std::vector<unsigned char>> shared_data) : m_shared_data{std::move(shared_data)} {}
+
+    Span<const unsigned char> Bytes() const
+    {
+        if (m_shared_data) return *m_shared_data;
+        return m_data;
+    }
+    size_t size() const { return Bytes().size(); }
+
+private:
+    std::vector<unsigned char> m_data;
+    std::shared_ptr<const std::vector<unsigned char>> m_shared_data;
+};
+
 /** Different types of connections to a peer. This enum encapsulates the
  * information we have available at the time of opening or accepting the
  * connection. Aside from INBOUND, all types are initiated by us.
@@ -272,6 +332,49 @@ public:
     Network m_network;
     uint32_t m_mapped_as;
     ConnectionType m_conn_type;
+    // Bytes allocated for the payload of the message being received
+    size_t m_recv_buffer_bytes;
+    // Bytes of received messages waiting to be processed
+    size_t m_recv_queue_bytes;
+    // Payload buffers taken from the receive buffer pool, and allocated because none was available
+    uint64_t m_recv_pool_hits;
+    uint64_t m_recv_pool_misses;
+};
+
+/** Pool of payload buffers for received messages, shared by all peers. Message
+ *  payloads are small and short-lived, so instead of allocating a buffer for every
+ *  one, buffers are kept in size classes and reused for later messages of a
+ *  similar size. Payloads larger than the largest class are not pooled.
+ */
+class RecvBufferPool
+{
+public:
+    /** Capacity of the smallest size class. Each next class is four times as large. */
+    static constexpr size_t MIN_CLASS_SIZE{256};
+    static constexpr size_t NUM_CLASSES{6};
+    static constexpr size_t MAX_CLASS_SIZE{MIN_CLASS_SIZE << (2 * (NUM_CLASSES - 1))};
+
+    /** max_bytes is the total capacity of the idle buffers kept in the pool. */
+    explicit RecvBufferPool(size_t max_bytes) : m_max_bytes{max_bytes} {}
+
+    /** Capacity of the buffer used for a payload of the given size, 0 if not pooled. */
+    static size_t BufferSize(size_t payload_size);
+
+    /** Get a buffer for a pooled payload size. Returns whether it was reused from the pool. */
+    bool Acquire(size_t payload_size, CDataStream& buffer) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    /** Give back the buffer of a pooled payload size. It is freed if the pool is full. */
+    void Release(size_t payload_size, CDataStream&& buffer) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Total capacity of the idle buffers in the pool. */
+    size_t GetPooledBytes() const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+private:
+    static size_t ClassIndex(size_t payload_size);
+
+    const size_t m_max_bytes;
+    mutable Mutex m_mutex;
+    std::array<std::vector<CDataStream>, NUM_CLASSES> m_free GUARDED_BY(m_mutex);
+    size_t m_pooled_bytes GUARDED_BY(m_mutex){0};
 };
 
 
@@ -286,8 +389,13 @@ public:
     uint32_t m_message_size{0};          //!< size of the payload
     uint32_t m_raw_message_size{0};      //!< used wire size of the message (including header/checksum)
     std::string m_command;
+    /** Pool that m_recv is given back to when the message is destroyed, if any */
+    std::shared_ptr<RecvBufferPool> m_recv_pool;
 
     CNetMessage(CDataStream&& recv_in) : m_recv(std::move(recv_in)) {}
+    CNetMessage(CNetMessage&&) = default;
+    CNetMessage& operator=(CNetMessage&&) = default;
+    ~CNetMessage();
 
     void SetVersion(int nVersionIn)
     {
@@ -309,6 +417,13 @@ public:
     virtual int Read(Span<const uint8_t>& msg_bytes) = 0;
     // decomposes a message from the context
     virtual CNetMessage GetMessage(std::chrono::microseconds time, bool& reject_message) = 0;
+    struct BufferStats {
+        size_t m_bytes{0};       //!< bytes allocated for the payload of the message being received
+        uint64_t m_pool_hits{0}; //!< payload buffers reused from a RecvBufferPool
+        uint64_t m_pool_misses{0};
+    };
+    // statistics about the payload buffers
+    virtual BufferStats GetBufferStats() const = 0;
     virtual ~TransportDeserializer() {}
 };
 
@@ -325,6 +440,12 @@ private:
     CDataStream vRecv;              // received message data
     unsigned int nHdrPos;
     unsigned int nDataPos;
+    /** Pool to take payload buffers from, if any */
+    const std::shared_ptr<RecvBufferPool> m_recv_pool;
+    /** Whether vRecv was taken from m_recv_pool */
+    bool m_recv_pooled{false};
+    uint64_t m_pool_hits{0};
+    uint64_t m_pool_misses{0};
 
     const uint256& GetMessageHash() const;
     int readHeader(Span<const uint8_t> msg_bytes);
@@ -339,14 +460,17 @@ private:
         nDataPos = 0;
         data_hash.SetNull();
         hasher.Reset();
+        m_recv_pooled = false;
     }
 
 public:
-    V1TransportDeserializer(const CChainParams& chain_params, const NodeId node_id, int nTypeIn, int nVersionIn)
+    V1TransportDeserializer(const CChainParams& chain_params, const NodeId node_id, int nTypeIn, int nVersionIn,
+                            std::shared_ptr<RecvBufferPool> recv_pool = nullptr)
         : m_chain_params(chain_params),
           m_node_id(node_id),
           hdrbuf(nTypeIn, nVersionIn),
-          vRecv(nTypeIn, nVersionIn)
+          vRecv(nTypeIn, nVersionIn),
+          m_recv_pool(std::move(recv_pool))
     {
         Reset();
     }
@@ -373,6 +497,7 @@ public:
         return ret;
     }
     CNetMessage GetMessage(std::chrono::microseconds time, bool& reject_message) override;
+    BufferStats GetBufferStats() const override;
 };
 
 /** The TransportSerializer prepares messages for the network transport
@@ -402,12 +527,20 @@ public:
     NetPermissionFlags m_permissionFlags{NetPermissionFlags::None};
     std::atomic<ServiceFlags> nServices{NODE_NONE};
     SOCKET hSocket GUARDED_BY(cs_hSocket);
+    /** Index of the socket handler thread servicing this node. Set before the node is
+     *  added to CConnman::m_nodes and constant afterwards. */
+    size_t m_socket_thread{0};
+#ifdef USE_EPOLL
+    /** Events hSocket is registered for in its socket handler thread's epoll set, 0 if
+     *  not registered yet. Only used by that thread. */
+    uint32_t m_epoll_events{0};
+#endif
     /** Total size of all vSendMsg entries */
     size_t nSendSize GUARDED_BY(cs_vSend){0};
     /** Offset inside the first vSendMsg already sent */
     size_t nSendOffset GUARDED_BY(cs_vSend){0};
     uint64_t nSendBytes GUARDED_BY(cs_vSend){0};
-    std::deque<std::vector<unsigned char>> vSendMsg GUARDED_BY(cs_vSend);
+    std::deque<SendBuffer> vSendMsg GUARDED_BY(cs_vSend);
     Mutex cs_vSend;
     Mutex cs_hSocket;
     Mutex cs_vRecv;
@@ -456,6 +589,9 @@ public:
     const uint64_t nKeyedNetGroup;
     std::atomic_bool fPauseRecv{false};
     std::atomic_bool fPauseSend{false};
+    /** Whether a message handler thread is processing this node. A node is only
+     *  processed by one thread at a time, so that its messages are handled in order. */
+    std::atomic_bool m_msgproc_busy{false};
 
     bool IsOutboundOrBlockRelayConn() const {
         switch (m_conn_type) {
@@ -539,9 +675,13 @@ public:
 
         mutable RecursiveMutex cs_tx_inventory;
         CRollingBloomFilter filterInventoryKnown GUARDED_BY(cs_tx_inventory){50000, 0.000001};
-        // Set of transaction ids we still have to announce.
+        // Set of transaction ids we still have to announce to this peer only, on top
+        // of those relayed to all peers (see TxRelayQueue).
         // They are sorted by the mempool before relay, so the order is not important.
         std::set<uint256> setInventoryTxToSend;
+        // Transactions in setInventoryTxToSend that reconciliation found the peer
+        // is missing, to be announced instead of being reconciled again (BIP330).
+        std::set<uint256> m_recon_announce GUARDED_BY(cs_tx_inventory);
         // Used for BIP35 mempool sending
         bool fSendMempool GUARDED_BY(cs_tx_inventory){false};
         // Last time a "MEMPOOL" request was serviced.
@@ -577,7 +717,7 @@ public:
      * criterium in CConnman::AttemptToEvictConnection. */
     std::atomic<std::chrono::microseconds> m_min_ping_time{std::chrono::microseconds::max()};
 
-    CNode(NodeId id, ServiceFlags nLocalServicesIn, SOCKET hSocketIn, const CAddress& addrIn, uint64_t nKeyedNetGroupIn, uint64_t nLocalHostNonceIn, const CAddress& addrBindIn, const std::string& addrNameIn, ConnectionType conn_type_in, bool inbound_onion);
+    CNode(NodeId id, ServiceFlags nLocalServicesIn, SOCKET hSocketIn, const CAddress& addrIn, uint64_t nKeyedNetGroupIn, uint64_t nLocalHostNonceIn, const CAddress& addrBindIn, const std::string& addrNameIn, ConnectionType conn_type_in, bool inbound_onion, std::shared_ptr<RecvBufferPool> recv_buffer_pool = nullptr);
     ~CNode();
     CNode(const CNode&) = delete;
     CNode& operator=(const CNode&) = delete;
@@ -728,6 +868,12 @@ public:
     */
     virtual bool SendMessages(CNode* pnode) EXCLUSIVE_LOCKS_REQUIRED(pnode->cs_sendProcessing) = 0;
 
+    /**
+    * Finish work that was deferred while processing messages, so that it can be
+    * done once for messages from several peers. Called after every pass over all
+    * peers, while the nodes processed in that pass are still referenced.
+    */
+    virtual void ProcessDeferredWork() = 0;
 
 protected:
     /**
@@ -756,6 +902,8 @@ public:
         unsigned int nReceiveFloodSize = 0;
         uint64_t nMaxOutboundLimit = 0;
         int64_t m_peer_connect_timeout = DEFAULT_PEER_CONNECT_TIMEOUT;
+        int m_num_socket_threads = DEFAULT_SOCKET_THREADS;
+        int m_num_msghand_threads = DEFAULT_MSGHAND_THREADS;
         std::vector<std::string> vSeedNodes;
         std::vector<NetWhitelistPermissions> vWhitelistedRange;
         std::vector<NetWhitebindPermissions> vWhiteBinds;
@@ -784,12 +932,25 @@ public:
         m_msgproc = connOptions.m_msgproc;
         nSendBufferMaxSize = connOptions.nSendBufferMaxSize;
         nReceiveFloodSize = connOptions.nReceiveFloodSize;
+        m_recv_buffer_pool = std::make_shared<RecvBufferPool>(nReceiveFloodSize);
         m_peer_connect_timeout = connOptions.m_peer_connect_timeout;
+        m_num_msghand_threads = std::max(connOptions.m_num_msghand_threads, 1);
+        m_socket_threads.clear();
+        for (int i = 0; i < std::max(connOptions.m_num_socket_threads, 1); ++i) {
+            m_socket_threads.push_back(std::make_unique<SocketThread>(i));
+        }
         {
             LOCK(cs_totalBytesSent);
             nMaxOutboundLimit = connOptions.nMaxOutboundLimit;
         }
-        vWhitelistedRange = connOptions.vWhitelistedRange;
+        m_whitelisted_ranges.Clear();
+        for (const NetWhitelistPermissions& subnet : connOptions.vWhitelistedRange) {
+            if (NetPermissionFlags* flags = m_whitelisted_ranges.Find(subnet.m_subnet)) {
+                NetPermissions::AddFlag(*flags, subnet.m_flags);
+            } else {
+                m_whitelisted_ranges.Insert(subnet.m_subnet, subnet.m_flags);
+            }
+        }
         {
             LOCK(m_added_nodes_mutex);
             m_added_nodes = connOptions.m_added_nodes;
@@ -928,6 +1089,27 @@ public:
     uint64_t GetTotalBytesRecv() const;
     uint64_t GetTotalBytesSent() const;
 
+    /** Statistics of the send path. */
+    struct SendStats {
+        /** Number of send system calls */
+        uint64_t m_syscalls;
+        /** Payload bytes serialized into a buffer for a single peer */
+        uint64_t m_bytes_copied;
+        /** Payload bytes queued by reference to a buffer shared between peers */
+        uint64_t m_bytes_shared;
+    };
+    SendStats GetSendStats() const;
+
+    /** Load statistics of one socket handler thread. */
+    struct SocketThreadStats {
+        size_t m_num_nodes;
+        uint64_t m_iterations;
+        uint64_t m_events;
+        uint64_t m_bytes_recv;
+        uint64_t m_bytes_sent;
+    };
+    std::vector<SocketThreadStats> GetSocketThreadStats() const;
+
     /** Get a unique deterministic randomizer. */
     CSipHasher GetDeterministicRandomizer(uint64_t id) const;
 
@@ -963,6 +1145,18 @@ private:
     void ProcessAddrFetch();
     void ThreadOpenConnections(std::vector<std::string> connect);
     void ThreadMessageHandler();
+    /** Process nodes handed out by ThreadMessageHandler() (-msghandthreads > 1). */
+    void ThreadMessageHandlerWorker();
+    /**
+     * Process a node's next message and send it messages.
+     * @return true if the node has more messages to process
+     */
+    bool ProcessNodeMessages(CNode& node);
+    /**
+     * Process nodes from m_msghand_queue until it is empty, then run the deferred work.
+     * @return true if one of the nodes has more messages to process
+     */
+    bool ProcessMessageHandlerQueue();
     void ThreadI2PAcceptIncoming();
     void AcceptConnection(const ListenSocket& hListenSocket);
 
@@ -979,6 +1173,38 @@ private:
                                       const CAddress& addr_bind,
                                       const CAddress& addr);
 
+    /**
+     * State of one socket handler thread. Nodes are distributed over the threads when
+     * they are created, and each thread only services the sockets of its own nodes.
+     * Thread 0 additionally accepts incoming connections and disconnects nodes.
+     */
+    struct SocketThread {
+        explicit SocketThread(size_t index) : m_index{index} {}
+
+        const size_t m_index;
+        std::thread m_thread;
+#ifdef USE_EPOLL
+        /** Persistent epoll set of this thread's sockets, -1 if not used. */
+        int m_epoll_fd{-1};
+        /** Pipe whose read end is in m_epoll_fd, written to by WakeSocketThread(). */
+        int m_wakeup_pipe[2]{-1, -1};
+#endif
+        std::atomic<size_t> m_num_nodes{0};
+        std::atomic<uint64_t> m_iterations{0};
+        std::atomic<uint64_t> m_events{0};
+        std::atomic<uint64_t> m_bytes_recv{0};
+        std::atomic<uint64_t> m_bytes_sent{0};
+    };
+
+    /**
+     * Assign a node that is about to be added to `m_nodes` to the socket handler
+     * thread with the fewest nodes.
+     */
+    void AssignSocketThread(CNode& node);
+
+    /** Make a socket handler thread return from waiting for socket events. */
+    void WakeSocketThread(SocketThread& thread);
+
     void DisconnectNodes();
     void NotifyNumConnectionsChanged();
     /** Return true if the peer is inactive and should be disconnected. */
@@ -987,54 +1213,99 @@ private:
     /**
      * Generate a collection of sockets to check for IO readiness.
      * @param[in] nodes Select from these nodes' sockets.
+     * @param[in] select_listening Whether to also select the listening sockets.
      * @param[out] recv_set Sockets to check for read readiness.
      * @param[out] send_set Sockets to check for write readiness.
      * @param[out] error_set Sockets to check for errors.
      * @return true if at least one socket is to be checked (the returned set is not empty)
      */
     bool GenerateSelectSet(const std::vector<CNode*>& nodes,
+                           bool select_listening,
                            std::set<SOCKET>& recv_set,
                            std::set<SOCKET>& send_set,
                            std::set<SOCKET>& error_set);
 
     /**
      * Check which sockets are ready for IO.
+     * @param[in] thread The calling socket handler thread. Only thread 0 selects the listening sockets.
      * @param[in] nodes Select from these nodes' sockets.
      * @param[out] recv_set Sockets which are ready for read.
      * @param[out] send_set Sockets which are ready for write.
      * @param[out] error_set Sockets which have errors.
      * This calls `GenerateSelectSet()` to gather a list of sockets to check.
      */
-    void SocketEvents(const std::vector<CNode*>& nodes,
+    void SocketEvents(const SocketThread& thread,
+                      const std::vector<CNode*>& nodes,
                       std::set<SOCKET>& recv_set,
                       std::set<SOCKET>& send_set,
                       std::set<SOCKET>& error_set);
 
     /**
      * Check connected and listening sockets for IO readiness and process them accordingly.
+     * @param[in] thread The calling socket handler thread. Only its nodes are processed.
      */
-    void SocketHandler();
+    void SocketHandler(SocketThread& thread);
 
     /**
      * Do the read/write for connected sockets that are ready for IO.
+     * @param[in] thread The calling socket handler thread.
      * @param[in] nodes Nodes to process. The socket of each node is checked against
      * `recv_set`, `send_set` and `error_set`.
      * @param[in] recv_set Sockets that are ready for read.
      * @param[in] send_set Sockets that are ready for send.
      * @param[in] error_set Sockets that have an exceptional condition (error).
      */
-    void SocketHandlerConnected(const std::vector<CNode*>& nodes,
+    void SocketHandlerConnected(SocketThread& thread,
+                                const std::vector<CNode*>& nodes,
                                 const std::set<SOCKET>& recv_set,
                                 const std::set<SOCKET>& send_set,
                                 const std::set<SOCKET>& error_set);
 
+    /**
+     * Do the read/write for one connected socket.
+     * @param[in] thread The calling socket handler thread.
+     * @param[in] node Node to process.
+     * @param[in] recv_ready Whether the node's socket is ready for read.
+     * @param[in] send_ready Whether the node's socket is ready for send.
+     * @param[in] error Whether the node's socket has an exceptional condition (error).
+     */
+    void SocketHandlerNode(SocketThread& thread, CNode& node, bool recv_ready, bool send_ready, bool error);
+
     /**
      * Accept incoming connections, one from each read-ready listening socket.
      * @param[in] recv_set Sockets that are ready for read.
      */
     void SocketHandlerListening(const std::set<SOCKET>& recv_set);
 
-    void ThreadSocketHandler();
+#ifdef USE_EPOLL
+    /**
+     * Create the thread's epoll set and wakeup pipe, and register the listening sockets
+     * with thread 0's set.
+     * @return false if epoll is unavailable, in which case SocketHandler() keeps using SocketEvents().
+     */
+    bool InitEpoll(SocketThread& thread);
+
+    /** Close the thread's epoll set and wakeup pipe. */
+    void CloseEpoll(SocketThread& thread);
+
+    /**
+     * Register new nodes' sockets with the thread's epoll set, and update the events a
+     * socket is registered for when its node's send buffer or receive pause state
+     * changed. The events follow the same policy as GenerateSelectSet().
+     * @param[in] thread The calling socket handler thread.
+     * @param[in] nodes Nodes whose sockets should be registered.
+     */
+    void UpdateEpollRegistrations(SocketThread& thread, const std::vector<CNode*>& nodes);
+
+    /**
+     * Counterpart of SocketHandler() using the thread's epoll set: only the sockets that
+     * are ready are reported by the kernel, so there is no per-iteration set of all
+     * sockets to build, poll and search.
+     */
+    void SocketHandlerEpoll(SocketThread& thread);
+#endif
+
+    void ThreadSocketHandler(SocketThread& thread);
     void ThreadDNSAddressSeed();
 
     uint64_t CalculateKeyedNetGroup(const CAddress& ad) const;
@@ -1058,7 +1329,9 @@ private:
 
     NodeId GetNewNodeId();
 
-    size_t SocketSendData(CNode& node) const EXCLUSIVE_LOCKS_REQUIRED(node.cs_vSend);
+    /** Send as much of the node's send queue as the socket accepts, gathering the
+     *  queued buffers into as few system calls as possible. */
+    size_t SocketSendData(CNode& node) EXCLUSIVE_LOCKS_REQUIRED(node.cs_vSend);
     void DumpAddresses();
 
     // Network stats
@@ -1077,6 +1350,9 @@ private:
     mutable RecursiveMutex cs_totalBytesSent;
     std::atomic<uint64_t> nTotalBytesRecv{0};
     uint64_t nTotalBytesSent GUARDED_BY(cs_totalBytesSent) {0};
+    std::atomic<uint64_t> m_send_syscalls{0};
+    std::atomic<uint64_t> m_send_bytes_copied{0};
+    std::atomic<uint64_t> m_send_bytes_shared{0};
 
     // outbound limit & stats
     uint64_t nMaxOutboundTotalBytesSentInCycle GUARDED_BY(cs_totalBytesSent) {0};
@@ -1088,12 +1364,18 @@ private:
 
     // Whitelisted ranges. Any node connecting from these is automatically
     // whitelisted (as well as those connecting to whitelisted binds).
-    std::vector<NetWhitelistPermissions> vWhitelistedRange;
+    // The permissions of ranges given more than once are combined.
+    SubNetTrie<NetPermissionFlags> m_whitelisted_ranges;
 
     unsigned int nSendBufferMaxSize{0};
     unsigned int nReceiveFloodSize{0};
+    /** Payload buffers for received messages, shared by all nodes. Idle buffers are
+     *  limited to nReceiveFloodSize bytes, the receive buffer of a single peer. */
+    std::shared_ptr<RecvBufferPool> m_recv_buffer_pool;
 
     std::vector<ListenSocket> vhListenSocket;
+    /** Socket handler threads, at least one. Only resized by Init(). */
+    std::vector<std::unique_ptr<SocketThread>> m_socket_threads;
     std::atomic<bool> fNetworkActive{true};
     bool fAddressesInitialized{false};
     AddrMan& addrman;
@@ -1132,7 +1414,8 @@ private:
      * resulting in at most ~196 KB. Every separate local socket may
      * add up to ~196 KB extra.
      */
-    std::map<uint64_t, CachedAddrResponse> m_addr_response_caches;
+    std::map<uint64_t, CachedAddrResponse> m_addr_response_caches GUARDED_BY(m_addr_response_caches_mutex);
+    Mutex m_addr_response_caches_mutex;
 
     /**
      * Services this instance offers.
@@ -1184,6 +1467,17 @@ private:
     Mutex mutexMsgProc;
     std::atomic<bool> flagInterruptMsgProc{false};
 
+    /** Total number of message handler threads, including threadMessageHandler. */
+    int m_num_msghand_threads{DEFAULT_MSGHAND_THREADS};
+    /**
+     * Nodes handed out by ThreadMessageHandler() to be processed by any message handler
+     * thread. Each node holds a reference and has m_msgproc_busy set while it is queued
+     * or being processed.
+     */
+    std::deque<CNode*> m_msghand_queue GUARDED_BY(m_msghand_queue_mutex);
+    Mutex m_msghand_queue_mutex;
+    std::condition_variable m_msghand_queue_cond;
+
     /**
      * This is signaled when network activity should cease.
      * A pointer to it is saved in `m_i2p_sam_session`, so make sure that
@@ -1199,10 +1493,10 @@ private:
     std::unique_ptr<i2p::sam::Session> m_i2p_sam_session;
 
     std::thread threadDNSAddressSeed;
-    std::thread threadSocketHandler;
     std::thread threadOpenAddedConnections;
     std::thread threadOpenConnections;
     std::thread threadMessageHandler;
+    std::vector<std::thread> m_msghand_workers;
     std::thread threadI2PAcceptIncoming;
 
     /** flag for deciding to connect to an extra outbound peer,
@@ -1245,6 +1539,18 @@ private:
             }
         }
 
+        /** Snapshot of the nodes serviced by one socket handler thread. */
+        NodesSnapshot(const CConnman& connman, const SocketThread& thread)
+        {
+            LOCK(connman.m_nodes_mutex);
+            for (CNode* node : connman.m_nodes) {
+                if (node->m_socket_thread == thread.m_index) {
+                    node->AddRef();
+                    m_nodes_copy.push_back(node);
+                }
+            }
+        }
+
         ~NodesSnapshot()
         {
             for (auto& node : m_nodes_copy) {
@@ -18,7 +18,12 @@
 #include <merkleblock.h>
 #include <netbase.h>
 #include <netmessagemaker.h>
+#include <node/blockcache.h>
+#include <node/blockdownload.h>
 #include <node/blockstorage.h>
+#include <node/headerssync.h>
+#include <node/txreconciliation.h>
+#include <node/txrelayqueue.h>
 #include <policy/fees.h>
 #include <policy/policy.h>
 #include <primitives/block.h>
@@ -99,9 +104,6 @@ static const unsigned int MAX_GETDATA_SZ = 1000;
 static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
 /** Time during which a peer must stall block download progress before being disconnected. */
 static constexpr auto BLOCK_STALLING_TIMEOUT = 2s;
-/** Number of headers sent in one getheaders result. We rely on the assumption that if a peer sends
- *  less than this number, we reached its tip. Changing this value is a protocol upgrade. */
-static const unsigned int MAX_HEADERS_RESULTS = 2000;
 /** Maximum depth of blocks we're willing to serve as compact blocks to peers
  *  when requested. For older blocks, a regular BLOCK response will be sent. */
 static const int MAX_CMPCTBLOCK_DEPTH = 5;
@@ -164,6 +166,9 @@ static constexpr double MAX_ADDR_RATE_PER_SECOND{0.1};
  *  based increments won't go above this, but the MAX_ADDR_TO_SEND increment following GETADDR
  *  is exempt from this limit). */
 static constexpr size_t MAX_ADDR_PROCESSING_TOKEN_BUCKET{MAX_ADDR_TO_SEND};
+/** Maximum number of transactions received from peers that are validated together. Below this,
+ *  transactions are batched for one pass of the message handler over all peers. */
+static constexpr size_t MAX_TX_BATCH_SIZE{100};
 
 // Internal stuff
 namespace {
@@ -173,6 +178,8 @@ struct QueuedBlock {
     const CBlockIndex* pindex;
     /** Optional, used for CMPCTBLOCK downloads */
     std::unique_ptr<PartiallyDownloadedBlock> partialBlock;
+    /** When the block was requested */
+    std::chrono::microseconds m_requested_time;
 };
 
 /**
@@ -224,8 +231,11 @@ struct Peer {
     /** Whether a ping has been requested by the user */
     std::atomic<bool> m_ping_queued{false};
 
+    /** Protects m_addrs_to_send and m_addr_known, which other peers' message handler
+     *  threads access when relaying addresses to this peer. */
+    Mutex m_addr_relay_mutex;
     /** A vector of addresses to send to the peer, limited to MAX_ADDR_TO_SEND. */
-    std::vector<CAddress> m_addrs_to_send;
+    std::vector<CAddress> m_addrs_to_send GUARDED_BY(m_addr_relay_mutex);
     /** Probabilistic filter to track recent addr messages relayed with this
      *  peer. Used to avoid relaying redundant addresses to this peer.
      *
@@ -235,7 +245,7 @@ struct Peer {
      *
      *  Presence of this filter must correlate with m_addr_relay_enabled.
      **/
-    std::unique_ptr<CRollingBloomFilter> m_addr_known;
+    std::unique_ptr<CRollingBloomFilter> m_addr_known GUARDED_BY(m_addr_relay_mutex);
     /** Whether we are participating in address relay with this connection.
      *
      *  We set this bool to true for outbound peers (other than
@@ -308,11 +318,13 @@ public:
     void FinalizeNode(const CNode& node) override;
     bool ProcessMessages(CNode* pfrom, std::atomic<bool>& interrupt) override;
     bool SendMessages(CNode* pto) override EXCLUSIVE_LOCKS_REQUIRED(pto->cs_sendProcessing);
+    void ProcessDeferredWork() override;
 
     /** Implement PeerManager */
     void StartScheduledTasks(CScheduler& scheduler) override;
     void CheckForStaleTipAndEvictPeers() override;
     bool GetNodeStateStats(NodeId nodeid, CNodeStateStats& stats) const override;
+    BlockCache::Stats GetBlockCacheStats() const override { return m_block_cache.GetStats(); }
     bool IgnoresIncomingTxs() override { return m_ignore_incoming_txs; }
     void SendPings() override;
     void RelayTransaction(const uint256& txid, const uint256& wtxid) override;
@@ -325,6 +337,9 @@ private:
     void _RelayTransaction(const uint256& txid, const uint256& wtxid)
         EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+    /** Announce transactions to a peer that reconciliation found it is missing, with the next inventory. */
+    void AnnounceReconciledTxs(CNode& node, const std::vector<uint256>& wtxids);
+
     /** Consider evicting an outbound peer based on the amount of time they've been behind our tip */
     void ConsiderEviction(CNode& pto, int64_t time_in_seconds) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
@@ -371,6 +386,16 @@ private:
     bool MaybeDiscourageAndDisconnect(CNode& pnode, Peer& peer);
 
     void ProcessOrphanTx(std::set<uint256>& orphan_work_set) EXCLUSIVE_LOCKS_REQUIRED(cs_main, g_cs_orphans);
+
+    /** Relay, orphan or reject a transaction received from a peer, and punish the peer if
+     *  needed, according to the result of its mempool validation. */
+    void ProcessTxResult(CNode& pfrom, Peer& peer, const CTransactionRef& ptx, const MempoolAcceptResult& result)
+        EXCLUSIVE_LOCKS_REQUIRED(cs_main, g_cs_orphans);
+
+    /** Validate all transactions in m_tx_batch with a single mempool acceptance call, then
+     *  handle the result of each one as if it had been validated on receipt. */
+    void ProcessTxBatch() EXCLUSIVE_LOCKS_REQUIRED(cs_main, g_cs_orphans);
+
     /** Process a single headers message from a peer. */
     void ProcessHeadersMessage(CNode& pfrom, const Peer& peer,
                                const std::vector<CBlockHeader>& headers,
@@ -416,6 +441,10 @@ private:
     ChainstateManager& m_chainman;
     CTxMemPool& m_mempool;
     TxRequestTracker m_txrequest GUARDED_BY(::cs_main);
+    /** Reconciliation state of peers we relay transactions to by BIP330; nullptr if disabled */
+    std::unique_ptr<TxReconciliationTracker> m_txreconciliation;
+    /** Transactions to announce to all peers we relay transactions to */
+    TxRelayQueue m_tx_relay_queue;
 
     /** The height of the best chain */
     std::atomic<int> m_best_height{-1};
@@ -444,6 +473,15 @@ private:
     /** Number of nodes with fSyncStarted. */
     int nSyncStarted GUARDED_BY(cs_main) = 0;
 
+    /** Headers between checkpoints, fetched from other peers than those with fSyncStarted */
+    HeadersSyncScheduler m_headers_sync GUARDED_BY(cs_main);
+
+    /** Handle headers that a peer sent for a range of m_headers_sync. Returns false if they are not for one. */
+    bool ProcessHeadersRange(CNode& pfrom, const std::vector<CBlockHeader>& headers);
+
+    /** Add the headers of m_headers_sync ranges that connect to the block index. */
+    void ConnectHeadersRanges();
+
     /**
      * Sources of received blocks, saved to be able punish them when processing
      * happens afterwards.
@@ -492,9 +530,9 @@ private:
      * communicating with txid-relay peers or if we were to otherwise fetch a
      * transaction via txid (eg in our orphan handling).
      *
-     * Memory used: 1.3 MB
+     * Memory used: 2.2 MB
      */
-    CRollingBloomFilter m_recent_rejects GUARDED_BY(::cs_main){120'000, 0.000'001};
+    CBlockedRollingBloomFilter m_recent_rejects GUARDED_BY(::cs_main){120'000, 0.000'001};
     uint256 hashRecentRejectsChainTip GUARDED_BY(cs_main);
 
     /*
@@ -539,6 +577,9 @@ private:
 
     std::map<uint256, std::pair<NodeId, std::list<QueuedBlock>::iterator> > mapBlocksInFlight GUARDED_BY(cs_main);
 
+    /** Download speed of peers, which decides how many blocks to request from each */
+    BlockDownloadScheduler m_block_download GUARDED_BY(cs_main);
+
     /** When our tip was last updated. */
     std::atomic<int64_t> m_last_tip_update{0};
 
@@ -573,6 +614,18 @@ private:
     /** Storage for orphan information */
     TxOrphanage m_orphanage;
 
+    /** A transaction received from a peer, waiting to be validated with the rest of its batch. */
+    struct PendingTx {
+        /** The peer that sent the transaction. FinalizeNode() drops its entries before the CNode
+         *  can be destroyed. */
+        CNode* node;
+        PeerRef peer;
+        CTransactionRef tx;
+    };
+
+    /** Transactions received since the last ProcessTxBatch(), in order of receipt. */
+    std::vector<PendingTx> m_tx_batch GUARDED_BY(cs_main);
+
     void AddToCompactExtraTransactions(const CTransactionRef& tx) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans);
 
     /** Orphan/conflicted/etc transactions that are kept for compact block reconstruction.
@@ -598,6 +651,20 @@ private:
     bool AlreadyHaveBlock(const uint256& block_hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     void ProcessGetBlockData(CNode& pfrom, Peer& peer, const CInv& inv);
 
+    /** Blocks recently served to peers, in the forms they were sent in */
+    BlockCache m_block_cache;
+
+    /**
+     * Get a block to serve to a peer, in one of its forms, from m_block_cache.
+     * If it is not cached, take it from recent_block if that is the requested
+     * block, or else read it from disk at pindex, and add it to the cache.
+     */
+    std::shared_ptr<const CBlock> GetBlockToServe(const uint256& hash, const CBlockIndex* pindex, const std::shared_ptr<const CBlock>& recent_block);
+    BlockCache::SerializedBlock GetSerializedBlockToServe(const uint256& hash, const CBlockIndex* pindex, bool witness, const std::shared_ptr<const CBlock>& recent_block);
+    std::shared_ptr<const CBlockHeaderAndShortTxIDs> GetCompactBlockToServe(const uint256& hash, const CBlockIndex* pindex, bool use_wtxid, const std::shared_ptr<const CBlock>& recent_block);
+    /** Add a block that is not in m_block_cache, from recent_block or disk. */
+    std::shared_ptr<const CBlock> LoadBlockToServe(const uint256& hash, const CBlockIndex* pindex, const std::shared_ptr<const CBlock>& recent_block);
+
     /**
      * Validation logic for compact filters request handling.
      *
@@ -757,7 +824,7 @@ struct CNodeState {
     const bool m_is_inbound;
 
     //! A rolling bloom filter of all announced tx CInvs to this peer.
-    CRollingBloomFilter m_recently_announced_invs = CRollingBloomFilter{INVENTORY_MAX_RECENT_RELAY, 0.000001};
+    CBlockedRollingBloomFilter m_recently_announced_invs = CBlockedRollingBloomFilter{INVENTORY_MAX_RECENT_RELAY, 0.000001};
 
     //! Whether this peer relays txs via wtxid
     bool m_wtxid_relay{false};
@@ -785,13 +852,13 @@ static bool IsAddrCompatible(const Peer& peer, const CAddress& addr)
     return peer.m_wants_addrv2 || addr.IsAddrV1Compatible();
 }
 
-static void AddAddressKnown(Peer& peer, const CAddress& addr)
+static void AddAddressKnown(Peer& peer, const CAddress& addr) EXCLUSIVE_LOCKS_REQUIRED(peer.m_addr_relay_mutex)
 {
     assert(peer.m_addr_known);
     peer.m_addr_known->insert(addr.GetKey());
 }
 
-static void PushAddress(Peer& peer, const CAddress& addr, FastRandomContext& insecure_rand)
+static void PushAddress(Peer& peer, const CAddress& addr, FastRandomContext& insecure_rand) EXCLUSIVE_LOCKS_REQUIRED(peer.m_addr_relay_mutex)
 {
     // Known checking here is only to save space from duplicates.
     // Before sending, we'll filter it again for known addresses that were
@@ -868,7 +935,7 @@ bool PeerManagerImpl::BlockRequested(NodeId nodeid, const CBlockIndex& block, st
     RemoveBlockRequest(hash);
 
     std::list<QueuedBlock>::iterator it = state->vBlocksInFlight.insert(state->vBlocksInFlight.end(),
-            {&block, std::unique_ptr<PartiallyDownloadedBlock>(pit ? new PartiallyDownloadedBlock(&m_mempool) : nullptr)});
+            {&block, std::unique_ptr<PartiallyDownloadedBlock>(pit ? new PartiallyDownloadedBlock(&m_mempool) : nullptr), GetTime<std::chrono::microseconds>()});
     state->nBlocksInFlight++;
     if (state->nBlocksInFlight == 1) {
         // We're starting a block download (batch) from this peer.
@@ -1165,6 +1232,7 @@ void PeerManagerImpl::InitializeNode(CNode *pnode)
         LOCK(m_peer_mutex);
         m_peer_map.emplace_hint(m_peer_map.end(), nodeid, std::move(peer));
     }
+    if (pnode->m_tx_relay != nullptr) m_tx_relay_queue.RegisterPeer(nodeid);
     if (!pnode->IsInboundConn()) {
         PushNodeVersion(*pnode, GetTime());
     }
@@ -1217,7 +1285,14 @@ void PeerManagerImpl::FinalizeNode(const CNode& node)
         mapBlocksInFlight.erase(entry.pindex->GetBlockHash());
     }
     WITH_LOCK(g_cs_orphans, m_orphanage.EraseForPeer(nodeid));
+    m_tx_batch.erase(std::remove_if(m_tx_batch.begin(), m_tx_batch.end(),
+                                    [nodeid](const PendingTx& pending) { return pending.node->GetId() == nodeid; }),
+                     m_tx_batch.end());
     m_txrequest.DisconnectedPeer(nodeid);
+    m_block_download.ForgetPeer(nodeid);
+    m_headers_sync.ForgetPeer(nodeid);
+    if (m_txreconciliation) m_txreconciliation->ForgetPeer(nodeid);
+    m_tx_relay_queue.ForgetPeer(nodeid);
     nPreferredDownload -= state->fPreferredDownload;
     m_peers_downloading_from -= (state->nBlocksInFlight != 0);
     assert(m_peers_downloading_from >= 0);
@@ -1237,6 +1312,7 @@ void PeerManagerImpl::FinalizeNode(const CNode& node)
         assert(m_wtxid_relay_peers == 0);
         assert(m_txrequest.Size() == 0);
         assert(m_orphanage.Size() == 0);
+        assert(m_tx_batch.empty());
     }
     } // cs_main
     if (node.fSuccessfullyConnected && misbehavior == 0 &&
@@ -1443,8 +1519,13 @@ PeerManagerImpl::PeerManagerImpl(const CChainParams& chainparams, CConnman& conn
       m_banman(banman),
       m_chainman(chainman),
       m_mempool(pool),
-      m_ignore_incoming_txs(ignore_incoming_txs)
+      m_ignore_incoming_txs(ignore_incoming_txs),
+      m_headers_sync(chainparams.Checkpoints().mapCheckpoints),
+      m_block_cache(std::max<int64_t>(0, gArgs.GetIntArg("-blockservecache", DEFAULT_BLOCK_SERVE_CACHE)) << 20)
 {
+    if (gArgs.GetBoolArg("-txreconciliation", DEFAULT_TXRECONCILIATION_ENABLE)) {
+        m_txreconciliation = std::make_unique<TxReconciliationTracker>(TXRECONCILIATION_VERSION);
+    }
 }
 
 void PeerManagerImpl::StartScheduledTasks(CScheduler& scheduler)
@@ -1461,16 +1542,33 @@ void PeerManagerImpl::StartScheduledTasks(CScheduler& scheduler)
     scheduler.scheduleFromNow([&] { ReattemptInitialBroadcast(scheduler); }, delta);
 }
 
+// All of the following cache a recent block, and are protected by cs_most_recent_block
+static RecursiveMutex cs_most_recent_block;
+static std::shared_ptr<const CBlock> most_recent_block GUARDED_BY(cs_most_recent_block);
+static std::shared_ptr<const CBlockHeaderAndShortTxIDs> most_recent_compact_block GUARDED_BY(cs_most_recent_block);
+/** most_recent_compact_block serialized with witnesses, shared by all peers it is sent to */
+static CSerializedNetMsg most_recent_compact_block_msg GUARDED_BY(cs_most_recent_block);
+static uint256 most_recent_block_hash GUARDED_BY(cs_most_recent_block);
+static bool fWitnessesPresentInMostRecentCompactBlock GUARDED_BY(cs_most_recent_block);
+/** Whether most_recent_block was connected to the active chain */
+static bool most_recent_block_connected GUARDED_BY(cs_most_recent_block){false};
+
 /**
  * Evict orphan txn pool entries based on a newly connected
  * block, remember the recently confirmed transactions, and delete tracked
- * announcements for them. Also save the time of the last tip update.
+ * announcements for them. Also save the time of the last tip update, and
+ * whether the most recent block was connected.
  */
 void PeerManagerImpl::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex)
 {
     m_orphanage.EraseForBlock(*pblock);
     m_last_tip_update = GetTime();
 
+    {
+        LOCK(cs_most_recent_block);
+        if (most_recent_block_hash == pblock->GetHash()) most_recent_block_connected = true;
+    }
+
     {
         LOCK(m_recent_confirmed_transactions_mutex);
         for (const auto& ptx : pblock->vtx) {
@@ -1503,13 +1601,6 @@ void PeerManagerImpl::BlockDisconnected(const std::shared_ptr<const CBlock> &blo
     m_recent_confirmed_transactions.reset();
 }
 
-// All of the following cache a recent block, and are protected by cs_most_recent_block
-static RecursiveMutex cs_most_recent_block;
-static std::shared_ptr<const CBlock> most_recent_block GUARDED_BY(cs_most_recent_block);
-static std::shared_ptr<const CBlockHeaderAndShortTxIDs> most_recent_compact_block GUARDED_BY(cs_most_recent_block);
-static uint256 most_recent_block_hash GUARDED_BY(cs_most_recent_block);
-static bool fWitnessesPresentInMostRecentCompactBlock GUARDED_BY(cs_most_recent_block);
-
 /**
  * Maintain state about the best-seen block and fast-announce a compact block
  * to compatible peers.
@@ -1518,6 +1609,9 @@ void PeerManagerImpl::NewPoWValidBlock(const CBlockIndex *pindex, const std::sha
 {
     std::shared_ptr<const CBlockHeaderAndShortTxIDs> pcmpctblock = std::make_shared<const CBlockHeaderAndShortTxIDs> (*pblock, true);
     const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
+    // Serialize the compact block once; every peer's send queue references the same buffer
+    CSerializedNetMsg cmpctblock_msg = msgMaker.Make(NetMsgType::CMPCTBLOCK, *pcmpctblock);
+    cmpctblock_msg.Share();
 
     LOCK(cs_main);
 
@@ -1534,13 +1628,17 @@ void PeerManagerImpl::NewPoWValidBlock(const CBlockIndex *pindex, const std::sha
         most_recent_block_hash = hashBlock;
         most_recent_block = pblock;
         most_recent_compact_block = pcmpctblock;
+        most_recent_compact_block_msg = cmpctblock_msg.Copy();
         fWitnessesPresentInMostRecentCompactBlock = fWitnessEnabled;
+        most_recent_block_connected = false;
     }
+    // Peers that do not take the compact block announcement will fetch the block shortly
+    m_block_cache.Insert(pblock);
+    m_block_cache.InsertCompactBlock(hashBlock, /*use_wtxid=*/true, pcmpctblock);
 
-    m_connman.ForEachNode([this, &pcmpctblock, pindex, &msgMaker, fWitnessEnabled, &hashBlock](CNode* pnode) EXCLUSIVE_LOCKS_REQUIRED(::cs_main) {
+    m_connman.ForEachNode([this, &cmpctblock_msg, pindex, fWitnessEnabled, &hashBlock](CNode* pnode) EXCLUSIVE_LOCKS_REQUIRED(::cs_main) {
         AssertLockHeld(::cs_main);
 
-        // TODO: Avoid the repeated-serialization here
         if (pnode->GetCommonVersion() < INVALID_CB_NO_BAN_VERSION || pnode->fDisconnect)
             return;
         ProcessBlockAvailability(pnode->GetId());
@@ -1552,7 +1650,7 @@ void PeerManagerImpl::NewPoWValidBlock(const CBlockIndex *pindex, const std::sha
 
             LogPrint(BCLog::NET, "%s sending header-and-ids %s to peer=%d\n", "PeerManager::NewPoWValidBlock",
                     hashBlock.ToString(), pnode->GetId());
-            m_connman.PushMessage(pnode, msgMaker.Make(NetMsgType::CMPCTBLOCK, *pcmpctblock));
+            m_connman.PushMessage(pnode, cmpctblock_msg.Copy());
             state.pindexBestHeaderSent = pindex;
         }
     });
@@ -1679,17 +1777,21 @@ void PeerManagerImpl::RelayTransaction(const uint256& txid, const uint256& wtxid
 
 void PeerManagerImpl::_RelayTransaction(const uint256& txid, const uint256& wtxid)
 {
-    m_connman.ForEachNode([&txid, &wtxid](CNode* pnode) EXCLUSIVE_LOCKS_REQUIRED(::cs_main) {
-        AssertLockHeld(::cs_main);
+    // Each peer is announced the txid or the wtxid, depending on m_wtxid_relay,
+    // when its cursor in the queue passes the transaction.
+    m_tx_relay_queue.Add(wtxid);
+}
 
-        CNodeState* state = State(pnode->GetId());
-        if (state == nullptr) return;
-        if (state->m_wtxid_relay) {
-            pnode->PushTxInventory(wtxid);
-        } else {
-            pnode->PushTxInventory(txid);
-        }
-    });
+void PeerManagerImpl::AnnounceReconciledTxs(CNode& node, const std::vector<uint256>& wtxids)
+{
+    if (wtxids.empty() || node.m_tx_relay == nullptr) return;
+    LOCK(node.m_tx_relay->cs_tx_inventory);
+    for (const uint256& wtxid : wtxids) {
+        node.m_tx_relay->setInventoryTxToSend.insert(wtxid);
+        node.m_tx_relay->m_recon_announce.insert(wtxid);
+    }
+    // Don't wait for the next trickle; the reconciliation delay already applied.
+    node.m_tx_relay->nNextInvSend = 0us;
 }
 
 void PeerManagerImpl::RelayAddress(NodeId originator,
@@ -1733,20 +1835,95 @@ void PeerManagerImpl::RelayAddress(NodeId originator,
     };
 
     for (unsigned int i = 0; i < nRelayNodes && best[i].first != 0; i++) {
+        LOCK(best[i].second->m_addr_relay_mutex);
         PushAddress(*best[i].second, addr, insecure_rand);
     }
 }
 
+/** A block message referencing a serialized block, which is shared instead of copied */
+static CSerializedNetMsg MakeBlockMsg(BlockCache::SerializedBlock data)
+{
+    CSerializedNetMsg msg;
+    msg.m_type = NetMsgType::BLOCK;
+    msg.m_shared_data = std::move(data);
+    return msg;
+}
+
+std::shared_ptr<const CBlock> PeerManagerImpl::LoadBlockToServe(const uint256& hash, const CBlockIndex* pindex, const std::shared_ptr<const CBlock>& recent_block)
+{
+    std::shared_ptr<const CBlock> block;
+    if (recent_block && recent_block->GetHash() == hash) {
+        block = recent_block;
+    } else {
+        assert(pindex);
+        auto new_block = std::make_shared<CBlock>();
+        const bool ret = ReadBlockFromDisk(*new_block, pindex, m_chainparams.GetConsensus());
+        assert(ret);
+        block = std::move(new_block);
+    }
+    m_block_cache.Insert(block);
+    return block;
+}
+
+std::shared_ptr<const CBlock> PeerManagerImpl::GetBlockToServe(const uint256& hash, const CBlockIndex* pindex, const std::shared_ptr<const CBlock>& recent_block)
+{
+    if (auto block = m_block_cache.GetBlock(hash)) return block;
+    return LoadBlockToServe(hash, pindex, recent_block);
+}
+
+BlockCache::SerializedBlock PeerManagerImpl::GetSerializedBlockToServe(const uint256& hash, const CBlockIndex* pindex, bool witness, const std::shared_ptr<const CBlock>& recent_block)
+{
+    if (auto data = m_block_cache.GetSerializedBlock(hash, witness)) return data;
+    if (witness && !(recent_block && recent_block->GetHash() == hash)) {
+        // Blocks are stored on disk in this form, so they need not be deserialized
+        assert(pindex);
+        auto data = std::make_shared<std::vector<uint8_t>>();
+        if (!ReadRawBlockFromDisk(*data, pindex, m_chainparams.MessageStart())) {
+            assert(!"cannot load block from disk");
+        }
+        m_block_cache.InsertSerialized(hash, /*witness=*/true, data);
+        return data;
+    }
+    const auto block = LoadBlockToServe(hash, pindex, recent_block);
+    auto data = BlockCache::Serialize(*block, witness);
+    m_block_cache.InsertSerialized(hash, witness, data);
+    return data;
+}
+
+std::shared_ptr<const CBlockHeaderAndShortTxIDs> PeerManagerImpl::GetCompactBlockToServe(const uint256& hash, const CBlockIndex* pindex, bool use_wtxid, const std::shared_ptr<const CBlock>& recent_block)
+{
+    if (auto compact_block = m_block_cache.GetCompactBlock(hash, use_wtxid)) return compact_block;
+    const auto block = LoadBlockToServe(hash, pindex, recent_block);
+    auto compact_block = std::make_shared<const CBlockHeaderAndShortTxIDs>(*block, use_wtxid);
+    m_block_cache.InsertCompactBlock(hash, use_wtxid, compact_block);
+    return compact_block;
+}
+
 void PeerManagerImpl::ProcessGetBlockData(CNode& pfrom, Peer& peer, const CInv& inv)
 {
     std::shared_ptr<const CBlock> a_recent_block;
     std::shared_ptr<const CBlockHeaderAndShortTxIDs> a_recent_compact_block;
+    CSerializedNetMsg a_recent_compact_block_msg;
     bool fWitnessesPresentInARecentCompactBlock;
+    bool a_recent_block_connected;
     {
         LOCK(cs_most_recent_block);
         a_recent_block = most_recent_block;
         a_recent_compact_block = most_recent_compact_block;
+        a_recent_compact_block_msg = most_recent_compact_block_msg.Copy();
         fWitnessesPresentInARecentCompactBlock = fWitnessesPresentInMostRecentCompactBlock;
+        a_recent_block_connected = most_recent_block_connected;
+    }
+
+    // Serve the most recent block without cs_main, so that peers fetching a new block
+    // are not held up while another message handler thread validates. The block was
+    // connected to the active chain, so it passes all the checks below, except for the
+    // continuation which needs the tip.
+    if (a_recent_block_connected && a_recent_block && a_recent_block->GetHash() == inv.hash &&
+        (inv.IsMsgBlk() || inv.IsMsgWitnessBlk()) &&
+        WITH_LOCK(peer.m_block_inv_mutex, return inv.hash != peer.m_continuation_block)) {
+        m_connman.PushMessage(&pfrom, MakeBlockMsg(GetSerializedBlockToServe(inv.hash, /*pindex=*/nullptr, inv.IsMsgWitnessBlk(), a_recent_block)));
+        return;
     }
 
     bool need_activate_chain = false;
@@ -1805,72 +1982,51 @@ void PeerManagerImpl::ProcessGetBlockData(CNode& pfrom, Peer& peer, const CInv&
     if (!(pindex->nStatus & BLOCK_HAVE_DATA)) {
         return;
     }
-    std::shared_ptr<const CBlock> pblock;
-    if (a_recent_block && a_recent_block->GetHash() == pindex->GetBlockHash()) {
-        pblock = a_recent_block;
-    } else if (inv.IsMsgWitnessBlk()) {
-        // Fast-path: in this case it is possible to serve the block directly from disk,
-        // as the network format matches the format on disk
-        std::vector<uint8_t> block_data;
-        if (!ReadRawBlockFromDisk(block_data, pindex, m_chainparams.MessageStart())) {
-            assert(!"cannot load block from disk");
-        }
-        m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::BLOCK, Span{block_data}));
-        // Don't set pblock as we've sent the block
-    } else {
-        // Send block from disk
-        std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
-        if (!ReadBlockFromDisk(*pblockRead, pindex, m_chainparams.GetConsensus())) {
-            assert(!"cannot load block from disk");
-        }
-        pblock = pblockRead;
-    }
-    if (pblock) {
-        if (inv.IsMsgBlk()) {
-            m_connman.PushMessage(&pfrom, msgMaker.Make(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::BLOCK, *pblock));
-        } else if (inv.IsMsgWitnessBlk()) {
-            m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::BLOCK, *pblock));
-        } else if (inv.IsMsgFilteredBlk()) {
-            bool sendMerkleBlock = false;
-            CMerkleBlock merkleBlock;
-            if (pfrom.m_tx_relay != nullptr) {
-                LOCK(pfrom.m_tx_relay->cs_filter);
-                if (pfrom.m_tx_relay->pfilter) {
-                    sendMerkleBlock = true;
-                    merkleBlock = CMerkleBlock(*pblock, *pfrom.m_tx_relay->pfilter);
-                }
-            }
-            if (sendMerkleBlock) {
-                m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::MERKLEBLOCK, merkleBlock));
-                // CMerkleBlock just contains hashes, so also push any transactions in the block the client did not see
-                // This avoids hurting performance by pointlessly requiring a round-trip
-                // Note that there is currently no way for a node to request any single transactions we didn't send here -
-                // they must either disconnect and retry or request the full block.
-                // Thus, the protocol spec specified allows for us to provide duplicate txn here,
-                // however we MUST always provide at least what the remote peer needs
-                typedef std::pair<unsigned int, uint256> PairType;
-                for (PairType& pair : merkleBlock.vMatchedTxn)
-                    m_connman.PushMessage(&pfrom, msgMaker.Make(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::TX, *pblock->vtx[pair.first]));
+    if (inv.IsMsgBlk() || inv.IsMsgWitnessBlk()) {
+        m_connman.PushMessage(&pfrom, MakeBlockMsg(GetSerializedBlockToServe(pindex->GetBlockHash(), pindex, inv.IsMsgWitnessBlk(), a_recent_block)));
+    } else if (inv.IsMsgFilteredBlk()) {
+        const std::shared_ptr<const CBlock> pblock = GetBlockToServe(pindex->GetBlockHash(), pindex, a_recent_block);
+        bool sendMerkleBlock = false;
+        CMerkleBlock merkleBlock;
+        if (pfrom.m_tx_relay != nullptr) {
+            LOCK(pfrom.m_tx_relay->cs_filter);
+            if (pfrom.m_tx_relay->pfilter) {
+                sendMerkleBlock = true;
+                merkleBlock = CMerkleBlock(*pblock, *pfrom.m_tx_relay->pfilter);
             }
-            // else
-            // no response
-        } else if (inv.IsMsgCmpctBlk()) {
-            // If a peer is asking for old blocks, we're almost guaranteed
-            // they won't have a useful mempool to match against a compact block,
-            // and we don't feel like constructing the object for them, so
-            // instead we respond with the full, non-compact block.
-            bool fPeerWantsWitness = State(pfrom.GetId())->fWantsCmpctWitness;
-            int nSendFlags = fPeerWantsWitness ? 0 : SERIALIZE_TRANSACTION_NO_WITNESS;
-            if (CanDirectFetch() && pindex->nHeight >= m_chainman.ActiveChain().Height() - MAX_CMPCTBLOCK_DEPTH) {
-                if ((fPeerWantsWitness || !fWitnessesPresentInARecentCompactBlock) && a_recent_compact_block && a_recent_compact_block->header.GetHash() == pindex->GetBlockHash()) {
-                    m_connman.PushMessage(&pfrom, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, *a_recent_compact_block));
-                } else {
-                    CBlockHeaderAndShortTxIDs cmpctblock(*pblock, fPeerWantsWitness);
-                    m_connman.PushMessage(&pfrom, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, cmpctblock));
-                }
+        }
+        if (sendMerkleBlock) {
+            m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::MERKLEBLOCK, merkleBlock));
+            // CMerkleBlock just contains hashes, so also push any transactions in the block the client did not see
+            // This avoids hurting performance by pointlessly requiring a round-trip
+            // Note that there is currently no way for a node to request any single transactions we didn't send here -
+            // they must either disconnect and retry or request the full block.
+            // Thus, the protocol spec specified allows for us to provide duplicate txn here,
+            // however we MUST always provide at least what the remote peer needs
+            typedef std::pair<unsigned int, uint256> PairType;
+            for (PairType& pair : merkleBlock.vMatchedTxn)
+                m_connman.PushMessage(&pfrom, msgMaker.Make(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::TX, *pblock->vtx[pair.first]));
+        }
+        // else
+        // no response
+    } else if (inv.IsMsgCmpctBlk()) {
+        // If a peer is asking for old blocks, we're almost guaranteed
+        // they won't have a useful mempool to match against a compact block,
+        // and we don't feel like constructing the object for them, so
+        // instead we respond with the full, non-compact block.
+        bool fPeerWantsWitness = State(pfrom.GetId())->fWantsCmpctWitness;
+        int nSendFlags = fPeerWantsWitness ? 0 : SERIALIZE_TRANSACTION_NO_WITNESS;
+        if (CanDirectFetch() && pindex->nHeight >= m_chainman.ActiveChain().Height() - MAX_CMPCTBLOCK_DEPTH) {
+            if (fPeerWantsWitness && a_recent_compact_block && a_recent_compact_block->header.GetHash() == pindex->GetBlockHash()) {
+                m_connman.PushMessage(&pfrom, std::move(a_recent_compact_block_msg));
+            } else if (!fWitnessesPresentInARecentCompactBlock && a_recent_compact_block && a_recent_compact_block->header.GetHash() == pindex->GetBlockHash()) {
+                m_connman.PushMessage(&pfrom, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, *a_recent_compact_block));
             } else {
-                m_connman.PushMessage(&pfrom, msgMaker.Make(nSendFlags, NetMsgType::BLOCK, *pblock));
+                const auto cmpctblock = GetCompactBlockToServe(pindex->GetBlockHash(), pindex, fPeerWantsWitness, a_recent_block);
+                m_connman.PushMessage(&pfrom, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, *cmpctblock));
             }
+        } else {
+            m_connman.PushMessage(&pfrom, MakeBlockMsg(GetSerializedBlockToServe(pindex->GetBlockHash(), pindex, fPeerWantsWitness, a_recent_block)));
         }
     }
 
@@ -2102,6 +2258,7 @@ void PeerManagerImpl::ProcessHeadersMessage(CNode& pfrom, const Peer& peer,
             return;
         }
     }
+    ConnectHeadersRanges();
 
     {
         LOCK(cs_main);
@@ -2124,11 +2281,12 @@ void PeerManagerImpl::ProcessHeadersMessage(CNode& pfrom, const Peer& peer,
 
         if (nCount == MAX_HEADERS_RESULTS) {
             // Headers message had its maximum size; the peer may have more headers.
-            // TODO: optimize: if pindexLast is an ancestor of m_chainman.ActiveChain().Tip or pindexBestHeader, continue
-            // from there instead.
+            // If pindexBestHeader extends pindexLast, for instance with headers of a
+            // range received from another peer, continue from there instead.
+            const CBlockIndex* pindex_continue{pindexBestHeader->GetAncestor(pindexLast->nHeight) == pindexLast ? pindexBestHeader : pindexLast};
             LogPrint(BCLog::NET, "more getheaders (%d) to end to peer=%d (startheight:%d)\n",
-                                 pindexLast->nHeight, pfrom.GetId(), peer.m_starting_height);
-            m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::GETHEADERS, m_chainman.ActiveChain().GetLocator(pindexLast), uint256()));
+                                 pindex_continue->nHeight, pfrom.GetId(), peer.m_starting_height);
+            m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::GETHEADERS, m_chainman.ActiveChain().GetLocator(pindex_continue), uint256()));
         }
 
         // If this set of headers is valid and ends in a block with at least as
@@ -2223,6 +2381,55 @@ void PeerManagerImpl::ProcessHeadersMessage(CNode& pfrom, const Peer& peer,
     return;
 }
 
+bool PeerManagerImpl::ProcessHeadersRange(CNode& pfrom, const std::vector<CBlockHeader>& headers)
+{
+    std::optional<HeadersRangeRequest> request;
+    {
+        LOCK(cs_main);
+        switch (m_headers_sync.ReceivedHeaders(pfrom.GetId(), headers, m_chainparams.GetConsensus(), GetTime<std::chrono::microseconds>())) {
+        case HeadersSyncScheduler::Result::NOT_FOR_RANGE:
+            return false;
+        case HeadersSyncScheduler::Result::INVALID:
+            Misbehaving(pfrom.GetId(), 100, "invalid headers before checkpoint");
+            return true;
+        case HeadersSyncScheduler::Result::UNSERVED:
+            LogPrint(BCLog::NET, "peer=%d is missing headers before checkpoint\n", pfrom.GetId());
+            break;
+        case HeadersSyncScheduler::Result::MORE:
+            request = m_headers_sync.GetRequest(pfrom.GetId());
+            break;
+        case HeadersSyncScheduler::Result::DONE:
+            break;
+        }
+        UpdateBlockAvailability(pfrom.GetId(), headers.back().GetHash());
+    }
+    if (request) {
+        LogPrint(BCLog::NET, "more getheaders after %s up to checkpoint %s to peer=%d\n", request->locator_hash.ToString(), request->stop_hash.ToString(), pfrom.GetId());
+        m_connman.PushMessage(&pfrom, CNetMsgMaker(pfrom.GetCommonVersion()).Make(NetMsgType::GETHEADERS, CBlockLocator({request->locator_hash}), request->stop_hash));
+    }
+    ConnectHeadersRanges();
+    return true;
+}
+
+void PeerManagerImpl::ConnectHeadersRanges()
+{
+    while (true) {
+        std::vector<CBlockHeader> headers;
+        {
+            LOCK(cs_main);
+            headers = m_headers_sync.TakeConnectableHeaders([&](const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main) {
+                return m_chainman.m_blockman.LookupBlockIndex(hash) != nullptr;
+            }, MAX_HEADERS_RESULTS);
+        }
+        if (headers.empty()) return;
+        BlockValidationState state;
+        if (!m_chainman.ProcessNewBlockHeaders(headers, state, m_chainparams)) {
+            LogPrint(BCLog::NET, "headers after %s do not connect: %s\n", headers.front().hashPrevBlock.ToString(), state.ToString());
+            return;
+        }
+    }
+}
+
 /**
  * Reconsider orphan transactions after a parent has been accepted to the mempool.
  *
@@ -2302,6 +2509,184 @@ void PeerManagerImpl::ProcessOrphanTx(std::set<uint256>& orphan_work_set)
     }
 }
 
+void PeerManagerImpl::ProcessTxResult(CNode& pfrom, Peer& peer, const CTransactionRef& ptx, const MempoolAcceptResult& result)
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(g_cs_orphans);
+
+    const CTransaction& tx = *ptx;
+    const TxValidationState& state = result.m_state;
+
+    if (result.m_result_type == MempoolAcceptResult::ResultType::VALID) {
+        // As this version of the transaction was acceptable, we can forget about any
+        // requests for it.
+        m_txrequest.ForgetTxHash(tx.GetHash());
+        m_txrequest.ForgetTxHash(tx.GetWitnessHash());
+        _RelayTransaction(tx.GetHash(), tx.GetWitnessHash());
+        m_orphanage.AddChildrenToWorkSet(tx, peer.m_orphan_work_set);
+
+        pfrom.nLastTXTime = GetTime();
+
+        LogPrint(BCLog::MEMPOOL, "AcceptToMemoryPool: peer=%d: accepted %s (poolsz %u txn, %u kB)\n",
+            pfrom.GetId(),
+            tx.GetHash().ToString(),
+            m_mempool.size(), m_mempool.DynamicMemoryUsage() / 1000);
+
+        for (const CTransactionRef& removedTx : result.m_replaced_transactions.value()) {
+            AddToCompactExtraTransactions(removedTx);
+        }
+
+        // Recursively process any orphan transactions that depended on this one
+        ProcessOrphanTx(peer.m_orphan_work_set);
+    }
+    else if (state.GetResult() == TxValidationResult::TX_MISSING_INPUTS)
+    {
+        bool fRejectedParents = false; // It may be the case that the orphans parents have all been rejected
+
+        // Deduplicate parent txids, so that we don't have to loop over
+        // the same parent txid more than once down below.
+        std::vector<uint256> unique_parents;
+        unique_parents.reserve(tx.vin.size());
+        for (const CTxIn& txin : tx.vin) {
+            // We start with all parents, and then remove duplicates below.
+            unique_parents.push_back(txin.prevout.hash);
+        }
+        std::sort(unique_parents.begin(), unique_parents.end());
+        unique_parents.erase(std::unique(unique_parents.begin(), unique_parents.end()), unique_parents.end());
+        for (const uint256& parent_txid : unique_parents) {
+            if (m_recent_rejects.contains(parent_txid)) {
+                fRejectedParents = true;
+                break;
+            }
+        }
+        if (!fRejectedParents) {
+            const auto current_time = GetTime<std::chrono::microseconds>();
+
+            for (const uint256& parent_txid : unique_parents) {
+                // Here, we only have the txid (and not wtxid) of the
+                // inputs, so we only request in txid mode, even for
+                // wtxidrelay peers.
+                // Eventually we should replace this with an improved
+                // protocol for getting all unconfirmed parents.
+                const auto gtxid{GenTxid::Txid(parent_txid)};
+                pfrom.AddKnownTx(parent_txid);
+                if (!AlreadyHaveTx(gtxid)) AddTxAnnouncement(pfrom, gtxid, current_time);
+            }
+
+            if (m_orphanage.AddTx(ptx, pfrom.GetId())) {
+                AddToCompactExtraTransactions(ptx);
+            }
+
+            // Once added to the orphan pool, a tx is considered AlreadyHave, and we shouldn't request it anymore.
+            m_txrequest.ForgetTxHash(tx.GetHash());
+            m_txrequest.ForgetTxHash(tx.GetWitnessHash());
+
+            // DoS prevention: do not allow m_orphanage to grow unbounded (see CVE-2012-3789)
+            unsigned int nMaxOrphanTx = (unsigned int)std::max((int64_t)0, gArgs.GetIntArg("-maxorphantx", DEFAULT_MAX_ORPHAN_TRANSACTIONS));
+            unsigned int nEvicted = m_orphanage.LimitOrphans(nMaxOrphanTx);
+            if (nEvicted > 0) {
+                LogPrint(BCLog::MEMPOOL, "orphanage overflow, removed %u tx\n", nEvicted);
+            }
+        } else {
+            LogPrint(BCLog::MEMPOOL, "not keeping orphan with rejected parents %s\n",tx.GetHash().ToString());
+            // We will continue to reject this tx since it has rejected
+            // parents so avoid re-requesting it from other peers.
+            // Here we add both the txid and the wtxid, as we know that
+            // regardless of what witness is provided, we will not accept
+            // this, so we don't need to allow for redownload of this txid
+            // from any of our non-wtxidrelay peers.
+            m_recent_rejects.insert(tx.GetHash());
+            m_recent_rejects.insert(tx.GetWitnessHash());
+            m_txrequest.ForgetTxHash(tx.GetHash());
+            m_txrequest.ForgetTxHash(tx.GetWitnessHash());
+        }
+    } else {
+        if (state.GetResult() != TxValidationResult::TX_WITNESS_STRIPPED) {
+            // We can add the wtxid of this transaction to our reject filter.
+            // Do not add txids of witness transactions or witness-stripped
+            // transactions to the filter, as they can have been malleated;
+            // adding such txids to the reject filter would potentially
+            // interfere with relay of valid transactions from peers that
+            // do not support wtxid-based relay. See
+            // https://github.com/bitcoin/bitcoin/issues/8279 for details.
+            // We can remove this restriction (and always add wtxids to
+            // the filter even for witness stripped transactions) once
+            // wtxid-based relay is broadly deployed.
+            // See also comments in https://github.com/bitcoin/bitcoin/pull/18044#discussion_r443419034
+            // for concerns around weakening security of unupgraded nodes
+            // if we start doing this too early.
+            m_recent_rejects.insert(tx.GetWitnessHash());
+            m_txrequest.ForgetTxHash(tx.GetWitnessHash());
+            // If the transaction failed for TX_INPUTS_NOT_STANDARD,
+            // then we know that the witness was irrelevant to the policy
+            // failure, since this check depends only on the txid
+            // (the scriptPubKey being spent is covered by the txid).
+            // Add the txid to the reject filter to prevent repeated
+            // processing of this transaction in the event that child
+            // transactions are later received (resulting in
+            // parent-fetching by txid via the orphan-handling logic).
+            if (state.GetResult() == TxValidationResult::TX_INPUTS_NOT_STANDARD && tx.GetWitnessHash() != tx.GetHash()) {
+                m_recent_rejects.insert(tx.GetHash());
+                m_txrequest.ForgetTxHash(tx.GetHash());
+            }
+            if (RecursiveDynamicUsage(*ptx) < 100000) {
+                AddToCompactExtraTransactions(ptx);
+            }
+        }
+    }
+
+    // If a tx has been detected by m_recent_rejects, we will have reached
+    // this point and the tx will have been ignored. Because we haven't
+    // submitted the tx to our mempool, we won't have computed a DoS
+    // score for it or determined exactly why we consider it invalid.
+    //
+    // This means we won't penalize any peer subsequently relaying a DoSy
+    // tx (even if we penalized the first peer who gave it to us) because
+    // we have to account for m_recent_rejects showing false positives. In
+    // other words, we shouldn't penalize a peer if we aren't *sure* they
+    // submitted a DoSy tx.
+    //
+    // Note that m_recent_rejects doesn't just record DoSy or invalid
+    // transactions, but any tx not accepted by the mempool, which may be
+    // due to node policy (vs. consensus). So we can't blanket penalize a
+    // peer simply for relaying a tx that our m_recent_rejects has caught,
+    // regardless of false positives.
+
+    if (state.IsInvalid()) {
+        LogPrint(BCLog::MEMPOOLREJ, "%s from peer=%d was not accepted: %s\n", tx.GetHash().ToString(),
+            pfrom.GetId(),
+            state.ToString());
+        MaybePunishNodeForTx(pfrom.GetId(), state);
+    }
+}
+
+void PeerManagerImpl::ProcessTxBatch()
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(g_cs_orphans);
+
+    if (m_tx_batch.empty()) return;
+
+    std::vector<PendingTx> batch;
+    batch.swap(m_tx_batch);
+    std::vector<CTransactionRef> txns;
+    txns.reserve(batch.size());
+    for (const PendingTx& pending : batch) {
+        txns.push_back(pending.tx);
+    }
+
+    const std::vector<MempoolAcceptResult> results = m_chainman.ProcessTransactions(txns);
+    for (size_t i = 0; i < batch.size(); ++i) {
+        ProcessTxResult(*batch[i].node, *batch[i].peer, batch[i].tx, results[i]);
+    }
+}
+
+void PeerManagerImpl::ProcessDeferredWork()
+{
+    LOCK2(cs_main, g_cs_orphans);
+    ProcessTxBatch();
+}
+
 bool PeerManagerImpl::PrepareBlockFilterRequest(CNode& peer,
                                                 BlockFilterType filter_type, uint32_t start_height,
                                                 const uint256& stop_hash, uint32_t max_height_diff,
@@ -2576,6 +2961,13 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
             m_connman.PushMessage(&pfrom, msg_maker.Make(NetMsgType::WTXIDRELAY));
         }
 
+        // Signal support for transaction reconciliation (BIP330), which requires wtxid relay.
+        if (m_txreconciliation && greatest_common_version >= WTXID_RELAY_VERSION &&
+            !m_ignore_incoming_txs && pfrom.m_tx_relay != nullptr && fRelay) {
+            const uint64_t recon_salt = m_txreconciliation->PreRegisterPeer(pfrom.GetId());
+            m_connman.PushMessage(&pfrom, msg_maker.Make(NetMsgType::SENDTXRCNCL, TXRECONCILIATION_VERSION, recon_salt));
+        }
+
         // Signal ADDRv2 support (BIP155).
         if (greatest_common_version >= 70016) {
             // BIP155 defines addrv2 and sendaddrv2 for all protocol versions, but some
@@ -2638,11 +3030,11 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
                 if (addr.IsRoutable())
                 {
                     LogPrint(BCLog::NET, "ProcessMessages: advertising address %s\n", addr.ToString());
-                    PushAddress(*peer, addr, insecure_rand);
+                    WITH_LOCK(peer->m_addr_relay_mutex, PushAddress(*peer, addr, insecure_rand));
                 } else if (IsPeerAddrLocalGood(&pfrom)) {
                     addr.SetIP(addrMe);
                     LogPrint(BCLog::NET, "ProcessMessages: advertising address %s\n", addr.ToString());
-                    PushAddress(*peer, addr, insecure_rand);
+                    WITH_LOCK(peer->m_addr_relay_mutex, PushAddress(*peer, addr, insecure_rand));
                 }
             }
 
@@ -2810,6 +3202,43 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
         return;
     }
 
+    // BIP330 defines feature negotiation of transaction reconciliation, which must
+    // happen between VERSION and VERACK, after WTXIDRELAY.
+    if (msg_type == NetMsgType::SENDTXRCNCL) {
+        if (!m_txreconciliation) {
+            LogPrint(BCLog::NET, "sendtxrcncl from peer=%d ignored, as transaction reconciliation is disabled\n", pfrom.GetId());
+            return;
+        }
+        if (pfrom.fSuccessfullyConnected) {
+            // Disconnect peers that send a SENDTXRCNCL message after VERACK.
+            LogPrint(BCLog::NET, "sendtxrcncl received after verack from peer=%d; disconnecting\n", pfrom.GetId());
+            pfrom.fDisconnect = true;
+            return;
+        }
+        if (!WITH_LOCK(cs_main, return State(pfrom.GetId())->m_wtxid_relay)) {
+            LogPrint(BCLog::NET, "sendtxrcncl received before wtxidrelay from peer=%d; ignoring\n", pfrom.GetId());
+            return;
+        }
+
+        uint32_t peer_recon_version;
+        uint64_t remote_salt;
+        vRecv >> peer_recon_version >> remote_salt;
+        switch (m_txreconciliation->RegisterPeer(pfrom.GetId(), pfrom.IsInboundConn(), peer_recon_version, remote_salt)) {
+        case ReconciliationRegisterResult::NOT_FOUND:
+            // We did not offer reconciliation to this peer, e.g. because it does not relay transactions.
+            LogPrint(BCLog::NET, "ignoring unexpected sendtxrcncl from peer=%d\n", pfrom.GetId());
+            break;
+        case ReconciliationRegisterResult::SUCCESS:
+            break;
+        case ReconciliationRegisterResult::ALREADY_REGISTERED:
+        case ReconciliationRegisterResult::PROTOCOL_VIOLATION:
+            LogPrint(BCLog::NET, "invalid sendtxrcncl from peer=%d; disconnecting\n", pfrom.GetId());
+            pfrom.fDisconnect = true;
+            break;
+        }
+        return;
+    }
+
     if (!pfrom.fSuccessfullyConnected) {
         LogPrint(BCLog::NET, "Unsupported message \"%s\" prior to verack from peer=%d\n", SanitizeString(msg_type), pfrom.GetId());
         return;
@@ -2880,7 +3309,7 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
 
             if (addr.nTime <= 100000000 || addr.nTime > nNow + 10 * 60)
                 addr.nTime = nNow - 5 * 24 * 60 * 60;
-            AddAddressKnown(*peer, addr);
+            WITH_LOCK(peer->m_addr_relay_mutex, AddAddressKnown(*peer, addr));
             if (m_banman && (m_banman->IsDiscouraged(addr) || m_banman->IsBanned(addr))) {
                 // Do not process banned/discouraged addresses beyond remembering we received them
                 continue;
@@ -2970,6 +3399,7 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
                 LogPrint(BCLog::NET, "got inv: %s  %s peer=%d\n", inv.ToString(), fAlreadyHave ? "have" : "new", pfrom.GetId());
 
                 pfrom.AddKnownTx(inv.hash);
+                if (m_txreconciliation) m_txreconciliation->TryRemovingFromSet(pfrom.GetId(), inv.hash);
                 if (!fAlreadyHave && !m_chainman.ActiveChainstate().IsInitialBlockDownload()) {
                     AddTxAnnouncement(pfrom, gtxid, current_time);
                 }
@@ -2986,6 +3416,58 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
         return;
     }
 
+    // BIP330 transaction reconciliation, only with peers that completed its handshake
+    if (msg_type == NetMsgType::REQTXRCNCL) {
+        if (!m_txreconciliation || !m_txreconciliation->IsPeerRegistered(pfrom.GetId())) {
+            LogPrint(BCLog::NET, "ignoring reqtxrcncl from peer=%d not registered for reconciliation\n", pfrom.GetId());
+            return;
+        }
+        uint16_t peer_set_size, peer_q;
+        vRecv >> peer_set_size >> peer_q;
+        // The sketch is sent along with the next transaction announcements, see SendMessages().
+        if (!m_txreconciliation->HandleReconciliationRequest(pfrom.GetId(), peer_set_size, peer_q)) {
+            LogPrint(BCLog::NET, "unexpected reqtxrcncl from peer=%d; disconnecting\n", pfrom.GetId());
+            pfrom.fDisconnect = true;
+        }
+        return;
+    }
+
+    if (msg_type == NetMsgType::SKETCH) {
+        if (!m_txreconciliation || !m_txreconciliation->IsPeerRegistered(pfrom.GetId())) {
+            LogPrint(BCLog::NET, "ignoring sketch from peer=%d not registered for reconciliation\n", pfrom.GetId());
+            return;
+        }
+        std::vector<uint8_t> skdata;
+        vRecv >> skdata;
+        const auto result = m_txreconciliation->HandleSketch(pfrom.GetId(), skdata);
+        if (!result) {
+            LogPrint(BCLog::NET, "unexpected or invalid sketch from peer=%d; disconnecting\n", pfrom.GetId());
+            pfrom.fDisconnect = true;
+            return;
+        }
+        m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::RECONCILDIFF, result->m_success, result->m_ask_shortids));
+        AnnounceReconciledTxs(pfrom, result->m_announce);
+        return;
+    }
+
+    if (msg_type == NetMsgType::RECONCILDIFF) {
+        if (!m_txreconciliation || !m_txreconciliation->IsPeerRegistered(pfrom.GetId())) {
+            LogPrint(BCLog::NET, "ignoring reconcildiff from peer=%d not registered for reconciliation\n", pfrom.GetId());
+            return;
+        }
+        bool success;
+        std::vector<uint32_t> ask_shortids;
+        vRecv >> success >> ask_shortids;
+        const auto announce = m_txreconciliation->HandleReconciliationDifference(pfrom.GetId(), success, ask_shortids);
+        if (!announce) {
+            LogPrint(BCLog::NET, "unexpected reconcildiff from peer=%d; disconnecting\n", pfrom.GetId());
+            pfrom.fDisconnect = true;
+            return;
+        }
+        AnnounceReconciledTxs(pfrom, *announce);
+        return;
+    }
+
     if (msg_type == NetMsgType::GETDATA) {
         std::vector<CInv> vInv;
         vRecv >> vInv;
@@ -3103,11 +3585,8 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
             }
 
             if (pindex->nHeight >= m_chainman.ActiveChain().Height() - MAX_BLOCKTXN_DEPTH) {
-                CBlock block;
-                bool ret = ReadBlockFromDisk(block, pindex, m_chainparams.GetConsensus());
-                assert(ret);
-
-                SendBlockTransactions(pfrom, block, req);
+                const auto block = GetBlockToServe(req.blockhash, pindex, /*recent_block=*/nullptr);
+                SendBlockTransactions(pfrom, *block, req);
                 return;
             }
         }
@@ -3224,6 +3703,7 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
 
         const uint256& hash = nodestate->m_wtxid_relay ? wtxid : txid;
         pfrom.AddKnownTx(hash);
+        if (m_txreconciliation) m_txreconciliation->TryRemovingFromSet(pfrom.GetId(), wtxid);
         if (nodestate->m_wtxid_relay && txid != wtxid) {
             // Insert txid into filterInventoryKnown, even for
             // wtxidrelay peers. This prevents re-adding of
@@ -3263,149 +3743,19 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
             return;
         }
 
-        const MempoolAcceptResult result = m_chainman.ProcessTransaction(ptx);
-        const TxValidationState& state = result.m_state;
-
-        if (result.m_result_type == MempoolAcceptResult::ResultType::VALID) {
-            // As this version of the transaction was acceptable, we can forget about any
-            // requests for it.
-            m_txrequest.ForgetTxHash(tx.GetHash());
-            m_txrequest.ForgetTxHash(tx.GetWitnessHash());
-            _RelayTransaction(tx.GetHash(), tx.GetWitnessHash());
-            m_orphanage.AddChildrenToWorkSet(tx, peer->m_orphan_work_set);
-
-            pfrom.nLastTXTime = GetTime();
-
-            LogPrint(BCLog::MEMPOOL, "AcceptToMemoryPool: peer=%d: accepted %s (poolsz %u txn, %u kB)\n",
-                pfrom.GetId(),
-                tx.GetHash().ToString(),
-                m_mempool.size(), m_mempool.DynamicMemoryUsage() / 1000);
-
-            for (const CTransactionRef& removedTx : result.m_replaced_transactions.value()) {
-                AddToCompactExtraTransactions(removedTx);
-            }
-
-            // Recursively process any orphan transactions that depended on this one
-            ProcessOrphanTx(peer->m_orphan_work_set);
-        }
-        else if (state.GetResult() == TxValidationResult::TX_MISSING_INPUTS)
-        {
-            bool fRejectedParents = false; // It may be the case that the orphans parents have all been rejected
-
-            // Deduplicate parent txids, so that we don't have to loop over
-            // the same parent txid more than once down below.
-            std::vector<uint256> unique_parents;
-            unique_parents.reserve(tx.vin.size());
-            for (const CTxIn& txin : tx.vin) {
-                // We start with all parents, and then remove duplicates below.
-                unique_parents.push_back(txin.prevout.hash);
-            }
-            std::sort(unique_parents.begin(), unique_parents.end());
-            unique_parents.erase(std::unique(unique_parents.begin(), unique_parents.end()), unique_parents.end());
-            for (const uint256& parent_txid : unique_parents) {
-                if (m_recent_rejects.contains(parent_txid)) {
-                    fRejectedParents = true;
-                    break;
-                }
-            }
-            if (!fRejectedParents) {
-                const auto current_time = GetTime<std::chrono::microseconds>();
-
-                for (const uint256& parent_txid : unique_parents) {
-                    // Here, we only have the txid (and not wtxid) of the
-                    // inputs, so we only request in txid mode, even for
-                    // wtxidrelay peers.
-                    // Eventually we should replace this with an improved
-                    // protocol for getting all unconfirmed parents.
-                    const auto gtxid{GenTxid::Txid(parent_txid)};
-                    pfrom.AddKnownTx(parent_txid);
-                    if (!AlreadyHaveTx(gtxid)) AddTxAnnouncement(pfrom, gtxid, current_time);
-                }
-
-                if (m_orphanage.AddTx(ptx, pfrom.GetId())) {
-                    AddToCompactExtraTransactions(ptx);
-                }
-
-                // Once added to the orphan pool, a tx is considered AlreadyHave, and we shouldn't request it anymore.
-                m_txrequest.ForgetTxHash(tx.GetHash());
-                m_txrequest.ForgetTxHash(tx.GetWitnessHash());
-
-                // DoS prevention: do not allow m_orphanage to grow unbounded (see CVE-2012-3789)
-                unsigned int nMaxOrphanTx = (unsigned int)std::max((int64_t)0, gArgs.GetIntArg("-maxorphantx", DEFAULT_MAX_ORPHAN_TRANSACTIONS));
-                unsigned int nEvicted = m_orphanage.LimitOrphans(nMaxOrphanTx);
-                if (nEvicted > 0) {
-                    LogPrint(BCLog::MEMPOOL, "orphanage overflow, removed %u tx\n", nEvicted);
-                }
-            } else {
-                LogPrint(BCLog::MEMPOOL, "not keeping orphan with rejected parents %s\n",tx.GetHash().ToString());
-                // We will continue to reject this tx since it has rejected
-                // parents so avoid re-requesting it from other peers.
-                // Here we add both the txid and the wtxid, as we know that
-                // regardless of what witness is provided, we will not accept
-                // this, so we don't need to allow for redownload of this txid
-                // from any of our non-wtxidrelay peers.
-                m_recent_rejects.insert(tx.GetHash());
-                m_recent_rejects.insert(tx.GetWitnessHash());
-                m_txrequest.ForgetTxHash(tx.GetHash());
-                m_txrequest.ForgetTxHash(tx.GetWitnessHash());
-            }
-        } else {
-            if (state.GetResult() != TxValidationResult::TX_WITNESS_STRIPPED) {
-                // We can add the wtxid of this transaction to our reject filter.
-                // Do not add txids of witness transactions or witness-stripped
-                // transactions to the filter, as they can have been malleated;
-                // adding such txids to the reject filter would potentially
-                // interfere with relay of valid transactions from peers that
-                // do not support wtxid-based relay. See
-                // https://github.com/bitcoin/bitcoin/issues/8279 for details.
-                // We can remove this restriction (and always add wtxids to
-                // the filter even for witness stripped transactions) once
-                // wtxid-based relay is broadly deployed.
-                // See also comments in https://github.com/bitcoin/bitcoin/pull/18044#discussion_r443419034
-                // for concerns around weakening security of unupgraded nodes
-                // if we start doing this too early.
-                m_recent_rejects.insert(tx.GetWitnessHash());
-                m_txrequest.ForgetTxHash(tx.GetWitnessHash());
-                // If the transaction failed for TX_INPUTS_NOT_STANDARD,
-                // then we know that the witness was irrelevant to the policy
-                // failure, since this check depends only on the txid
-                // (the scriptPubKey being spent is covered by the txid).
-                // Add the txid to the reject filter to prevent repeated
-                // processing of this transaction in the event that child
-                // transactions are later received (resulting in
-                // parent-fetching by txid via the orphan-handling logic).
-                if (state.GetResult() == TxValidationResult::TX_INPUTS_NOT_STANDARD && tx.GetWitnessHash() != tx.GetHash()) {
-                    m_recent_rejects.insert(tx.GetHash());
-                    m_txrequest.ForgetTxHash(tx.GetHash());
-                }
-                if (RecursiveDynamicUsage(*ptx) < 100000) {
-                    AddToCompactExtraTransactions(ptx);
-                }
-            }
+        // Another peer sent the same transaction earlier in this batch; it will be relayed or
+        // rejected once the batch is validated.
+        if (std::any_of(m_tx_batch.begin(), m_tx_batch.end(),
+                        [&wtxid](const PendingTx& pending) { return pending.tx->GetWitnessHash() == wtxid; })) {
+            return;
         }
 
-        // If a tx has been detected by m_recent_rejects, we will have reached
-        // this point and the tx will have been ignored. Because we haven't
-        // submitted the tx to our mempool, we won't have computed a DoS
-        // score for it or determined exactly why we consider it invalid.
-        //
-        // This means we won't penalize any peer subsequently relaying a DoSy
-        // tx (even if we penalized the first peer who gave it to us) because
-        // we have to account for m_recent_rejects showing false positives. In
-        // other words, we shouldn't penalize a peer if we aren't *sure* they
-        // submitted a DoSy tx.
-        //
-        // Note that m_recent_rejects doesn't just record DoSy or invalid
-        // transactions, but any tx not accepted by the mempool, which may be
-        // due to node policy (vs. consensus). So we can't blanket penalize a
-        // peer simply for relaying a tx that our m_recent_rejects has caught,
-        // regardless of false positives.
-
-        if (state.IsInvalid()) {
-            LogPrint(BCLog::MEMPOOLREJ, "%s from peer=%d was not accepted: %s\n", tx.GetHash().ToString(),
-                pfrom.GetId(),
-                state.ToString());
-            MaybePunishNodeForTx(pfrom.GetId(), state);
+        // Validation is deferred to the end of the current pass over all peers (see
+        // ProcessDeferredWork()), so that a burst of transactions from many peers is admitted
+        // to the mempool under a single lock.
+        m_tx_batch.push_back({&pfrom, peer, ptx});
+        if (m_tx_batch.size() >= MAX_TX_BATCH_SIZE) {
+            ProcessTxBatch();
         }
         return;
     }
@@ -3723,6 +4073,7 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
             ReadCompactSize(vRecv); // ignore tx count; assume it is 0.
         }
 
+        if (ProcessHeadersRange(pfrom, headers)) return;
         return ProcessHeadersMessage(pfrom, *peer, headers, /*via_compact_block=*/false);
     }
 
@@ -3734,6 +4085,7 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
             return;
         }
 
+        const size_t block_size{vRecv.size()};
         std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
         vRecv >> *pblock;
 
@@ -3743,6 +4095,11 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
         const uint256 hash(pblock->GetHash());
         {
             LOCK(cs_main);
+            const auto in_flight = mapBlocksInFlight.find(hash);
+            if (in_flight != mapBlocksInFlight.end() && in_flight->second.first == pfrom.GetId()) {
+                m_block_download.BlockReceived(pfrom.GetId(), in_flight->second.second->m_requested_time,
+                                               GetTime<std::chrono::microseconds>(), block_size);
+            }
             // Always process the block if we requested it, since we may
             // need it even when it's not a candidate for a new best tip.
             forceProcessing = IsBlockRequested(hash);
@@ -3779,7 +4136,6 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
         }
         peer->m_getaddr_recvd = true;
 
-        peer->m_addrs_to_send.clear();
         std::vector<CAddress> vAddr;
         if (pfrom.HasPermission(NetPermissionFlags::Addr)) {
             vAddr = m_connman.GetAddresses(MAX_ADDR_TO_SEND, MAX_PCT_ADDR_TO_SEND, /* network */ std::nullopt);
@@ -3787,6 +4143,8 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
             vAddr = m_connman.GetAddresses(pfrom, MAX_ADDR_TO_SEND, MAX_PCT_ADDR_TO_SEND);
         }
         FastRandomContext insecure_rand;
+        LOCK(peer->m_addr_relay_mutex);
+        peer->m_addrs_to_send.clear();
         for (const CAddress &addr : vAddr) {
             PushAddress(*peer, addr, insecure_rand);
         }
@@ -4063,7 +4421,9 @@ bool PeerManagerImpl::ProcessMessages(CNode* pfrom, std::atomic<bool>& interrupt
         }
     }
 
-    {
+    // Only take cs_main if there is orphan work, so that messages which don't need
+    // it can be processed while another message handler thread holds it.
+    if (WITH_LOCK(g_cs_orphans, return !peer->m_orphan_work_set.empty())) {
         LOCK2(cs_main, g_cs_orphans);
         if (!peer->m_orphan_work_set.empty()) {
             ProcessOrphanTx(peer->m_orphan_work_set);
@@ -4363,7 +4723,7 @@ void PeerManagerImpl::MaybeSendAddr(CNode& node, Peer& peer, std::chrono::micros
     // Nothing to do for non-address-relay peers
     if (!peer.m_addr_relay_enabled) return;
 
-    LOCK(peer.m_addr_send_times_mutex);
+    LOCK2(peer.m_addr_send_times_mutex, peer.m_addr_relay_mutex);
     // Periodically advertise our local address to the peer.
     if (fListen && !m_chainman.ActiveChainstate().IsInitialBlockDownload() &&
         peer.m_next_local_addr_send < current_time) {
@@ -4396,7 +4756,7 @@ void PeerManagerImpl::MaybeSendAddr(CNode& node, Peer& peer, std::chrono::micros
 
     // Remove addr records that the peer already knows about, and add new
     // addrs to the m_addr_known filter on the same pass.
-    auto addr_already_known = [&peer](const CAddress& addr) {
+    auto addr_already_known = [&peer](const CAddress& addr) EXCLUSIVE_LOCKS_REQUIRED(peer.m_addr_relay_mutex) {
         bool ret = peer.m_addr_known->contains(addr.GetKey());
         if (!ret) peer.m_addr_known->insert(addr.GetKey());
         return ret;
@@ -4496,10 +4856,12 @@ bool PeerManagerImpl::SetupAddressRelay(const CNode& node, Peer& peer)
     // information of addr traffic to infer the link.
     if (node.IsBlockOnlyConn()) return false;
 
-    if (!peer.m_addr_relay_enabled.exchange(true)) {
+    if (!peer.m_addr_relay_enabled) {
         // First addr message we have received from the peer, initialize
-        // m_addr_known
-        peer.m_addr_known = std::make_unique<CRollingBloomFilter>(5000, 0.001);
+        // m_addr_known. Only enable relay afterwards, as the message handler
+        // threads of other peers may relay addresses to this peer right away.
+        WITH_LOCK(peer.m_addr_relay_mutex, peer.m_addr_known = std::make_unique<CRollingBloomFilter>(5000, 0.001));
+        peer.m_addr_relay_enabled = true;
     }
 
     return true;
@@ -4572,6 +4934,13 @@ bool PeerManagerImpl::SendMessages(CNode* pto)
                 m_connman.PushMessage(pto, msgMaker.Make(NetMsgType::GETHEADERS, m_chainman.ActiveChain().GetLocator(pindexStart), uint256()));
             }
         }
+        // Meanwhile, fetch the headers between checkpoints ahead of the best header from other peers.
+        if (!state.fSyncStarted && fFetch && !pto->fClient && !fImporting && !fReindex) {
+            if (const auto request{m_headers_sync.AssignRange(pto->GetId(), pindexBestHeader->nHeight, current_time)}) {
+                LogPrint(BCLog::NET, "getheaders after %s up to checkpoint %s to peer=%d\n", request->locator_hash.ToString(), request->stop_hash.ToString(), pto->GetId());
+                m_connman.PushMessage(pto, msgMaker.Make(NetMsgType::GETHEADERS, CBlockLocator({request->locator_hash}), request->stop_hash));
+            }
+        }
 
         //
         // Try sending block announcements via headers
@@ -4652,7 +5021,9 @@ bool PeerManagerImpl::SendMessages(CNode* pto)
                     {
                         LOCK(cs_most_recent_block);
                         if (most_recent_block_hash == pBestIndex->GetBlockHash()) {
-                            if (state.fWantsCmpctWitness || !fWitnessesPresentInMostRecentCompactBlock)
+                            if (state.fWantsCmpctWitness)
+                                m_connman.PushMessage(pto, most_recent_compact_block_msg.Copy());
+                            else if (!fWitnessesPresentInMostRecentCompactBlock)
                                 m_connman.PushMessage(pto, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, *most_recent_compact_block));
                             else {
                                 CBlockHeaderAndShortTxIDs cmpctblock(*most_recent_block, state.fWantsCmpctWitness);
@@ -4662,11 +5033,8 @@ bool PeerManagerImpl::SendMessages(CNode* pto)
                         }
                     }
                     if (!fGotBlockFromCache) {
-                        CBlock block;
-                        bool ret = ReadBlockFromDisk(block, pBestIndex, consensusParams);
-                        assert(ret);
-                        CBlockHeaderAndShortTxIDs cmpctblock(block, state.fWantsCmpctWitness);
-                        m_connman.PushMessage(pto, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, cmpctblock));
+                        const auto cmpctblock = GetCompactBlockToServe(pBestIndex->GetBlockHash(), pBestIndex, state.fWantsCmpctWitness, /*recent_block=*/nullptr);
+                        m_connman.PushMessage(pto, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, *cmpctblock));
                     }
                     state.pindexBestHeaderSent = pBestIndex;
                 } else if (state.fPreferHeaders) {
@@ -4744,10 +5112,17 @@ bool PeerManagerImpl::SendMessages(CNode* pto)
                     }
                 }
 
+                // Make the transactions relayed since the last trickle to any peer
+                // available to all peers, in announcement order.
+                if (fSendTrickle) m_tx_relay_queue.Seal(m_mempool);
+
                 // Time to send but the peer has requested we not relay transactions.
                 if (fSendTrickle) {
                     LOCK(pto->m_tx_relay->cs_filter);
-                    if (!pto->m_tx_relay->fRelayTxes) pto->m_tx_relay->setInventoryTxToSend.clear();
+                    if (!pto->m_tx_relay->fRelayTxes) {
+                        pto->m_tx_relay->setInventoryTxToSend.clear();
+                        m_tx_relay_queue.SkipAll(pto->GetId());
+                    }
                 }
 
                 // Respond to BIP35 mempool requests
@@ -4782,46 +5157,36 @@ bool PeerManagerImpl::SendMessages(CNode* pto)
 
                 // Determine transactions to relay
                 if (fSendTrickle) {
-                    // Produce a vector with all candidates for sending
-                    std::vector<std::set<uint256>::iterator> vInvTx;
-                    vInvTx.reserve(pto->m_tx_relay->setInventoryTxToSend.size());
-                    for (std::set<uint256>::iterator it = pto->m_tx_relay->setInventoryTxToSend.begin(); it != pto->m_tx_relay->setInventoryTxToSend.end(); it++) {
-                        vInvTx.push_back(it);
-                    }
                     const CFeeRate filterrate{pto->m_tx_relay->minFeeFilter.load()};
-                    // Topologically and fee-rate sort the inventory we send for privacy and priority reasons.
-                    // A heap is used so that not all items need sorting if only a few are being sent.
-                    CompareInvMempoolOrder compareInvMempoolOrder(&m_mempool, state.m_wtxid_relay);
-                    std::make_heap(vInvTx.begin(), vInvTx.end(), compareInvMempoolOrder);
                     // No reason to drain out at many times the network's capacity,
                     // especially since we have many peers and some will draw much shorter delays.
                     unsigned int nRelayedTransactions = 0;
                     LOCK(pto->m_tx_relay->cs_filter);
-                    while (!vInvTx.empty() && nRelayedTransactions < INVENTORY_BROADCAST_MAX) {
-                        // Fetch the top element from the heap
-                        std::pop_heap(vInvTx.begin(), vInvTx.end(), compareInvMempoolOrder);
-                        std::set<uint256>::iterator it = vInvTx.back();
-                        vInvTx.pop_back();
-                        uint256 hash = *it;
+                    const auto announce = [&](const uint256& hash, bool reconciled)
+                        EXCLUSIVE_LOCKS_REQUIRED(::cs_main, pto->m_tx_relay->cs_tx_inventory, pto->m_tx_relay->cs_filter) {
                         CInv inv(state.m_wtxid_relay ? MSG_WTX : MSG_TX, hash);
-                        // Remove it from the to-be-sent set
-                        pto->m_tx_relay->setInventoryTxToSend.erase(it);
                         // Check if not in the filter already
                         if (pto->m_tx_relay->filterInventoryKnown.contains(hash)) {
-                            continue;
+                            return;
                         }
                         // Not in the mempool anymore? don't bother sending it.
                         auto txinfo = m_mempool.info(ToGenTxid(inv));
                         if (!txinfo.tx) {
-                            continue;
+                            return;
                         }
                         auto txid = txinfo.tx->GetHash();
                         auto wtxid = txinfo.tx->GetWitnessHash();
                         // Peer told you to not send transactions at that feerate? Don't bother sending it.
                         if (txinfo.fee < filterrate.GetFee(txinfo.vsize)) {
-                            continue;
+                            return;
+                        }
+                        if (pto->m_tx_relay->pfilter && !pto->m_tx_relay->pfilter->IsRelevantAndUpdate(*txinfo.tx)) return;
+                        // Reconcile it with the peer instead, unless it is flooded to this peer or
+                        // reconciliation found the peer is missing it
+                        if (!reconciled && m_txreconciliation && !m_txreconciliation->ShouldFanoutTo(hash, pto->GetId()) &&
+                            m_txreconciliation->AddToSet(pto->GetId(), hash)) {
+                            return;
                         }
-                        if (pto->m_tx_relay->pfilter && !pto->m_tx_relay->pfilter->IsRelevantAndUpdate(*txinfo.tx)) continue;
                         // Send
                         State(pto->GetId())->m_recently_announced_invs.insert(hash);
                         vInv.push_back(inv);
@@ -4857,6 +5222,49 @@ bool PeerManagerImpl::SendMessages(CNode* pto)
                             // ProcessGetData().
                             pto->m_tx_relay->filterInventoryKnown.insert(txid);
                         }
+                    };
+
+                    // First the transactions to announce to this peer only, which are few.
+                    // Topologically and fee-rate sort them for privacy and priority reasons.
+                    // A heap is used so that not all items need sorting if only a few are being sent.
+                    std::vector<std::set<uint256>::iterator> vInvTx;
+                    vInvTx.reserve(pto->m_tx_relay->setInventoryTxToSend.size());
+                    for (std::set<uint256>::iterator it = pto->m_tx_relay->setInventoryTxToSend.begin(); it != pto->m_tx_relay->setInventoryTxToSend.end(); it++) {
+                        vInvTx.push_back(it);
+                    }
+                    CompareInvMempoolOrder compareInvMempoolOrder(&m_mempool, state.m_wtxid_relay);
+                    std::make_heap(vInvTx.begin(), vInvTx.end(), compareInvMempoolOrder);
+                    while (!vInvTx.empty() && nRelayedTransactions < INVENTORY_BROADCAST_MAX) {
+                        // Fetch the top element from the heap
+                        std::pop_heap(vInvTx.begin(), vInvTx.end(), compareInvMempoolOrder);
+                        std::set<uint256>::iterator it = vInvTx.back();
+                        vInvTx.pop_back();
+                        uint256 hash = *it;
+                        // Remove it from the to-be-sent set
+                        pto->m_tx_relay->setInventoryTxToSend.erase(it);
+                        const bool reconciled = pto->m_tx_relay->m_recon_announce.erase(hash);
+                        announce(hash, reconciled);
+                    }
+
+                    // Then the transactions relayed to all peers, which are already in
+                    // announcement order.
+                    if (nRelayedTransactions < INVENTORY_BROADCAST_MAX) {
+                        m_tx_relay_queue.ForEachPending(pto->GetId(), [&](const TxRelayQueue::Entry& entry)
+                            EXCLUSIVE_LOCKS_REQUIRED(::cs_main, pto->m_tx_relay->cs_tx_inventory, pto->m_tx_relay->cs_filter) {
+                            announce(state.m_wtxid_relay ? entry.m_wtxid : entry.m_txid, /*reconciled=*/false);
+                            return nRelayedTransactions < INVENTORY_BROADCAST_MAX;
+                        });
+                    }
+
+                    // Reconcile with the peer (BIP330) along with the announcements, so that the
+                    // transactions just added to its reconciliation set are included.
+                    if (m_txreconciliation) {
+                        if (const auto request = m_txreconciliation->InitiateReconciliationRequest(pto->GetId(), current_time)) {
+                            m_connman.PushMessage(pto, msgMaker.Make(NetMsgType::REQTXRCNCL, request->m_set_size, request->m_q));
+                        }
+                        if (const auto sketch = m_txreconciliation->RespondToReconciliationRequest(pto->GetId())) {
+                            m_connman.PushMessage(pto, msgMaker.Make(NetMsgType::SKETCH, *sketch));
+                        }
                     }
                 }
         }
@@ -4927,10 +5335,11 @@ bool PeerManagerImpl::SendMessages(CNode* pto)
         // Message: getdata (blocks)
         //
         std::vector<CInv> vGetData;
-        if (!pto->fClient && ((fFetch && !pto->m_limited_node) || !m_chainman.ActiveChainstate().IsInitialBlockDownload()) && state.nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER) {
+        const int max_blocks_in_flight{m_block_download.GetMaxBlocksInFlight(pto->GetId())};
+        if (!pto->fClient && ((fFetch && !pto->m_limited_node) || !m_chainman.ActiveChainstate().IsInitialBlockDownload()) && state.nBlocksInFlight < max_blocks_in_flight) {
             std::vector<const CBlockIndex*> vToDownload;
             NodeId staller = -1;
-            FindNextBlocksToDownload(pto->GetId(), MAX_BLOCKS_IN_TRANSIT_PER_PEER - state.nBlocksInFlight, vToDownload, staller);
+            FindNextBlocksToDownload(pto->GetId(), max_blocks_in_flight - state.nBlocksInFlight, vToDownload, staller);
             for (const CBlockIndex *pindex : vToDownload) {
                 uint32_t nFetchFlags = GetFetchFlags(*pto);
                 vGetData.push_back(CInv(MSG_BLOCK | nFetchFlags, pindex->GetBlockHash()));
@@ -4939,7 +5348,26 @@ bool PeerManagerImpl::SendMessages(CNode* pto)
                     pindex->nHeight, pto->GetId());
             }
             if (state.nBlocksInFlight == 0 && staller != -1) {
-                if (State(staller)->m_stalling_since == 0us) {
+                // Request the blocks of the peer that holds back the download window from this one instead,
+                // if it is expected to deliver them earlier, rather than waiting for the staller to time out.
+                std::vector<const CBlockIndex*> rerequest;
+                int queue_position{0};
+                for (const QueuedBlock& queued : State(staller)->vBlocksInFlight) {
+                    if (int(rerequest.size()) >= max_blocks_in_flight) break;
+                    // Only blocks on the chain this peer announced
+                    const bool has_block{state.pindexBestKnownBlock && state.pindexBestKnownBlock->GetAncestor(queued.pindex->nHeight) == queued.pindex};
+                    if (has_block && m_block_download.ShouldRerequest(staller, queued.m_requested_time, queue_position, pto->GetId(), rerequest.size(), current_time)) {
+                        rerequest.push_back(queued.pindex);
+                    }
+                    ++queue_position;
+                }
+                for (const CBlockIndex* pindex : rerequest) {
+                    vGetData.push_back(CInv(MSG_BLOCK | GetFetchFlags(*pto), pindex->GetBlockHash()));
+                    BlockRequested(pto->GetId(), *pindex);
+                    LogPrint(BCLog::NET, "Requesting block %s (%d) stalled at peer=%d from peer=%d\n", pindex->GetBlockHash().ToString(),
+                             pindex->nHeight, staller, pto->GetId());
+                }
+                if (rerequest.empty() && State(staller)->m_stalling_since == 0us) {
                     State(staller)->m_stalling_since = current_time;
                     LogPrint(BCLog::NET, "Stall started peer=%d\n", staller);
                 }
@@ -7,6 +7,7 @@
 #define BITCOIN_NET_PROCESSING_H
 
 #include <net.h>
+#include <node/blockcache.h>
 #include <validationinterface.h>
 
 class AddrMan;
@@ -48,6 +49,9 @@ public:
     /** Get statistics from node state */
     virtual bool GetNodeStateStats(NodeId nodeid, CNodeStateStats& stats) const = 0;
 
+    /** Get statistics of the cache of blocks served to peers */
+    virtual BlockCache::Stats GetBlockCacheStats() const = 0;
+
     /** Whether this node ignores txs received over p2p. */
     virtual bool IgnoresIncomingTxs() = 0;
 
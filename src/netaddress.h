@@ -33,6 +33,8 @@
  */
 static constexpr int ADDRV2_FORMAT = 0x20000000;
 
+class CompiledAsmap;
+
 /**
  * A network type.
  * @note An address may belong to more than one network, for example `10.0.0.1`
@@ -206,9 +208,9 @@ public:
     // The AS on the BGP path to the node we use to diversify
     // peers in AddrMan bucketing based on the AS infrastructure.
     // The ip->AS mapping depends on how asmap is constructed.
-    uint32_t GetMappedAS(const std::vector<bool>& asmap) const;
+    uint32_t GetMappedAS(const CompiledAsmap& asmap) const;
 
-    std::vector<unsigned char> GetGroup(const std::vector<bool>& asmap) const;
+    std::vector<unsigned char> GetGroup(const CompiledAsmap& asmap) const;
     std::vector<unsigned char> GetAddrBytes() const;
     int GetReachabilityFrom(const CNetAddr* paddrPartner = nullptr) const;
 
@@ -254,6 +256,8 @@ public:
     }
 
     friend class CSubNet;
+    template <typename T>
+    friend class SubNetTrie;
 
 private:
     /**
@@ -522,6 +526,9 @@ public:
     friend bool operator==(const CSubNet& a, const CSubNet& b);
     friend bool operator!=(const CSubNet& a, const CSubNet& b) { return !(a == b); }
     friend bool operator<(const CSubNet& a, const CSubNet& b);
+
+    template <typename T>
+    friend class SubNetTrie;
 };
 
 /** A combination of a network address (CNetAddr) and a (TCP) port */
@@ -0,0 +1,154 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/blockcache.h>
+
+#include <blockencodings.h>
+#include <core_memusage.h>
+#include <primitives/block.h>
+#include <serialize.h>
+#include <streams.h>
+#include <version.h>
+
+#include <cassert>
+
+BlockCache::SerializedBlock BlockCache::Serialize(const CBlock& block, bool witness)
+{
+    auto data = std::make_shared<std::vector<unsigned char>>();
+    CVectorWriter{SER_NETWORK, PROTOCOL_VERSION | (witness ? 0 : SERIALIZE_TRANSACTION_NO_WITNESS), *data, 0, block};
+    return data;
+}
+
+void BlockCache::Insert(const std::shared_ptr<const CBlock>& block)
+{
+    Store(block->GetHash(), [](Entry& entry) -> auto& { return entry.m_block; },
+          block, RecursiveDynamicUsage(block), /*create=*/true);
+}
+
+void BlockCache::InsertSerialized(const uint256& hash, bool witness, SerializedBlock data)
+{
+    const size_t bytes = data->size();
+    Store(hash, [witness](Entry& entry) -> auto& { return witness ? entry.m_witness_data : entry.m_no_witness_data; },
+          std::move(data), bytes, /*create=*/witness);
+}
+
+void BlockCache::InsertCompactBlock(const uint256& hash, bool use_wtxid, std::shared_ptr<const CBlockHeaderAndShortTxIDs> compact_block)
+{
+    const size_t bytes = GetSerializeSize(*compact_block, PROTOCOL_VERSION);
+    Store(hash, [use_wtxid](Entry& entry) -> auto& { return entry.m_compact_blocks[use_wtxid]; },
+          std::move(compact_block), bytes, /*create=*/false);
+}
+
+std::shared_ptr<const CBlock> BlockCache::GetBlock(const uint256& hash)
+{
+    std::shared_ptr<const CBlock> block;
+    SerializedBlock witness_data;
+    {
+        LOCK(m_mutex);
+        const Entry* entry = Lookup(hash);
+        if (!entry) return nullptr;
+        block = entry->m_block;
+        witness_data = entry->m_witness_data;
+    }
+    return LoadBlock(hash, std::move(block), std::move(witness_data));
+}
+
+BlockCache::SerializedBlock BlockCache::GetSerializedBlock(const uint256& hash, bool witness)
+{
+    std::shared_ptr<const CBlock> block;
+    SerializedBlock witness_data;
+    {
+        LOCK(m_mutex);
+        const Entry* entry = Lookup(hash);
+        if (!entry) return nullptr;
+        const SerializedBlock& data = witness ? entry->m_witness_data : entry->m_no_witness_data;
+        if (data) return data;
+        block = entry->m_block;
+        witness_data = entry->m_witness_data;
+    }
+    block = LoadBlock(hash, std::move(block), std::move(witness_data));
+    SerializedBlock data = Serialize(*block, witness);
+    const size_t bytes = data->size();
+    return Store(hash, [witness](Entry& entry) -> auto& { return witness ? entry.m_witness_data : entry.m_no_witness_data; },
+                 std::move(data), bytes, /*create=*/false);
+}
+
+std::shared_ptr<const CBlockHeaderAndShortTxIDs> BlockCache::GetCompactBlock(const uint256& hash, bool use_wtxid)
+{
+    std::shared_ptr<const CBlock> block;
+    SerializedBlock witness_data;
+    {
+        LOCK(m_mutex);
+        const Entry* entry = Lookup(hash);
+        if (!entry) return nullptr;
+        if (entry->m_compact_blocks[use_wtxid]) return entry->m_compact_blocks[use_wtxid];
+        block = entry->m_block;
+        witness_data = entry->m_witness_data;
+    }
+    block = LoadBlock(hash, std::move(block), std::move(witness_data));
+    auto compact_block = std::make_shared<const CBlockHeaderAndShortTxIDs>(*block, use_wtxid);
+    const size_t bytes = GetSerializeSize(*compact_block, PROTOCOL_VERSION);
+    return Store(hash, [use_wtxid](Entry& entry) -> auto& { return entry.m_compact_blocks[use_wtxid]; },
+                 std::move(compact_block), bytes, /*create=*/false);
+}
+
+BlockCache::Stats BlockCache::GetStats() const
+{
+    LOCK(m_mutex);
+    return {m_entries.size(), m_bytes, m_max_bytes, m_hits, m_misses};
+}
+
+BlockCache::Entry* BlockCache::Lookup(const uint256& hash)
+{
+    const auto it = m_entries.find(hash);
+    if (it == m_entries.end()) {
+        ++m_misses;
+        return nullptr;
+    }
+    ++m_hits;
+    m_lru.splice(m_lru.begin(), m_lru, it->second.m_lru_it);
+    return &it->second;
+}
+
+template <typename T, typename GetForm>
+T BlockCache::Store(const uint256& hash, GetForm get_form, T value, size_t bytes, bool create)
+{
+    LOCK(m_mutex);
+    auto it = m_entries.find(hash);
+    if (it == m_entries.end()) {
+        if (!create) return value;
+        it = m_entries.try_emplace(hash).first;
+        m_lru.push_front(hash);
+        it->second.m_lru_it = m_lru.begin();
+    } else {
+        m_lru.splice(m_lru.begin(), m_lru, it->second.m_lru_it);
+    }
+    T& form = get_form(it->second);
+    // Another thread may have stored this form of the block in the meantime
+    if (form) return form;
+    form = value;
+    it->second.m_bytes += bytes;
+    m_bytes += bytes;
+
+    while (m_bytes > m_max_bytes && !m_lru.empty()) {
+        const auto evict = m_entries.find(m_lru.back());
+        assert(evict != m_entries.end());
+        m_bytes -= evict->second.m_bytes;
+        m_entries.erase(evict);
+        m_lru.pop_back();
+    }
+    return value;
+}
+
+std::shared_ptr<const CBlock> BlockCache::LoadBlock(const uint256& hash, std::shared_ptr<const CBlock> block, SerializedBlock witness_data)
+{
+    if (block) return block;
+    // Every entry holds the deserialized block or the block serialized with witnesses
+    assert(witness_data);
+    auto new_block = std::make_shared<CBlock>();
+    SpanReader{SER_NETWORK, PROTOCOL_VERSION, *witness_data, 0} >> *new_block;
+    const size_t bytes = RecursiveDynamicUsage(*new_block);
+    return Store(hash, [](Entry& entry) -> auto& { return entry.m_block; },
+                 std::shared_ptr<const CBlock>{std::move(new_block)}, bytes, /*create=*/false);
+}
@@ -0,0 +1,100 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_BLOCKCACHE_H
+#define BITCOIN_NODE_BLOCKCACHE_H
+
+#include <sync.h>
+#include <uint256.h>
+#include <util/hasher.h>
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+class CBlock;
+class CBlockHeaderAndShortTxIDs;
+
+/** Default for -blockservecache, the memory in MiB for blocks recently served to peers */
+static constexpr int64_t DEFAULT_BLOCK_SERVE_CACHE{32};
+
+/**
+ * Least recently used cache of blocks served to peers, bounded by its memory
+ * usage. Peers tend to ask for the same recent blocks within minutes of each
+ * other, so a cached block is kept in every form it has been sent in:
+ * deserialized, serialized with and without witnesses, and as compact block
+ * with either kind of short ids. Each form is created on first use, outside of
+ * the cache lock, and afterwards shared by reference.
+ */
+class BlockCache
+{
+public:
+    using SerializedBlock = std::shared_ptr<const std::vector<unsigned char>>;
+
+    explicit BlockCache(size_t max_bytes) : m_max_bytes{max_bytes} {}
+
+    /** Serialize a block for the network. */
+    static SerializedBlock Serialize(const CBlock& block, bool witness);
+
+    /** Add a block, evicting the least recently used ones beyond the memory limit. */
+    void Insert(const std::shared_ptr<const CBlock>& block);
+    /** Add a serialized form of a block. Only a block serialized with witnesses, as
+     *  stored on disk, is added if the block is not cached yet. */
+    void InsertSerialized(const uint256& hash, bool witness, SerializedBlock data);
+    /** Add a compact block to an already cached block. */
+    void InsertCompactBlock(const uint256& hash, bool use_wtxid, std::shared_ptr<const CBlockHeaderAndShortTxIDs> compact_block);
+
+    /** The lookups count a cache hit or miss, and return nullptr on a miss. */
+    std::shared_ptr<const CBlock> GetBlock(const uint256& hash);
+    SerializedBlock GetSerializedBlock(const uint256& hash, bool witness);
+    std::shared_ptr<const CBlockHeaderAndShortTxIDs> GetCompactBlock(const uint256& hash, bool use_wtxid);
+
+    struct Stats {
+        size_t m_blocks;
+        size_t m_bytes;
+        size_t m_max_bytes;
+        uint64_t m_hits;
+        uint64_t m_misses;
+    };
+    Stats GetStats() const;
+
+private:
+    struct Entry {
+        std::shared_ptr<const CBlock> m_block;
+        SerializedBlock m_witness_data;
+        SerializedBlock m_no_witness_data;
+        /** Compact blocks with txid and wtxid short ids */
+        std::shared_ptr<const CBlockHeaderAndShortTxIDs> m_compact_blocks[2];
+        /** Memory usage of all forms of the block above */
+        size_t m_bytes{0};
+        /** Position in m_lru */
+        std::list<uint256>::iterator m_lru_it;
+    };
+
+    /** Find a block, mark it as most recently used and count a hit or a miss. */
+    Entry* Lookup(const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+    /**
+     * Store a form of a block, selected from its entry by get_form, and evict blocks
+     * beyond the memory limit. Returns the stored form, which is the one that was
+     * already cached if there is one. An entry for the block is only added if create
+     * is set, otherwise value is returned without caching it.
+     */
+    template <typename T, typename GetForm>
+    T Store(const uint256& hash, GetForm get_form, T value, size_t bytes, bool create);
+    /** The deserialized block of a looked up entry, deserializing it if needed. */
+    std::shared_ptr<const CBlock> LoadBlock(const uint256& hash, std::shared_ptr<const CBlock> block, SerializedBlock witness_data);
+
+    const size_t m_max_bytes;
+    mutable Mutex m_mutex;
+    std::unordered_map<uint256, Entry, SaltedTxidHasher> m_entries GUARDED_BY(m_mutex);
+    /** Block hashes, most recently used first */
+    std::list<uint256> m_lru GUARDED_BY(m_mutex);
+    size_t m_bytes GUARDED_BY(m_mutex){0};
+    uint64_t m_hits GUARDED_BY(m_mutex){0};
+    uint64_t m_misses GUARDED_BY(m_mutex){0};
+};
+
+#endif // BITCOIN_NODE_BLOCKCACHE_H
@@ -0,0 +1,93 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/blockdownload.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+/** Weight of a new sample in the moving averages */
+constexpr double NEW_SAMPLE_WEIGHT{0.25};
+/** Shortest time between two blocks for a throughput sample, as blocks read together arrive at once */
+constexpr std::chrono::milliseconds MIN_THROUGHPUT_SAMPLE_TIME{1};
+
+void AddSample(std::optional<double>& average, double sample)
+{
+    average = average ? *average + NEW_SAMPLE_WEIGHT * (sample - *average) : sample;
+}
+
+double ToSeconds(std::chrono::microseconds duration)
+{
+    return std::chrono::duration<double>{duration}.count();
+}
+
+std::chrono::microseconds FromSeconds(double seconds)
+{
+    return std::chrono::microseconds{std::llround(seconds * 1e6)};
+}
+} // namespace
+
+void BlockDownloadScheduler::BlockReceived(NodeId peer, std::chrono::microseconds requested_time, std::chrono::microseconds now, size_t block_size)
+{
+    PeerDownload& download = m_peers[peer];
+    AddSample(m_avg_block_size, block_size);
+    if (requested_time >= download.m_last_received) {
+        // Nothing was being received from the peer when the block was requested.
+        AddSample(download.m_latency, ToSeconds(std::max(now - requested_time, std::chrono::microseconds{0})));
+    } else {
+        // The peer sent this block right after the previous one.
+        const auto elapsed = std::max<std::chrono::microseconds>(now - download.m_last_received, MIN_THROUGHPUT_SAMPLE_TIME);
+        AddSample(download.m_throughput, block_size / ToSeconds(elapsed));
+    }
+    download.m_last_received = std::max(download.m_last_received, now);
+}
+
+const BlockDownloadScheduler::PeerDownload* BlockDownloadScheduler::GetPeer(NodeId peer) const
+{
+    const auto it = m_peers.find(peer);
+    return it == m_peers.end() ? nullptr : &it->second;
+}
+
+int BlockDownloadScheduler::GetMaxBlocksInFlight(NodeId peer) const
+{
+    const PeerDownload* download = GetPeer(peer);
+    if (!download || !download->m_latency) return INITIAL_BLOCKS_IN_TRANSIT_PER_PEER;
+    // The first block arrives after the latency, and each further one after the time to transfer it.
+    const double time_left = ToSeconds(BLOCK_DOWNLOAD_TARGET_TIME) - *download->m_latency;
+    const double blocks = time_left > 0 ? 1 + time_left / GetTransferTime(*download) : 0;
+    return int(std::clamp<double>(blocks, MIN_BLOCKS_IN_TRANSIT_PER_PEER, MAX_ADAPTIVE_BLOCKS_IN_TRANSIT_PER_PEER));
+}
+
+double BlockDownloadScheduler::GetTransferTime(const PeerDownload& download) const
+{
+    // Until the throughput is known, the latency includes the transfer of a whole block.
+    return download.m_throughput ? *m_avg_block_size / *download.m_throughput : *download.m_latency;
+}
+
+std::optional<std::chrono::microseconds> BlockDownloadScheduler::GetExpectedBlockTime(NodeId peer, int queue_position) const
+{
+    const PeerDownload* download = GetPeer(peer);
+    if (!download || !download->m_latency) return std::nullopt;
+    return FromSeconds(*download->m_latency + queue_position * GetTransferTime(*download));
+}
+
+bool BlockDownloadScheduler::ShouldRerequest(NodeId staller, std::chrono::microseconds requested_time, int queue_position,
+                                             NodeId candidate, int candidate_position, std::chrono::microseconds now) const
+{
+    const auto candidate_time = GetExpectedBlockTime(candidate, candidate_position);
+    if (!candidate_time) return false;
+    const auto in_flight = now - requested_time;
+    if (in_flight < std::max<std::chrono::microseconds>(BLOCK_REREQUEST_MIN_WAIT, BLOCK_REREQUEST_FACTOR * *GetExpectedBlockTime(candidate))) return false;
+    // A staller that did not deliver a block yet is treated as overdue.
+    const PeerDownload* download = GetPeer(staller);
+    if (!download || !download->m_latency) return true;
+    // The block arrives after the latency and the transfer of the blocks before it, but
+    // no earlier than the transfer of those blocks after the last one that arrived.
+    const double transfer_time = GetTransferTime(*download);
+    const auto staller_arrival = std::max(requested_time + FromSeconds(*download->m_latency + queue_position * transfer_time),
+                                          download->m_last_received + FromSeconds((queue_position + 1) * transfer_time));
+    // Blocks the staller should have delivered by now are overdue too.
+    return staller_arrival <= now || staller_arrival > now + *candidate_time;
+}
@@ -0,0 +1,93 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_BLOCKDOWNLOAD_H
+#define BITCOIN_NODE_BLOCKDOWNLOAD_H
+
+#include <net.h>
+
+#include <chrono>
+#include <cstddef>
+#include <optional>
+#include <unordered_map>
+
+/** Number of blocks in flight from a peer before its download speed is known */
+static constexpr int INITIAL_BLOCKS_IN_TRANSIT_PER_PEER{16};
+/** Bounds on the number of blocks in flight from a peer whose download speed is known */
+static constexpr int MIN_BLOCKS_IN_TRANSIT_PER_PEER{2};
+static constexpr int MAX_ADAPTIVE_BLOCKS_IN_TRANSIT_PER_PEER{64};
+/** Peers are assigned the blocks they are expected to deliver within this time */
+static constexpr std::chrono::seconds BLOCK_DOWNLOAD_TARGET_TIME{4};
+/**
+ * A block that holds back the download window is requested from a faster peer once
+ * it has been in flight for this many times the time the faster peer is expected to
+ * take to deliver it, and at least BLOCK_REREQUEST_MIN_WAIT.
+ */
+static constexpr int BLOCK_REREQUEST_FACTOR{2};
+static constexpr std::chrono::milliseconds BLOCK_REREQUEST_MIN_WAIT{500};
+
+/**
+ * Estimates of how fast each peer delivers the blocks requested from it, which
+ * drive how many blocks are requested from the peer, and whether a block that
+ * holds back the download window is requested from another peer before the
+ * peer that has it in flight is considered stalling.
+ *
+ * Two estimates are kept per peer, as exponentially weighted moving averages:
+ * - the latency, from blocks requested while no other block was being received
+ *   from the peer, as the time from the request until the block arrived;
+ * - the throughput, from blocks requested while another one was being received,
+ *   as the size of the block divided by the time since the previous block arrived.
+ *
+ * This class is not thread-safe; its user is expected to synchronize access.
+ */
+class BlockDownloadScheduler
+{
+public:
+    /** Record the arrival of a block from a peer, requested at requested_time. */
+    void BlockReceived(NodeId peer, std::chrono::microseconds requested_time, std::chrono::microseconds now, size_t block_size);
+
+    /** Drop the estimates of a disconnected peer. */
+    void ForgetPeer(NodeId peer) { m_peers.erase(peer); }
+
+    /**
+     * Number of blocks to keep in flight from a peer: the blocks it is expected to
+     * deliver within BLOCK_DOWNLOAD_TARGET_TIME, within the bounds above.
+     */
+    int GetMaxBlocksInFlight(NodeId peer) const;
+
+    /**
+     * Expected time for a peer to deliver a block after it was requested, if the peer
+     * delivered enough blocks to tell, with queue_position blocks requested before it.
+     */
+    std::optional<std::chrono::microseconds> GetExpectedBlockTime(NodeId peer, int queue_position = 0) const;
+
+    /**
+     * Whether a block in flight from staller since requested_time at queue_position, while
+     * staller holds back the download window, should be requested from candidate instead,
+     * after candidate_position other blocks. This is the case if candidate, which had no
+     * blocks in flight, is expected to deliver it before staller, and the block has been in
+     * flight long enough (see above).
+     */
+    bool ShouldRerequest(NodeId staller, std::chrono::microseconds requested_time, int queue_position,
+                         NodeId candidate, int candidate_position, std::chrono::microseconds now) const;
+
+private:
+    struct PeerDownload {
+        /** When the last block from the peer arrived */
+        std::chrono::microseconds m_last_received{0};
+        /** Moving averages of the latency in seconds, and of the throughput in bytes per second */
+        std::optional<double> m_latency;
+        std::optional<double> m_throughput;
+    };
+
+    const PeerDownload* GetPeer(NodeId peer) const;
+    /** Expected time in seconds to transfer a block once the peer started sending it */
+    double GetTransferTime(const PeerDownload& download) const;
+
+    std::unordered_map<NodeId, PeerDownload> m_peers;
+    /** Moving average of the size of received blocks */
+    std::optional<double> m_avg_block_size;
+};
+
+#endif // BITCOIN_NODE_BLOCKDOWNLOAD_H
@@ -0,0 +1,110 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/headerssync.h>
+
+#include <consensus/params.h>
+#include <pow.h>
+
+#include <algorithm>
+#include <iterator>
+
+HeadersSyncScheduler::HeadersSyncScheduler(const MapCheckpoints& checkpoints)
+{
+    for (auto it = checkpoints.begin(); it != checkpoints.end() && std::next(it) != checkpoints.end(); ++it) {
+        const auto& [start_height, start_hash] = *it;
+        const auto& [end_height, end_hash] = *std::next(it);
+        m_ranges.push_back({start_height, end_height, end_hash, start_hash, start_height, {}, start_hash});
+    }
+}
+
+HeadersSyncScheduler::Range* HeadersSyncScheduler::GetRange(NodeId peer)
+{
+    const auto it = std::find_if(m_ranges.begin(), m_ranges.end(), [peer](const Range& range) { return range.m_peer == peer; });
+    return it == m_ranges.end() ? nullptr : &*it;
+}
+
+std::optional<HeadersRangeRequest> HeadersSyncScheduler::AssignRange(NodeId peer, int best_height, std::chrono::microseconds now)
+{
+    if (m_unusable_peers.count(peer) || GetRange(peer)) return std::nullopt;
+    for (Range& range : m_ranges) {
+        // Ranges the best header reached are left to the headers sync peer.
+        if (range.Received() || range.m_start_height <= best_height) continue;
+        if (range.m_peer) {
+            if (range.m_request_time + HEADERS_RANGE_TIMEOUT > now) continue;
+            m_unusable_peers.insert(*range.m_peer);
+        }
+        range.m_peer = peer;
+        range.m_request_time = now;
+        return HeadersRangeRequest{range.m_last_hash, range.m_end_hash};
+    }
+    return std::nullopt;
+}
+
+std::optional<HeadersRangeRequest> HeadersSyncScheduler::GetRequest(NodeId peer) const
+{
+    for (const Range& range : m_ranges) {
+        if (range.m_peer == peer) return HeadersRangeRequest{range.m_last_hash, range.m_end_hash};
+    }
+    return std::nullopt;
+}
+
+HeadersSyncScheduler::Result HeadersSyncScheduler::ReceivedHeaders(NodeId peer, const std::vector<CBlockHeader>& headers,
+                                                                   const Consensus::Params& params, std::chrono::microseconds now)
+{
+    Range* range = GetRange(peer);
+    if (!range) return Result::NOT_FOR_RANGE;
+    // Other headers from the peer, such as announcements, are processed as usual. If the peer
+    // does not know the start of the range, the range is reassigned once the request times out.
+    if (headers.empty() || headers.front().hashPrevBlock != range->m_last_hash) return Result::NOT_FOR_RANGE;
+    if (range->m_last_height + int(headers.size()) > range->m_end_height) return Result::INVALID;
+
+    uint256 prev_hash{range->m_last_hash};
+    for (const CBlockHeader& header : headers) {
+        const uint256 hash{header.GetHash()};
+        if (header.hashPrevBlock != prev_hash || !CheckProofOfWork(hash, header.nBits, params)) return Result::INVALID;
+        prev_hash = hash;
+    }
+    const int last_height{range->m_last_height + int(headers.size())};
+    if (last_height == range->m_end_height && prev_hash != range->m_end_hash) return Result::INVALID;
+
+    range->m_headers.insert(range->m_headers.end(), headers.begin(), headers.end());
+    range->m_last_hash = prev_hash;
+    range->m_last_height = last_height;
+    range->m_request_time = now;
+    if (range->Received()) {
+        range->m_peer.reset();
+        return Result::DONE;
+    }
+    if (headers.size() < MAX_HEADERS_RESULTS) {
+        range->m_peer.reset();
+        m_unusable_peers.insert(peer);
+        return Result::UNSERVED;
+    }
+    return Result::MORE;
+}
+
+std::vector<CBlockHeader> HeadersSyncScheduler::TakeConnectableHeaders(const std::function<bool(const uint256&)>& is_known, size_t max_count)
+{
+    for (Range& range : m_ranges) {
+        if (range.m_headers.empty() || !is_known(range.m_connect_hash)) continue;
+        const size_t count{std::min(max_count, range.m_headers.size())};
+        std::vector<CBlockHeader> headers{range.m_headers.begin(), range.m_headers.begin() + count};
+        range.m_headers.erase(range.m_headers.begin(), range.m_headers.begin() + count);
+        range.m_connect_hash = headers.back().GetHash();
+        return headers;
+    }
+    return {};
+}
+
+void HeadersSyncScheduler::ForgetPeer(NodeId peer)
+{
+    if (Range* range = GetRange(peer)) range->m_peer.reset();
+    m_unusable_peers.erase(peer);
+}
+
+size_t HeadersSyncScheduler::GetPendingRangeCount() const
+{
+    return std::count_if(m_ranges.begin(), m_ranges.end(), [](const Range& range) { return !range.Received(); });
+}
@@ -0,0 +1,117 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_HEADERSSYNC_H
+#define BITCOIN_NODE_HEADERSSYNC_H
+
+#include <chainparams.h>
+#include <net.h>
+#include <primitives/block.h>
+#include <uint256.h>
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <set>
+#include <vector>
+
+namespace Consensus {
+struct Params;
+} // namespace Consensus
+
+/** Number of headers sent in one getheaders result. We rely on the assumption that if a peer sends
+ *  less than this number, we reached its tip. Changing this value is a protocol upgrade. */
+static const unsigned int MAX_HEADERS_RESULTS = 2000;
+/** Time a peer has to answer a request for headers of a range before the range is given to another peer */
+static constexpr std::chrono::minutes HEADERS_RANGE_TIMEOUT{2};
+
+/** A getheaders request for a range: the headers after locator_hash, up to stop_hash */
+struct HeadersRangeRequest {
+    uint256 locator_hash;
+    uint256 stop_hash;
+};
+
+/**
+ * Fetches headers between consecutive checkpoints from several peers at once, while
+ * the headers sync peer fetches them from the best known header onwards.
+ *
+ * The headers of each range start after a checkpoint and end at the next one, so
+ * they can be requested before the headers leading up to the range are known. On
+ * arrival, they are checked for continuity, proof of work and the checkpoint at the
+ * end of the range; the other checks need the headers before them, so they are kept
+ * until the start of the range is in the block index, and then connected in order.
+ *
+ * This class is not thread-safe; its user is expected to synchronize access.
+ */
+class HeadersSyncScheduler
+{
+public:
+    enum class Result {
+        /** The headers are not a response to a range request from this peer */
+        NOT_FOR_RANGE,
+        /** Part of the range was received; request more with GetRequest() */
+        MORE,
+        /** The range was received completely */
+        DONE,
+        /** The peer does not have all headers of the range, which was given back */
+        UNSERVED,
+        /** The headers are invalid, or do not end at the checkpoint */
+        INVALID,
+    };
+
+    explicit HeadersSyncScheduler(const MapCheckpoints& checkpoints);
+
+    /**
+     * Assign to a peer the first range that is not received yet, nor assigned to
+     * another peer, and starts after best_height. Ranges assigned to a peer for
+     * longer than HEADERS_RANGE_TIMEOUT are reassigned.
+     */
+    std::optional<HeadersRangeRequest> AssignRange(NodeId peer, int best_height, std::chrono::microseconds now);
+
+    /** The next request for the range assigned to a peer, if any. */
+    std::optional<HeadersRangeRequest> GetRequest(NodeId peer) const;
+
+    /** Handle headers received from a peer. */
+    Result ReceivedHeaders(NodeId peer, const std::vector<CBlockHeader>& headers, const Consensus::Params& params,
+                           std::chrono::microseconds now);
+
+    /**
+     * Take up to max_count received headers that follow a header for which is_known
+     * returns true, to connect them to the block index.
+     */
+    std::vector<CBlockHeader> TakeConnectableHeaders(const std::function<bool(const uint256&)>& is_known, size_t max_count);
+
+    /** Give back the range assigned to a disconnected peer. */
+    void ForgetPeer(NodeId peer);
+
+    /** Number of ranges that are not received completely */
+    size_t GetPendingRangeCount() const;
+
+private:
+    struct Range {
+        /** Height of the checkpoint the range starts after, and of the one it ends at */
+        int m_start_height;
+        int m_end_height;
+        uint256 m_end_hash;
+        /** Hash and height of the last header received */
+        uint256 m_last_hash;
+        int m_last_height;
+        /** Received headers, not connected yet, which follow m_connect_hash */
+        std::deque<CBlockHeader> m_headers;
+        uint256 m_connect_hash;
+        std::optional<NodeId> m_peer;
+        std::chrono::microseconds m_request_time{0};
+
+        bool Received() const { return m_last_height == m_end_height; }
+    };
+
+    Range* GetRange(NodeId peer);
+
+    std::vector<Range> m_ranges;
+    /** Peers that did not serve a range, which are not assigned any other */
+    std::set<NodeId> m_unusable_peers;
+};
+
+#endif // BITCOIN_NODE_HEADERSSYNC_H
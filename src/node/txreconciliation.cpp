@@ -0,0 +1,378 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/txreconciliation.h>
+
+#include <crypto/siphash.h>
+#include <hash.h>
+#include <logging.h>
+#include <minisketch.h>
+#include <node/minisketchwrapper.h>
+#include <random.h>
+#include <sync.h>
+#include <util/hasher.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+/** Static salt component used to compute short txids for reconciliation (BIP 330). */
+const std::string RECON_STATIC_SALT = "Tx Relay Salting";
+
+const CHashWriter RECON_SALT_HASHER = TaggedHash(RECON_STATIC_SALT);
+
+/** Combine the salts of both peers, in ascending order as defined by BIP 330. */
+uint256 ComputeSalt(uint64_t salt1, uint64_t salt2)
+{
+    const uint64_t salt_lower = std::min(salt1, salt2), salt_upper = std::max(salt1, salt2);
+    return (CHashWriter(RECON_SALT_HASHER) << salt_lower << salt_upper).GetSHA256();
+}
+
+/** Reconciliation state of a registered peer. */
+struct TxReconciliationState {
+    /** Whether we made the connection, and therefore initiate the reconciliations */
+    const bool m_we_initiate;
+
+    /** Keys for computing the short ids of transactions */
+    const uint64_t m_k0, m_k1;
+
+    /** Transactions to announce to the peer at the next reconciliation */
+    std::unordered_set<uint256, SaltedTxidHasher> m_local_set;
+
+    /** Initiator: when to request the next reconciliation */
+    std::chrono::microseconds m_next_request{0};
+    /** Initiator: whether a request was sent and the sketch is outstanding */
+    bool m_awaiting_sketch{false};
+    /** Initiator: coefficient estimating the set difference from past reconciliations */
+    double m_q{DEFAULT_RECON_Q};
+
+    /** Responder: the peer's request, not yet responded to */
+    std::optional<TxReconciliationTracker::ReconciliationRequest> m_pending_request;
+    /** Responder: whether a sketch was sent and the peer's RECONCILDIFF is outstanding */
+    bool m_awaiting_diff{false};
+    /** Responder: the set the sent sketch was computed from */
+    std::vector<uint256> m_sketched_set;
+
+    TxReconciliationState(bool we_initiate, uint64_t k0, uint64_t k1) : m_we_initiate{we_initiate}, m_k0{k0}, m_k1{k1} {}
+
+    /** Short ids are 32 bits and never 0, which minisketch cannot represent. */
+    uint32_t ComputeShortID(const uint256& wtxid) const
+    {
+        const uint64_t s = SipHashUint256(m_k0, m_k1, wtxid);
+        return 1 + (s % 0xFFFFFFFF);
+    }
+
+    /** Sketch a set of transactions, and map their short ids back to them. */
+    template <typename Set>
+    Minisketch ComputeSketch(const Set& set, uint32_t capacity, std::unordered_map<uint32_t, uint256>& short_ids) const
+    {
+        Minisketch sketch = MakeMinisketch32(capacity);
+        for (const uint256& wtxid : set) {
+            const uint32_t short_id = ComputeShortID(wtxid);
+            // Ignore the unlikely collisions; adding an element twice would remove it.
+            if (short_ids.emplace(short_id, wtxid).second) sketch.Add(short_id);
+        }
+        return sketch;
+    }
+};
+
+} // namespace
+
+class TxReconciliationTracker::Impl
+{
+    const uint32_t m_recon_version;
+    /** Keys for picking the peers transactions are flooded to */
+    const uint64_t m_fanout_k0{GetRand(UINT64_MAX)};
+    const uint64_t m_fanout_k1{GetRand(UINT64_MAX)};
+
+    mutable Mutex m_mutex;
+    /** Salts we sent to peers that did not complete the handshake yet */
+    std::unordered_map<NodeId, uint64_t> m_pre_registered GUARDED_BY(m_mutex);
+    std::unordered_map<NodeId, TxReconciliationState> m_states GUARDED_BY(m_mutex);
+
+    TxReconciliationState* GetState(NodeId peer_id) EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        const auto it = m_states.find(peer_id);
+        return it == m_states.end() ? nullptr : &it->second;
+    }
+
+public:
+    explicit Impl(uint32_t recon_version) : m_recon_version{recon_version} {}
+
+    uint64_t PreRegisterPeer(NodeId peer_id)
+    {
+        const uint64_t local_salt = GetRand(UINT64_MAX);
+        LOCK(m_mutex);
+        LogPrint(BCLog::NET, "Pre-register peer=%d for reconciling transactions\n", peer_id);
+        m_pre_registered[peer_id] = local_salt;
+        return local_salt;
+    }
+
+    ReconciliationRegisterResult RegisterPeer(NodeId peer_id, bool is_peer_inbound, uint32_t peer_recon_version, uint64_t remote_salt)
+    {
+        LOCK(m_mutex);
+        if (m_states.count(peer_id)) return ReconciliationRegisterResult::ALREADY_REGISTERED;
+        const auto pre_registered = m_pre_registered.find(peer_id);
+        if (pre_registered == m_pre_registered.end()) return ReconciliationRegisterResult::NOT_FOUND;
+
+        // Versions are backwards compatible; use the lowest common one.
+        const uint32_t recon_version = std::min(peer_recon_version, m_recon_version);
+        if (recon_version < 1) return ReconciliationRegisterResult::PROTOCOL_VIOLATION;
+
+        const uint256 full_salt = ComputeSalt(pre_registered->second, remote_salt);
+        m_pre_registered.erase(pre_registered);
+        LogPrint(BCLog::NET, "Register peer=%d for reconciling transactions (%s)\n", peer_id, is_peer_inbound ? "responder" : "initiator");
+        m_states.try_emplace(peer_id, /*we_initiate=*/!is_peer_inbound, full_salt.GetUint64(0), full_salt.GetUint64(1));
+        return ReconciliationRegisterResult::SUCCESS;
+    }
+
+    void ForgetPeer(NodeId peer_id)
+    {
+        LOCK(m_mutex);
+        m_pre_registered.erase(peer_id);
+        m_states.erase(peer_id);
+    }
+
+    bool IsPeerRegistered(NodeId peer_id) const
+    {
+        LOCK(m_mutex);
+        return m_states.count(peer_id);
+    }
+
+    bool ShouldFanoutTo(const uint256& wtxid, NodeId peer_id) const
+    {
+        LOCK(m_mutex);
+        const auto it = m_states.find(peer_id);
+        if (it == m_states.end()) return true;
+        const uint64_t hash = SipHashUint256Extra(m_fanout_k0, m_fanout_k1, wtxid, peer_id);
+        if (!it->second.m_we_initiate) {
+            return hash < INBOUND_FANOUT_DESTINATIONS_FRACTION * std::numeric_limits<uint64_t>::max();
+        }
+        // Flood to the outbound peers with the lowest hashes for this transaction.
+        size_t lower{0};
+        for (const auto& [other_id, other] : m_states) {
+            if (other_id == peer_id || !other.m_we_initiate) continue;
+            if (SipHashUint256Extra(m_fanout_k0, m_fanout_k1, wtxid, other_id) < hash && ++lower >= OUTBOUND_FANOUT_DESTINATIONS) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool AddToSet(NodeId peer_id, const uint256& wtxid)
+    {
+        LOCK(m_mutex);
+        TxReconciliationState* state = GetState(peer_id);
+        if (!state || state->m_local_set.size() >= MAX_RECONSET_SIZE) return false;
+        state->m_local_set.insert(wtxid);
+        return true;
+    }
+
+    void TryRemovingFromSet(NodeId peer_id, const uint256& wtxid)
+    {
+        LOCK(m_mutex);
+        TxReconciliationState* state = GetState(peer_id);
+        if (state) state->m_local_set.erase(wtxid);
+    }
+
+    std::optional<ReconciliationRequest> InitiateReconciliationRequest(NodeId peer_id, std::chrono::microseconds now)
+    {
+        LOCK(m_mutex);
+        TxReconciliationState* state = GetState(peer_id);
+        if (!state || !state->m_we_initiate || state->m_awaiting_sketch) return std::nullopt;
+        if (state->m_next_request.count() == 0) {
+            // The first reconciliation is a full interval after the handshake.
+            state->m_next_request = now + RECON_REQUEST_INTERVAL;
+            return std::nullopt;
+        }
+        if (now < state->m_next_request) return std::nullopt;
+        state->m_next_request = now + RECON_REQUEST_INTERVAL;
+        state->m_awaiting_sketch = true;
+        const size_t set_size = std::min<size_t>(state->m_local_set.size(), std::numeric_limits<uint16_t>::max());
+        return ReconciliationRequest{uint16_t(set_size), uint16_t(std::lround(state->m_q * Q_PRECISION))};
+    }
+
+    bool HandleReconciliationRequest(NodeId peer_id, uint16_t peer_set_size, uint16_t peer_q)
+    {
+        LOCK(m_mutex);
+        TxReconciliationState* state = GetState(peer_id);
+        if (!state || state->m_we_initiate) return false;
+        // The peer must wait for the previous reconciliation to finish.
+        if (state->m_pending_request || state->m_awaiting_diff) return false;
+        state->m_pending_request = ReconciliationRequest{peer_set_size, peer_q};
+        return true;
+    }
+
+    std::optional<std::vector<uint8_t>> RespondToReconciliationRequest(NodeId peer_id)
+    {
+        LOCK(m_mutex);
+        TxReconciliationState* state = GetState(peer_id);
+        if (!state || !state->m_pending_request) return std::nullopt;
+        const ReconciliationRequest request = *state->m_pending_request;
+        state->m_pending_request.reset();
+
+        state->m_sketched_set.assign(state->m_local_set.begin(), state->m_local_set.end());
+        state->m_local_set.clear();
+        state->m_awaiting_diff = true;
+
+        // Estimate the size of the difference from the set sizes as defined by BIP 330, rounding up.
+        const size_t local_size = state->m_sketched_set.size(), remote_size = request.m_set_size;
+        const double q = double(request.m_q) / Q_PRECISION;
+        const size_t capacity = (local_size > remote_size ? local_size - remote_size : remote_size - local_size) +
+                                size_t(std::ceil(q * std::min(local_size, remote_size))) + 1;
+        if (capacity > MAX_SKETCH_CAPACITY) return std::vector<uint8_t>{};
+
+        std::unordered_map<uint32_t, uint256> short_ids;
+        return state->ComputeSketch(state->m_sketched_set, capacity, short_ids).Serialize();
+    }
+
+    std::optional<SketchResult> HandleSketch(NodeId peer_id, Span<const uint8_t> skdata)
+    {
+        LOCK(m_mutex);
+        TxReconciliationState* state = GetState(peer_id);
+        if (!state || !state->m_we_initiate || !state->m_awaiting_sketch) return std::nullopt;
+        if (skdata.size() % 4 != 0 || skdata.size() / 4 > MAX_SKETCH_CAPACITY) return std::nullopt;
+        state->m_awaiting_sketch = false;
+
+        SketchResult result{/*m_success=*/false, {}, {}};
+        const size_t capacity = skdata.size() / 4;
+        std::optional<std::vector<uint64_t>> difference;
+        std::unordered_map<uint32_t, uint256> short_ids;
+        if (capacity > 0) {
+            Minisketch sketch = state->ComputeSketch(state->m_local_set, capacity, short_ids);
+            sketch.Merge(MakeMinisketch32(capacity).Deserialize(skdata));
+            // Decoding fewer elements than the capacity makes the extra one act as a checksum.
+            // Otherwise decoding a sketch with too many differences often "succeeds".
+            difference = sketch.Decode(capacity - 1);
+        }
+
+        if (!difference) {
+            // The sets differ too much, so the peer's whole set is announced to us, and ours to the peer.
+            LogPrint(BCLog::NET, "Reconciliation with peer=%d failed, flooding %u transactions\n", peer_id, state->m_local_set.size());
+            result.m_announce.assign(state->m_local_set.begin(), state->m_local_set.end());
+            state->m_local_set.clear();
+            // Without sketch extensions, the next estimate must be larger to avoid failing again. With a
+            // q of 2, the capacity is the sum of the set sizes, which is always enough.
+            state->m_q = std::min(std::max(state->m_q, DEFAULT_RECON_Q) * 2, 2.0);
+            return result;
+        }
+
+        result.m_success = true;
+        for (const uint64_t short_id : *difference) {
+            const auto local = short_ids.find(short_id);
+            if (local != short_ids.end()) {
+                result.m_announce.push_back(local->second);
+            } else {
+                result.m_ask_shortids.push_back(short_id);
+            }
+        }
+
+        // Estimate the next difference from this one as defined by BIP 330, with a margin.
+        const size_t local_size = short_ids.size();
+        const size_t remote_size = local_size - result.m_announce.size() + result.m_ask_shortids.size();
+        const size_t min_size = std::min(local_size, remote_size);
+        if (min_size > 0) {
+            const size_t size_difference = local_size > remote_size ? local_size - remote_size : remote_size - local_size;
+            state->m_q = std::min(double(difference->size() - size_difference) / min_size + RECON_Q_MARGIN, 2.0);
+        }
+        LogPrint(BCLog::NET, "Reconciled with peer=%d: announcing %u, requesting %u transactions\n",
+                 peer_id, result.m_announce.size(), result.m_ask_shortids.size());
+        state->m_local_set.clear();
+        return result;
+    }
+
+    std::optional<std::vector<uint256>> HandleReconciliationDifference(NodeId peer_id, bool success, const std::vector<uint32_t>& ask_shortids)
+    {
+        LOCK(m_mutex);
+        TxReconciliationState* state = GetState(peer_id);
+        if (!state || state->m_we_initiate || !state->m_awaiting_diff) return std::nullopt;
+        state->m_awaiting_diff = false;
+
+        std::vector<uint256> announce;
+        if (!success) {
+            announce = std::move(state->m_sketched_set);
+        } else {
+            std::unordered_map<uint32_t, uint256> short_ids;
+            for (const uint256& wtxid : state->m_sketched_set) {
+                short_ids.emplace(state->ComputeShortID(wtxid), wtxid);
+            }
+            for (const uint32_t short_id : ask_shortids) {
+                const auto it = short_ids.find(short_id);
+                if (it != short_ids.end()) announce.push_back(it->second);
+            }
+        }
+        state->m_sketched_set.clear();
+        return announce;
+    }
+};
+
+TxReconciliationTracker::TxReconciliationTracker(uint32_t recon_version) : m_impl{std::make_unique<TxReconciliationTracker::Impl>(recon_version)} {}
+
+TxReconciliationTracker::~TxReconciliationTracker() = default;
+
+uint64_t TxReconciliationTracker::PreRegisterPeer(NodeId peer_id)
+{
+    return m_impl->PreRegisterPeer(peer_id);
+}
+
+ReconciliationRegisterResult TxReconciliationTracker::RegisterPeer(NodeId peer_id, bool is_peer_inbound,
+                                                                   uint32_t peer_recon_version, uint64_t remote_salt)
+{
+    return m_impl->RegisterPeer(peer_id, is_peer_inbound, peer_recon_version, remote_salt);
+}
+
+void TxReconciliationTracker::ForgetPeer(NodeId peer_id)
+{
+    m_impl->ForgetPeer(peer_id);
+}
+
+bool TxReconciliationTracker::IsPeerRegistered(NodeId peer_id) const
+{
+    return m_impl->IsPeerRegistered(peer_id);
+}
+
+bool TxReconciliationTracker::ShouldFanoutTo(const uint256& wtxid, NodeId peer_id) const
+{
+    return m_impl->ShouldFanoutTo(wtxid, peer_id);
+}
+
+bool TxReconciliationTracker::AddToSet(NodeId peer_id, const uint256& wtxid)
+{
+    return m_impl->AddToSet(peer_id, wtxid);
+}
+
+void TxReconciliationTracker::TryRemovingFromSet(NodeId peer_id, const uint256& wtxid)
+{
+    m_impl->TryRemovingFromSet(peer_id, wtxid);
+}
+
+std::optional<TxReconciliationTracker::ReconciliationRequest> TxReconciliationTracker::InitiateReconciliationRequest(NodeId peer_id, std::chrono::microseconds now)
+{
+    return m_impl->InitiateReconciliationRequest(peer_id, now);
+}
+
+bool TxReconciliationTracker::HandleReconciliationRequest(NodeId peer_id, uint16_t peer_set_size, uint16_t peer_q)
+{
+    return m_impl->HandleReconciliationRequest(peer_id, peer_set_size, peer_q);
+}
+
+std::optional<std::vector<uint8_t>> TxReconciliationTracker::RespondToReconciliationRequest(NodeId peer_id)
+{
+    return m_impl->RespondToReconciliationRequest(peer_id);
+}
+
+std::optional<TxReconciliationTracker::SketchResult> TxReconciliationTracker::HandleSketch(NodeId peer_id, Span<const uint8_t> skdata)
+{
+    return m_impl->HandleSketch(peer_id, skdata);
+}
+
+std::optional<std::vector<uint256>> TxReconciliationTracker::HandleReconciliationDifference(NodeId peer_id, bool success,
+                                                                                            const std::vector<uint32_t>& ask_shortids)
+{
+    return m_impl->HandleReconciliationDifference(peer_id, success, ask_shortids);
+}
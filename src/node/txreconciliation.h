@@ -0,0 +1,160 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_TXRECONCILIATION_H
+#define BITCOIN_NODE_TXRECONCILIATION_H
+
+#include <net.h>
+#include <span.h>
+#include <uint256.h>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+/** Default for -txreconciliation, whether to relay transactions to supporting peers by set reconciliation */
+static constexpr bool DEFAULT_TXRECONCILIATION_ENABLE{false};
+/** Supported transaction reconciliation protocol version */
+static constexpr uint32_t TXRECONCILIATION_VERSION{1};
+/** Interval between reconciliations with each outbound peer */
+static constexpr std::chrono::seconds RECON_REQUEST_INTERVAL{8};
+/** The q coefficient is sent as an integer, scaled by this factor (BIP 330) */
+static constexpr uint16_t Q_PRECISION{(2 << 14) - 1};
+/** Coefficient for the estimated set difference, before any reconciliation with a peer */
+static constexpr double DEFAULT_RECON_Q{0.25};
+/** Added to the coefficient estimated from the last reconciliation, as a failure costs far more than a larger sketch */
+static constexpr double RECON_Q_MARGIN{0.25};
+/** Number of outbound reconciling peers each transaction is still flooded to, so that it propagates quickly */
+static constexpr size_t OUTBOUND_FANOUT_DESTINATIONS{1};
+/** Fraction of inbound reconciling peers each transaction is still flooded to */
+static constexpr double INBOUND_FANOUT_DESTINATIONS_FRACTION{0.1};
+/** Maximum number of transactions in a reconciliation set. Transactions beyond it are flooded. */
+static constexpr size_t MAX_RECONSET_SIZE{3000};
+/** Maximum capacity of a sketch. Larger differences fall back to flooding the sets. */
+static constexpr uint32_t MAX_SKETCH_CAPACITY{2 << 12};
+
+enum class ReconciliationRegisterResult {
+    NOT_FOUND,
+    SUCCESS,
+    ALREADY_REGISTERED,
+    PROTOCOL_VIOLATION,
+};
+
+/**
+ * Transaction reconciliation (BIP 330) replaces flooding transaction announcements
+ * with periodic set reconciliation between peers that both support it.
+ *
+ * Transactions to announce to a registered peer are added to the reconciliation set
+ * of that peer. Every RECON_REQUEST_INTERVAL, the node that made the connection
+ * requests a reconciliation by sending the size of its set. The other node responds
+ * with a sketch of its set, which the initiator combines with a sketch of its own set
+ * to find the difference. The initiator then announces the transactions the peer is
+ * missing, and asks for the ones it is missing itself by their short ids.
+ *
+ * To keep transactions propagating quickly, each one is still flooded to a few
+ * reconciling peers (low-fanout flooding), which are picked per transaction.
+ *
+ * If the difference is too large to decode, both sides fall back to announcing
+ * their whole sets.
+ *
+ * This class only keeps the reconciliation state; the messages are sent and the
+ * transactions announced by the caller.
+ */
+class TxReconciliationTracker
+{
+    // Avoid littering this header file with implementation details.
+    class Impl;
+    const std::unique_ptr<Impl> m_impl;
+
+public:
+    explicit TxReconciliationTracker(uint32_t recon_version);
+    ~TxReconciliationTracker();
+
+    /**
+     * Start the handshake with a peer, before sending it our SENDTXRCNCL. Returns the
+     * salt to send, which contributes to the short ids of transactions.
+     */
+    uint64_t PreRegisterPeer(NodeId peer_id);
+
+    /**
+     * Complete the handshake when the peer's SENDTXRCNCL is received. The peer that
+     * made the connection initiates reconciliations.
+     */
+    ReconciliationRegisterResult RegisterPeer(NodeId peer_id, bool is_peer_inbound,
+                                              uint32_t peer_recon_version, uint64_t remote_salt);
+
+    /** Drop all state of a peer, whether or not it completed the handshake. */
+    void ForgetPeer(NodeId peer_id);
+
+    /** Whether the peer completed the handshake and transactions are reconciled with it. */
+    bool IsPeerRegistered(NodeId peer_id) const;
+
+    /**
+     * Whether a transaction should be announced to a peer right away rather than
+     * reconciled: to OUTBOUND_FANOUT_DESTINATIONS of the peers we initiate
+     * reconciliations with, to a fraction of the others, and to peers that are not
+     * registered.
+     */
+    bool ShouldFanoutTo(const uint256& wtxid, NodeId peer_id) const;
+
+    /**
+     * Add a transaction to be announced to a peer to its reconciliation set. Returns
+     * false if the peer is not registered or its set is full, in which case the
+     * transaction should be announced right away.
+     */
+    bool AddToSet(NodeId peer_id, const uint256& wtxid);
+
+    /** Remove a transaction the peer already knows about from its reconciliation set. */
+    void TryRemovingFromSet(NodeId peer_id, const uint256& wtxid);
+
+    struct ReconciliationRequest {
+        uint16_t m_set_size;
+        uint16_t m_q;
+    };
+
+    /**
+     * For a peer we reconcile with as initiator, return a request if it is time for
+     * the next reconciliation. Only one reconciliation is in flight at a time.
+     */
+    std::optional<ReconciliationRequest> InitiateReconciliationRequest(NodeId peer_id, std::chrono::microseconds now);
+
+    /**
+     * Store the REQTXRCNCL of a peer, to be responded to with the next transaction
+     * announcements. Returns false on a protocol violation.
+     */
+    bool HandleReconciliationRequest(NodeId peer_id, uint16_t peer_set_size, uint16_t peer_q);
+
+    /**
+     * If the peer requested a reconciliation, return the sketch of its set to send.
+     * The set is kept until the peer's RECONCILDIFF. An empty sketch tells the peer
+     * that the difference is too large, and that the sets are flooded.
+     */
+    std::optional<std::vector<uint8_t>> RespondToReconciliationRequest(NodeId peer_id);
+
+    struct SketchResult {
+        /** Whether the difference was decoded */
+        bool m_success;
+        /** Short ids of the transactions the peer has and we do not */
+        std::vector<uint32_t> m_ask_shortids;
+        /** Transactions to announce to the peer: the ones it is missing, or our whole set on failure */
+        std::vector<uint256> m_announce;
+    };
+
+    /**
+     * Find the difference with the peer's set from its SKETCH. The result is to be
+     * sent to the peer in a RECONCILDIFF. Returns std::nullopt on a protocol violation.
+     */
+    std::optional<SketchResult> HandleSketch(NodeId peer_id, Span<const uint8_t> skdata);
+
+    /**
+     * Process the peer's RECONCILDIFF in response to our sketch. Returns the transactions
+     * to announce to the peer, or std::nullopt on a protocol violation.
+     */
+    std::optional<std::vector<uint256>> HandleReconciliationDifference(NodeId peer_id, bool success,
+                                                                       const std::vector<uint32_t>& ask_shortids);
+};
+
+#endif // BITCOIN_NODE_TXRECONCILIATION_H
@@ -0,0 +1,108 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/txrelayqueue.h>
+
+#include <primitives/transaction.h>
+#include <txmempool.h>
+
+#include <algorithm>
+
+void TxRelayQueue::Add(const uint256& wtxid)
+{
+    LOCK(m_mutex);
+    m_unsealed.insert(wtxid);
+}
+
+void TxRelayQueue::Seal(const CTxMemPool& mempool)
+{
+    LOCK(m_seal_mutex);
+    std::vector<uint256> wtxids;
+    {
+        LOCK(m_mutex);
+        if (m_unsealed.empty()) return;
+        wtxids.assign(m_unsealed.begin(), m_unsealed.end());
+        m_unsealed.clear();
+    }
+    // Add() need not wait for the mempool lock.
+    const std::vector<CTransactionRef> txs{mempool.SortByDepthAndScore(wtxids)};
+
+    LOCK(m_mutex);
+    Trim();
+    if (txs.empty()) return;
+    auto batch = std::make_shared<Batch>();
+    batch->m_first = m_end;
+    batch->m_entries.reserve(txs.size());
+    for (const CTransactionRef& tx : txs) batch->m_entries.push_back({tx->GetHash(), tx->GetWitnessHash()});
+    m_end = batch->End();
+    m_batches.push_back(std::move(batch));
+}
+
+void TxRelayQueue::RegisterPeer(NodeId peer)
+{
+    LOCK(m_mutex);
+    m_cursors.emplace(peer, m_end);
+}
+
+void TxRelayQueue::ForgetPeer(NodeId peer)
+{
+    LOCK(m_mutex);
+    m_cursors.erase(peer);
+}
+
+void TxRelayQueue::ForEachPending(NodeId peer, const std::function<bool(const Entry&)>& fn)
+{
+    uint64_t cursor;
+    std::vector<std::shared_ptr<const Batch>> batches;
+    {
+        LOCK(m_mutex);
+        const auto it = m_cursors.find(peer);
+        if (it == m_cursors.end()) return;
+        cursor = it->second;
+        const auto first = std::upper_bound(m_batches.begin(), m_batches.end(), cursor,
+                                            [](uint64_t pos, const auto& batch) { return pos < batch->End(); });
+        batches.assign(first, m_batches.end());
+    }
+
+    bool more{true};
+    for (const auto& batch : batches) {
+        for (size_t i = cursor - batch->m_first; more && i < batch->m_entries.size(); ++i) {
+            more = fn(batch->m_entries[i]);
+            cursor = batch->m_first + i + 1;
+        }
+        if (!more) break;
+    }
+
+    LOCK(m_mutex);
+    const auto it = m_cursors.find(peer);
+    if (it != m_cursors.end()) it->second = std::max(it->second, cursor);
+}
+
+void TxRelayQueue::SkipAll(NodeId peer)
+{
+    LOCK(m_mutex);
+    const auto it = m_cursors.find(peer);
+    if (it != m_cursors.end()) it->second = m_end;
+}
+
+size_t TxRelayQueue::CountPending(NodeId peer) const
+{
+    LOCK(m_mutex);
+    const auto it = m_cursors.find(peer);
+    return it == m_cursors.end() ? 0 : m_end - it->second;
+}
+
+size_t TxRelayQueue::Size() const
+{
+    LOCK(m_mutex);
+    const uint64_t first{m_batches.empty() ? m_end : m_batches.front()->m_first};
+    return m_end - first + m_unsealed.size();
+}
+
+void TxRelayQueue::Trim()
+{
+    uint64_t min_cursor{m_end};
+    for (const auto& [peer, cursor] : m_cursors) min_cursor = std::min(min_cursor, cursor);
+    while (!m_batches.empty() && m_batches.front()->End() <= min_cursor) m_batches.pop_front();
+}
@@ -0,0 +1,93 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_TXRELAYQUEUE_H
+#define BITCOIN_NODE_TXRELAYQUEUE_H
+
+#include <net.h>
+#include <sync.h>
+#include <uint256.h>
+#include <util/hasher.h>
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class CTxMemPool;
+
+/**
+ * Transactions to announce to all peers, in one announcement order shared by them.
+ *
+ * Relayed transactions are collected until the next trickle to any peer, when
+ * they are sorted once, topologically and by fee rate, and appended to the
+ * queue. Transactions relayed later are always announced after them. Each peer
+ * only keeps a cursor into the queue, so relaying a transaction and ordering it
+ * for announcement costs the same no matter how many peers there are.
+ * Transactions are dropped from the queue once every peer's cursor has passed
+ * them.
+ */
+class TxRelayQueue
+{
+public:
+    struct Entry {
+        uint256 m_txid;
+        uint256 m_wtxid;
+    };
+
+    /** Queue a mempool transaction for announcement to every registered peer. */
+    void Add(const uint256& wtxid) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Sort the transactions added since the last call into announcement order
+     *  and make them visible to the peers. Transactions that are no longer in the
+     *  mempool are dropped. */
+    void Seal(const CTxMemPool& mempool) EXCLUSIVE_LOCKS_REQUIRED(!m_seal_mutex, !m_mutex);
+
+    /** Start announcing transactions to a peer, beginning with those added after now. */
+    void RegisterPeer(NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    void ForgetPeer(NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /**
+     * Call fn on the sealed transactions a peer has not been passed yet, in
+     * announcement order, until fn returns false. The peer's cursor is moved
+     * past every transaction fn was called for. No lock is held while calling fn.
+     */
+    void ForEachPending(NodeId peer, const std::function<bool(const Entry&)>& fn) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Move the cursor of a peer past all sealed transactions. */
+    void SkipAll(NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Number of sealed transactions a peer has not been passed yet. */
+    size_t CountPending(NodeId peer) const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    /** Number of transactions kept, sealed or not. */
+    size_t Size() const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+private:
+    /** Transactions sealed together, which are shared with the peers iterating over them. */
+    struct Batch {
+        /** Position in the queue of the first entry */
+        uint64_t m_first;
+        std::vector<Entry> m_entries;
+        uint64_t End() const { return m_first + m_entries.size(); }
+    };
+
+    /** Serializes Seal calls, so that batches are appended in the order they were sealed in. */
+    Mutex m_seal_mutex;
+    mutable Mutex m_mutex;
+    /** Wtxids of the transactions added since the last Seal */
+    std::unordered_set<uint256, SaltedTxidHasher> m_unsealed GUARDED_BY(m_mutex);
+    std::deque<std::shared_ptr<const Batch>> m_batches GUARDED_BY(m_mutex);
+    /** Position after the last sealed entry */
+    uint64_t m_end GUARDED_BY(m_mutex){0};
+    /** Position of the next entry to announce to each peer */
+    std::unordered_map<NodeId, uint64_t> m_cursors GUARDED_BY(m_mutex);
+
+    /** Drop the batches that every peer has been passed. */
+    void Trim() EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+};
+
+#endif // BITCOIN_NODE_TXRELAYQUEUE_H
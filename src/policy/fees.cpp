@@ -17,6 +17,10 @@ static const char* FEE_ESTIMATES_FILENAME = "fee_estimates.dat";
 
 static constexpr double INF_FEERATE = 1e99;
 
+/** Once the pending decay factor of a TxConfirmStats drops below this, it is
+ *  folded into the stored averages to keep them well within double range. */
+static constexpr double MIN_DECAY_FACTOR = 1e-50;
+
 std::string StringForFeeEstimateHorizon(FeeEstimateHorizon horizon)
 {
     switch (horizon) {
@@ -83,6 +87,12 @@ private:
 
     double decay;
 
+    // The moving averages above are decayed lazily: the actual value of each
+    // one is its stored value times m_decay_factor, the product of all decays
+    // applied since the stored values were last normalized. This makes
+    // UpdateMovingAverages O(1) instead of touching every bucket and period.
+    double m_decay_factor{1.0};
+
     // Resolution (# of blocks) with which confirmations are tracked
     unsigned int scale;
 
@@ -95,6 +105,13 @@ private:
 
     void resizeInMemoryCounters(size_t newbuckets);
 
+    /** Fold m_decay_factor into the stored moving averages */
+    void Normalize();
+
+    /** Multiply every element of the given averages by m_decay_factor */
+    std::vector<double> Scaled(const std::vector<double>& avg) const;
+    std::vector<std::vector<double>> Scaled(const std::vector<std::vector<double>>& avg) const;
+
 public:
     /**
      * Create new TxConfirmStats. This is called by BlockPolicyEstimator's
@@ -200,24 +217,50 @@ void TxConfirmStats::Record(int blocksToConfirm, double feerate)
         return;
     int periodsToConfirm = (blocksToConfirm + scale - 1) / scale;
     unsigned int bucketindex = bucketMap.lower_bound(feerate)->second;
+    // Stored values are later multiplied by m_decay_factor, so a new data
+    // point is stored with the inverse weight.
+    const double weight = 1 / m_decay_factor;
     for (size_t i = periodsToConfirm; i <= confAvg.size(); i++) {
-        confAvg[i - 1][bucketindex]++;
+        confAvg[i - 1][bucketindex] += weight;
     }
-    txCtAvg[bucketindex]++;
-    m_feerate_avg[bucketindex] += feerate;
+    txCtAvg[bucketindex] += weight;
+    m_feerate_avg[bucketindex] += feerate * weight;
 }
 
 void TxConfirmStats::UpdateMovingAverages()
+{
+    m_decay_factor *= decay;
+    if (m_decay_factor < MIN_DECAY_FACTOR) Normalize();
+}
+
+void TxConfirmStats::Normalize()
 {
     assert(confAvg.size() == failAvg.size());
     for (unsigned int j = 0; j < buckets.size(); j++) {
         for (unsigned int i = 0; i < confAvg.size(); i++) {
-            confAvg[i][j] *= decay;
-            failAvg[i][j] *= decay;
+            confAvg[i][j] *= m_decay_factor;
+            failAvg[i][j] *= m_decay_factor;
         }
-        m_feerate_avg[j] *= decay;
-        txCtAvg[j] *= decay;
+        m_feerate_avg[j] *= m_decay_factor;
+        txCtAvg[j] *= m_decay_factor;
     }
+    m_decay_factor = 1.0;
+}
+
+std::vector<double> TxConfirmStats::Scaled(const std::vector<double>& avg) const
+{
+    std::vector<double> ret;
+    ret.reserve(avg.size());
+    for (double val : avg) ret.push_back(val * m_decay_factor);
+    return ret;
+}
+
+std::vector<std::vector<double>> TxConfirmStats::Scaled(const std::vector<std::vector<double>>& avg) const
+{
+    std::vector<std::vector<double>> ret;
+    ret.reserve(avg.size());
+    for (const auto& row : avg) ret.push_back(Scaled(row));
+    return ret;
 }
 
 // returns -1 on error conditions
@@ -257,9 +300,9 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
             newBucketRange = false;
         }
         curFarBucket = bucket;
-        nConf += confAvg[periodTarget - 1][bucket];
-        totalNum += txCtAvg[bucket];
-        failNum += failAvg[periodTarget - 1][bucket];
+        nConf += confAvg[periodTarget - 1][bucket] * m_decay_factor;
+        totalNum += txCtAvg[bucket] * m_decay_factor;
+        failNum += failAvg[periodTarget - 1][bucket] * m_decay_factor;
         for (unsigned int confct = confTarget; confct < GetMaxConfirms(); confct++)
             extraNum += unconfTxs[(nBlockHeight - confct) % bins][bucket];
         extraNum += oldUnconfTxs[bucket];
@@ -314,6 +357,7 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
     // Find the bucket with the median transaction and then report the average feerate from that bucket
     // This is a compromise between finding the median which we can't since we don't save all tx's
     // and reporting the average which is less accurate
+    // (Only ratios of stored values are used here, so m_decay_factor cancels out.)
     unsigned int minBucket = std::min(bestNearBucket, bestFarBucket);
     unsigned int maxBucket = std::max(bestNearBucket, bestFarBucket);
     for (unsigned int j = minBucket; j <= maxBucket; j++) {
@@ -378,10 +422,10 @@ void TxConfirmStats::Write(CAutoFile& fileout) const
 {
     fileout << Using<EncodedDoubleFormatter>(decay);
     fileout << scale;
-    fileout << Using<VectorFormatter<EncodedDoubleFormatter>>(m_feerate_avg);
-    fileout << Using<VectorFormatter<EncodedDoubleFormatter>>(txCtAvg);
-    fileout << Using<VectorFormatter<VectorFormatter<EncodedDoubleFormatter>>>(confAvg);
-    fileout << Using<VectorFormatter<VectorFormatter<EncodedDoubleFormatter>>>(failAvg);
+    fileout << Using<VectorFormatter<EncodedDoubleFormatter>>(Scaled(m_feerate_avg));
+    fileout << Using<VectorFormatter<EncodedDoubleFormatter>>(Scaled(txCtAvg));
+    fileout << Using<VectorFormatter<VectorFormatter<EncodedDoubleFormatter>>>(Scaled(confAvg));
+    fileout << Using<VectorFormatter<VectorFormatter<EncodedDoubleFormatter>>>(Scaled(failAvg));
 }
 
 void TxConfirmStats::Read(CAutoFile& filein, int nFileVersion, size_t numBuckets)
@@ -400,6 +444,8 @@ void TxConfirmStats::Read(CAutoFile& filein, int nFileVersion, size_t numBuckets
     if (scale == 0) {
         throw std::runtime_error("Corrupt estimates file. Scale must be non-zero");
     }
+    // The file stores the actual (decayed) averages
+    m_decay_factor = 1.0;
 
     filein >> Using<VectorFormatter<EncodedDoubleFormatter>>(m_feerate_avg);
     if (m_feerate_avg.size() != numBuckets) {
@@ -480,7 +526,7 @@ void TxConfirmStats::removeTx(unsigned int entryHeight, unsigned int nBestSeenHe
         assert(scale != 0);
         unsigned int periodsAgo = blocksAgo / scale;
         for (size_t i = 0; i < periodsAgo && i < failAvg.size(); i++) {
-            failAvg[i][bucketindex]++;
+            failAvg[i][bucketindex] += 1 / m_decay_factor;
         }
     }
 }
@@ -501,6 +547,9 @@ bool CBlockPolicyEstimator::_removeTx(const uint256& hash, bool inBlock)
     AssertLockHeld(m_cs_fee_estimator);
     std::map<uint256, TxStatsInfo>::iterator pos = mapMemPoolTxs.find(hash);
     if (pos != mapMemPoolTxs.end()) {
+        // Only transactions that entered before the current height are
+        // counted by EstimateMedianVal.
+        if (pos->second.blockHeight < nBestSeenHeight) m_smart_fee_cache.clear();
         feeStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
         shortStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
         longStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
@@ -625,6 +674,7 @@ void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
     // calls to removeTx (via processBlockTx) correctly calculate age
     // of unconfirmed txs to remove from tracking.
     nBestSeenHeight = nBlockHeight;
+    m_smart_fee_cache.clear();
 
     // Update unconfirmed circular buffer
     feeStats->ClearCurrent(nBlockHeight);
@@ -814,6 +864,21 @@ CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, FeeCalculation
 {
     LOCK(m_cs_fee_estimator);
 
+    const auto key = std::make_pair(confTarget, conservative);
+    auto it = m_smart_fee_cache.find(key);
+    if (it == m_smart_fee_cache.end()) {
+        FeeCalculation calc;
+        const CFeeRate estimate = estimateSmartFeeUncached(confTarget, &calc, conservative);
+        it = m_smart_fee_cache.emplace(key, std::make_pair(estimate, calc)).first;
+    }
+    if (feeCalc) *feeCalc = it->second.second;
+    return it->second.first;
+}
+
+CFeeRate CBlockPolicyEstimator::estimateSmartFeeUncached(int confTarget, FeeCalculation *feeCalc, bool conservative) const
+{
+    AssertLockHeld(m_cs_fee_estimator);
+
     if (feeCalc) {
         feeCalc->desiredTarget = confTarget;
         feeCalc->returnedTarget = confTarget;
@@ -976,6 +1041,7 @@ bool CBlockPolicyEstimator::Read(CAutoFile& filein)
             nBestSeenHeight = nFileBestSeenHeight;
             historicalFirst = nFileHistoricalFirst;
             historicalBest = nFileHistoricalBest;
+            m_smart_fee_cache.clear();
         }
     }
     catch (const std::exception& e) {
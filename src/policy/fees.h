@@ -266,9 +266,17 @@ private:
     std::vector<double> buckets GUARDED_BY(m_cs_fee_estimator); // The upper-bound of the range for the bucket (inclusive)
     std::map<double, unsigned int> bucketMap GUARDED_BY(m_cs_fee_estimator); // Map of bucket upper-bound to index into all vectors by bucket
 
+    /** Memoized estimateSmartFee results, keyed by (confTarget, conservative).
+     *  Transactions entering the mempool at the current height don't affect
+     *  any estimate, so this only needs to be cleared when a block is
+     *  processed or a transaction from an earlier block stops being tracked. */
+    mutable std::map<std::pair<int, bool>, std::pair<CFeeRate, FeeCalculation>> m_smart_fee_cache GUARDED_BY(m_cs_fee_estimator);
+
     /** Process a transaction confirmed in a block*/
     bool processBlockTx(unsigned int nBlockHeight, const CTxMemPoolEntry* entry) EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
 
+    /** Helper for estimateSmartFee, doing the actual calculation */
+    CFeeRate estimateSmartFeeUncached(int confTarget, FeeCalculation *feeCalc, bool conservative) const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
     /** Helper for estimateSmartFee */
     double estimateCombinedFee(unsigned int confTarget, double successThreshold, bool checkShorterHorizon, EstimationResult *result) const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
     /** Helper for estimateSmartFee */
@@ -262,6 +262,28 @@ extern const char* CFCHECKPT;
  * @since protocol version 70016 as described by BIP 339.
  */
 extern const char* WTXIDRELAY;
+/**
+ * Contains a 4-byte version number and an 8-byte salt.
+ * Signals support of transaction reconciliation (BIP 330), and is sent between
+ * VERSION and VERACK. The salt contributes to the short ids of transactions.
+ */
+extern const char* SENDTXRCNCL;
+/**
+ * Contains the 2-byte size of the sender's reconciliation set and the 2-byte q
+ * coefficient. Sent by the peer that made the connection to request a
+ * reconciliation (BIP 330).
+ */
+extern const char* REQTXRCNCL;
+/**
+ * Contains a sketch of the sender's reconciliation set, in response to
+ * a reqtxrcncl message (BIP 330).
+ */
+extern const char* SKETCH;
+/**
+ * Contains whether the set difference could be decoded from a sketch, and the
+ * short ids of the transactions the sender is missing (BIP 330).
+ */
+extern const char* RECONCILDIFF;
 }; // namespace NetMsgType
 
 /* Get a vector of all valid message types (see above) */
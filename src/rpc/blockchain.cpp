@@ -1703,6 +1703,94 @@ static RPCHelpMan getmempoolinfo()
     };
 }
 
+UniValue MempoolFeeRateHistogramToJSON(const CTxMemPool& pool, bool include_history)
+{
+    // Make sure this call is atomic in the pool.
+    LOCK(pool.cs);
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("time", count_seconds(GetTime<std::chrono::seconds>()));
+
+    const MempoolFeeRateHistogram& histogram = pool.GetFeeRateHistogram();
+    UniValue buckets(UniValue::VARR);
+    for (size_t i = 0; i < histogram.size(); ++i) {
+        UniValue bucket(UniValue::VOBJ);
+        bucket.pushKV("min_feerate", MEMPOOL_FEERATE_HISTOGRAM_BOUNDS[i]);
+        bucket.pushKV("count", histogram[i].count);
+        bucket.pushKV("vsize", histogram[i].vsize);
+        bucket.pushKV("fees", ValueFromAmount(histogram[i].fees));
+        buckets.push_back(bucket);
+    }
+    ret.pushKV("buckets", buckets);
+
+    if (include_history) {
+        UniValue history(UniValue::VARR);
+        for (const MempoolFeeRateSnapshot& snapshot : pool.GetFeeRateSnapshots()) {
+            UniValue counts(UniValue::VARR);
+            UniValue vsizes(UniValue::VARR);
+            UniValue fees(UniValue::VARR);
+            for (const MempoolFeeRateBucket& bucket : snapshot.m_histogram) {
+                counts.push_back(bucket.count);
+                vsizes.push_back(bucket.vsize);
+                fees.push_back(ValueFromAmount(bucket.fees));
+            }
+            UniValue entry(UniValue::VOBJ);
+            entry.pushKV("time", count_seconds(snapshot.m_time));
+            entry.pushKV("count", counts);
+            entry.pushKV("vsize", vsizes);
+            entry.pushKV("fees", fees);
+            history.push_back(entry);
+        }
+        ret.pushKV("history", history);
+    }
+    return ret;
+}
+
+static RPCHelpMan getmempoolfeehistogram()
+{
+    return RPCHelpMan{"getmempoolfeehistogram",
+                "\nReturns the count, virtual size and fees of the mempool transactions in each fee rate bucket.\n"
+                "These aggregates are maintained as transactions enter and leave the mempool, so this is much\n"
+                "cheaper than building a histogram from getrawmempool.\n",
+                {
+                    {"history", RPCArg::Type::BOOL, RPCArg::Default{false}, "Also return the snapshots of the histogram recorded every " + ToString(count_seconds(MEMPOOL_FEERATE_SNAPSHOT_INTERVAL)) + " seconds (at most " + ToString(MAX_MEMPOOL_FEERATE_SNAPSHOTS) + ")"},
+                },
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::NUM_TIME, "time", "The current time, in " + UNIX_EPOCH_TIME},
+                        {RPCResult::Type::ARR, "buckets", "Fee rate buckets, by increasing fee rate, ignoring modified fees through prioritizetransaction",
+                        {
+                            {RPCResult::Type::OBJ, "", "",
+                            {
+                                {RPCResult::Type::NUM, "min_feerate", "Lowest fee rate in this bucket, in " + CURRENCY_ATOM + "/vB. The bucket extends up to the min_feerate of the next one"},
+                                {RPCResult::Type::NUM, "count", "Number of transactions"},
+                                {RPCResult::Type::NUM, "vsize", "Sum of the virtual transaction sizes"},
+                                {RPCResult::Type::STR_AMOUNT, "fees", "Sum of the fees in " + CURRENCY_UNIT},
+                            }},
+                        }},
+                        {RPCResult::Type::ARR, "history", /*optional=*/true, "Recorded snapshots, oldest first (only present if history=true)",
+                        {
+                            {RPCResult::Type::OBJ, "", "",
+                            {
+                                {RPCResult::Type::NUM_TIME, "time", "The time the snapshot was taken, in " + UNIX_EPOCH_TIME},
+                                {RPCResult::Type::ARR, "count", "Number of transactions in each bucket", {{RPCResult::Type::NUM, "", ""}}},
+                                {RPCResult::Type::ARR, "vsize", "Sum of the virtual transaction sizes in each bucket", {{RPCResult::Type::NUM, "", ""}}},
+                                {RPCResult::Type::ARR, "fees", "Sum of the fees in each bucket in " + CURRENCY_UNIT, {{RPCResult::Type::STR_AMOUNT, "", ""}}},
+                            }},
+                        }},
+                    }},
+                RPCExamples{
+                    HelpExampleCli("getmempoolfeehistogram", "true")
+            + HelpExampleRpc("getmempoolfeehistogram", "true")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    const bool include_history = request.params[0].isNull() ? false : request.params[0].get_bool();
+    return MempoolFeeRateHistogramToJSON(EnsureAnyMemPool(request.context), include_history);
+},
+    };
+}
+
 static RPCHelpMan preciousblock()
 {
     return RPCHelpMan{"preciousblock",
@@ -2685,6 +2773,7 @@ static const CRPCCommand commands[] =
     { "blockchain",         &getmempoolancestors,                },
     { "blockchain",         &getmempooldescendants,              },
     { "blockchain",         &getmempoolentry,                    },
+    { "blockchain",         &getmempoolfeehistogram,             },
     { "blockchain",         &getmempoolinfo,                     },
     { "blockchain",         &getrawmempool,                      },
     { "blockchain",         &gettxout,                           },
@@ -45,6 +45,9 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* tip, const CBlockIn
 /** Mempool information to JSON */
 UniValue MempoolInfoToJSON(const CTxMemPool& pool);
 
+/** Mempool fee rate histogram, optionally with its recorded snapshots, to JSON */
+UniValue MempoolFeeRateHistogramToJSON(const CTxMemPool& pool, bool include_history);
+
 /** Mempool to JSON */
 UniValue MempoolToJSON(const CTxMemPool& pool, bool verbose = false, bool include_mempool_sequence = false);
 
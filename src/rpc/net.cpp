@@ -135,6 +135,13 @@ static RPCHelpMan getpeerinfo()
                     {RPCResult::Type::NUM_TIME, "last_block", "The " + UNIX_EPOCH_TIME + " of the last block received from this peer"},
                     {RPCResult::Type::NUM, "bytessent", "The total bytes sent"},
                     {RPCResult::Type::NUM, "bytesrecv", "The total bytes received"},
+                    {RPCResult::Type::OBJ, "recvbuffer", "Memory used for messages received from this peer",
+                    {
+                        {RPCResult::Type::NUM, "partial", "Bytes allocated for the message being received"},
+                        {RPCResult::Type::NUM, "queued", "Bytes of received messages waiting to be processed"},
+                        {RPCResult::Type::NUM, "poolhits", "Number of messages received into a buffer reused from the shared receive buffer pool"},
+                        {RPCResult::Type::NUM, "poolmisses", "Number of messages small enough for the pool that needed a newly allocated buffer"},
+                    }},
                     {RPCResult::Type::NUM_TIME, "conntime", "The " + UNIX_EPOCH_TIME + " of the connection"},
                     {RPCResult::Type::NUM, "timeoffset", "The time offset in seconds"},
                     {RPCResult::Type::NUM, "pingtime", /* optional */ true, "ping time (if available)"},
@@ -219,6 +226,12 @@ static RPCHelpMan getpeerinfo()
         obj.pushKV("last_block", stats.nLastBlockTime);
         obj.pushKV("bytessent", stats.nSendBytes);
         obj.pushKV("bytesrecv", stats.nRecvBytes);
+        UniValue recv_buffer(UniValue::VOBJ);
+        recv_buffer.pushKV("partial", (uint64_t)stats.m_recv_buffer_bytes);
+        recv_buffer.pushKV("queued", (uint64_t)stats.m_recv_queue_bytes);
+        recv_buffer.pushKV("poolhits", stats.m_recv_pool_hits);
+        recv_buffer.pushKV("poolmisses", stats.m_recv_pool_misses);
+        obj.pushKV("recvbuffer", recv_buffer);
         obj.pushKV("conntime", stats.nTimeConnected);
         obj.pushKV("timeoffset", stats.nTimeOffset);
         if (stats.m_last_ping_time > 0us) {
@@ -525,6 +538,9 @@ static RPCHelpMan getnettotals()
                        {RPCResult::Type::NUM, "totalbytesrecv", "Total bytes received"},
                        {RPCResult::Type::NUM, "totalbytessent", "Total bytes sent"},
                        {RPCResult::Type::NUM_TIME, "timemillis", "Current " + UNIX_EPOCH_TIME + " in milliseconds"},
+                       {RPCResult::Type::NUM, "sendcalls", "Number of send system calls. Each call can send several queued messages"},
+                       {RPCResult::Type::NUM, "bytescopied", "Payload bytes serialized into a separate buffer for each peer"},
+                       {RPCResult::Type::NUM, "bytesshared", "Payload bytes sent from a buffer shared between peers, without copying"},
                        {RPCResult::Type::OBJ, "uploadtarget", "",
                        {
                            {RPCResult::Type::NUM, "timeframe", "Length of the measuring timeframe in seconds"},
@@ -549,6 +565,10 @@ static RPCHelpMan getnettotals()
     obj.pushKV("totalbytesrecv", connman.GetTotalBytesRecv());
     obj.pushKV("totalbytessent", connman.GetTotalBytesSent());
     obj.pushKV("timemillis", GetTimeMillis());
+    const CConnman::SendStats send_stats = connman.GetSendStats();
+    obj.pushKV("sendcalls", send_stats.m_syscalls);
+    obj.pushKV("bytescopied", send_stats.m_bytes_copied);
+    obj.pushKV("bytesshared", send_stats.m_bytes_shared);
 
     UniValue outboundLimit(UniValue::VOBJ);
     outboundLimit.pushKV("timeframe", count_seconds(connman.GetMaxOutboundTimeframe()));
@@ -599,11 +619,30 @@ static RPCHelpMan getnetworkinfo()
                             {RPCResult::Type::STR, "SERVICE_NAME", "the service name"},
                         }},
                         {RPCResult::Type::BOOL, "localrelay", "true if transaction relay is requested from peers"},
+                        {RPCResult::Type::OBJ, "blockcache", "cache of blocks recently served to peers (see -blockservecache)",
+                        {
+                            {RPCResult::Type::NUM, "blocks", "the number of cached blocks"},
+                            {RPCResult::Type::NUM, "bytes", "the memory used by cached blocks in all forms they were served in"},
+                            {RPCResult::Type::NUM, "maxbytes", "the memory limit of the cache"},
+                            {RPCResult::Type::NUM, "hits", "the number of requested blocks served from the cache"},
+                            {RPCResult::Type::NUM, "misses", "the number of requested blocks that were read from disk"},
+                        }},
                         {RPCResult::Type::NUM, "timeoffset", "the time offset"},
                         {RPCResult::Type::NUM, "connections", "the total number of connections"},
                         {RPCResult::Type::NUM, "connections_in", "the number of inbound connections"},
                         {RPCResult::Type::NUM, "connections_out", "the number of outbound connections"},
                         {RPCResult::Type::BOOL, "networkactive", "whether p2p networking is enabled"},
+                        {RPCResult::Type::ARR, "socketthreads", "load statistics per socket handler thread (see -socketthreads)",
+                        {
+                            {RPCResult::Type::OBJ, "", "",
+                            {
+                                {RPCResult::Type::NUM, "connections", "the number of connections serviced by this thread"},
+                                {RPCResult::Type::NUM, "iterations", "the number of event loop iterations"},
+                                {RPCResult::Type::NUM, "events", "the number of times a socket was ready for IO"},
+                                {RPCResult::Type::NUM, "bytesrecv", "total bytes received by this thread"},
+                                {RPCResult::Type::NUM, "bytessent", "total bytes sent by this thread, not including optimistic sends by the message handler"},
+                            }},
+                        }},
                         {RPCResult::Type::ARR, "networks", "information per network",
                         {
                             {RPCResult::Type::OBJ, "", "",
@@ -648,6 +687,14 @@ static RPCHelpMan getnetworkinfo()
     }
     if (node.peerman) {
         obj.pushKV("localrelay", !node.peerman->IgnoresIncomingTxs());
+        const BlockCache::Stats cache_stats = node.peerman->GetBlockCacheStats();
+        UniValue block_cache(UniValue::VOBJ);
+        block_cache.pushKV("blocks", (uint64_t)cache_stats.m_blocks);
+        block_cache.pushKV("bytes", (uint64_t)cache_stats.m_bytes);
+        block_cache.pushKV("maxbytes", (uint64_t)cache_stats.m_max_bytes);
+        block_cache.pushKV("hits", cache_stats.m_hits);
+        block_cache.pushKV("misses", cache_stats.m_misses);
+        obj.pushKV("blockcache", block_cache);
     }
     obj.pushKV("timeoffset",    GetTimeOffset());
     if (node.connman) {
@@ -655,6 +702,17 @@ static RPCHelpMan getnetworkinfo()
         obj.pushKV("connections", (int)node.connman->GetNodeCount(ConnectionDirection::Both));
         obj.pushKV("connections_in", (int)node.connman->GetNodeCount(ConnectionDirection::In));
         obj.pushKV("connections_out", (int)node.connman->GetNodeCount(ConnectionDirection::Out));
+        UniValue socket_threads(UniValue::VARR);
+        for (const CConnman::SocketThreadStats& stats : node.connman->GetSocketThreadStats()) {
+            UniValue thread(UniValue::VOBJ);
+            thread.pushKV("connections", (uint64_t)stats.m_num_nodes);
+            thread.pushKV("iterations", stats.m_iterations);
+            thread.pushKV("events", stats.m_events);
+            thread.pushKV("bytesrecv", stats.m_bytes_recv);
+            thread.pushKV("bytessent", stats.m_bytes_sent);
+            socket_threads.push_back(thread);
+        }
+        obj.pushKV("socketthreads", socket_threads);
     }
     obj.pushKV("networks",      GetNetworksInfo());
     obj.pushKV("relayfee",      ValueFromAmount(::minRelayTxFee.GetFeePerK()));
@@ -0,0 +1,212 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_SUBNETTRIE_H
+#define BITCOIN_SUBNETTRIE_H
+
+#include <netaddress.h>
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+
+/**
+ * Map of subnets to values, which finds all the subnets containing an address
+ * in time proportional to the length of the address rather than to the number
+ * of subnets.
+ *
+ * There is one path-compressed binary trie (a radix tree) per network. Each
+ * node stands for the subnet of the leading bits of its key, and only has a
+ * value if that subnet was inserted. Single-host subnets of non-IP networks
+ * are keys of the full address length, so they are matched exactly, as by
+ * CSubNet::Match.
+ */
+template <typename T>
+class SubNetTrie
+{
+    using Key = prevector<ADDR_IPV6_SIZE, uint8_t>;
+
+    struct Node {
+        //! Leading m_bits bits of this are the prefix of the node, the rest is zero
+        Key m_key;
+        size_t m_bits;
+        std::optional<T> m_value;
+        std::array<std::unique_ptr<Node>, 2> m_children;
+
+        Node(const Key& key, size_t bits) : m_key{Mask(key, bits)}, m_bits{bits} {}
+    };
+
+    std::array<std::unique_ptr<Node>, NET_MAX> m_roots;
+    size_t m_size{0};
+
+    static bool Bit(const Key& key, size_t pos)
+    {
+        return (key[pos / 8] >> (7 - pos % 8)) & 1;
+    }
+
+    static Key Mask(Key key, size_t bits)
+    {
+        for (size_t i = 0; i < key.size(); ++i) {
+            if (bits >= 8) {
+                bits -= 8;
+            } else {
+                key[i] &= (uint8_t)(0xFF << (8 - bits));
+                bits = 0;
+            }
+        }
+        return key;
+    }
+
+    /** Number of leading bits, up to max_bits, in which a and b agree. */
+    static size_t CommonPrefix(const Key& a, const Key& b, size_t max_bits)
+    {
+        size_t bits = 0;
+        for (size_t i = 0; bits < max_bits; ++i, bits += 8) {
+            const uint8_t diff = a[i] ^ b[i];
+            if (diff != 0) {
+                uint8_t mask = 0x80;
+                while (!(diff & mask)) {
+                    mask >>= 1;
+                    ++bits;
+                }
+                break;
+            }
+        }
+        return std::min(bits, max_bits);
+    }
+
+    /** The key and prefix length of a subnet, if it can be stored. */
+    static std::optional<std::pair<Key, size_t>> SubNetKey(const CSubNet& subnet)
+    {
+        if (!subnet.valid) return std::nullopt;
+        const CNetAddr& network = subnet.network;
+        size_t bits = network.m_addr.size() * 8;
+        if (network.IsIPv4() || network.IsIPv6()) {
+            // The netmask of a valid subnet consists of leading 1-bits only.
+            bits = 0;
+            for (size_t i = 0; i < network.m_addr.size(); ++i) {
+                for (uint8_t b = subnet.netmask[i]; b & 0x80; b <<= 1) ++bits;
+            }
+        }
+        return std::make_pair(network.m_addr, bits);
+    }
+
+    /** Node of exactly key and bits, if any. */
+    Node* FindNode(Network net, const Key& key, size_t bits) const
+    {
+        Node* node = m_roots[net].get();
+        while (node && node->m_bits <= bits && CommonPrefix(node->m_key, key, node->m_bits) == node->m_bits) {
+            if (node->m_bits == bits) return node;
+            node = node->m_children[Bit(key, node->m_bits)].get();
+        }
+        return nullptr;
+    }
+
+    /** Remove the value of key and bits from the subtree at node, and nodes that become redundant. */
+    bool Erase(std::unique_ptr<Node>& node, const Key& key, size_t bits)
+    {
+        if (!node || node->m_bits > bits || CommonPrefix(node->m_key, key, node->m_bits) != node->m_bits) return false;
+        if (node->m_bits < bits) {
+            if (!Erase(node->m_children[Bit(key, node->m_bits)], key, bits)) return false;
+        } else {
+            if (!node->m_value) return false;
+            node->m_value.reset();
+            --m_size;
+        }
+        // A node without a value is only needed to join two subtrees.
+        if (!node->m_value && !(node->m_children[0] && node->m_children[1])) {
+            node = std::move(node->m_children[0] ? node->m_children[0] : node->m_children[1]);
+        }
+        return true;
+    }
+
+public:
+    /** Set the value of a subnet, replacing any value it had. Invalid subnets are ignored. */
+    void Insert(const CSubNet& subnet, T value)
+    {
+        const auto key_bits = SubNetKey(subnet);
+        if (!key_bits) return;
+        const auto& [key, bits] = *key_bits;
+        std::unique_ptr<Node>* slot = &m_roots[subnet.network.m_net];
+        while (true) {
+            Node* node = slot->get();
+            if (!node) {
+                *slot = std::make_unique<Node>(key, bits);
+                (*slot)->m_value = std::move(value);
+                ++m_size;
+                return;
+            }
+            const size_t common = CommonPrefix(node->m_key, key, std::min(node->m_bits, bits));
+            if (common == node->m_bits) {
+                if (common == bits) {
+                    if (!node->m_value) ++m_size;
+                    node->m_value = std::move(value);
+                    return;
+                }
+                slot = &node->m_children[Bit(key, common)];
+                continue;
+            }
+            // Split the node at the first bit in which it differs from the key.
+            auto parent = std::make_unique<Node>(key, common);
+            const bool node_bit = Bit(node->m_key, common);
+            parent->m_children[node_bit] = std::move(*slot);
+            if (common == bits) {
+                parent->m_value = std::move(value);
+            } else {
+                parent->m_children[!node_bit] = std::make_unique<Node>(key, bits);
+                parent->m_children[!node_bit]->m_value = std::move(value);
+            }
+            ++m_size;
+            *slot = std::move(parent);
+            return;
+        }
+    }
+
+    /** Remove a subnet. Returns whether it was present. */
+    bool Erase(const CSubNet& subnet)
+    {
+        const auto key_bits = SubNetKey(subnet);
+        if (!key_bits) return false;
+        return Erase(m_roots[subnet.network.m_net], key_bits->first, key_bits->second);
+    }
+
+    /** The value of exactly this subnet, or nullptr. */
+    T* Find(const CSubNet& subnet)
+    {
+        const auto key_bits = SubNetKey(subnet);
+        if (!key_bits) return nullptr;
+        Node* node = FindNode(subnet.network.m_net, key_bits->first, key_bits->second);
+        return node && node->m_value ? &*node->m_value : nullptr;
+    }
+
+    /** Call fn with the value of every subnet that matches addr, from the widest to the narrowest. */
+    template <typename Fn>
+    void ForEachMatch(const CNetAddr& addr, Fn&& fn) const
+    {
+        if (!addr.IsValid()) return;
+        const Key& key = addr.m_addr;
+        const size_t bits = key.size() * 8;
+        const Node* node = m_roots[addr.m_net].get();
+        while (node && node->m_bits <= bits && CommonPrefix(node->m_key, key, node->m_bits) == node->m_bits) {
+            if (node->m_value) fn(*node->m_value);
+            if (node->m_bits == bits) break;
+            node = node->m_children[Bit(key, node->m_bits)].get();
+        }
+    }
+
+    void Clear()
+    {
+        for (auto& root : m_roots) root.reset();
+        m_size = 0;
+    }
+
+    /** Number of subnets with a value. */
+    size_t Size() const { return m_size; }
+};
+
+#endif // BITCOIN_SUBNETTRIE_H
@@ -13,6 +13,7 @@
 
 #include <condition_variable>
 #include <mutex>
+#include <shared_mutex>
 #include <string>
 #include <thread>
 
@@ -83,6 +84,14 @@ inline bool LockStackEmpty() { return true; }
 #define AssertLockHeld(cs) AssertLockHeldInternal(#cs, __FILE__, __LINE__, &cs)
 #define AssertLockNotHeld(cs) AssertLockNotHeldInternal(#cs, __FILE__, __LINE__, &cs)
 
+/** Like AssertLockHeld, for code that only needs a shared (READ_LOCK) lock. */
+template <typename MutexType>
+inline void AssertSharedLockHeldInternal(const char* pszName, const char* pszFile, int nLine, MutexType* cs) SHARED_LOCKS_REQUIRED(cs) NO_THREAD_SAFETY_ANALYSIS
+{
+    AssertLockHeldInternal(pszName, pszFile, nLine, cs);
+}
+#define AssertSharedLockHeld(cs) AssertSharedLockHeldInternal(#cs, __FILE__, __LINE__, &cs)
+
 /**
  * Template mixin that adds -Wthread-safety locking annotations and lock order
  * checking to a subset of the mutex API.
@@ -128,6 +137,37 @@ using RecursiveMutex = AnnotatedMixin<std::recursive_mutex>;
 /** Wrapped mutex: supports waiting but not recursive locking */
 typedef AnnotatedMixin<std::mutex> Mutex;
 
+/**
+ * Template mixin that adds -Wthread-safety annotations for shared locking to
+ * AnnotatedMixin.
+ */
+template <typename PARENT>
+class LOCKABLE SharedAnnotatedMixin : public AnnotatedMixin<PARENT>
+{
+public:
+    void lock_shared() SHARED_LOCK_FUNCTION()
+    {
+        PARENT::lock_shared();
+    }
+
+    void unlock_shared() UNLOCK_FUNCTION()
+    {
+        PARENT::unlock_shared();
+    }
+
+    bool try_lock_shared() SHARED_TRYLOCK_FUNCTION(true)
+    {
+        return PARENT::try_lock_shared();
+    }
+
+#ifdef __clang__
+    const SharedAnnotatedMixin& operator!() const { return *this; }
+#endif // __clang__
+};
+
+/** Wrapped mutex: can be locked exclusively with LOCK, or shared by many threads with READ_LOCK */
+using SharedMutex = SharedAnnotatedMixin<std::shared_mutex>;
+
 /** Wrapper around std::unique_lock style lock for Mutex. */
 template <typename Mutex, typename Base = typename Mutex::UniqueLock>
 class SCOPED_LOCKABLE UniqueLock : public Base
@@ -218,6 +258,30 @@ public:
      friend class reverse_lock;
 };
 
+/**
+ * Wrapper around std::shared_lock for SharedMutex. It is lock order checked
+ * like an exclusive lock, since it can take part in a deadlock all the same.
+ */
+template <typename Mutex>
+class SCOPED_LOCKABLE SharedLock : public std::shared_lock<Mutex>
+{
+    using Base = std::shared_lock<Mutex>;
+
+public:
+    SharedLock(Mutex& mutex, const char* pszName, const char* pszFile, int nLine) SHARED_LOCK_FUNCTION(mutex) : Base(mutex, std::defer_lock)
+    {
+        EnterCritical(pszName, pszFile, nLine, Base::mutex());
+        if (Base::try_lock()) return;
+        LOG_TIME_MICROS_WITH_CATEGORY(strprintf("lock contention %s, %s:%d", pszName, pszFile, nLine), BCLog::LOCK);
+        Base::lock();
+    }
+
+    ~SharedLock() UNLOCK_FUNCTION()
+    {
+        if (Base::owns_lock()) LeaveCritical();
+    }
+};
+
 #define REVERSE_LOCK(g) typename std::decay<decltype(g)>::type::reverse_lock PASTE2(revlock, __COUNTER__)(g, #g, __FILE__, __LINE__)
 
 template<typename MutexArg>
@@ -227,6 +291,7 @@ using DebugLock = UniqueLock<typename std::remove_reference<typename std::remove
 #define LOCK2(cs1, cs2)                                               \
     DebugLock<decltype(cs1)> criticalblock1(cs1, #cs1, __FILE__, __LINE__); \
     DebugLock<decltype(cs2)> criticalblock2(cs2, #cs2, __FILE__, __LINE__);
+#define READ_LOCK(cs) SharedLock<std::remove_reference_t<decltype(cs)>> PASTE2(criticalblock, __COUNTER__)(cs, #cs, __FILE__, __LINE__)
 #define TRY_LOCK(cs, name) DebugLock<decltype(cs)> name(cs, #cs, __FILE__, __LINE__, true)
 #define WAIT_LOCK(cs, name) DebugLock<decltype(cs)> name(cs, #cs, __FILE__, __LINE__)
 
@@ -0,0 +1,134 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockencodings.h>
+#include <node/blockcache.h>
+#include <primitives/block.h>
+#include <serialize.h>
+#include <version.h>
+
+#include <test/util/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockcache_tests, BasicTestingSetup)
+
+static std::shared_ptr<const CBlock> MakeBlock()
+{
+    auto block = std::make_shared<CBlock>();
+    block->nNonce = InsecureRand32();
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout.hash = InsecureRand256();
+    tx.vin[0].scriptWitness.stack.push_back(std::vector<unsigned char>(100, 0x01));
+    tx.vout.resize(1);
+    tx.vout[0].nValue = 42;
+    block->vtx.push_back(MakeTransactionRef(tx));
+    return block;
+}
+
+BOOST_AUTO_TEST_CASE(blockcache_forms)
+{
+    BlockCache cache{1 << 20};
+    const auto block = MakeBlock();
+    const uint256 hash = block->GetHash();
+
+    BOOST_CHECK(!cache.GetBlock(hash));
+    BOOST_CHECK_EQUAL(cache.GetStats().m_misses, 1U);
+
+    cache.Insert(block);
+    BOOST_CHECK_EQUAL(cache.GetStats().m_blocks, 1U);
+    BOOST_CHECK(cache.GetBlock(hash) == block);
+
+    // Serialized forms are created on first use and then shared
+    const auto witness_data = cache.GetSerializedBlock(hash, /*witness=*/true);
+    const auto no_witness_data = cache.GetSerializedBlock(hash, /*witness=*/false);
+    BOOST_CHECK(*witness_data == *BlockCache::Serialize(*block, /*witness=*/true));
+    BOOST_CHECK(*no_witness_data == *BlockCache::Serialize(*block, /*witness=*/false));
+    BOOST_CHECK_EQUAL(witness_data->size(), GetSerializeSize(*block, PROTOCOL_VERSION));
+    BOOST_CHECK_EQUAL(no_witness_data->size(), GetSerializeSize(*block, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS));
+    BOOST_CHECK(cache.GetSerializedBlock(hash, /*witness=*/true) == witness_data);
+    BOOST_CHECK(cache.GetSerializedBlock(hash, /*witness=*/false) == no_witness_data);
+
+    const auto compact_block = cache.GetCompactBlock(hash, /*use_wtxid=*/true);
+    BOOST_CHECK(compact_block->header.GetHash() == hash);
+    BOOST_CHECK(cache.GetCompactBlock(hash, /*use_wtxid=*/true) == compact_block);
+    BOOST_CHECK(cache.GetCompactBlock(hash, /*use_wtxid=*/false) != compact_block);
+
+    const BlockCache::Stats stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.m_hits, 8U);
+    BOOST_CHECK_EQUAL(stats.m_misses, 1U);
+    BOOST_CHECK(stats.m_bytes > witness_data->size() + no_witness_data->size());
+    BOOST_CHECK(stats.m_bytes <= stats.m_max_bytes);
+}
+
+BOOST_AUTO_TEST_CASE(blockcache_serialized)
+{
+    BlockCache cache{1 << 20};
+    const auto block = MakeBlock();
+    const uint256 hash = block->GetHash();
+
+    // A block without witnesses cannot be served in other forms, so it is not cached
+    cache.InsertSerialized(hash, /*witness=*/false, BlockCache::Serialize(*block, /*witness=*/false));
+    BOOST_CHECK_EQUAL(cache.GetStats().m_blocks, 0U);
+    // Compact blocks are only added to cached blocks
+    cache.InsertCompactBlock(hash, /*use_wtxid=*/true, std::make_shared<const CBlockHeaderAndShortTxIDs>(*block, true));
+    BOOST_CHECK_EQUAL(cache.GetStats().m_blocks, 0U);
+
+    // A block read from disk is deserialized when it is needed
+    cache.InsertSerialized(hash, /*witness=*/true, BlockCache::Serialize(*block, /*witness=*/true));
+    BOOST_CHECK_EQUAL(cache.GetStats().m_blocks, 1U);
+    const auto cached_block = cache.GetBlock(hash);
+    BOOST_REQUIRE(cached_block);
+    BOOST_CHECK(cached_block->GetHash() == hash);
+    BOOST_CHECK(cached_block->vtx[0]->GetWitnessHash() == block->vtx[0]->GetWitnessHash());
+    BOOST_CHECK(cache.GetBlock(hash) == cached_block);
+    BOOST_CHECK(*cache.GetSerializedBlock(hash, /*witness=*/false) == *BlockCache::Serialize(*block, /*witness=*/false));
+}
+
+BOOST_AUTO_TEST_CASE(blockcache_eviction)
+{
+    std::vector<std::shared_ptr<const CBlock>> blocks;
+    for (int i = 0; i < 4; ++i) blocks.push_back(MakeBlock());
+    const size_t block_bytes = BlockCache::Serialize(*blocks[0], /*witness=*/true)->size();
+
+    // Room for three blocks, serialized with witnesses
+    BlockCache cache{3 * block_bytes};
+    for (int i = 0; i < 3; ++i) {
+        cache.InsertSerialized(blocks[i]->GetHash(), /*witness=*/true, BlockCache::Serialize(*blocks[i], /*witness=*/true));
+    }
+    BOOST_CHECK_EQUAL(cache.GetStats().m_blocks, 3U);
+    BOOST_CHECK_EQUAL(cache.GetStats().m_bytes, 3 * block_bytes);
+
+    // Using the oldest block makes the second one the least recently used
+    BOOST_CHECK(cache.GetSerializedBlock(blocks[0]->GetHash(), /*witness=*/true));
+    cache.InsertSerialized(blocks[3]->GetHash(), /*witness=*/true, BlockCache::Serialize(*blocks[3], /*witness=*/true));
+    BOOST_CHECK_EQUAL(cache.GetStats().m_blocks, 3U);
+    BOOST_CHECK(!cache.GetSerializedBlock(blocks[1]->GetHash(), /*witness=*/true));
+    BOOST_CHECK(cache.GetSerializedBlock(blocks[0]->GetHash(), /*witness=*/true));
+    BOOST_CHECK(cache.GetSerializedBlock(blocks[2]->GetHash(), /*witness=*/true));
+    BOOST_CHECK(cache.GetSerializedBlock(blocks[3]->GetHash(), /*witness=*/true));
+
+    // Adding another form of a block counts towards the limit as well
+    BOOST_CHECK(cache.GetSerializedBlock(blocks[0]->GetHash(), /*witness=*/false));
+    BOOST_CHECK(cache.GetStats().m_blocks < 3);
+    BOOST_CHECK(cache.GetStats().m_bytes <= 3 * block_bytes);
+    BOOST_CHECK(!cache.GetSerializedBlock(blocks[2]->GetHash(), /*witness=*/true));
+}
+
+BOOST_AUTO_TEST_CASE(blockcache_disabled)
+{
+    BlockCache cache{0};
+    const auto block = MakeBlock();
+    const uint256 hash = block->GetHash();
+
+    cache.Insert(block);
+    BOOST_CHECK_EQUAL(cache.GetStats().m_blocks, 0U);
+    BOOST_CHECK_EQUAL(cache.GetStats().m_bytes, 0U);
+    BOOST_CHECK(!cache.GetBlock(hash));
+    BOOST_CHECK_EQUAL(cache.GetStats().m_hits, 0U);
+    BOOST_CHECK_EQUAL(cache.GetStats().m_misses, 1U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,207 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/blockdownload.h>
+#include <tinyformat.h>
+#include <util/time.h>
+
+#include <test/util/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <deque>
+#include <list>
+#include <map>
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(blockdownload_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(blockdownload_estimates)
+{
+    BlockDownloadScheduler scheduler;
+    BOOST_CHECK_EQUAL(scheduler.GetMaxBlocksInFlight(0), INITIAL_BLOCKS_IN_TRANSIT_PER_PEER);
+    BOOST_CHECK(!scheduler.GetExpectedBlockTime(0));
+
+    // The first block gives the latency, requested while nothing was being received.
+    scheduler.BlockReceived(0, 1s, 1s + 100ms, 500'000);
+    BOOST_CHECK(scheduler.GetExpectedBlockTime(0) == 100ms);
+    // Until the throughput is known, each block is expected to take the latency: 1 + (4s - 100ms) / 100ms blocks
+    BOOST_CHECK(scheduler.GetExpectedBlockTime(0, 1) == 200ms);
+    BOOST_CHECK_EQUAL(scheduler.GetMaxBlocksInFlight(0), 40);
+
+    // A block requested together with the first one gives the throughput: 500 kB in 250ms.
+    scheduler.BlockReceived(0, 1s, 1s + 350ms, 500'000);
+    BOOST_CHECK(scheduler.GetExpectedBlockTime(0) == 100ms);
+    BOOST_CHECK(scheduler.GetExpectedBlockTime(0, 4) == 1100ms);
+    // 1 + (4s - 100ms) / 250ms blocks
+    BOOST_CHECK_EQUAL(scheduler.GetMaxBlocksInFlight(0), 16);
+
+    // A slow peer keeps the minimum, a fast one is capped.
+    scheduler.BlockReceived(1, 0s, 3s, 500'000);
+    scheduler.BlockReceived(1, 0s, 13s, 500'000);
+    BOOST_CHECK_EQUAL(scheduler.GetMaxBlocksInFlight(1), MIN_BLOCKS_IN_TRANSIT_PER_PEER);
+    scheduler.BlockReceived(2, 0s, 10ms, 500'000);
+    scheduler.BlockReceived(2, 0s, 11ms, 500'000);
+    BOOST_CHECK_EQUAL(scheduler.GetMaxBlocksInFlight(2), MAX_ADAPTIVE_BLOCKS_IN_TRANSIT_PER_PEER);
+
+    // Forgotten peers start over.
+    scheduler.ForgetPeer(1);
+    BOOST_CHECK_EQUAL(scheduler.GetMaxBlocksInFlight(1), INITIAL_BLOCKS_IN_TRANSIT_PER_PEER);
+    BOOST_CHECK(!scheduler.GetExpectedBlockTime(1));
+}
+
+BOOST_AUTO_TEST_CASE(blockdownload_rerequest)
+{
+    BlockDownloadScheduler scheduler;
+    // Peer 0 takes 100ms plus 250ms per block, peer 1 takes 3s plus 10s per block.
+    scheduler.BlockReceived(0, 0s, 100ms, 500'000);
+    scheduler.BlockReceived(0, 0s, 350ms, 500'000);
+    scheduler.BlockReceived(1, 0s, 3s, 500'000);
+    scheduler.BlockReceived(1, 0s, 13s, 500'000);
+
+    // A candidate without estimates is never used.
+    BOOST_CHECK(!scheduler.ShouldRerequest(0, 0s, 0, 2, 0, 1h));
+    // Peers that did not deliver a block yet are overdue once the minimum wait passed.
+    BOOST_CHECK(!scheduler.ShouldRerequest(2, 0s, 0, 0, 0, BLOCK_REREQUEST_MIN_WAIT - 1us));
+    BOOST_CHECK(scheduler.ShouldRerequest(2, 0s, 0, 0, 0, BLOCK_REREQUEST_MIN_WAIT));
+    // Blocks requested after the last one arrived take the latency of the slow peer.
+    BOOST_CHECK(scheduler.ShouldRerequest(1, 20s, 0, 0, 0, 21s));
+    // ... but not if they are almost there.
+    BOOST_CHECK(!scheduler.ShouldRerequest(1, 20s, 0, 0, 0, 22950ms));
+    // Blocks further back in its queue take longer.
+    BOOST_CHECK(scheduler.ShouldRerequest(1, 20s, 1, 0, 0, 30s));
+    // ... unless they are overdue.
+    BOOST_CHECK(scheduler.ShouldRerequest(1, 20s, 0, 0, 0, 23s));
+    // ... or if the fast peer would get them after many other blocks.
+    BOOST_CHECK(!scheduler.ShouldRerequest(1, 20s, 0, 0, 20, 21s));
+    // Blocks requested before the last one arrived are only sent after it.
+    BOOST_CHECK(scheduler.ShouldRerequest(1, 0s, 0, 0, 0, 22s));
+    // The slow peer is not used for blocks the fast one delivers before it would.
+    BOOST_CHECK(!scheduler.ShouldRerequest(0, 0s, 30, 1, 0, 7s));
+}
+
+namespace {
+
+constexpr size_t BLOCK_SIZE{500'000};
+constexpr int NUM_BLOCKS{2000};
+constexpr int DOWNLOAD_WINDOW{1024};
+constexpr std::chrono::milliseconds TICK{10};
+constexpr std::chrono::seconds STALLING_TIMEOUT{2};
+
+/** A peer that sends the blocks requested from it in order, over a link with the given latency and bandwidth. */
+struct MockPeer {
+    NodeId id;
+    std::chrono::microseconds latency;
+    double bytes_per_second;
+    std::chrono::microseconds link_free{0};
+    /** Blocks being sent, with the time they arrive */
+    std::deque<std::pair<int, std::chrono::microseconds>> sending;
+    /** Blocks requested from this peer and not received yet, in the order they were requested */
+    std::list<int> in_flight;
+    std::chrono::microseconds stalling_since{0};
+};
+
+/**
+ * Download a chain from mock peers, following the block request logic of net_processing:
+ * peers are asked for the next missing blocks within the download window, and a peer that
+ * holds back the window while another one is idle is disconnected after STALLING_TIMEOUT,
+ * in which case it reconnects as a new peer. With adaptive scheduling, the number of blocks
+ * in flight per peer and early re-requests of the block that holds back the window come from
+ * BlockDownloadScheduler; otherwise each peer gets INITIAL_BLOCKS_IN_TRANSIT_PER_PEER blocks.
+ *
+ * Returns how long the download took.
+ */
+std::chrono::microseconds SimulateIBD(bool adaptive)
+{
+    BlockDownloadScheduler scheduler;
+    std::vector<MockPeer> peers;
+    NodeId next_id{0};
+    for (int i = 0; i < 6; ++i) peers.push_back({next_id++, 100ms, 2e6});
+    for (int i = 0; i < 2; ++i) peers.push_back({next_id++, 1s, 2e4});
+
+    std::vector<bool> received(NUM_BLOCKS, false);
+    // In-flight blocks, with the peer they were requested from and when.
+    std::map<int, std::pair<MockPeer*, std::chrono::microseconds>> blocks_in_flight;
+    int first_missing{0};
+    std::chrono::microseconds now{0};
+
+    const auto request = [&](MockPeer& peer, int height) {
+        if (const auto it = blocks_in_flight.find(height); it != blocks_in_flight.end()) {
+            it->second.first->in_flight.remove(height);
+            it->second.first->stalling_since = 0us;
+        }
+        blocks_in_flight[height] = {&peer, now};
+        peer.in_flight.push_back(height);
+        const auto transfer = std::chrono::microseconds{int64_t(BLOCK_SIZE / peer.bytes_per_second * 1e6)};
+        peer.link_free = std::max(now + peer.latency, peer.link_free) + transfer;
+        peer.sending.emplace_back(height, peer.link_free);
+    };
+
+    while (first_missing < NUM_BLOCKS) {
+        BOOST_REQUIRE(now < 1h);
+        now += TICK;
+        for (MockPeer& peer : peers) {
+            while (!peer.sending.empty() && peer.sending.front().second <= now) {
+                const int height = peer.sending.front().first;
+                peer.sending.pop_front();
+                const auto it = blocks_in_flight.find(height);
+                if (it == blocks_in_flight.end()) continue;
+                MockPeer& owner = *it->second.first;
+                if (&owner == &peer && adaptive) scheduler.BlockReceived(peer.id, it->second.second, now, BLOCK_SIZE);
+                owner.in_flight.remove(height);
+                owner.stalling_since = 0us;
+                blocks_in_flight.erase(it);
+                received[height] = true;
+            }
+        }
+        while (first_missing < NUM_BLOCKS && received[first_missing]) ++first_missing;
+
+        for (MockPeer& peer : peers) {
+            const int max_in_flight = adaptive ? scheduler.GetMaxBlocksInFlight(peer.id) : INITIAL_BLOCKS_IN_TRANSIT_PER_PEER;
+            const int window_end = std::min(first_missing + DOWNLOAD_WINDOW, NUM_BLOCKS);
+            bool fetched{false};
+            for (int height = first_missing; height < window_end && int(peer.in_flight.size()) < max_in_flight; ++height) {
+                if (received[height] || blocks_in_flight.count(height)) continue;
+                request(peer, height);
+                fetched = true;
+            }
+            if (fetched || !peer.in_flight.empty() || first_missing == NUM_BLOCKS) continue;
+            // The window is full: the peer that has the block at its start in flight holds it back.
+            MockPeer& staller = *blocks_in_flight.at(first_missing).first;
+            std::vector<int> rerequest;
+            int queue_position{0};
+            for (const int height : staller.in_flight) {
+                if (!adaptive || int(rerequest.size()) >= max_in_flight) break;
+                if (scheduler.ShouldRerequest(staller.id, blocks_in_flight.at(height).second, queue_position++, peer.id, rerequest.size(), now)) {
+                    rerequest.push_back(height);
+                }
+            }
+            for (const int height : rerequest) request(peer, height);
+            if (rerequest.empty() && staller.stalling_since == 0us) staller.stalling_since = now;
+        }
+
+        for (MockPeer& peer : peers) {
+            if (peer.stalling_since == 0us || peer.stalling_since >= now - STALLING_TIMEOUT) continue;
+            for (const int height : peer.in_flight) blocks_in_flight.erase(height);
+            scheduler.ForgetPeer(peer.id);
+            peer = MockPeer{next_id++, peer.latency, peer.bytes_per_second};
+        }
+    }
+    return now;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(blockdownload_ibd_simulation)
+{
+    const auto fixed_time = SimulateIBD(/*adaptive=*/false);
+    const auto adaptive_time = SimulateIBD(/*adaptive=*/true);
+    BOOST_TEST_MESSAGE(strprintf("IBD of %d blocks: %.1fs with %d blocks per peer, %.1fs with adaptive scheduling",
+                                 NUM_BLOCKS, count_microseconds(fixed_time) / 1e6, INITIAL_BLOCKS_IN_TRANSIT_PER_PEER,
+                                 count_microseconds(adaptive_time) / 1e6));
+    BOOST_CHECK(adaptive_time < fixed_time);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
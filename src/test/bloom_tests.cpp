@@ -514,4 +514,50 @@ BOOST_AUTO_TEST_CASE(rolling_bloom)
     g_mock_deterministic_tests = false;
 }
 
+BOOST_AUTO_TEST_CASE(blocked_rolling_bloom)
+{
+    SeedInsecureRand(SeedRand::ZEROS);
+    g_mock_deterministic_tests = true;
+
+    // last-100-entry, 1% false positive:
+    CBlockedRollingBloomFilter rb1(100, 0.01);
+    static const int DATASIZE=399;
+    std::vector<unsigned char> data[DATASIZE];
+    for (int i = 0; i < DATASIZE; i++) {
+        data[i] = RandomData();
+        rb1.insert(data[i]);
+    }
+    // Last 100 guaranteed to be remembered:
+    for (int i = 299; i < DATASIZE; i++) {
+        BOOST_CHECK(rb1.contains(data[i]));
+    }
+    BOOST_CHECK(rb1.contains(data[DATASIZE-1]));
+    rb1.reset();
+    BOOST_CHECK(!rb1.contains(data[DATASIZE-1]));
+
+    // Roll through data, make sure last 100 entries are always remembered:
+    for (int i = 0; i < DATASIZE; i++) {
+        if (i >= 100)
+            BOOST_CHECK(rb1.contains(data[i-100]));
+        rb1.insert(data[i]);
+        BOOST_CHECK(rb1.contains(data[i]));
+    }
+
+    // The false positive rate holds when the filter is as full as it gets,
+    // which is with 3 generations of 1000 / 2 entries.
+    for (const double fp_rate : {0.01, 0.001}) {
+        CBlockedRollingBloomFilter rb2(1000, fp_rate);
+        for (int i = 0; i < 1500; i++) {
+            rb2.insert(RandomData());
+        }
+        unsigned int nHits = 0;
+        for (int i = 0; i < 100000; i++) {
+            if (rb2.contains(RandomData()))
+                ++nHits;
+        }
+        BOOST_CHECK_LE(nHits, 100000 * fp_rate);
+    }
+    g_mock_deterministic_tests = false;
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -429,4 +429,52 @@ BOOST_AUTO_TEST_CASE(DoS_mapOrphans)
     BOOST_CHECK(orphanage.CountOrphans() == 0);
 }
 
+BOOST_AUTO_TEST_CASE(DoS_orphan_weight_limits)
+{
+    TxOrphanageTest orphanage;
+    LOCK(g_cs_orphans);
+
+    // Peer 0 floods the orphanage, peer 1 announces a single orphan.
+    std::vector<CTransactionRef> peer0_orphans;
+    for (int i = 0; i < 20; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout.n = 0;
+        tx.vin[0].prevout.hash = InsecureRand256();
+        tx.vin[0].scriptSig << std::vector<unsigned char>(5000, 1);
+        tx.vout.resize(1);
+        tx.vout[0].nValue = 1*CENT;
+        tx.vout[0].scriptPubKey = CScript() << OP_TRUE;
+        peer0_orphans.push_back(MakeTransactionRef(tx));
+        BOOST_CHECK(orphanage.AddTx(peer0_orphans.back(), 0));
+    }
+    CMutableTransaction small_tx;
+    small_tx.vin.resize(1);
+    small_tx.vin[0].prevout.hash = InsecureRand256();
+    small_tx.vout.resize(1);
+    small_tx.vout[0].scriptPubKey = CScript() << OP_TRUE;
+    const CTransactionRef small_orphan = MakeTransactionRef(small_tx);
+    BOOST_CHECK(orphanage.AddTx(small_orphan, 1));
+
+    int64_t total_weight = GetTransactionWeight(*small_orphan);
+    for (const auto& tx : peer0_orphans) total_weight += GetTransactionWeight(*tx);
+    BOOST_CHECK_EQUAL(orphanage.TotalOrphanWeight(), total_weight);
+    BOOST_CHECK_EQUAL(orphanage.PeerOrphanWeight(1), GetTransactionWeight(*small_orphan));
+
+    // Shrinking below the two peers' reservations only evicts from the heavy peer.
+    orphanage.LimitOrphans(/*max_orphans=*/1000, /*max_weight=*/0);
+    BOOST_CHECK(orphanage.HaveTx(GenTxid::Txid(small_orphan->GetHash())));
+    BOOST_CHECK(orphanage.PeerOrphanWeight(0) <= 2 * ORPHAN_RESERVED_WEIGHT_PER_PEER);
+    BOOST_CHECK(orphanage.TotalOrphanWeight() <= 2 * ORPHAN_RESERVED_WEIGHT_PER_PEER);
+
+    // Count-based eviction also takes from the heaviest peer first.
+    orphanage.LimitOrphans(/*max_orphans=*/1, /*max_weight=*/0);
+    BOOST_CHECK_EQUAL(orphanage.CountOrphans(), 1U);
+    BOOST_CHECK(orphanage.HaveTx(GenTxid::Txid(small_orphan->GetHash())));
+
+    orphanage.EraseForPeer(1);
+    BOOST_CHECK_EQUAL(orphanage.CountOrphans(), 0U);
+    BOOST_CHECK_EQUAL(orphanage.TotalOrphanWeight(), 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
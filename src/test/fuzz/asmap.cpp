@@ -56,5 +56,5 @@ FUZZ_TARGET(asmap)
         memcpy(&ipv4, addr_data, addr_size);
         net_addr.SetIP(CNetAddr{ipv4});
     }
-    (void)net_addr.GetMappedAS(asmap);
+    (void)net_addr.GetMappedAS(CompiledAsmap{asmap});
 }
@@ -44,6 +44,13 @@ FUZZ_TARGET(asmap_direct)
         }
         // No address input should trigger assertions in interpreter
         std::vector<bool> addr(buffer.begin() + sep_pos + 1, buffer.end());
-        (void)Interpret(asmap, addr);
+        const uint32_t asn{Interpret(asmap, addr)};
+        // The compiled asmap gives the same result. The bits of addr are padded
+        // to whole bytes, which the asmap does not consume.
+        std::vector<uint8_t> addr_bytes((addr.size() + 7) / 8);
+        for (size_t i = 0; i < addr.size(); ++i) {
+            addr_bytes[i / 8] |= addr[i] << (7 - i % 8);
+        }
+        assert(CompiledAsmap{asmap}.Interpret(addr_bytes) == asn);
     }
 }
@@ -95,6 +95,7 @@ void fuzz_target(FuzzBufferType buffer, const std::string& LIMIT_TO_MESSAGE_TYPE
                                                 GetTime<std::chrono::microseconds>(), std::atomic<bool>{false});
     } catch (const std::ios_base::failure&) {
     }
+    g_setup->m_node.peerman->ProcessDeferredWork();
     {
         LOCK(p2p_node.cs_sendProcessing);
         g_setup->m_node.peerman->SendMessages(&p2p_node);
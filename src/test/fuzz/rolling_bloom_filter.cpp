@@ -18,9 +18,10 @@ FUZZ_TARGET(rolling_bloom_filter)
 {
     FuzzedDataProvider fuzzed_data_provider(buffer.data(), buffer.size());
 
-    CRollingBloomFilter rolling_bloom_filter{
-        fuzzed_data_provider.ConsumeIntegralInRange<unsigned int>(1, 1000),
-        0.999 / fuzzed_data_provider.ConsumeIntegralInRange<unsigned int>(1, std::numeric_limits<unsigned int>::max())};
+    const unsigned int n_elements{fuzzed_data_provider.ConsumeIntegralInRange<unsigned int>(1, 1000)};
+    const double fp_rate{0.999 / fuzzed_data_provider.ConsumeIntegralInRange<unsigned int>(1, std::numeric_limits<unsigned int>::max())};
+    CRollingBloomFilter rolling_bloom_filter{n_elements, fp_rate};
+    CBlockedRollingBloomFilter blocked_filter{n_elements, fp_rate};
     LIMITED_WHILE(fuzzed_data_provider.remaining_bytes() > 0, 3000)
     {
         CallOneOf(
@@ -31,6 +32,8 @@ FUZZ_TARGET(rolling_bloom_filter)
                 rolling_bloom_filter.insert(b);
                 const bool present = rolling_bloom_filter.contains(b);
                 assert(present);
+                blocked_filter.insert(b);
+                assert(blocked_filter.contains(b));
             },
             [&] {
                 const uint256 u256{ConsumeUInt256(fuzzed_data_provider)};
@@ -38,9 +41,12 @@ FUZZ_TARGET(rolling_bloom_filter)
                 rolling_bloom_filter.insert(u256);
                 const bool present = rolling_bloom_filter.contains(u256);
                 assert(present);
+                blocked_filter.insert(u256);
+                assert(blocked_filter.contains(u256));
             },
             [&] {
                 rolling_bloom_filter.reset();
+                blocked_filter.reset();
             });
     }
 }
@@ -126,6 +126,7 @@ const std::vector<std::string> RPC_COMMANDS_SAFE_FOR_FUZZING{
     "getmempoolancestors",
     "getmempooldescendants",
     "getmempoolentry",
+    "getmempoolfeehistogram",
     "getmempoolinfo",
     "getmininginfo",
     "getnettotals",
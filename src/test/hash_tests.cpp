@@ -8,6 +8,8 @@
 #include <test/util/setup_common.h>
 #include <util/strencodings.h>
 
+#include <vector>
+
 #include <boost/test/unit_test.hpp>
 
 BOOST_AUTO_TEST_SUITE(hash_tests)
@@ -145,6 +147,24 @@ BOOST_AUTO_TEST_CASE(siphash)
         BOOST_CHECK_EQUAL(SipHashUint256(k1, k2, x), sip256.Finalize());
         BOOST_CHECK_EQUAL(SipHashUint256Extra(k1, k2, x, n), sip288.Finalize());
     }
+
+    // Check consistency between SipHashUint256Batch and SipHashUint256, for
+    // batch sizes that do and do not fill the interleaved lanes.
+    for (size_t count = 0; count < 11; ++count) {
+        uint64_t k1 = ctx.rand64();
+        uint64_t k2 = ctx.rand64();
+        std::vector<uint256> vals(count);
+        std::vector<const uint256*> ptrs;
+        for (uint256& val : vals) {
+            val = InsecureRand256();
+            ptrs.push_back(&val);
+        }
+        std::vector<uint64_t> out(count);
+        SipHashUint256Batch(k1, k2, ptrs.data(), count, out.data());
+        for (size_t i = 0; i < count; ++i) {
+            BOOST_CHECK_EQUAL(out[i], SipHashUint256(k1, k2, vals[i]));
+        }
+    }
 }
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,361 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <arith_uint256.h>
+#include <chainparams.h>
+#include <net.h>
+#include <net_processing.h>
+#include <netmessagemaker.h>
+#include <node/headerssync.h>
+#include <pow.h>
+#include <primitives/block.h>
+#include <protocol.h>
+#include <timedata.h>
+#include <tinyformat.h>
+#include <util/system.h>
+#include <validation.h>
+#include <version.h>
+
+#include <test/util/net.h>
+#include <test/util/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+/** Build a chain of regtest headers, with headers[i] at height i. */
+std::vector<CBlockHeader> MakeHeaders(const CChainParams& params, int count)
+{
+    std::vector<CBlockHeader> headers{params.GenesisBlock().GetBlockHeader()};
+    for (int height = 1; height <= count; ++height) {
+        CBlockHeader header;
+        header.nVersion = 4;
+        header.hashPrevBlock = headers.back().GetHash();
+        header.nTime = headers.back().nTime + 600;
+        header.nBits = headers.back().nBits;
+        while (!CheckProofOfWork(header.GetHash(), header.nBits, params.GetConsensus())) ++header.nNonce;
+        headers.push_back(header);
+    }
+    return headers;
+}
+
+std::vector<CBlockHeader> Slice(const std::vector<CBlockHeader>& headers, int first, int last)
+{
+    return {headers.begin() + first, headers.begin() + last + 1};
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(headerssync_tests)
+
+BOOST_FIXTURE_TEST_CASE(headerssync_ranges, BasicTestingSetup)
+{
+    const auto chain_params = CreateChainParams(ArgsManager{}, CBaseChainParams::REGTEST);
+    const auto& params = chain_params->GetConsensus();
+    const auto headers = MakeHeaders(*chain_params, 5000);
+    HeadersSyncScheduler sync{{{0, headers[0].GetHash()}, {3000, headers[3000].GetHash()}, {5000, headers[5000].GetHash()}}};
+    BOOST_CHECK_EQUAL(sync.GetPendingRangeCount(), 2U);
+
+    // The range from the best header is left to the headers sync peer.
+    const auto request = sync.AssignRange(/*peer=*/1, /*best_height=*/0, 0s);
+    BOOST_REQUIRE(request);
+    BOOST_CHECK(request->locator_hash == headers[3000].GetHash());
+    BOOST_CHECK(request->stop_hash == headers[5000].GetHash());
+    BOOST_CHECK(!sync.AssignRange(/*peer=*/1, /*best_height=*/0, 0s));
+    BOOST_CHECK(!sync.AssignRange(/*peer=*/2, /*best_height=*/0, 0s));
+
+    // Headers from other peers, or that do not follow the range start, are processed as usual.
+    BOOST_CHECK(sync.ReceivedHeaders(2, Slice(headers, 3001, 5000), params, 1s) == HeadersSyncScheduler::Result::NOT_FOR_RANGE);
+    BOOST_CHECK(sync.ReceivedHeaders(1, Slice(headers, 1, 2000), params, 1s) == HeadersSyncScheduler::Result::NOT_FOR_RANGE);
+
+    BOOST_CHECK(sync.ReceivedHeaders(1, Slice(headers, 3001, 5000), params, 1s) == HeadersSyncScheduler::Result::DONE);
+    BOOST_CHECK_EQUAL(sync.GetPendingRangeCount(), 1U);
+    BOOST_CHECK(!sync.GetRequest(1));
+
+    // The headers are connected once the start of the range is known, in order.
+    const uint256 start_hash{headers[3000].GetHash()};
+    auto is_known = [&](const uint256& hash) { return hash == start_hash; };
+    BOOST_CHECK(sync.TakeConnectableHeaders([](const uint256&) { return false; }, 1500).empty());
+    auto connect = sync.TakeConnectableHeaders(is_known, 1500);
+    BOOST_REQUIRE_EQUAL(connect.size(), 1500U);
+    BOOST_CHECK(connect.front().GetHash() == headers[3001].GetHash());
+    // The rest follows the headers taken before.
+    BOOST_CHECK(sync.TakeConnectableHeaders(is_known, 1500).empty());
+    connect = sync.TakeConnectableHeaders([&](const uint256& hash) { return hash == headers[4500].GetHash(); }, 1500);
+    BOOST_REQUIRE_EQUAL(connect.size(), 500U);
+    BOOST_CHECK(connect.back().GetHash() == headers[5000].GetHash());
+}
+
+BOOST_FIXTURE_TEST_CASE(headerssync_partial, BasicTestingSetup)
+{
+    const auto chain_params = CreateChainParams(ArgsManager{}, CBaseChainParams::REGTEST);
+    const auto& params = chain_params->GetConsensus();
+    const auto headers = MakeHeaders(*chain_params, 5500);
+    HeadersSyncScheduler sync{{{1000, headers[1000].GetHash()}, {5500, headers[5500].GetHash()}}};
+
+    BOOST_REQUIRE(sync.AssignRange(/*peer=*/1, /*best_height=*/0, 0s));
+    BOOST_CHECK(sync.ReceivedHeaders(1, Slice(headers, 1001, 3000), params, 1s) == HeadersSyncScheduler::Result::MORE);
+    const auto request = sync.GetRequest(1);
+    BOOST_REQUIRE(request);
+    BOOST_CHECK(request->locator_hash == headers[3000].GetHash());
+
+    // A peer that stops before the end of the range does not get it, nor any other.
+    BOOST_CHECK(sync.ReceivedHeaders(1, Slice(headers, 3001, 4000), params, 2s) == HeadersSyncScheduler::Result::UNSERVED);
+    BOOST_CHECK(!sync.AssignRange(/*peer=*/1, /*best_height=*/0, 2s));
+    const auto next_request = sync.AssignRange(/*peer=*/2, /*best_height=*/0, 2s);
+    BOOST_REQUIRE(next_request);
+    BOOST_CHECK(next_request->locator_hash == headers[4000].GetHash());
+
+    // Ranges are reassigned when the peer does not answer in time.
+    BOOST_CHECK(!sync.AssignRange(/*peer=*/3, /*best_height=*/0, 2s + HEADERS_RANGE_TIMEOUT - 1us));
+    BOOST_CHECK(sync.AssignRange(/*peer=*/3, /*best_height=*/0, 2s + HEADERS_RANGE_TIMEOUT));
+    BOOST_CHECK(sync.ReceivedHeaders(2, Slice(headers, 4001, 5500), params, 3s) == HeadersSyncScheduler::Result::NOT_FOR_RANGE);
+    BOOST_CHECK(sync.ReceivedHeaders(3, Slice(headers, 4001, 5500), params, 3s) == HeadersSyncScheduler::Result::DONE);
+
+    // All received headers are connected in one sequence.
+    size_t connected{0};
+    uint256 known{headers[1000].GetHash()};
+    for (auto batch = sync.TakeConnectableHeaders([&](const uint256& hash) { return hash == known; }, 2000); !batch.empty();
+         batch = sync.TakeConnectableHeaders([&](const uint256& hash) { return hash == known; }, 2000)) {
+        BOOST_CHECK(batch.front().hashPrevBlock == known);
+        known = batch.back().GetHash();
+        connected += batch.size();
+    }
+    BOOST_CHECK_EQUAL(connected, 4500U);
+    BOOST_CHECK(known == headers[5500].GetHash());
+
+    // Peers are usable again after reconnecting.
+    sync.ForgetPeer(1);
+    BOOST_CHECK_EQUAL(sync.GetPendingRangeCount(), 0U);
+}
+
+BOOST_FIXTURE_TEST_CASE(headerssync_invalid, BasicTestingSetup)
+{
+    const auto chain_params = CreateChainParams(ArgsManager{}, CBaseChainParams::REGTEST);
+    const auto& params = chain_params->GetConsensus();
+    const auto headers = MakeHeaders(*chain_params, 1100);
+    HeadersSyncScheduler sync{{{100, headers[100].GetHash()}, {1100, headers[1100].GetHash()}}};
+    BOOST_REQUIRE(sync.AssignRange(/*peer=*/1, /*best_height=*/0, 0s));
+
+    // Headers past the end of the range
+    auto overflow = Slice(headers, 101, 1100);
+    overflow.push_back(headers[1]);
+    BOOST_CHECK(sync.ReceivedHeaders(1, overflow, params, 1s) == HeadersSyncScheduler::Result::INVALID);
+    // Headers that do not connect to each other
+    auto broken = Slice(headers, 101, 1000);
+    broken.erase(broken.begin() + 10);
+    BOOST_CHECK(sync.ReceivedHeaders(1, broken, params, 1s) == HeadersSyncScheduler::Result::INVALID);
+    // Headers without enough proof of work
+    auto weak = Slice(headers, 101, 101);
+    weak[0].nBits = UintToArith256(params.powLimit).GetCompact() - 1;
+    while (CheckProofOfWork(weak[0].GetHash(), weak[0].nBits, params)) ++weak[0].nNonce;
+    BOOST_CHECK(sync.ReceivedHeaders(1, weak, params, 1s) == HeadersSyncScheduler::Result::INVALID);
+    // A chain that does not end at the checkpoint
+    auto fork = Slice(headers, 101, 1100);
+    ++fork.back().nTime;
+    while (!CheckProofOfWork(fork.back().GetHash(), fork.back().nBits, params)) ++fork.back().nNonce;
+    BOOST_CHECK(sync.ReceivedHeaders(1, fork, params, 1s) == HeadersSyncScheduler::Result::INVALID);
+
+    // Nothing was kept from them.
+    BOOST_CHECK(sync.ReceivedHeaders(1, Slice(headers, 101, 1100), params, 2s) == HeadersSyncScheduler::Result::DONE);
+}
+
+namespace {
+
+/** Time a mock peer takes to answer getheaders */
+constexpr std::chrono::milliseconds MOCK_PEER_LATENCY{50};
+constexpr int NUM_HEADERS{16000};
+constexpr int NUM_PEERS{4};
+
+/**
+ * A peer at the other end of a socketpair, which completes the version handshake
+ * and answers getheaders from a fixed chain after MOCK_PEER_LATENCY. Other messages
+ * are ignored.
+ */
+class MockHeadersPeer
+{
+    const int m_socket;
+    const std::vector<CBlockHeader>& m_headers;
+    const std::map<uint256, int>& m_heights;
+    V1TransportDeserializer m_deserializer{Params(), /*node_id=*/0, SER_NETWORK, INIT_PROTO_VERSION};
+    /** Bytes to send, and when */
+    std::deque<std::pair<std::chrono::steady_clock::time_point, std::vector<uint8_t>>> m_send_queue;
+
+    void Push(CSerializedNetMsg&& msg, std::chrono::steady_clock::time_point when)
+    {
+        std::vector<uint8_t> bytes;
+        V1TransportSerializer{}.prepareForTransport(msg, bytes);
+        bytes.insert(bytes.end(), msg.Payload().begin(), msg.Payload().end());
+        m_send_queue.emplace_back(when, std::move(bytes));
+    }
+
+    void HandleMessage(CNetMessage& msg, std::chrono::steady_clock::time_point now)
+    {
+        if (msg.m_command == NetMsgType::VERSION) {
+            const uint64_t services{NODE_NETWORK | NODE_WITNESS};
+            Push(CNetMsgMaker(INIT_PROTO_VERSION).Make(NetMsgType::VERSION, PROTOCOL_VERSION, services, GetTime(), uint64_t{NODE_NONE}, CService{},
+                                                       services, CService{}, uint64_t{GetRand(UINT64_MAX)}, std::string{"/mock/"},
+                                                       int(m_headers.size()) - 1, true), now);
+            Push(CNetMsgMaker(INIT_PROTO_VERSION).Make(NetMsgType::VERACK), now);
+        } else if (msg.m_command == NetMsgType::GETHEADERS) {
+            ++m_getheaders;
+            CBlockLocator locator;
+            uint256 stop_hash;
+            msg.m_recv >> locator >> stop_hash;
+            int first{1};
+            for (const uint256& hash : locator.vHave) {
+                if (const auto it = m_heights.find(hash); it != m_heights.end()) {
+                    first = it->second + 1;
+                    break;
+                }
+            }
+            std::vector<CBlock> blocks;
+            for (int height = first; height < int(m_headers.size()) && blocks.size() < MAX_HEADERS_RESULTS; ++height) {
+                blocks.emplace_back(m_headers[height]);
+                if (m_headers[height].GetHash() == stop_hash) break;
+            }
+            Push(CNetMsgMaker(PROTOCOL_VERSION).Make(NetMsgType::HEADERS, blocks), now + MOCK_PEER_LATENCY);
+        }
+    }
+
+public:
+    /** Number of getheaders answered */
+    int m_getheaders{0};
+
+    MockHeadersPeer(int socket, const std::vector<CBlockHeader>& headers, const std::map<uint256, int>& heights)
+        : m_socket{socket}, m_headers{headers}, m_heights{heights} {}
+    ~MockHeadersPeer() { close(m_socket); }
+
+    /** Read what the node sent, and send what is due. */
+    void Poll(std::chrono::steady_clock::time_point now)
+    {
+        uint8_t buf[0x10000];
+        ssize_t received;
+        while ((received = recv(m_socket, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+            Span<const uint8_t> bytes{buf, size_t(received)};
+            while (!bytes.empty()) {
+                BOOST_REQUIRE(m_deserializer.Read(bytes) >= 0);
+                if (!m_deserializer.Complete()) continue;
+                bool reject_message{false};
+                CNetMessage msg{m_deserializer.GetMessage(0us, reject_message)};
+                BOOST_REQUIRE(!reject_message);
+                HandleMessage(msg, now);
+            }
+        }
+        while (!m_send_queue.empty() && m_send_queue.front().first <= now) {
+            auto& bytes = m_send_queue.front().second;
+            const ssize_t sent{send(m_socket, bytes.data(), bytes.size(), MSG_DONTWAIT | MSG_NOSIGNAL)};
+            if (sent <= 0) break;
+            bytes.erase(bytes.begin(), bytes.begin() + sent);
+            if (bytes.empty()) m_send_queue.pop_front();
+        }
+    }
+};
+
+struct SyncResult {
+    std::chrono::milliseconds m_duration;
+    /** Most getheaders answered by a single peer */
+    int m_max_getheaders;
+};
+
+/**
+ * Sync the headers from NUM_PEERS outbound mock peers, connected to a node over
+ * socketpairs, with the given checkpoints.
+ */
+SyncResult SyncHeaders(const std::vector<CBlockHeader>& headers, const std::vector<int>& checkpoint_heights)
+{
+    std::vector<std::string> args;
+    for (const int height : checkpoint_heights) {
+        args.push_back(strprintf("-testcheckpoint=%d@%s", height, headers[height].GetHash().ToString()));
+    }
+    std::vector<const char*> arg_ptrs;
+    for (const std::string& arg : args) arg_ptrs.push_back(arg.c_str());
+    TestingSetup setup{CBaseChainParams::REGTEST, arg_ptrs};
+    NodeContext& node_context = setup.m_node;
+    // Checking the whole block index after each header would dominate the sync time.
+    fCheckBlockIndex = false;
+
+    std::map<uint256, int> heights;
+    for (size_t height = 0; height < headers.size(); ++height) heights.emplace(headers[height].GetHash(), height);
+
+    ConnmanTestMsg connman{/*nSeed0=*/0x1337, /*nSeed1=*/0x1337, *node_context.addrman};
+    auto peerman = PeerManager::make(Params(), connman, *node_context.addrman, /*banman=*/nullptr,
+                                     *node_context.chainman, *node_context.mempool, /*ignore_incoming_txs=*/false);
+    CConnman::Options options;
+    options.m_msgproc = peerman.get();
+    options.nSendBufferMaxSize = 1000 * DEFAULT_MAXSENDBUFFER;
+    options.nReceiveFloodSize = 1000 * DEFAULT_MAXRECEIVEBUFFER;
+    connman.Init(options);
+
+    std::vector<std::unique_ptr<MockHeadersPeer>> peers;
+    std::vector<CNode*> nodes;
+    for (int i = 0; i < NUM_PEERS; ++i) {
+        int fds[2];
+        BOOST_REQUIRE_EQUAL(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+        CNode* node = new CNode(/*id=*/i, ServiceFlags(NODE_NETWORK | NODE_WITNESS), /*hSocketIn=*/fds[0], CAddress{}, /*nKeyedNetGroupIn=*/0,
+                                /*nLocalHostNonceIn=*/0, CAddress{}, /*addrNameIn=*/"", ConnectionType::OUTBOUND_FULL_RELAY,
+                                /*inbound_onion=*/false);
+        connman.AddTestNode(*node);
+        peerman->InitializeNode(node);
+        nodes.push_back(node);
+        peers.push_back(std::make_unique<MockHeadersPeer>(fds[1], headers, heights));
+    }
+
+    const auto start{std::chrono::steady_clock::now()};
+    const auto best_header_height = [] { return WITH_LOCK(cs_main, return pindexBestHeader ? pindexBestHeader->nHeight : 0); };
+    while (best_header_height() < NUM_HEADERS) {
+        const auto now{std::chrono::steady_clock::now()};
+        if (now - start > 1min) {
+            BOOST_ERROR(strprintf("Headers sync stopped at height %d", best_header_height()));
+            break;
+        }
+        for (auto& peer : peers) peer->Poll(now);
+        connman.SocketHandlerOnce();
+        for (CNode* node : nodes) {
+            for (int i = 0; i < 4; ++i) connman.ProcessMessagesOnce(*node);
+            LOCK(node->cs_sendProcessing);
+            peerman->SendMessages(node);
+        }
+    }
+    const auto duration{std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start)};
+
+    int max_getheaders{0};
+    for (const auto& peer : peers) max_getheaders = std::max(max_getheaders, peer->m_getheaders);
+    for (CNode* node : nodes) peerman->FinalizeNode(*node);
+    connman.ClearTestNodes();
+    // The version messages of the mock peers added time samples.
+    TestOnlyResetTimeData();
+    return {duration, max_getheaders};
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(headerssync_parallel_sync)
+{
+    const auto headers = MakeHeaders(*CreateChainParams(ArgsManager{}, CBaseChainParams::REGTEST), NUM_HEADERS);
+
+    // One peer serves all headers, 2000 per round trip.
+    const SyncResult sequential{SyncHeaders(headers, {})};
+    BOOST_CHECK_GE(sequential.m_max_getheaders, NUM_HEADERS / int{MAX_HEADERS_RESULTS});
+
+    // The other peers fetch the ranges between checkpoints meanwhile.
+    const SyncResult parallel{SyncHeaders(headers, {4000, 8000, 12000, 16000})};
+    BOOST_CHECK_LT(parallel.m_max_getheaders, sequential.m_max_getheaders);
+
+    BOOST_TEST_MESSAGE(strprintf("Synced %d headers from %d peers in %dms with one sync peer, in %dms with checkpoint ranges",
+                                 NUM_HEADERS, NUM_PEERS, count_milliseconds(sequential.m_duration), count_milliseconds(parallel.m_duration)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -786,4 +786,55 @@ BOOST_AUTO_TEST_CASE(MempoolAncestryTests)
     BOOST_CHECK_EQUAL(descendants, 4ULL);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolFeeRateHistogramTest)
+{
+    BOOST_CHECK_EQUAL(GetFeeRateHistogramBucket(0, 100), 0U);
+    BOOST_CHECK_EQUAL(GetFeeRateHistogramBucket(99, 100), 0U);
+    BOOST_CHECK_EQUAL(GetFeeRateHistogramBucket(100, 100), 1U);
+    BOOST_CHECK_EQUAL(GetFeeRateHistogramBucket(999, 100), 8U); // 9.99 sat/vB is in the [8, 10) bucket
+    BOOST_CHECK_EQUAL(GetFeeRateHistogramBucket(1000, 100), 9U);
+    BOOST_CHECK_EQUAL(GetFeeRateHistogramBucket(100 * 1000000, 100), MEMPOOL_FEERATE_HISTOGRAM_BOUNDS.size() - 1);
+
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+    TestMemPoolEntryHelper entry;
+
+    CMutableTransaction tx1;
+    tx1.vin.resize(1);
+    tx1.vin[0].scriptSig = CScript() << OP_1;
+    tx1.vout.resize(1);
+    tx1.vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+    tx1.vout[0].nValue = 10 * COIN;
+    CMutableTransaction tx2 = tx1;
+    tx2.vin[0].scriptSig = CScript() << OP_2;
+
+    const size_t vsize1 = GetVirtualTransactionSize(CTransaction(tx1));
+    const size_t vsize2 = GetVirtualTransactionSize(CTransaction(tx2));
+    const size_t bucket1 = GetFeeRateHistogramBucket(2 * vsize1, vsize1);
+    const size_t bucket2 = GetFeeRateHistogramBucket(50 * vsize2, vsize2);
+    BOOST_CHECK(bucket1 != bucket2);
+
+    pool.addUnchecked(entry.Fee(2 * vsize1).FromTx(tx1));
+    pool.addUnchecked(entry.Fee(50 * vsize2).FromTx(tx2));
+    BOOST_CHECK_EQUAL(pool.GetFeeRateHistogram()[bucket1].count, 1U);
+    BOOST_CHECK_EQUAL(pool.GetFeeRateHistogram()[bucket1].vsize, vsize1);
+    BOOST_CHECK_EQUAL(pool.GetFeeRateHistogram()[bucket2].count, 1U);
+    BOOST_CHECK_EQUAL(pool.GetFeeRateHistogram()[bucket2].fees, CAmount(50 * vsize2));
+
+    // Snapshots keep the histogram at the time they are recorded
+    pool.RecordFeeRateSnapshot();
+    pool.removeRecursive(CTransaction(tx2), REMOVAL_REASON_DUMMY);
+    BOOST_CHECK_EQUAL(pool.GetFeeRateHistogram()[bucket2].count, 0U);
+    BOOST_CHECK_EQUAL(pool.GetFeeRateHistogram()[bucket2].fees, 0);
+    BOOST_CHECK_EQUAL(pool.GetFeeRateSnapshots().size(), 1U);
+    BOOST_CHECK_EQUAL(pool.GetFeeRateSnapshots().back().m_histogram[bucket2].count, 1U);
+
+    for (size_t i = 0; i < MAX_MEMPOOL_FEERATE_SNAPSHOTS + 5; ++i) pool.RecordFeeRateSnapshot();
+    BOOST_CHECK_EQUAL(pool.GetFeeRateSnapshots().size(), MAX_MEMPOOL_FEERATE_SNAPSHOTS);
+    BOOST_CHECK_EQUAL(pool.GetFeeRateSnapshots().front().m_histogram[bucket2].count, 0U);
+
+    pool.clear();
+    BOOST_CHECK(pool.GetFeeRateHistogram() == MempoolFeeRateHistogram{});
+}
+
 BOOST_AUTO_TEST_SUITE_END()
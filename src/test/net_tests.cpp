@@ -2,15 +2,19 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <addrman.h>
 #include <chainparams.h>
 #include <clientversion.h>
 #include <cstdint>
 #include <net.h>
 #include <netaddress.h>
 #include <netbase.h>
+#include <netmessagemaker.h>
+#include <protocol.h>
 #include <serialize.h>
 #include <span.h>
 #include <streams.h>
+#include <test/util/net.h>
 #include <test/util/setup_common.h>
 #include <util/strencodings.h>
 #include <util/string.h>
@@ -25,6 +29,11 @@
 #include <optional>
 #include <string>
 
+#ifndef WIN32
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
 using namespace std::literals;
 
 BOOST_FIXTURE_TEST_SUITE(net_tests, BasicTestingSetup)
@@ -704,4 +713,130 @@ BOOST_AUTO_TEST_CASE(LocalAddress_BasicLifecycle)
     BOOST_CHECK(!IsLocal(addr));
 }
 
+/** Serialize a message with a payload of the given size the way it is sent on the wire. */
+static std::vector<unsigned char> WireMessage(size_t payload_size)
+{
+    CSerializedNetMsg msg;
+    msg.m_type = NetMsgType::TX;
+    msg.data.assign(payload_size, 0x42);
+    std::vector<unsigned char> wire;
+    V1TransportSerializer{}.prepareForTransport(msg, wire);
+    wire.insert(wire.end(), msg.data.begin(), msg.data.end());
+    return wire;
+}
+
+BOOST_AUTO_TEST_CASE(recv_buffer_pool)
+{
+    BOOST_CHECK_EQUAL(RecvBufferPool::BufferSize(0), 256U);
+    BOOST_CHECK_EQUAL(RecvBufferPool::BufferSize(256), 256U);
+    BOOST_CHECK_EQUAL(RecvBufferPool::BufferSize(257), 1024U);
+    BOOST_CHECK_EQUAL(RecvBufferPool::BufferSize(RecvBufferPool::MAX_CLASS_SIZE), 256U * 1024);
+    BOOST_CHECK_EQUAL(RecvBufferPool::BufferSize(RecvBufferPool::MAX_CLASS_SIZE + 1), 0U);
+
+    // Room for two idle buffers of 1 KiB
+    const auto pool = std::make_shared<RecvBufferPool>(2048);
+    V1TransportDeserializer deserializer{Params(), /*node_id=*/0, SER_NETWORK, INIT_PROTO_VERSION, pool};
+    const auto receive = [&](size_t payload_size) {
+        const std::vector<unsigned char> wire = WireMessage(payload_size);
+        Span<const uint8_t> bytes{wire};
+        while (!bytes.empty()) BOOST_REQUIRE(deserializer.Read(bytes) > 0);
+        BOOST_REQUIRE(deserializer.Complete());
+        bool reject_message;
+        CNetMessage msg = deserializer.GetMessage(/*time=*/{}, reject_message);
+        BOOST_REQUIRE(!reject_message);
+        BOOST_REQUIRE_EQUAL(msg.m_recv.size(), payload_size);
+        BOOST_CHECK(std::all_of(msg.m_recv.begin(), msg.m_recv.end(), [](auto b) { return b == 0x42; }));
+        return msg;
+    };
+
+    // The first message needs a new buffer, which is reused once the message is processed
+    std::optional<CNetMessage> msg1{receive(1000)};
+    BOOST_CHECK_EQUAL(deserializer.GetBufferStats().m_pool_misses, 1U);
+    msg1.reset();
+    BOOST_CHECK_EQUAL(pool->GetPooledBytes(), 1024U);
+    std::optional<CNetMessage> msg2{receive(500)};
+    BOOST_CHECK_EQUAL(deserializer.GetBufferStats().m_pool_hits, 1U);
+    BOOST_CHECK_EQUAL(pool->GetPooledBytes(), 0U);
+
+    // Buffers of other size classes are not used, and idle buffers are limited
+    std::optional<CNetMessage> msg3{receive(100)};
+    std::optional<CNetMessage> msg4{receive(1024)};
+    std::optional<CNetMessage> msg5{receive(1024)};
+    BOOST_CHECK_EQUAL(deserializer.GetBufferStats().m_pool_misses, 4U);
+    msg2.reset();
+    msg3.reset();
+    msg4.reset();
+    msg5.reset();
+    BOOST_CHECK_EQUAL(pool->GetPooledBytes(), 256U + 1024U);
+
+    // Large messages are not pooled
+    std::optional<CNetMessage> msg6{receive(RecvBufferPool::MAX_CLASS_SIZE + 1)};
+    BOOST_CHECK(!msg6->m_recv_pool);
+    BOOST_CHECK_EQUAL(deserializer.GetBufferStats().m_pool_hits + deserializer.GetBufferStats().m_pool_misses, 5U);
+    msg6.reset();
+    BOOST_CHECK_EQUAL(pool->GetPooledBytes(), 256U + 1024U);
+
+    // The buffer of a partially received message is accounted for
+    const std::vector<unsigned char> wire = WireMessage(2000);
+    Span<const uint8_t> bytes = Span{wire}.first(CMessageHeader::HEADER_SIZE + 10);
+    while (!bytes.empty()) BOOST_REQUIRE(deserializer.Read(bytes) > 0);
+    BOOST_CHECK_EQUAL(deserializer.GetBufferStats().m_bytes, 4096U);
+}
+
+#ifndef WIN32
+BOOST_AUTO_TEST_CASE(socket_send_data_gather)
+{
+    AddrMan addrman{/*asmap=*/{}, /*deterministic=*/true, /*consistency_check_ratio=*/0};
+    ConnmanTestMsg connman{/*nSeed0=*/0x1337, /*nSeed1=*/0x1337, addrman};
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    CNode* node = new CNode(/*id=*/0, NODE_NETWORK, /*hSocketIn=*/fds[0], CAddress{}, /*nKeyedNetGroupIn=*/0,
+                            /*nLocalHostNonceIn=*/0, CAddress{}, /*addrNameIn=*/"", ConnectionType::INBOUND,
+                            /*inbound_onion=*/false);
+    connman.AddTestNode(*node);
+
+    // A payload larger than the socket buffer, so that it is sent in several parts
+    const CNetMsgMaker msg_maker{PROTOCOL_VERSION};
+    CSerializedNetMsg shared_msg = msg_maker.Make(NetMsgType::CMPCTBLOCK, std::vector<unsigned char>(1 << 20, 0xab));
+    shared_msg.Share();
+    CSerializedNetMsg ping_msg = msg_maker.Make(NetMsgType::PING, uint64_t{42});
+
+    std::vector<unsigned char> expected;
+    for (const CSerializedNetMsg* msg : {&shared_msg, &ping_msg, &shared_msg}) {
+        std::vector<unsigned char> header;
+        CSerializedNetMsg copy = msg->Copy();
+        V1TransportSerializer{}.prepareForTransport(copy, header);
+        expected.insert(expected.end(), header.begin(), header.end());
+        expected.insert(expected.end(), msg->Payload().begin(), msg->Payload().end());
+    }
+
+    // Only the first message is sent optimistically, the others are queued behind it
+    connman.PushMessage(node, shared_msg.Copy());
+    connman.PushMessage(node, ping_msg.Copy());
+    connman.PushMessage(node, shared_msg.Copy());
+    const CConnman::SendStats stats = connman.GetSendStats();
+    // The header and the start of the payload went out in a single call
+    BOOST_CHECK_EQUAL(stats.m_syscalls, 1U);
+    BOOST_CHECK_EQUAL(stats.m_bytes_shared, 2 * shared_msg.Payload().size());
+    BOOST_CHECK_EQUAL(stats.m_bytes_copied, ping_msg.Payload().size());
+    // The shared payload is referenced by the send queue and the two messages in it
+    BOOST_CHECK_EQUAL(shared_msg.m_shared_data.use_count(), 3);
+
+    std::vector<unsigned char> received;
+    while (received.size() < expected.size()) {
+        unsigned char buf[65536];
+        const ssize_t n = recv(fds[1], buf, sizeof(buf), MSG_DONTWAIT);
+        if (n > 0) received.insert(received.end(), buf, buf + n);
+        LOCK(node->cs_vSend);
+        connman.SocketSendData(*node);
+    }
+    BOOST_CHECK(received == expected);
+    BOOST_CHECK(WITH_LOCK(node->cs_vSend, return node->vSendMsg.empty()));
+    BOOST_CHECK_EQUAL(shared_msg.m_shared_data.use_count(), 1);
+
+    connman.ClearTestNodes();
+    close(fds[1]);
+}
+#endif
+
 BOOST_AUTO_TEST_SUITE_END()
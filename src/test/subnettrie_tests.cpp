@@ -0,0 +1,127 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <netaddress.h>
+#include <netbase.h>
+#include <subnettrie.h>
+
+#include <test/util/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(subnettrie_tests, BasicTestingSetup)
+
+static CSubNet SubNet(const std::string& str)
+{
+    CSubNet subnet;
+    BOOST_REQUIRE(LookupSubNet(str, subnet));
+    return subnet;
+}
+
+static CNetAddr Addr(const std::string& str)
+{
+    CNetAddr addr;
+    BOOST_REQUIRE(LookupHost(str, addr, /*fAllowLookup=*/false));
+    return addr;
+}
+
+static std::vector<int> Matches(const SubNetTrie<int>& trie, const CNetAddr& addr)
+{
+    std::vector<int> values;
+    trie.ForEachMatch(addr, [&](int value) { values.push_back(value); });
+    return values;
+}
+
+BOOST_AUTO_TEST_CASE(subnettrie_basic)
+{
+    SubNetTrie<int> trie;
+    trie.Insert(SubNet("1.2.0.0/16"), 16);
+    trie.Insert(SubNet("1.2.3.0/24"), 24);
+    trie.Insert(SubNet("1.2.3.4"), 32);
+    trie.Insert(SubNet("0.0.0.0/0"), 0);
+    trie.Insert(SubNet("102::/16"), 616);
+    trie.Insert(SubNet("pg6mmjiyjmcrsslvykfwnntlaru7p5svn6y2ymmju6nubxndf4pscryd.onion"), 1000);
+    // Invalid subnets are ignored.
+    trie.Insert(CSubNet{}, -1);
+    BOOST_CHECK_EQUAL(trie.Size(), 6U);
+
+    // Matches are from the widest to the narrowest subnet.
+    BOOST_CHECK(Matches(trie, Addr("1.2.3.4")) == std::vector<int>({0, 16, 24, 32}));
+    BOOST_CHECK(Matches(trie, Addr("1.2.3.5")) == std::vector<int>({0, 16, 24}));
+    BOOST_CHECK(Matches(trie, Addr("1.2.4.4")) == std::vector<int>({0, 16}));
+    BOOST_CHECK(Matches(trie, Addr("9.9.9.9")) == std::vector<int>({0}));
+    // Networks are kept apart, and non-IP addresses are matched exactly.
+    BOOST_CHECK(Matches(trie, Addr("102:304::1")) == std::vector<int>({616}));
+    BOOST_CHECK(Matches(trie, Addr("103::1")).empty());
+    BOOST_CHECK(Matches(trie, Addr("pg6mmjiyjmcrsslvykfwnntlaru7p5svn6y2ymmju6nubxndf4pscryd.onion")) == std::vector<int>({1000}));
+    BOOST_CHECK(Matches(trie, Addr("ukeu3k5oycgaauneqgtnvselmt4yemvoilkln7jpvamvfx7dnkdq.b32.i2p")).empty());
+
+    BOOST_CHECK(trie.Find(SubNet("1.2.3.0/24")) && *trie.Find(SubNet("1.2.3.0/24")) == 24);
+    BOOST_CHECK(!trie.Find(SubNet("1.2.3.0/25")));
+    trie.Insert(SubNet("1.2.3.0/24"), 124);
+    BOOST_CHECK_EQUAL(*trie.Find(SubNet("1.2.3.0/24")), 124);
+    BOOST_CHECK_EQUAL(trie.Size(), 6U);
+
+    BOOST_CHECK(trie.Erase(SubNet("1.2.0.0/16")));
+    BOOST_CHECK(!trie.Erase(SubNet("1.2.0.0/16")));
+    BOOST_CHECK(!trie.Erase(SubNet("1.2.0.0/15")));
+    BOOST_CHECK(Matches(trie, Addr("1.2.3.4")) == std::vector<int>({0, 124, 32}));
+    BOOST_CHECK_EQUAL(trie.Size(), 5U);
+
+    trie.Clear();
+    BOOST_CHECK_EQUAL(trie.Size(), 0U);
+    BOOST_CHECK(Matches(trie, Addr("1.2.3.4")).empty());
+}
+
+BOOST_AUTO_TEST_CASE(subnettrie_random)
+{
+    // Compare against CSubNet::Match of every subnet, with subnets and addresses
+    // drawn from a few prefixes so that they overlap.
+    const auto random_addr = [](bool ipv4) {
+        std::vector<uint8_t> bytes(ipv4 ? 4 : 16);
+        for (auto& b : bytes) b = InsecureRandBool() ? InsecureRandBits(2) : InsecureRandBits(8);
+        if (ipv4) {
+            in_addr ipv4_addr;
+            memcpy(&ipv4_addr, bytes.data(), bytes.size());
+            return CNetAddr{ipv4_addr};
+        }
+        CNetAddr addr;
+        addr.SetLegacyIPv6(bytes);
+        return addr;
+    };
+
+    SubNetTrie<int> trie;
+    std::map<CSubNet, int> subnets;
+    for (int i = 0; i < 2000; ++i) {
+        const bool ipv4 = InsecureRandBool();
+        const CSubNet subnet{random_addr(ipv4), (uint8_t)InsecureRandRange(ipv4 ? 33 : 129)};
+        if (!subnet.IsValid()) continue;
+        if (InsecureRandRange(4) == 0 && !subnets.empty()) {
+            // Remove a present or absent subnet.
+            const CSubNet& erased = InsecureRandBool() ? subnets.begin()->first : subnet;
+            BOOST_CHECK_EQUAL(trie.Erase(erased), subnets.erase(erased) == 1);
+        } else {
+            trie.Insert(subnet, i);
+            subnets[subnet] = i;
+        }
+        BOOST_CHECK_EQUAL(trie.Size(), subnets.size());
+
+        const CNetAddr addr{random_addr(InsecureRandBool())};
+        std::vector<int> expected;
+        for (const auto& [s, value] : subnets) {
+            if (s.Match(addr)) expected.push_back(value);
+        }
+        std::vector<int> found{Matches(trie, addr)};
+        std::sort(expected.begin(), expected.end());
+        std::sort(found.begin(), found.end());
+        BOOST_CHECK(found == expected);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
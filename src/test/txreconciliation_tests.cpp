@@ -0,0 +1,225 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/txreconciliation.h>
+
+#include <test/util/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+
+BOOST_FIXTURE_TEST_SUITE(txreconciliation_tests, BasicTestingSetup)
+
+/** Complete the handshake between the tracker of the node that made a connection and its peer. */
+static void Connect(TxReconciliationTracker& initiator, NodeId responder_id, TxReconciliationTracker& responder, NodeId initiator_id)
+{
+    const uint64_t initiator_salt = initiator.PreRegisterPeer(responder_id);
+    const uint64_t responder_salt = responder.PreRegisterPeer(initiator_id);
+    BOOST_REQUIRE(initiator.RegisterPeer(responder_id, /*is_peer_inbound=*/false, TXRECONCILIATION_VERSION, responder_salt) == ReconciliationRegisterResult::SUCCESS);
+    BOOST_REQUIRE(responder.RegisterPeer(initiator_id, /*is_peer_inbound=*/true, TXRECONCILIATION_VERSION, initiator_salt) == ReconciliationRegisterResult::SUCCESS);
+}
+
+static std::vector<uint256> Sorted(std::vector<uint256> wtxids)
+{
+    std::sort(wtxids.begin(), wtxids.end());
+    return wtxids;
+}
+
+BOOST_AUTO_TEST_CASE(register_peer)
+{
+    TxReconciliationTracker tracker(TXRECONCILIATION_VERSION);
+    const uint64_t salt = 0;
+
+    // The handshake must be started by us.
+    BOOST_CHECK(tracker.RegisterPeer(/*peer_id=*/0, /*is_peer_inbound=*/true, TXRECONCILIATION_VERSION, salt) == ReconciliationRegisterResult::NOT_FOUND);
+    BOOST_CHECK(!tracker.IsPeerRegistered(0));
+
+    tracker.PreRegisterPeer(0);
+    BOOST_CHECK(tracker.RegisterPeer(0, /*is_peer_inbound=*/true, /*peer_recon_version=*/0, salt) == ReconciliationRegisterResult::PROTOCOL_VIOLATION);
+    BOOST_CHECK(!tracker.IsPeerRegistered(0));
+    // Later versions are compatible.
+    BOOST_CHECK(tracker.RegisterPeer(0, /*is_peer_inbound=*/true, TXRECONCILIATION_VERSION + 1, salt) == ReconciliationRegisterResult::SUCCESS);
+    BOOST_CHECK(tracker.IsPeerRegistered(0));
+    BOOST_CHECK(tracker.RegisterPeer(0, /*is_peer_inbound=*/true, TXRECONCILIATION_VERSION, salt) == ReconciliationRegisterResult::ALREADY_REGISTERED);
+
+    tracker.ForgetPeer(0);
+    BOOST_CHECK(!tracker.IsPeerRegistered(0));
+    BOOST_CHECK(!tracker.AddToSet(0, InsecureRand256()));
+}
+
+BOOST_AUTO_TEST_CASE(reconcile)
+{
+    TxReconciliationTracker initiator(TXRECONCILIATION_VERSION), responder(TXRECONCILIATION_VERSION);
+    Connect(initiator, /*responder_id=*/1, responder, /*initiator_id=*/2);
+
+    std::vector<uint256> initiator_only, responder_only;
+    for (int i = 0; i < 20; ++i) {
+        const uint256 shared = InsecureRand256();
+        BOOST_CHECK(initiator.AddToSet(1, shared));
+        BOOST_CHECK(responder.AddToSet(2, shared));
+    }
+    for (int i = 0; i < 3; ++i) {
+        initiator_only.push_back(InsecureRand256());
+        BOOST_CHECK(initiator.AddToSet(1, initiator_only.back()));
+    }
+    for (int i = 0; i < 2; ++i) {
+        responder_only.push_back(InsecureRand256());
+        BOOST_CHECK(responder.AddToSet(2, responder_only.back()));
+    }
+    // A transaction the peer announced to us is not reconciled.
+    const uint256 announced = InsecureRand256();
+    BOOST_CHECK(initiator.AddToSet(1, announced));
+    initiator.TryRemovingFromSet(1, announced);
+
+    // Only the node that made the connection requests reconciliations, once per interval.
+    std::chrono::microseconds now{1s};
+    BOOST_CHECK(!responder.InitiateReconciliationRequest(2, now));
+    BOOST_CHECK(!initiator.InitiateReconciliationRequest(1, now));
+    now += RECON_REQUEST_INTERVAL - 1s;
+    BOOST_CHECK(!initiator.InitiateReconciliationRequest(1, now));
+    now += 1s;
+    const auto request = initiator.InitiateReconciliationRequest(1, now);
+    BOOST_REQUIRE(request);
+    BOOST_CHECK_EQUAL(request->m_set_size, 23);
+    BOOST_CHECK_EQUAL(request->m_q, uint16_t(DEFAULT_RECON_Q * Q_PRECISION + 0.5));
+    // No new request while one is outstanding.
+    BOOST_CHECK(!initiator.InitiateReconciliationRequest(1, now + 2 * RECON_REQUEST_INTERVAL));
+
+    BOOST_CHECK(!responder.RespondToReconciliationRequest(2));
+    BOOST_CHECK(responder.HandleReconciliationRequest(2, request->m_set_size, request->m_q));
+    const auto sketch = responder.RespondToReconciliationRequest(2);
+    BOOST_REQUIRE(sketch);
+    // Capacity is the difference of the set sizes, q times the smaller set rounded up, plus one.
+    BOOST_CHECK_EQUAL(sketch->size(), 4 * (1 + 6 + 1));
+
+    const auto result = initiator.HandleSketch(1, *sketch);
+    BOOST_REQUIRE(result);
+    BOOST_CHECK(result->m_success);
+    BOOST_CHECK(Sorted(result->m_announce) == Sorted(initiator_only));
+    BOOST_CHECK_EQUAL(result->m_ask_shortids.size(), responder_only.size());
+
+    const auto announce = responder.HandleReconciliationDifference(2, result->m_success, result->m_ask_shortids);
+    BOOST_REQUIRE(announce);
+    BOOST_CHECK(Sorted(*announce) == Sorted(responder_only));
+
+    // The sets were emptied, and the difference adjusted the estimate for the next reconciliation.
+    const auto next_request = initiator.InitiateReconciliationRequest(1, now + RECON_REQUEST_INTERVAL);
+    BOOST_REQUIRE(next_request);
+    BOOST_CHECK_EQUAL(next_request->m_set_size, 0);
+    BOOST_CHECK_EQUAL(next_request->m_q, uint16_t((4.0 / 22 + RECON_Q_MARGIN) * Q_PRECISION + 0.5));
+}
+
+BOOST_AUTO_TEST_CASE(reconcile_fallback)
+{
+    TxReconciliationTracker initiator(TXRECONCILIATION_VERSION), responder(TXRECONCILIATION_VERSION);
+    Connect(initiator, /*responder_id=*/1, responder, /*initiator_id=*/2);
+    std::chrono::microseconds now{1s};
+    BOOST_CHECK(!initiator.InitiateReconciliationRequest(1, now));
+    now += RECON_REQUEST_INTERVAL;
+
+    // Transactions added after the request make the sketch too small to decode the difference.
+    const auto request = initiator.InitiateReconciliationRequest(1, now);
+    BOOST_REQUIRE(request);
+    BOOST_CHECK_EQUAL(request->m_set_size, 0);
+    std::vector<uint256> initiator_set, responder_set;
+    for (int i = 0; i < 10; ++i) {
+        initiator_set.push_back(InsecureRand256());
+        BOOST_CHECK(initiator.AddToSet(1, initiator_set.back()));
+    }
+    responder_set.push_back(InsecureRand256());
+    BOOST_CHECK(responder.AddToSet(2, responder_set.back()));
+
+    BOOST_CHECK(responder.HandleReconciliationRequest(2, request->m_set_size, request->m_q));
+    const auto sketch = responder.RespondToReconciliationRequest(2);
+    BOOST_REQUIRE(sketch);
+    const auto result = initiator.HandleSketch(1, *sketch);
+    BOOST_REQUIRE(result);
+
+    // Both sides announce their whole sets instead.
+    BOOST_CHECK(!result->m_success);
+    BOOST_CHECK(result->m_ask_shortids.empty());
+    BOOST_CHECK(Sorted(result->m_announce) == Sorted(initiator_set));
+    const auto announce = responder.HandleReconciliationDifference(2, result->m_success, result->m_ask_shortids);
+    BOOST_REQUIRE(announce);
+    BOOST_CHECK(*announce == responder_set);
+
+    // An empty sketch also means the peer gave up on reconciling.
+    now += RECON_REQUEST_INTERVAL;
+    BOOST_CHECK(initiator.AddToSet(1, InsecureRand256()));
+    BOOST_REQUIRE(initiator.InitiateReconciliationRequest(1, now));
+    const auto empty_result = initiator.HandleSketch(1, {});
+    BOOST_REQUIRE(empty_result);
+    BOOST_CHECK(!empty_result->m_success);
+    BOOST_CHECK_EQUAL(empty_result->m_announce.size(), 1U);
+}
+
+BOOST_AUTO_TEST_CASE(protocol_violations)
+{
+    TxReconciliationTracker initiator(TXRECONCILIATION_VERSION), responder(TXRECONCILIATION_VERSION);
+    Connect(initiator, /*responder_id=*/1, responder, /*initiator_id=*/2);
+
+    // Messages out of order, or sent by the wrong side.
+    BOOST_CHECK(!initiator.HandleReconciliationRequest(1, 0, 0));
+    BOOST_CHECK(!initiator.HandleSketch(1, std::vector<uint8_t>(4)));
+    BOOST_CHECK(!responder.HandleSketch(2, std::vector<uint8_t>(4)));
+    BOOST_CHECK(!responder.HandleReconciliationDifference(2, true, {}));
+
+    BOOST_CHECK(responder.HandleReconciliationRequest(2, 0, 0));
+    BOOST_CHECK(!responder.HandleReconciliationRequest(2, 0, 0));
+    BOOST_CHECK(responder.RespondToReconciliationRequest(2));
+    BOOST_CHECK(!responder.HandleReconciliationRequest(2, 0, 0));
+    BOOST_CHECK(responder.HandleReconciliationDifference(2, true, {}));
+    BOOST_CHECK(!responder.HandleReconciliationDifference(2, true, {}));
+
+    // Sketches must be a whole number of 32-bit elements, up to the maximum capacity.
+    std::chrono::microseconds now{1s};
+    initiator.InitiateReconciliationRequest(1, now);
+    BOOST_REQUIRE(initiator.InitiateReconciliationRequest(1, now + RECON_REQUEST_INTERVAL));
+    BOOST_CHECK(!initiator.HandleSketch(1, std::vector<uint8_t>(3)));
+    BOOST_CHECK(!initiator.HandleSketch(1, std::vector<uint8_t>(4 * (MAX_SKETCH_CAPACITY + 1))));
+    BOOST_CHECK(initiator.HandleSketch(1, std::vector<uint8_t>(4)));
+}
+
+BOOST_AUTO_TEST_CASE(fanout)
+{
+    TxReconciliationTracker tracker(TXRECONCILIATION_VERSION);
+    const int outbound_peers{8}, inbound_peers{100};
+    for (NodeId peer_id = 0; peer_id < outbound_peers + inbound_peers; ++peer_id) {
+        tracker.PreRegisterPeer(peer_id);
+        const bool inbound{peer_id >= outbound_peers};
+        BOOST_REQUIRE(tracker.RegisterPeer(peer_id, inbound, TXRECONCILIATION_VERSION, /*remote_salt=*/0) == ReconciliationRegisterResult::SUCCESS);
+    }
+
+    // Each transaction is flooded to one outbound peer, and about a tenth of the inbound peers.
+    size_t inbound_fanout{0};
+    for (int i = 0; i < 100; ++i) {
+        const uint256 wtxid = InsecureRand256();
+        size_t outbound_fanout{0};
+        for (NodeId peer_id = 0; peer_id < outbound_peers + inbound_peers; ++peer_id) {
+            if (!tracker.ShouldFanoutTo(wtxid, peer_id)) continue;
+            ++(peer_id < outbound_peers ? outbound_fanout : inbound_fanout);
+        }
+        BOOST_CHECK_EQUAL(outbound_fanout, OUTBOUND_FANOUT_DESTINATIONS);
+    }
+    BOOST_CHECK(inbound_fanout > 100 * inbound_peers * INBOUND_FANOUT_DESTINATIONS_FRACTION * 0.8);
+    BOOST_CHECK(inbound_fanout < 100 * inbound_peers * INBOUND_FANOUT_DESTINATIONS_FRACTION * 1.2);
+
+    // Peers that are not registered are always flooded to.
+    BOOST_CHECK(tracker.ShouldFanoutTo(InsecureRand256(), outbound_peers + inbound_peers));
+}
+
+BOOST_AUTO_TEST_CASE(set_limit)
+{
+    TxReconciliationTracker tracker(TXRECONCILIATION_VERSION);
+    tracker.PreRegisterPeer(0);
+    BOOST_REQUIRE(tracker.RegisterPeer(0, /*is_peer_inbound=*/true, TXRECONCILIATION_VERSION, /*remote_salt=*/0) == ReconciliationRegisterResult::SUCCESS);
+    for (size_t i = 0; i < MAX_RECONSET_SIZE; ++i) {
+        BOOST_CHECK(tracker.AddToSet(0, InsecureRand256()));
+    }
+    // Further transactions are flooded.
+    BOOST_CHECK(!tracker.AddToSet(0, InsecureRand256()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,116 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/txrelayqueue.h>
+#include <primitives/transaction.h>
+#include <txmempool.h>
+#include <validation.h>
+
+#include <test/util/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(txrelayqueue_tests, TestingSetup)
+
+static CTransactionRef AddToMempool(CTxMemPool& pool, CAmount fee, const COutPoint& prevout = COutPoint(InsecureRand256(), 0))
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = prevout;
+    tx.vout.resize(1);
+    tx.vout[0].nValue = 1000;
+    const CTransactionRef ref{MakeTransactionRef(tx)};
+    LOCK2(cs_main, pool.cs);
+    pool.addUnchecked(TestMemPoolEntryHelper().Fee(fee).FromTx(ref));
+    return ref;
+}
+
+static std::vector<uint256> Pending(TxRelayQueue& queue, NodeId peer, size_t max)
+{
+    std::vector<uint256> wtxids;
+    if (max == 0) return wtxids;
+    queue.ForEachPending(peer, [&](const TxRelayQueue::Entry& entry) {
+        wtxids.push_back(entry.m_wtxid);
+        return wtxids.size() < max;
+    });
+    return wtxids;
+}
+
+BOOST_AUTO_TEST_CASE(txrelayqueue_order)
+{
+    CTxMemPool& pool = *m_node.mempool;
+    TxRelayQueue queue;
+    queue.RegisterPeer(0);
+
+    const CTransactionRef low{AddToMempool(pool, 1000)};
+    const CTransactionRef high{AddToMempool(pool, 5000)};
+    // A child with a higher fee rate than its parent still comes after it.
+    const CTransactionRef child{AddToMempool(pool, 100000, COutPoint(low->GetHash(), 0))};
+    queue.Add(child->GetWitnessHash());
+    queue.Add(low->GetWitnessHash());
+    queue.Add(high->GetWitnessHash());
+    queue.Add(high->GetWitnessHash());
+    // Transactions that left the mempool are not announced.
+    queue.Add(InsecureRand256());
+
+    BOOST_CHECK_EQUAL(queue.CountPending(0), 0U);
+    queue.Seal(pool);
+    BOOST_CHECK_EQUAL(queue.CountPending(0), 3U);
+    const std::vector<uint256> expected{high->GetWitnessHash(), low->GetWitnessHash(), child->GetWitnessHash()};
+    BOOST_CHECK(Pending(queue, 0, 10) == expected);
+    BOOST_CHECK_EQUAL(queue.CountPending(0), 0U);
+
+    // Transactions relayed later are announced later, even with a higher fee rate.
+    const CTransactionRef later{AddToMempool(pool, 900000)};
+    queue.Add(later->GetWitnessHash());
+    queue.Seal(pool);
+    BOOST_CHECK(Pending(queue, 0, 10) == std::vector<uint256>{later->GetWitnessHash()});
+}
+
+BOOST_AUTO_TEST_CASE(txrelayqueue_cursors)
+{
+    CTxMemPool& pool = *m_node.mempool;
+    TxRelayQueue queue;
+    queue.RegisterPeer(0);
+    queue.RegisterPeer(1);
+
+    std::vector<uint256> wtxids;
+    for (int i = 0; i < 10; ++i) {
+        const CTransactionRef tx{AddToMempool(pool, 1000 * (10 - i))};
+        wtxids.push_back(tx->GetWitnessHash());
+        queue.Add(tx->GetWitnessHash());
+        // Seal in batches of different sizes.
+        if (i == 2 || i == 3 || i == 9) queue.Seal(pool);
+    }
+    BOOST_CHECK_EQUAL(queue.Size(), 10U);
+
+    // Each peer continues where it stopped, within and across batches.
+    BOOST_CHECK(Pending(queue, 0, 2) == std::vector<uint256>(wtxids.begin(), wtxids.begin() + 2));
+    BOOST_CHECK(Pending(queue, 0, 3) == std::vector<uint256>(wtxids.begin() + 2, wtxids.begin() + 5));
+    BOOST_CHECK(Pending(queue, 1, 4) == std::vector<uint256>(wtxids.begin(), wtxids.begin() + 4));
+    BOOST_CHECK_EQUAL(queue.CountPending(0), 5U);
+    BOOST_CHECK_EQUAL(queue.CountPending(1), 6U);
+
+    // A peer registered now only gets transactions added from now on.
+    queue.RegisterPeer(2);
+    BOOST_CHECK_EQUAL(queue.CountPending(2), 0U);
+
+    // Batches are dropped once every peer is past them, when sealing.
+    queue.Seal(pool);
+    BOOST_CHECK_EQUAL(queue.Size(), 10U);
+    queue.SkipAll(1);
+    queue.ForgetPeer(0);
+    BOOST_CHECK_EQUAL(queue.CountPending(0), 0U);
+    BOOST_CHECK(Pending(queue, 0, 10).empty());
+    const CTransactionRef tx{AddToMempool(pool, 1000)};
+    queue.Add(tx->GetWitnessHash());
+    queue.Seal(pool);
+    BOOST_CHECK_EQUAL(queue.Size(), 1U);
+    BOOST_CHECK(Pending(queue, 1, 10) == std::vector<uint256>{tx->GetWitnessHash()});
+    BOOST_CHECK(Pending(queue, 2, 10) == std::vector<uint256>{tx->GetWitnessHash()});
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -49,4 +49,64 @@ BOOST_FIXTURE_TEST_CASE(tx_mempool_reject_coinbase, TestChain100Setup)
     BOOST_CHECK_EQUAL(result.m_state.GetRejectReason(), "coinbase");
     BOOST_CHECK(result.m_state.GetResult() == TxValidationResult::TX_CONSENSUS);
 }
+
+/**
+ * Ensure that a batch gives the same results as submitting each transaction in order.
+ */
+BOOST_FIXTURE_TEST_CASE(tx_mempool_accept_batch, TestChain100Setup)
+{
+    CScript script = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    // Mature the second coinbase.
+    CreateAndProcessBlock({}, script);
+    auto parent = MakeTransactionRef(CreateValidMempoolTransaction(/*input_transaction=*/m_coinbase_txns[0], /*input_vout=*/0,
+                                                                  /*input_height=*/0, /*input_signing_key=*/coinbaseKey,
+                                                                  /*output_destination=*/script,
+                                                                  /*output_amount=*/CAmount(49 * COIN), /*submit=*/false));
+    auto child = MakeTransactionRef(CreateValidMempoolTransaction(/*input_transaction=*/parent, /*input_vout=*/0,
+                                                                 /*input_height=*/102, /*input_signing_key=*/coinbaseKey,
+                                                                 /*output_destination=*/script,
+                                                                 /*output_amount=*/CAmount(48 * COIN), /*submit=*/false));
+    // Spends the same coinbase output as parent, without signaling replaceability.
+    auto conflict = MakeTransactionRef(CreateValidMempoolTransaction(/*input_transaction=*/m_coinbase_txns[0], /*input_vout=*/0,
+                                                                    /*input_height=*/0, /*input_signing_key=*/coinbaseKey,
+                                                                    /*output_destination=*/script,
+                                                                    /*output_amount=*/CAmount(40 * COIN), /*submit=*/false));
+    auto unrelated = MakeTransactionRef(CreateValidMempoolTransaction(/*input_transaction=*/m_coinbase_txns[1], /*input_vout=*/0,
+                                                                     /*input_height=*/0, /*input_signing_key=*/coinbaseKey,
+                                                                     /*output_destination=*/script,
+                                                                     /*output_amount=*/CAmount(49 * COIN), /*submit=*/false));
+    // Spends an output of a transaction that is not submitted.
+    auto unsubmitted = MakeTransactionRef(CreateValidMempoolTransaction(/*input_transaction=*/m_coinbase_txns[2], /*input_vout=*/0,
+                                                                       /*input_height=*/0, /*input_signing_key=*/coinbaseKey,
+                                                                       /*output_destination=*/script,
+                                                                       /*output_amount=*/CAmount(49 * COIN), /*submit=*/false));
+    auto orphan = MakeTransactionRef(CreateValidMempoolTransaction(/*input_transaction=*/unsubmitted, /*input_vout=*/0,
+                                                                  /*input_height=*/102, /*input_signing_key=*/coinbaseKey,
+                                                                  /*output_destination=*/script,
+                                                                  /*output_amount=*/CAmount(48 * COIN), /*submit=*/false));
+
+    LOCK(cs_main);
+    const unsigned int initial_pool_size = m_node.mempool->size();
+    const auto results = m_node.chainman->ProcessTransactions({parent, child, conflict, parent, orphan, unrelated});
+    BOOST_REQUIRE_EQUAL(results.size(), 6U);
+
+    BOOST_CHECK(results[0].m_result_type == MempoolAcceptResult::ResultType::VALID);
+    BOOST_CHECK(results[1].m_result_type == MempoolAcceptResult::ResultType::VALID);
+    BOOST_CHECK(results[2].m_result_type == MempoolAcceptResult::ResultType::INVALID);
+    BOOST_CHECK_EQUAL(results[2].m_state.GetRejectReason(), "txn-mempool-conflict");
+    BOOST_CHECK(results[3].m_result_type == MempoolAcceptResult::ResultType::INVALID);
+    BOOST_CHECK_EQUAL(results[3].m_state.GetRejectReason(), "txn-already-in-mempool");
+    BOOST_CHECK(results[4].m_result_type == MempoolAcceptResult::ResultType::INVALID);
+    BOOST_CHECK(results[4].m_state.GetResult() == TxValidationResult::TX_MISSING_INPUTS);
+    BOOST_CHECK(results[5].m_result_type == MempoolAcceptResult::ResultType::VALID);
+
+    BOOST_CHECK_EQUAL(m_node.mempool->size(), initial_pool_size + 3);
+    BOOST_CHECK(m_node.mempool->exists(GenTxid::Txid(parent->GetHash())));
+    BOOST_CHECK(m_node.mempool->exists(GenTxid::Txid(child->GetHash())));
+    BOOST_CHECK(m_node.mempool->exists(GenTxid::Txid(unrelated->GetHash())));
+
+    // The coin looked up for the rejected orphan's missing input must not stay in the cache.
+    BOOST_CHECK(!m_node.chainman->ActiveChainstate().CoinsTip().HaveCoinInCache(orphan->vin[0].prevout));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -25,6 +25,7 @@ struct ConnmanTestMsg : public CConnman {
 
     void AddTestNode(CNode& node)
     {
+        AssignSocketThread(node);
         LOCK(m_nodes_mutex);
         m_nodes.push_back(&node);
     }
@@ -37,7 +38,19 @@ struct ConnmanTestMsg : public CConnman {
         m_nodes.clear();
     }
 
-    void ProcessMessagesOnce(CNode& node) { m_msgproc->ProcessMessages(&node, flagInterruptMsgProc); }
+    void ProcessMessagesOnce(CNode& node)
+    {
+        m_msgproc->ProcessMessages(&node, flagInterruptMsgProc);
+        m_msgproc->ProcessDeferredWork();
+    }
+
+    void SocketHandlerOnce() { SocketHandler(*m_socket_threads.front()); }
+
+    using CConnman::SocketSendData;
+
+#ifdef USE_EPOLL
+    bool InitEpoll() { return CConnman::InitEpoll(*m_socket_threads.front()); }
+#endif
 
     void NodeReceiveMsgBytes(CNode& node, Span<const uint8_t> msg_bytes, bool& complete) const;
 
@@ -405,6 +405,12 @@ void CTxMemPool::UpdateForRemoveFromMempool(const setEntries &entriesToRemove, b
             }
         }
     }
+    struct DescendantDelta {
+        int64_t size{0};
+        CAmount fee{0};
+        int64_t count{0};
+    };
+    std::map<txiter, DescendantDelta, CompareIteratorByHash> ancestor_deltas;
     for (txiter removeIt : entriesToRemove) {
         setEntries setAncestors;
         const CTxMemPoolEntry &entry = *removeIt;
@@ -429,9 +435,25 @@ void CTxMemPool::UpdateForRemoveFromMempool(const setEntries &entriesToRemove, b
         // we use the cached notion of ancestor transactions as the set of
         // things to update for removal.
         CalculateMemPoolAncestors(entry, setAncestors, nNoLimit, nNoLimit, nNoLimit, nNoLimit, dummy, false);
-        // Note that UpdateAncestorsOf severs the child links that point to
-        // removeIt in the entries for the parents of removeIt.
-        UpdateAncestorsOf(false, removeIt, setAncestors);
+        // Sever the child links that point to removeIt in the entries for
+        // the parents of removeIt.
+        for (const CTxMemPoolEntry& parent : entry.GetMemPoolParentsConst()) {
+            UpdateChild(mapTx.iterator_to(parent), removeIt, false);
+        }
+        // Ancestors that are removed as well don't need their descendant
+        // state updated. For the remaining ones, accumulate the removed
+        // size/fee/count so that each is modified (and re-sorted in mapTx)
+        // only once, rather than once per removed descendant.
+        for (txiter ancestorIt : setAncestors) {
+            if (entriesToRemove.count(ancestorIt)) continue;
+            DescendantDelta& delta = ancestor_deltas[ancestorIt];
+            delta.size -= entry.GetTxSize();
+            delta.fee -= entry.GetModifiedFee();
+            delta.count -= 1;
+        }
+    }
+    for (const auto& [ancestorIt, delta] : ancestor_deltas) {
+        mapTx.modify(ancestorIt, update_descendant_state(delta.size, delta.fee, delta.count));
     }
     // After updating all the ancestor sizes, we can now sever the link between each
     // transaction being removed and any mempool children (ie, update CTxMemPoolEntry::m_parents
@@ -461,12 +483,30 @@ void CTxMemPoolEntry::UpdateAncestorState(int64_t modifySize, CAmount modifyFee,
     assert(int(nSigOpCostWithAncestors) >= 0);
 }
 
+size_t GetFeeRateHistogramBucket(CAmount fee, size_t vsize)
+{
+    // Find the last bucket whose lower bound (in sat/vB) the fee rate reaches,
+    // comparing fee against bound * vsize to stay in integer arithmetic.
+    const auto it = std::upper_bound(MEMPOOL_FEERATE_HISTOGRAM_BOUNDS.begin(), MEMPOOL_FEERATE_HISTOGRAM_BOUNDS.end(), fee,
+        [vsize](CAmount value, CAmount bound) { return value < bound * static_cast<CAmount>(vsize); });
+    return it == MEMPOOL_FEERATE_HISTOGRAM_BOUNDS.begin() ? 0 : std::distance(MEMPOOL_FEERATE_HISTOGRAM_BOUNDS.begin(), it) - 1;
+}
+
 CTxMemPool::CTxMemPool(CBlockPolicyEstimator* estimator, int check_ratio)
     : m_check_ratio(check_ratio), minerPolicyEstimator(estimator)
 {
     _clear(); //lock free clear
 }
 
+void CTxMemPool::RecordFeeRateSnapshot()
+{
+    LOCK(cs);
+    m_feerate_snapshots.push_back({GetTime<std::chrono::seconds>(), m_feerate_histogram});
+    while (m_feerate_snapshots.size() > MAX_MEMPOOL_FEERATE_SNAPSHOTS) {
+        m_feerate_snapshots.pop_front();
+    }
+}
+
 bool CTxMemPool::isSpent(const COutPoint& outpoint) const
 {
     LOCK(cs);
@@ -527,6 +567,10 @@ void CTxMemPool::addUnchecked(const CTxMemPoolEntry &entry, setEntries &setAnces
     nTransactionsUpdated++;
     totalTxSize += entry.GetTxSize();
     m_total_fee += entry.GetFee();
+    MempoolFeeRateBucket& bucket = m_feerate_histogram[GetFeeRateHistogramBucket(entry.GetFee(), entry.GetTxSize())];
+    bucket.count++;
+    bucket.vsize += entry.GetTxSize();
+    bucket.fees += entry.GetFee();
     if (minerPolicyEstimator) {
         minerPolicyEstimator->processTransaction(entry, validFeeEstimate);
     }
@@ -566,6 +610,10 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
 
     totalTxSize -= it->GetTxSize();
     m_total_fee -= it->GetFee();
+    MempoolFeeRateBucket& bucket = m_feerate_histogram[GetFeeRateHistogramBucket(it->GetFee(), it->GetTxSize())];
+    bucket.count--;
+    bucket.vsize -= it->GetTxSize();
+    bucket.fees -= it->GetFee();
     cachedInnerUsage -= it->DynamicMemoryUsage();
     cachedInnerUsage -= memusage::DynamicUsage(it->GetMemPoolParentsConst()) + memusage::DynamicUsage(it->GetMemPoolChildrenConst());
     mapTx.erase(it);
@@ -712,6 +760,7 @@ void CTxMemPool::_clear()
     totalTxSize = 0;
     m_total_fee = 0;
     cachedInnerUsage = 0;
+    m_feerate_histogram = {};
     lastRollingFeeUpdate = GetTime();
     blockSinceLastRollingFeeBump = false;
     rollingMinimumFeeRate = 0;
@@ -736,6 +785,7 @@ void CTxMemPool::check(const CCoinsViewCache& active_coins_tip, int64_t spendhei
 
     uint64_t checkTotal = 0;
     CAmount check_total_fee{0};
+    MempoolFeeRateHistogram check_histogram;
     uint64_t innerUsage = 0;
     uint64_t prev_ancestor_count{0};
 
@@ -744,6 +794,10 @@ void CTxMemPool::check(const CCoinsViewCache& active_coins_tip, int64_t spendhei
     for (const auto& it : GetSortedDepthAndScore()) {
         checkTotal += it->GetTxSize();
         check_total_fee += it->GetFee();
+        MempoolFeeRateBucket& check_bucket = check_histogram[GetFeeRateHistogramBucket(it->GetFee(), it->GetTxSize())];
+        check_bucket.count++;
+        check_bucket.vsize += it->GetTxSize();
+        check_bucket.fees += it->GetFee();
         innerUsage += it->DynamicMemoryUsage();
         const CTransaction& tx = it->GetTx();
         innerUsage += memusage::DynamicUsage(it->GetMemPoolParentsConst()) + memusage::DynamicUsage(it->GetMemPoolChildrenConst());
@@ -829,6 +883,7 @@ void CTxMemPool::check(const CCoinsViewCache& active_coins_tip, int64_t spendhei
 
     assert(totalTxSize == checkTotal);
     assert(m_total_fee == check_total_fee);
+    assert(check_histogram == m_feerate_histogram);
     assert(innerUsage == cachedInnerUsage);
 }
 
@@ -877,6 +932,24 @@ std::vector<CTxMemPool::indexed_transaction_set::const_iterator> CTxMemPool::Get
     return iters;
 }
 
+std::vector<CTransactionRef> CTxMemPool::SortByDepthAndScore(const std::vector<uint256>& wtxids) const
+{
+    LOCK(cs);
+    std::vector<indexed_transaction_set::const_iterator> iters;
+    iters.reserve(wtxids.size());
+    for (const uint256& wtxid : wtxids) {
+        const auto it = get_iter_from_wtxid(wtxid);
+        if (it != mapTx.end()) iters.push_back(it);
+    }
+    std::sort(iters.begin(), iters.end(), DepthAndScoreComparator());
+    iters.erase(std::unique(iters.begin(), iters.end()), iters.end());
+
+    std::vector<CTransactionRef> txs;
+    txs.reserve(iters.size());
+    for (const auto& it : iters) txs.push_back(it->GetSharedTx());
+    return txs;
+}
+
 void CTxMemPool::queryHashes(std::vector<uint256>& vtxid) const
 {
     LOCK(cs);
@@ -1143,6 +1216,7 @@ void CTxMemPool::TrimToSize(size_t sizelimit, std::vector<COutPoint>* pvNoSpends
 
     unsigned nTxnRemoved = 0;
     CFeeRate maxFeeRateRemoved(0);
+    std::vector<CTransactionRef> txn;
     while (!mapTx.empty() && DynamicMemoryUsage() > sizelimit) {
         indexed_transaction_set::index<descendant_score>::type::iterator it = mapTx.get<descendant_score>().begin();
 
@@ -1155,23 +1229,30 @@ void CTxMemPool::TrimToSize(size_t sizelimit, std::vector<COutPoint>* pvNoSpends
         trackPackageRemoved(removed);
         maxFeeRateRemoved = std::max(maxFeeRateRemoved, removed);
 
+        // The package (it and its descendants) is evicted as a whole. Its
+        // size and fees are already cached in the entry, so only walk the
+        // descendants if there are any.
         setEntries stage;
-        CalculateDescendants(mapTx.project<0>(it), stage);
+        if (it->GetCountWithDescendants() == 1) {
+            stage.insert(mapTx.project<0>(it));
+        } else {
+            CalculateDescendants(mapTx.project<0>(it), stage);
+        }
         nTxnRemoved += stage.size();
 
-        std::vector<CTransaction> txn;
         if (pvNoSpendsRemaining) {
-            txn.reserve(stage.size());
             for (txiter iter : stage)
-                txn.push_back(iter->GetTx());
+                txn.push_back(iter->GetSharedTx());
         }
         RemoveStaged(stage, false, MemPoolRemovalReason::SIZELIMIT);
-        if (pvNoSpendsRemaining) {
-            for (const CTransaction& tx : txn) {
-                for (const CTxIn& txin : tx.vin) {
-                    if (exists(GenTxid::Txid(txin.prevout.hash))) continue;
-                    pvNoSpendsRemaining->push_back(txin.prevout);
-                }
+    }
+
+    // Check for remaining spends once, after all evictions.
+    if (pvNoSpendsRemaining) {
+        for (const CTransactionRef& tx : txn) {
+            for (const CTxIn& txin : tx->vin) {
+                if (exists(GenTxid::Txid(txin.prevout.hash))) continue;
+                pvNoSpendsRemaining->push_back(txin.prevout);
             }
         }
     }
@@ -6,7 +6,10 @@
 #ifndef BITCOIN_TXMEMPOOL_H
 #define BITCOIN_TXMEMPOOL_H
 
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <deque>
 #include <map>
 #include <optional>
 #include <set>
@@ -341,6 +344,44 @@ struct TxMempoolInfo
     int64_t nFeeDelta;
 };
 
+/** Lower bounds, in sat/vB, of the fee rate buckets of the mempool fee rate
+ *  histogram. Each bucket extends up to the next bound; the last one is
+ *  unbounded. */
+static constexpr std::array<CAmount, 46> MEMPOOL_FEERATE_HISTOGRAM_BOUNDS{
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 10, 12, 14, 17, 20, 25, 30, 40, 50, 60, 70, 80, 100, 120, 140, 170,
+    200, 250, 300, 400, 500, 600, 700, 800, 1000, 1200, 1400, 1700, 2000, 2500, 3000, 4000, 5000,
+    6000, 7000, 8000, 10000};
+/** How often a snapshot of the fee rate histogram is recorded */
+static constexpr std::chrono::minutes MEMPOOL_FEERATE_SNAPSHOT_INTERVAL{1};
+/** Number of fee rate histogram snapshots kept */
+static constexpr size_t MAX_MEMPOOL_FEERATE_SNAPSHOTS{60};
+
+/** Aggregate of the mempool transactions whose fee rate falls in one bucket
+ *  of the fee rate histogram (fees are NOT modified fees). */
+struct MempoolFeeRateBucket
+{
+    uint64_t count{0};
+    uint64_t vsize{0};
+    CAmount fees{0};
+
+    bool operator==(const MempoolFeeRateBucket& other) const
+    {
+        return count == other.count && vsize == other.vsize && fees == other.fees;
+    }
+};
+
+using MempoolFeeRateHistogram = std::array<MempoolFeeRateBucket, MEMPOOL_FEERATE_HISTOGRAM_BOUNDS.size()>;
+
+/** The fee rate histogram at a point in time */
+struct MempoolFeeRateSnapshot
+{
+    std::chrono::seconds m_time;
+    MempoolFeeRateHistogram m_histogram;
+};
+
+/** Index of the fee rate histogram bucket for a transaction */
+size_t GetFeeRateHistogramBucket(CAmount fee, size_t vsize);
+
 /** Reason why a transaction was removed from the mempool,
  * this is passed to the notification signal.
  */
@@ -436,6 +477,8 @@ protected:
     uint64_t totalTxSize GUARDED_BY(cs);      //!< sum of all mempool tx's virtual sizes. Differs from serialized tx size since witness data is discounted. Defined in BIP 141.
     CAmount m_total_fee GUARDED_BY(cs);       //!< sum of all mempool tx's fees (NOT modified fee)
     uint64_t cachedInnerUsage GUARDED_BY(cs); //!< sum of dynamic memory usage of all the map elements (NOT the maps themselves)
+    MempoolFeeRateHistogram m_feerate_histogram GUARDED_BY(cs); //!< count, size and fees of all mempool tx's, by fee rate
+    std::deque<MempoolFeeRateSnapshot> m_feerate_snapshots GUARDED_BY(cs); //!< recent copies of m_feerate_histogram, oldest first
 
     mutable int64_t lastRollingFeeUpdate GUARDED_BY(cs);
     mutable bool blockSinceLastRollingFeeBump GUARDED_BY(cs);
@@ -599,6 +642,9 @@ public:
     void clear();
     void _clear() EXCLUSIVE_LOCKS_REQUIRED(cs); //lock free
     bool CompareDepthAndScore(const uint256& hasha, const uint256& hashb, bool wtxid=false);
+    /** Look up transactions by wtxid and return them in the order of CompareDepthAndScore,
+     *  without duplicates. Transactions that are not in the mempool are left out. */
+    std::vector<CTransactionRef> SortByDepthAndScore(const std::vector<uint256>& wtxids) const;
     void queryHashes(std::vector<uint256>& vtxid) const;
     bool isSpent(const COutPoint& outpoint) const;
     unsigned int GetTransactionsUpdated() const;
@@ -731,6 +777,22 @@ public:
         return m_total_fee;
     }
 
+    const MempoolFeeRateHistogram& GetFeeRateHistogram() const EXCLUSIVE_LOCKS_REQUIRED(cs)
+    {
+        AssertLockHeld(cs);
+        return m_feerate_histogram;
+    }
+
+    const std::deque<MempoolFeeRateSnapshot>& GetFeeRateSnapshots() const EXCLUSIVE_LOCKS_REQUIRED(cs)
+    {
+        AssertLockHeld(cs);
+        return m_feerate_snapshots;
+    }
+
+    /** Record a snapshot of the fee rate histogram, dropping the oldest one
+     *  once MAX_MEMPOOL_FEERATE_SNAPSHOTS are kept. */
+    void RecordFeeRateSnapshot();
+
     bool exists(const GenTxid& gtxid) const
     {
         LOCK(cs);
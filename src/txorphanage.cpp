@@ -12,8 +12,6 @@
 
 /** Expiration time for orphan transactions in seconds */
 static constexpr int64_t ORPHAN_TX_EXPIRE_TIME = 20 * 60;
-/** Minimum time between orphan transactions expire time checks in seconds */
-static constexpr int64_t ORPHAN_TX_EXPIRE_INTERVAL = 5 * 60;
 
 RecursiveMutex g_cs_orphans;
 
@@ -39,17 +37,23 @@ bool TxOrphanage::AddTx(const CTransactionRef& tx, NodeId peer)
         return false;
     }
 
-    auto ret = m_orphans.emplace(hash, OrphanTx{tx, peer, GetTime() + ORPHAN_TX_EXPIRE_TIME, m_orphan_list.size()});
+    PeerOrphanInfo& peer_info = m_peer_orphanage_info[peer];
+    const int64_t expire_time = GetTime() + ORPHAN_TX_EXPIRE_TIME;
+    auto ret = m_orphans.emplace(hash, OrphanTx{tx, peer, expire_time, m_orphan_list.size(), peer_info.m_orphan_list.size(), sz});
     assert(ret.second);
     m_orphan_list.push_back(ret.first);
+    peer_info.m_orphan_list.push_back(ret.first);
+    peer_info.m_total_weight += sz;
+    m_total_orphan_weight += sz;
+    m_expiry_queue.emplace(expire_time, hash);
     // Allow for lookups in the orphan pool by wtxid, as well as txid
     m_wtxid_to_orphan_it.emplace(tx->GetWitnessHash(), ret.first);
     for (const CTxIn& txin : tx->vin) {
         m_outpoint_to_orphan_it[txin.prevout].insert(ret.first);
     }
 
-    LogPrint(BCLog::MEMPOOL, "stored orphan tx %s (mapsz %u outsz %u)\n", hash.ToString(),
-             m_orphans.size(), m_outpoint_to_orphan_it.size());
+    LogPrint(BCLog::MEMPOOL, "stored orphan tx %s (mapsz %u outsz %u weight %d)\n", hash.ToString(),
+             m_orphans.size(), m_outpoint_to_orphan_it.size(), m_total_orphan_weight);
     return true;
 }
 
@@ -79,6 +83,24 @@ int TxOrphanage::EraseTx(const uint256& txid)
         it_last->second.list_pos = old_pos;
     }
     m_orphan_list.pop_back();
+
+    // Same swap-and-pop for the announcing peer's list.
+    auto peer_it = m_peer_orphanage_info.find(it->second.fromPeer);
+    assert(peer_it != m_peer_orphanage_info.end());
+    std::vector<OrphanMap::iterator>& peer_list = peer_it->second.m_orphan_list;
+    size_t old_peer_pos = it->second.peer_list_pos;
+    assert(peer_list[old_peer_pos] == it);
+    if (old_peer_pos + 1 != peer_list.size()) {
+        auto it_last = peer_list.back();
+        peer_list[old_peer_pos] = it_last;
+        it_last->second.peer_list_pos = old_peer_pos;
+    }
+    peer_list.pop_back();
+    peer_it->second.m_total_weight -= it->second.weight;
+    if (peer_list.empty()) m_peer_orphanage_info.erase(peer_it);
+
+    m_total_orphan_weight -= it->second.weight;
+    m_expiry_queue.erase({it->second.nTimeExpire, txid});
     m_wtxid_to_orphan_it.erase(it->second.tx->GetWitnessHash());
 
     m_orphans.erase(it);
@@ -89,50 +111,50 @@ void TxOrphanage::EraseForPeer(NodeId peer)
 {
     AssertLockHeld(g_cs_orphans);
 
+    const auto peer_it = m_peer_orphanage_info.find(peer);
+    if (peer_it == m_peer_orphanage_info.end()) return;
+
+    // EraseTx drops the peer's entry together with its last orphan, so
+    // collect the txids first.
+    std::vector<uint256> txids;
+    txids.reserve(peer_it->second.m_orphan_list.size());
+    for (const auto& orphan_it : peer_it->second.m_orphan_list) {
+        txids.push_back(orphan_it->first);
+    }
+
     int nErased = 0;
-    std::map<uint256, OrphanTx>::iterator iter = m_orphans.begin();
-    while (iter != m_orphans.end())
-    {
-        std::map<uint256, OrphanTx>::iterator maybeErase = iter++; // increment to avoid iterator becoming invalid
-        if (maybeErase->second.fromPeer == peer)
-        {
-            nErased += EraseTx(maybeErase->second.tx->GetHash());
-        }
+    for (const uint256& txid : txids) {
+        nErased += EraseTx(txid);
     }
     if (nErased > 0) LogPrint(BCLog::MEMPOOL, "Erased %d orphan tx from peer=%d\n", nErased, peer);
 }
 
-unsigned int TxOrphanage::LimitOrphans(unsigned int max_orphans)
+unsigned int TxOrphanage::LimitOrphans(unsigned int max_orphans, int64_t max_weight)
 {
     AssertLockHeld(g_cs_orphans);
 
     unsigned int nEvicted = 0;
-    static int64_t nNextSweep;
     int64_t nNow = GetTime();
-    if (nNextSweep <= nNow) {
-        // Sweep out expired orphan pool entries:
-        int nErased = 0;
-        int64_t nMinExpTime = nNow + ORPHAN_TX_EXPIRE_TIME - ORPHAN_TX_EXPIRE_INTERVAL;
-        std::map<uint256, OrphanTx>::iterator iter = m_orphans.begin();
-        while (iter != m_orphans.end())
-        {
-            std::map<uint256, OrphanTx>::iterator maybeErase = iter++;
-            if (maybeErase->second.nTimeExpire <= nNow) {
-                nErased += EraseTx(maybeErase->second.tx->GetHash());
-            } else {
-                nMinExpTime = std::min(maybeErase->second.nTimeExpire, nMinExpTime);
-            }
-        }
-        // Sweep again 5 minutes after the next entry that expires in order to batch the linear scan.
-        nNextSweep = nMinExpTime + ORPHAN_TX_EXPIRE_INTERVAL;
-        if (nErased > 0) LogPrint(BCLog::MEMPOOL, "Erased %d orphan tx due to expiration\n", nErased);
+    // Sweep out expired orphan pool entries, oldest first:
+    int nErased = 0;
+    while (!m_expiry_queue.empty() && m_expiry_queue.begin()->first <= nNow) {
+        const uint256 txid = m_expiry_queue.begin()->second;
+        nErased += EraseTx(txid);
     }
+    if (nErased > 0) LogPrint(BCLog::MEMPOOL, "Erased %d orphan tx due to expiration\n", nErased);
+
     FastRandomContext rng;
-    while (m_orphans.size() > max_orphans)
+    while (m_orphans.size() > max_orphans ||
+           m_total_orphan_weight > std::max<int64_t>(max_weight, ORPHAN_RESERVED_WEIGHT_PER_PEER * m_peer_orphanage_info.size()))
     {
-        // Evict a random orphan:
-        size_t randompos = rng.randrange(m_orphan_list.size());
-        EraseTx(m_orphan_list[randompos]->first);
+        // Evict a random orphan of the peer using the most weight:
+        auto heaviest = m_peer_orphanage_info.begin();
+        for (auto peer_it = m_peer_orphanage_info.begin(); peer_it != m_peer_orphanage_info.end(); ++peer_it) {
+            if (peer_it->second.m_total_weight > heaviest->second.m_total_weight) heaviest = peer_it;
+        }
+        const std::vector<OrphanMap::iterator>& peer_list = heaviest->second.m_orphan_list;
+        size_t randompos = rng.randrange(peer_list.size());
+        EraseTx(peer_list[randompos]->first);
         ++nEvicted;
     }
     return nEvicted;
@@ -151,6 +173,14 @@ void TxOrphanage::AddChildrenToWorkSet(const CTransaction& tx, std::set<uint256>
     }
 }
 
+int64_t TxOrphanage::PeerOrphanWeight(NodeId peer) const
+{
+    LOCK(g_cs_orphans);
+    const auto peer_it = m_peer_orphanage_info.find(peer);
+    if (peer_it == m_peer_orphanage_info.end()) return 0;
+    return peer_it->second.m_total_weight;
+}
+
 bool TxOrphanage::HaveTx(const GenTxid& gtxid) const
 {
     LOCK(g_cs_orphans);
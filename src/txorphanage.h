@@ -6,13 +6,25 @@
 #define BITCOIN_TXORPHANAGE_H
 
 #include <net.h>
+#include <policy/policy.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <sync.h>
+#include <util/hasher.h>
+
+#include <set>
+#include <unordered_map>
 
 /** Guards orphan transactions and extra txs for compact blocks */
 extern RecursiveMutex g_cs_orphans;
 
+/** Default for the total weight of all orphans kept in the orphanage */
+static constexpr int64_t DEFAULT_MAX_ORPHAN_WEIGHT{25 * MAX_STANDARD_TX_WEIGHT};
+/** Orphan weight each announcing peer is entitled to before its orphans are
+ *  preferred for eviction. The total weight limit is raised so that every
+ *  peer with orphans can use its full reservation. */
+static constexpr int64_t ORPHAN_RESERVED_WEIGHT_PER_PEER{100000};
+
 /** A class to track orphan transactions (failed on TX_MISSING_INPUTS)
  * Since we cannot distinguish orphans from bad transactions with
  * non-existent inputs, we heavily limit the number of orphans
@@ -40,8 +52,11 @@ public:
     /** Erase all orphans included in or invalidated by a new block */
     void EraseForBlock(const CBlock& block) LOCKS_EXCLUDED(::g_cs_orphans);
 
-    /** Limit the orphanage to the given maximum */
-    unsigned int LimitOrphans(unsigned int max_orphans) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans);
+    /** Erase expired orphans, then evict orphans until both the count limit and the
+     *  weight limit are respected. Orphans are evicted at random from the peer
+     *  currently using the most weight, so a peer staying within its
+     *  reservation is only affected once every other peer has been trimmed. */
+    unsigned int LimitOrphans(unsigned int max_orphans, int64_t max_weight = DEFAULT_MAX_ORPHAN_WEIGHT) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans);
 
     /** Add any orphans that list a particular tx as a parent into a peer's work set
      * (ie orphans that may have found their final missing parent, and so should be reconsidered for the mempool) */
@@ -54,12 +69,25 @@ public:
         return m_orphans.size();
     }
 
+    /** Return the total weight of all orphans in the orphanage */
+    int64_t TotalOrphanWeight() const LOCKS_EXCLUDED(::g_cs_orphans)
+    {
+        LOCK(::g_cs_orphans);
+        return m_total_orphan_weight;
+    }
+
+    /** Return the total weight of the orphans announced by a peer */
+    int64_t PeerOrphanWeight(NodeId peer) const LOCKS_EXCLUDED(::g_cs_orphans);
+
 protected:
     struct OrphanTx {
         CTransactionRef tx;
         NodeId fromPeer;
         int64_t nTimeExpire;
         size_t list_pos;
+        /** Position in the announcing peer's PeerOrphanInfo::m_orphan_list */
+        size_t peer_list_pos;
+        int64_t weight;
     };
 
     /** Map from txid to orphan transaction record. Limited by
@@ -79,14 +107,32 @@ protected:
 
     /** Index from the parents' COutPoint into the m_orphans. Used
      *  to remove orphan transactions from the m_orphans */
-    std::map<COutPoint, std::set<OrphanMap::iterator, IteratorComparator>> m_outpoint_to_orphan_it GUARDED_BY(g_cs_orphans);
+    std::unordered_map<COutPoint, std::set<OrphanMap::iterator, IteratorComparator>, SaltedOutpointHasher> m_outpoint_to_orphan_it GUARDED_BY(g_cs_orphans);
 
     /** Orphan transactions in vector for quick random eviction */
     std::vector<OrphanMap::iterator> m_orphan_list GUARDED_BY(g_cs_orphans);
 
     /** Index from wtxid into the m_orphans to lookup orphan
      *  transactions using their witness ids. */
-    std::map<uint256, OrphanMap::iterator> m_wtxid_to_orphan_it GUARDED_BY(g_cs_orphans);
+    std::unordered_map<uint256, OrphanMap::iterator, SaltedTxidHasher> m_wtxid_to_orphan_it GUARDED_BY(g_cs_orphans);
+
+    struct PeerOrphanInfo {
+        /** Orphans announced by this peer, for per-peer erasure and random eviction */
+        std::vector<OrphanMap::iterator> m_orphan_list;
+        /** Sum of the weights of the orphans in m_orphan_list */
+        int64_t m_total_weight{0};
+    };
+
+    /** Per-peer index of the orphans each peer announced. Peers without
+     *  orphans have no entry. */
+    std::map<NodeId, PeerOrphanInfo> m_peer_orphanage_info GUARDED_BY(g_cs_orphans);
+
+    /** Orphans ordered by expiry time, so that expired entries can be
+     *  erased without scanning the whole orphanage */
+    std::set<std::pair<int64_t, uint256>> m_expiry_queue GUARDED_BY(g_cs_orphans);
+
+    /** Sum of the weights of all orphans in m_orphans */
+    int64_t m_total_orphan_weight GUARDED_BY(g_cs_orphans){0};
 };
 
 #endif // BITCOIN_TXORPHANAGE_H
@@ -9,13 +9,17 @@
 #include <primitives/transaction.h>
 #include <random.h>
 #include <uint256.h>
+#include <util/hasher.h>
 
-#include <boost/multi_index_container.hpp>
-#include <boost/multi_index/ordered_index.hpp>
-
+#include <algorithm>
 #include <chrono>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <optional>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include <assert.h>
 
@@ -24,7 +28,6 @@ namespace {
 /** The various states a (txhash,peer) pair can be in.
  *
  * Note that CANDIDATE is split up into 3 substates (DELAYED, BEST, READY), allowing more efficient implementation.
- * Also note that the sorting order of ByTxHashView relies on the specific order of values in this enum.
  *
  * Expected behaviour is:
  *   - When first announced by a peer, the state is CANDIDATE_DELAYED until reqtime is reached.
@@ -53,26 +56,54 @@ enum class State : uint8_t {
 //! Type alias for sequence numbers.
 using SequenceNumber = uint64_t;
 
+//! Type alias for priorities.
+using Priority = uint64_t;
+
+//! Type alias for the position of an announcement in TxRequestTracker::Impl's announcement storage.
+using AnnouncementIndex = uint32_t;
+
+//! Marker for the absence of an announcement.
+constexpr AnnouncementIndex NO_ANNOUNCEMENT{std::numeric_limits<AnnouncementIndex>::max()};
+
+struct TxHashEntry;
+struct PeerEntry;
+
 /** An announcement. This is the data we track for each txid or wtxid that is announced to us by each peer. */
 struct Announcement {
     /** Txid or wtxid that was announced. */
-    const uint256 m_txhash;
+    uint256 m_txhash;
     /** For CANDIDATE_{DELAYED,BEST,READY} the reqtime; for REQUESTED the expiry. */
     std::chrono::microseconds m_time;
     /** What peer the request was from. */
-    const NodeId m_peer;
+    NodeId m_peer;
     /** What sequence number this announcement has. */
-    const SequenceNumber m_sequence : 59;
+    SequenceNumber m_sequence : 59;
     /** Whether the request is preferred. */
-    const bool m_preferred : 1;
+    bool m_preferred : 1;
     /** Whether this is a wtxid request. */
-    const bool m_is_wtxid : 1;
+    bool m_is_wtxid : 1;
 
     /** What state this announcement is in.
      *  This is a uint8_t instead of a State to silence a GCC warning in versions prior to 8.4 and 9.3.
      *  See https://gcc.gnu.org/bugzilla/show_bug.cgi?id=61414 */
     uint8_t m_state : 3;
 
+    /** The priority of this announcement, which only matters for CANDIDATE_READY and CANDIDATE_BEST ones. */
+    Priority m_priority;
+
+    /** The entries of the txhash and of the peer of this announcement (nullptr if this storage slot is unused). */
+    TxHashEntry* m_txhash_entry;
+    PeerEntry* m_peer_entry;
+
+    /** Position of this announcement in m_txhash_entry->m_announcements and m_peer_entry->m_announcements. */
+    uint32_t m_txhash_pos;
+    uint32_t m_peer_pos;
+    /** For CANDIDATE_BEST, its position in m_peer_entry->m_best. */
+    uint32_t m_best_pos;
+    /** For CANDIDATE_DELAYED and REQUESTED, the timing wheel bucket it is in, and its position there. */
+    uint32_t m_wheel_bucket;
+    uint32_t m_wheel_pos;
+
     /** Convert m_state to a State enum. */
     State GetState() const { return static_cast<State>(m_state); }
 
@@ -97,16 +128,17 @@ struct Announcement {
         return GetState() == State::CANDIDATE_READY || GetState() == State::CANDIDATE_BEST;
     }
 
+    /** Whether this storage slot holds an announcement. */
+    bool InUse() const { return m_peer_entry != nullptr; }
+
     /** Construct a new announcement from scratch, initially in CANDIDATE_DELAYED state. */
     Announcement(const GenTxid& gtxid, NodeId peer, bool preferred, std::chrono::microseconds reqtime,
-        SequenceNumber sequence) :
+        SequenceNumber sequence, Priority priority, TxHashEntry& txhash_entry, PeerEntry& peer_entry) :
         m_txhash(gtxid.GetHash()), m_time(reqtime), m_peer(peer), m_sequence(sequence), m_preferred(preferred),
-        m_is_wtxid(gtxid.IsWtxid()), m_state(static_cast<uint8_t>(State::CANDIDATE_DELAYED)) {}
+        m_is_wtxid(gtxid.IsWtxid()), m_state(static_cast<uint8_t>(State::CANDIDATE_DELAYED)), m_priority(priority),
+        m_txhash_entry(&txhash_entry), m_peer_entry(&peer_entry) {}
 };
 
-//! Type alias for priorities.
-using Priority = uint64_t;
-
 /** A functor with embedded salt that computes priority of an announcement.
  *
  * Higher priorities are selected first.
@@ -130,104 +162,23 @@ public:
     }
 };
 
-// Definitions for the 3 indexes used in the main data structure.
-//
-// Each index has a By* type to identify it, a By*View data type to represent the view of announcement it is sorted
-// by, and an By*ViewExtractor type to convert an announcement into the By*View type.
-// See https://www.boost.org/doc/libs/1_58_0/libs/multi_index/doc/reference/key_extraction.html#key_extractors
-// for more information about the key extraction concept.
-
-// The ByPeer index is sorted by (peer, state == CANDIDATE_BEST, txhash)
-//
-// Uses:
-// * Looking up existing announcements by peer/txhash, by checking both (peer, false, txhash) and
-//   (peer, true, txhash).
-// * Finding all CANDIDATE_BEST announcements for a given peer in GetRequestable.
-struct ByPeer {};
-using ByPeerView = std::tuple<NodeId, bool, const uint256&>;
-struct ByPeerViewExtractor
-{
-    using result_type = ByPeerView;
-    result_type operator()(const Announcement& ann) const
-    {
-        return ByPeerView{ann.m_peer, ann.GetState() == State::CANDIDATE_BEST, ann.m_txhash};
-    }
-};
-
-// The ByTxHash index is sorted by (txhash, state, priority).
-//
-// Note: priority == 0 whenever state != CANDIDATE_READY.
-//
-// Uses:
-// * Deleting all announcements with a given txhash in ForgetTxHash.
-// * Finding the best CANDIDATE_READY to convert to CANDIDATE_BEST, when no other CANDIDATE_READY or REQUESTED
-//   announcement exists for that txhash.
-// * Determining when no more non-COMPLETED announcements for a given txhash exist, so the COMPLETED ones can be
-//   deleted.
-struct ByTxHash {};
-using ByTxHashView = std::tuple<const uint256&, State, Priority>;
-class ByTxHashViewExtractor {
-    const PriorityComputer& m_computer;
-public:
-    explicit ByTxHashViewExtractor(const PriorityComputer& computer) : m_computer(computer) {}
-    using result_type = ByTxHashView;
-    result_type operator()(const Announcement& ann) const
-    {
-        const Priority prio = (ann.GetState() == State::CANDIDATE_READY) ? m_computer(ann) : 0;
-        return ByTxHashView{ann.m_txhash, ann.GetState(), prio};
-    }
-};
-
-enum class WaitState {
-    //! Used for announcements that need efficient testing of "is their timestamp in the future?".
-    FUTURE_EVENT,
-    //! Used for announcements whose timestamp is not relevant.
-    NO_EVENT,
-    //! Used for announcements that need efficient testing of "is their timestamp in the past?".
-    PAST_EVENT,
-};
-
-WaitState GetWaitState(const Announcement& ann)
-{
-    if (ann.IsWaiting()) return WaitState::FUTURE_EVENT;
-    if (ann.IsSelectable()) return WaitState::PAST_EVENT;
-    return WaitState::NO_EVENT;
-}
-
-// The ByTime index is sorted by (wait_state, time).
-//
-// All announcements with a timestamp in the future can be found by iterating the index forward from the beginning.
-// All announcements with a timestamp in the past can be found by iterating the index backwards from the end.
-//
-// Uses:
-// * Finding CANDIDATE_DELAYED announcements whose reqtime has passed, and REQUESTED announcements whose expiry has
-//   passed.
-// * Finding CANDIDATE_READY/BEST announcements whose reqtime is in the future (when the clock time went backwards).
-struct ByTime {};
-using ByTimeView = std::pair<WaitState, std::chrono::microseconds>;
-struct ByTimeViewExtractor
-{
-    using result_type = ByTimeView;
-    result_type operator()(const Announcement& ann) const
-    {
-        return ByTimeView{GetWaitState(ann), ann.m_time};
-    }
+/** The announcements for a txhash.
+ *
+ * Uses:
+ * * Looking up existing announcements by peer/txhash. The announcements are scanned linearly, as a txhash has at
+ *   most one announcement per peer.
+ * * Finding the best CANDIDATE_READY to convert to CANDIDATE_BEST when the IsSelected() one changes state.
+ * * Determining when no more non-COMPLETED announcements exist, so the COMPLETED ones can be deleted.
+ */
+struct TxHashEntry {
+    //! The announcements, with the peer they are from.
+    std::vector<std::pair<NodeId, AnnouncementIndex>> m_announcements;
+    //! The CANDIDATE_BEST or REQUESTED announcement, if any.
+    AnnouncementIndex m_selected{NO_ANNOUNCEMENT};
+    //! Number of announcements that are not COMPLETED.
+    uint32_t m_non_completed{0};
 };
 
-/** Data type for the main data structure (Announcement objects with ByPeer/ByTxHash/ByTime indexes). */
-using Index = boost::multi_index_container<
-    Announcement,
-    boost::multi_index::indexed_by<
-        boost::multi_index::ordered_unique<boost::multi_index::tag<ByPeer>, ByPeerViewExtractor>,
-        boost::multi_index::ordered_non_unique<boost::multi_index::tag<ByTxHash>, ByTxHashViewExtractor>,
-        boost::multi_index::ordered_non_unique<boost::multi_index::tag<ByTime>, ByTimeViewExtractor>
-    >
->;
-
-/** Helper type to simplify syntax of iterator types. */
-template<typename Tag>
-using Iter = typename Index::index<Tag>::type::iterator;
-
 /** Per-peer statistics object. */
 struct PeerInfo {
     size_t m_total = 0; //!< Total number of announcements for this peer.
@@ -235,6 +186,19 @@ struct PeerInfo {
     size_t m_requested = 0; //!< Number of REQUESTED announcements for this peer.
 };
 
+/** The announcements from a peer.
+ *
+ * Uses:
+ * * Deleting all announcements of a peer in DisconnectedPeer.
+ * * Finding all CANDIDATE_BEST announcements for a given peer in GetRequestable.
+ */
+struct PeerEntry {
+    PeerInfo m_info;
+    std::vector<AnnouncementIndex> m_announcements;
+    //! The CANDIDATE_BEST announcements.
+    std::vector<AnnouncementIndex> m_best;
+};
+
 /** Per-txhash statistics object. Only used for sanity checking. */
 struct TxHashInfo
 {
@@ -261,11 +225,12 @@ bool operator==(const PeerInfo& a, const PeerInfo& b)
            std::tie(b.m_total, b.m_completed, b.m_requested);
 };
 
-/** (Re)compute the PeerInfo map from the index. Only used for sanity checking. */
-std::unordered_map<NodeId, PeerInfo> RecomputePeerInfo(const Index& index)
+/** (Re)compute the PeerInfo map from the announcements. Only used for sanity checking. */
+std::unordered_map<NodeId, PeerInfo> RecomputePeerInfo(const std::vector<Announcement>& announcements)
 {
     std::unordered_map<NodeId, PeerInfo> ret;
-    for (const Announcement& ann : index) {
+    for (const Announcement& ann : announcements) {
+        if (!ann.InUse()) continue;
         PeerInfo& info = ret[ann.m_peer];
         ++info.m_total;
         info.m_requested += (ann.GetState() == State::REQUESTED);
@@ -275,10 +240,11 @@ std::unordered_map<NodeId, PeerInfo> RecomputePeerInfo(const Index& index)
 }
 
 /** Compute the TxHashInfo map. Only used for sanity checking. */
-std::map<uint256, TxHashInfo> ComputeTxHashInfo(const Index& index, const PriorityComputer& computer)
+std::map<uint256, TxHashInfo> ComputeTxHashInfo(const std::vector<Announcement>& announcements, const PriorityComputer& computer)
 {
     std::map<uint256, TxHashInfo> ret;
-    for (const Announcement& ann : index) {
+    for (const Announcement& ann : announcements) {
+        if (!ann.InUse()) continue;
         TxHashInfo& info = ret[ann.m_txhash];
         // Classify how many announcements of each state we have for this txhash.
         info.m_candidate_delayed += (ann.GetState() == State::CANDIDATE_DELAYED);
@@ -303,9 +269,44 @@ GenTxid ToGenTxid(const Announcement& ann)
     return ann.m_is_wtxid ? GenTxid::Wtxid(ann.m_txhash) : GenTxid::Txid(ann.m_txhash);
 }
 
+/** Remove the element at pos from a vector by moving the last one in its place, and return the element that was
+ *  moved, if any. */
+template<typename T>
+std::optional<T> SwapRemove(std::vector<T>& vec, uint32_t pos)
+{
+    assert(pos < vec.size());
+    std::optional<T> moved;
+    if (pos + 1 != vec.size()) {
+        vec[pos] = std::move(vec.back());
+        moved = vec[pos];
+    }
+    vec.pop_back();
+    return moved;
+}
+
+//! The timing wheel has WHEEL_SIZE buckets of 2^WHEEL_TICK_BITS microseconds each (1024 x 65.5ms), so that the
+//! expiry of requests (60s in net_processing) fits within one rotation.
+constexpr int WHEEL_TICK_BITS{16};
+constexpr uint64_t WHEEL_SIZE{1024};
+
+int64_t WheelTick(std::chrono::microseconds time) { return time.count() >> WHEEL_TICK_BITS; }
+uint32_t WheelBucket(int64_t tick) { return uint64_t(tick) & (WHEEL_SIZE - 1); }
+
 }  // namespace
 
-/** Actual implementation for TxRequestTracker's data structure. */
+/** Actual implementation for TxRequestTracker's data structure.
+ *
+ * Announcements are kept in a vector, and referred to by their position in it. Each txhash and each peer has an
+ * entry with the announcements for it, and each announcement points to these entries, so that most operations only
+ * touch the announcements they affect, and those of the same txhash. Changes of state go through Modify(), which
+ * keeps the entries and the timing wheel consistent with the state of the announcement.
+ *
+ * The timing wheel holds the announcements that wait for their time to pass (IsWaiting()), in the bucket for their
+ * time. Time is split in ticks of one bucket each, and buckets are reused every WHEEL_SIZE ticks. Moving time forward
+ * scans the buckets of the ticks passed since the last time, and moving it backward needs no scan, except for the
+ * (rare) announcements that are added with a time before that. These are kept in the bucket of the last tick, so that
+ * each announcement is either in the bucket of its tick, or in the bucket of m_wheel_tick with an earlier tick.
+ */
 class TxRequestTracker::Impl {
     //! The current sequence number. Increases for every announcement. This is used to sort txhashes returned by
     //! GetRequestable in announcement order.
@@ -314,21 +315,55 @@ class TxRequestTracker::Impl {
     //! This tracker's priority computer.
     const PriorityComputer m_computer;
 
-    //! This tracker's main data structure. See SanityCheck() for the invariants that apply to it.
-    Index m_index;
+    //! Storage for the announcements. See SanityCheck() for the invariants that apply to it.
+    std::vector<Announcement> m_announcements;
+
+    //! Positions in m_announcements that do not hold an announcement.
+    std::vector<AnnouncementIndex> m_free;
+
+    //! Map with this tracker's per-txhash entries.
+    std::unordered_map<uint256, TxHashEntry, SaltedTxidHasher> m_txhashes;
 
-    //! Map with this tracker's per-peer statistics.
-    std::unordered_map<NodeId, PeerInfo> m_peerinfo;
+    //! Map with this tracker's per-peer entries.
+    std::unordered_map<NodeId, PeerEntry> m_peers;
+
+    //! Timing wheel with the IsWaiting() announcements.
+    std::vector<std::vector<AnnouncementIndex>> m_wheel = std::vector<std::vector<AnnouncementIndex>>(WHEEL_SIZE);
+
+    //! The tick up to which the timing wheel was scanned.
+    int64_t m_wheel_tick{std::numeric_limits<int64_t>::min()};
+
+    //! Upper bound on the time of IsSelectable() announcements, to detect when time went backwards.
+    std::chrono::microseconds m_max_selectable_time{std::chrono::microseconds::min()};
+
+    //! Find the announcement for a txhash from a peer, if any.
+    AnnouncementIndex Find(const TxHashEntry& entry, NodeId peer) const
+    {
+        for (const auto& [ann_peer, index] : entry.m_announcements) {
+            if (ann_peer == peer) return index;
+        }
+        return NO_ANNOUNCEMENT;
+    }
+
+    AnnouncementIndex Find(NodeId peer, const uint256& txhash) const
+    {
+        const auto it = m_txhashes.find(txhash);
+        return it == m_txhashes.end() ? NO_ANNOUNCEMENT : Find(it->second, peer);
+    }
 
 public:
     void SanityCheck() const
     {
-        // Recompute m_peerdata from m_index. This verifies the data in it as it should just be caching statistics
-        // on m_index. It also verifies the invariant that no PeerInfo announcements with m_total==0 exist.
-        assert(m_peerinfo == RecomputePeerInfo(m_index));
-
-        // Calculate per-txhash statistics from m_index, and validate invariants.
-        for (auto& item : ComputeTxHashInfo(m_index, m_computer)) {
+        // Recompute the PeerInfo objects from m_announcements. This verifies the data in them as they should just be
+        // caching statistics on m_announcements. It also verifies the invariant that no PeerEntry with m_total==0
+        // exists.
+        std::unordered_map<NodeId, PeerInfo> peerinfo;
+        for (const auto& [peer, entry] : m_peers) peerinfo.emplace(peer, entry.m_info);
+        assert(peerinfo == RecomputePeerInfo(m_announcements));
+
+        // Calculate per-txhash statistics from m_announcements, and validate invariants.
+        auto txhashinfo = ComputeTxHashInfo(m_announcements, m_computer);
+        for (auto& item : txhashinfo) {
             TxHashInfo& info = item.second;
 
             // Cannot have only COMPLETED peer (txhash should have been forgotten already)
@@ -353,11 +388,57 @@ public:
             std::sort(info.m_peers.begin(), info.m_peers.end());
             assert(std::adjacent_find(info.m_peers.begin(), info.m_peers.end()) == info.m_peers.end());
         }
+
+        // Verify the entries and the timing wheel against the announcements they refer to.
+        assert(m_txhashes.size() == txhashinfo.size());
+        size_t size{0}, waiting{0};
+        for (const auto& [txhash, entry] : m_txhashes) {
+            const TxHashInfo& info = txhashinfo.at(txhash);
+            assert(entry.m_announcements.size() == info.m_peers.size());
+            assert(entry.m_non_completed == info.m_candidate_delayed + info.m_candidate_ready + info.m_candidate_best + info.m_requested);
+            assert((entry.m_selected != NO_ANNOUNCEMENT) == (info.m_candidate_best + info.m_requested == 1));
+            for (uint32_t pos = 0; pos < entry.m_announcements.size(); ++pos) {
+                const auto& [peer, index] = entry.m_announcements[pos];
+                const Announcement& ann = m_announcements.at(index);
+                assert(ann.InUse() && ann.m_txhash == txhash && ann.m_peer == peer);
+                assert(ann.m_txhash_entry == &entry && ann.m_txhash_pos == pos);
+                assert(ann.m_priority == m_computer(ann));
+                assert(ann.IsSelected() == (entry.m_selected == index));
+                if (ann.IsSelectable()) assert(ann.m_time <= m_max_selectable_time);
+                if (ann.IsWaiting()) {
+                    assert(m_wheel.at(ann.m_wheel_bucket).at(ann.m_wheel_pos) == index);
+                    const int64_t tick{WheelTick(ann.m_time)};
+                    assert(ann.m_wheel_bucket == WheelBucket(std::max(tick, m_wheel_tick)));
+                    ++waiting;
+                }
+                ++size;
+            }
+        }
+        for (const auto& [peer, entry] : m_peers) {
+            assert(entry.m_announcements.size() == entry.m_info.m_total);
+            for (uint32_t pos = 0; pos < entry.m_announcements.size(); ++pos) {
+                const Announcement& ann = m_announcements.at(entry.m_announcements[pos]);
+                assert(ann.m_peer == peer && ann.m_peer_entry == &entry && ann.m_peer_pos == pos);
+            }
+            for (uint32_t pos = 0; pos < entry.m_best.size(); ++pos) {
+                const Announcement& ann = m_announcements.at(entry.m_best[pos]);
+                assert(ann.m_peer == peer && ann.GetState() == State::CANDIDATE_BEST && ann.m_best_pos == pos);
+            }
+        }
+        size_t best{0};
+        for (const Announcement& ann : m_announcements) best += ann.InUse() && ann.GetState() == State::CANDIDATE_BEST;
+        for (const auto& [peer, entry] : m_peers) best -= entry.m_best.size();
+        assert(best == 0);
+        for (const auto& bucket : m_wheel) waiting -= bucket.size();
+        assert(waiting == 0);
+        assert(size == Size());
+        for (const AnnouncementIndex index : m_free) assert(!m_announcements.at(index).InUse());
     }
 
     void PostGetRequestableSanityCheck(std::chrono::microseconds now) const
     {
-        for (const Announcement& ann : m_index) {
+        for (const Announcement& ann : m_announcements) {
+            if (!ann.InUse()) continue;
             if (ann.IsWaiting()) {
                 // REQUESTED and CANDIDATE_DELAYED must have a time in the future (they should have been converted
                 // to COMPLETED/CANDIDATE_READY respectively).
@@ -371,116 +452,144 @@ public:
     }
 
 private:
-    //! Wrapper around Index::...::erase that keeps m_peerinfo up to date.
-    template<typename Tag>
-    Iter<Tag> Erase(Iter<Tag> it)
+    //! Add an announcement to the entries and the timing wheel, according to its state.
+    void Link(AnnouncementIndex index)
     {
-        auto peerit = m_peerinfo.find(it->m_peer);
-        peerit->second.m_completed -= it->GetState() == State::COMPLETED;
-        peerit->second.m_requested -= it->GetState() == State::REQUESTED;
-        if (--peerit->second.m_total == 0) m_peerinfo.erase(peerit);
-        return m_index.get<Tag>().erase(it);
+        Announcement& ann = m_announcements[index];
+        PeerEntry& peer = *ann.m_peer_entry;
+        TxHashEntry& entry = *ann.m_txhash_entry;
+        peer.m_info.m_completed += ann.GetState() == State::COMPLETED;
+        peer.m_info.m_requested += ann.GetState() == State::REQUESTED;
+        entry.m_non_completed += ann.GetState() != State::COMPLETED;
+        if (ann.IsSelected()) {
+            assert(entry.m_selected == NO_ANNOUNCEMENT);
+            entry.m_selected = index;
+        }
+        if (ann.GetState() == State::CANDIDATE_BEST) {
+            ann.m_best_pos = peer.m_best.size();
+            peer.m_best.push_back(index);
+        }
+        if (ann.IsWaiting()) {
+            // Announcements with a time before the last scanned tick go in its bucket, to be found on the next scan.
+            ann.m_wheel_bucket = WheelBucket(std::max(WheelTick(ann.m_time), m_wheel_tick));
+            ann.m_wheel_pos = m_wheel[ann.m_wheel_bucket].size();
+            m_wheel[ann.m_wheel_bucket].push_back(index);
+        }
+        if (ann.IsSelectable()) m_max_selectable_time = std::max(m_max_selectable_time, ann.m_time);
     }
 
-    //! Wrapper around Index::...::modify that keeps m_peerinfo up to date.
-    template<typename Tag, typename Modifier>
-    void Modify(Iter<Tag> it, Modifier modifier)
+    //! Remove an announcement from the entries and the timing wheel, according to its state.
+    void Unlink(AnnouncementIndex index)
     {
-        auto peerit = m_peerinfo.find(it->m_peer);
-        peerit->second.m_completed -= it->GetState() == State::COMPLETED;
-        peerit->second.m_requested -= it->GetState() == State::REQUESTED;
-        m_index.get<Tag>().modify(it, std::move(modifier));
-        peerit->second.m_completed += it->GetState() == State::COMPLETED;
-        peerit->second.m_requested += it->GetState() == State::REQUESTED;
+        Announcement& ann = m_announcements[index];
+        PeerEntry& peer = *ann.m_peer_entry;
+        TxHashEntry& entry = *ann.m_txhash_entry;
+        peer.m_info.m_completed -= ann.GetState() == State::COMPLETED;
+        peer.m_info.m_requested -= ann.GetState() == State::REQUESTED;
+        entry.m_non_completed -= ann.GetState() != State::COMPLETED;
+        if (ann.IsSelected()) entry.m_selected = NO_ANNOUNCEMENT;
+        if (ann.GetState() == State::CANDIDATE_BEST) {
+            if (const auto moved = SwapRemove(peer.m_best, ann.m_best_pos)) m_announcements[*moved].m_best_pos = ann.m_best_pos;
+        }
+        if (ann.IsWaiting()) {
+            if (const auto moved = SwapRemove(m_wheel[ann.m_wheel_bucket], ann.m_wheel_pos)) m_announcements[*moved].m_wheel_pos = ann.m_wheel_pos;
+        }
+    }
+
+    //! Delete an announcement, and the entries of its txhash and peer if it was their last one.
+    void Erase(AnnouncementIndex index)
+    {
+        Unlink(index);
+        Announcement& ann = m_announcements[index];
+        TxHashEntry& entry = *ann.m_txhash_entry;
+        PeerEntry& peer = *ann.m_peer_entry;
+        if (const auto moved = SwapRemove(entry.m_announcements, ann.m_txhash_pos)) m_announcements[moved->second].m_txhash_pos = ann.m_txhash_pos;
+        if (const auto moved = SwapRemove(peer.m_announcements, ann.m_peer_pos)) m_announcements[*moved].m_peer_pos = ann.m_peer_pos;
+        if (entry.m_announcements.empty()) m_txhashes.erase(ann.m_txhash);
+        if (--peer.m_info.m_total == 0) m_peers.erase(ann.m_peer);
+        ann.m_txhash_entry = nullptr;
+        ann.m_peer_entry = nullptr;
+        m_free.push_back(index);
+    }
+
+    //! Modify an announcement, keeping the entries and the timing wheel up to date.
+    template<typename Modifier>
+    void Modify(AnnouncementIndex index, Modifier modifier)
+    {
+        Unlink(index);
+        modifier(m_announcements[index]);
+        Link(index);
     }
 
     //! Convert a CANDIDATE_DELAYED announcement into a CANDIDATE_READY. If this makes it the new best
     //! CANDIDATE_READY (and no REQUESTED exists) and better than the CANDIDATE_BEST (if any), it becomes the new
     //! CANDIDATE_BEST.
-    void PromoteCandidateReady(Iter<ByTxHash> it)
+    void PromoteCandidateReady(AnnouncementIndex index)
     {
-        assert(it != m_index.get<ByTxHash>().end());
-        assert(it->GetState() == State::CANDIDATE_DELAYED);
-        // Convert CANDIDATE_DELAYED to CANDIDATE_READY first.
-        Modify<ByTxHash>(it, [](Announcement& ann){ ann.SetState(State::CANDIDATE_READY); });
-        // The following code relies on the fact that the ByTxHash is sorted by txhash, and then by state (first
-        // _DELAYED, then _READY, then _BEST/REQUESTED). Within the _READY announcements, the best one (highest
-        // priority) comes last. Thus, if an existing _BEST exists for the same txhash that this announcement may
-        // be preferred over, it must immediately follow the newly created _READY.
-        auto it_next = std::next(it);
-        if (it_next == m_index.get<ByTxHash>().end() || it_next->m_txhash != it->m_txhash ||
-            it_next->GetState() == State::COMPLETED) {
-            // This is the new best CANDIDATE_READY, and there is no IsSelected() announcement for this txhash
-            // already.
-            Modify<ByTxHash>(it, [](Announcement& ann){ ann.SetState(State::CANDIDATE_BEST); });
-        } else if (it_next->GetState() == State::CANDIDATE_BEST) {
-            Priority priority_old = m_computer(*it_next);
-            Priority priority_new = m_computer(*it);
-            if (priority_new > priority_old) {
-                // There is a CANDIDATE_BEST announcement already, but this one is better.
-                Modify<ByTxHash>(it_next, [](Announcement& ann){ ann.SetState(State::CANDIDATE_READY); });
-                Modify<ByTxHash>(it, [](Announcement& ann){ ann.SetState(State::CANDIDATE_BEST); });
-            }
+        assert(m_announcements[index].GetState() == State::CANDIDATE_DELAYED);
+        const TxHashEntry& entry = *m_announcements[index].m_txhash_entry;
+        const AnnouncementIndex selected{entry.m_selected};
+        if (selected == NO_ANNOUNCEMENT) {
+            // There is no IsSelected() announcement for this txhash, and so no CANDIDATE_READY one either.
+            Modify(index, [](Announcement& ann){ ann.SetState(State::CANDIDATE_BEST); });
+            return;
+        }
+        Modify(index, [](Announcement& ann){ ann.SetState(State::CANDIDATE_READY); });
+        if (m_announcements[selected].GetState() == State::CANDIDATE_BEST &&
+            m_announcements[index].m_priority > m_announcements[selected].m_priority) {
+            // There is a CANDIDATE_BEST announcement already, but this one is better.
+            Modify(selected, [](Announcement& ann){ ann.SetState(State::CANDIDATE_READY); });
+            Modify(index, [](Announcement& ann){ ann.SetState(State::CANDIDATE_BEST); });
         }
     }
 
     //! Change the state of an announcement to something non-IsSelected(). If it was IsSelected(), the next best
     //! announcement will be marked CANDIDATE_BEST.
-    void ChangeAndReselect(Iter<ByTxHash> it, State new_state)
+    void ChangeAndReselect(AnnouncementIndex index, State new_state)
     {
         assert(new_state == State::COMPLETED || new_state == State::CANDIDATE_DELAYED);
-        assert(it != m_index.get<ByTxHash>().end());
-        if (it->IsSelected() && it != m_index.get<ByTxHash>().begin()) {
-            auto it_prev = std::prev(it);
-            // The next best CANDIDATE_READY, if any, immediately precedes the REQUESTED or CANDIDATE_BEST
-            // announcement in the ByTxHash index.
-            if (it_prev->m_txhash == it->m_txhash && it_prev->GetState() == State::CANDIDATE_READY) {
-                // If one such CANDIDATE_READY exists (for this txhash), convert it to CANDIDATE_BEST.
-                Modify<ByTxHash>(it_prev, [](Announcement& ann){ ann.SetState(State::CANDIDATE_BEST); });
+        const bool was_selected{m_announcements[index].IsSelected()};
+        Modify(index, [new_state](Announcement& ann){ ann.SetState(new_state); });
+        if (!was_selected) return;
+        // Select the best CANDIDATE_READY, if any.
+        AnnouncementIndex best{NO_ANNOUNCEMENT};
+        for (const auto& [peer, candidate] : m_announcements[index].m_txhash_entry->m_announcements) {
+            const Announcement& ann = m_announcements[candidate];
+            if (ann.GetState() == State::CANDIDATE_READY &&
+                (best == NO_ANNOUNCEMENT || ann.m_priority > m_announcements[best].m_priority)) {
+                best = candidate;
             }
         }
-        Modify<ByTxHash>(it, [new_state](Announcement& ann){ ann.SetState(new_state); });
+        if (best != NO_ANNOUNCEMENT) Modify(best, [](Announcement& ann){ ann.SetState(State::CANDIDATE_BEST); });
     }
 
-    //! Check if 'it' is the only announcement for a given txhash that isn't COMPLETED.
-    bool IsOnlyNonCompleted(Iter<ByTxHash> it)
+    //! Delete all announcements for a txhash.
+    void EraseTxHash(const TxHashEntry& entry)
     {
-        assert(it != m_index.get<ByTxHash>().end());
-        assert(it->GetState() != State::COMPLETED); // Not allowed to call this on COMPLETED announcements.
-
-        // This announcement has a predecessor that belongs to the same txhash. Due to ordering, and the
-        // fact that 'it' is not COMPLETED, its predecessor cannot be COMPLETED here.
-        if (it != m_index.get<ByTxHash>().begin() && std::prev(it)->m_txhash == it->m_txhash) return false;
-
-        // This announcement has a successor that belongs to the same txhash, and is not COMPLETED.
-        if (std::next(it) != m_index.get<ByTxHash>().end() && std::next(it)->m_txhash == it->m_txhash &&
-            std::next(it)->GetState() != State::COMPLETED) return false;
-
-        return true;
+        // Copy the announcements, as the entry is deleted with the last one.
+        const auto announcements{entry.m_announcements};
+        for (const auto& [peer, index] : announcements) Erase(index);
     }
 
     /** Convert any announcement to a COMPLETED one. If there are no non-COMPLETED announcements left for this
      *  txhash, they are deleted. If this was a REQUESTED announcement, and there are other CANDIDATEs left, the
      *  best one is made CANDIDATE_BEST. Returns whether the announcement still exists. */
-    bool MakeCompleted(Iter<ByTxHash> it)
+    bool MakeCompleted(AnnouncementIndex index)
     {
-        assert(it != m_index.get<ByTxHash>().end());
+        const Announcement& ann = m_announcements[index];
 
         // Nothing to be done if it's already COMPLETED.
-        if (it->GetState() == State::COMPLETED) return true;
+        if (ann.GetState() == State::COMPLETED) return true;
 
-        if (IsOnlyNonCompleted(it)) {
+        if (ann.m_txhash_entry->m_non_completed == 1) {
             // This is the last non-COMPLETED announcement for this txhash. Delete all.
-            uint256 txhash = it->m_txhash;
-            do {
-                it = Erase<ByTxHash>(it);
-            } while (it != m_index.get<ByTxHash>().end() && it->m_txhash == txhash);
+            EraseTxHash(*ann.m_txhash_entry);
             return false;
         }
 
         // Mark the announcement COMPLETED, and select the next best announcement (the first CANDIDATE_READY) if
         // needed.
-        ChangeAndReselect(it, State::COMPLETED);
+        ChangeAndReselect(index, State::COMPLETED);
 
         return true;
     }
@@ -493,102 +602,121 @@ private:
     {
         if (expired) expired->clear();
 
-        // Iterate over all CANDIDATE_DELAYED and REQUESTED from old to new, as long as they're in the past,
-        // and convert them to CANDIDATE_READY and COMPLETED respectively.
-        while (!m_index.empty()) {
-            auto it = m_index.get<ByTime>().begin();
-            if (it->GetState() == State::CANDIDATE_DELAYED && it->m_time <= now) {
-                PromoteCandidateReady(m_index.project<ByTxHash>(it));
-            } else if (it->GetState() == State::REQUESTED && it->m_time <= now) {
-                if (expired) expired->emplace_back(it->m_peer, ToGenTxid(*it));
-                MakeCompleted(m_index.project<ByTxHash>(it));
+        // Find the CANDIDATE_DELAYED and REQUESTED announcements that are in the past, in the buckets of the ticks
+        // up to now.
+        std::vector<AnnouncementIndex> due;
+        const auto scan = [&](uint32_t bucket) {
+            for (const AnnouncementIndex index : m_wheel[bucket]) {
+                if (m_announcements[index].m_time <= now) due.push_back(index);
+            }
+        };
+        const int64_t now_tick{WheelTick(now)};
+        if (now_tick <= m_wheel_tick) {
+            scan(WheelBucket(m_wheel_tick));
+        } else {
+            if (uint64_t(now_tick) - uint64_t(m_wheel_tick) >= WHEEL_SIZE) {
+                for (uint32_t bucket = 0; bucket < WHEEL_SIZE; ++bucket) scan(bucket);
             } else {
-                break;
+                for (int64_t tick = m_wheel_tick; tick <= now_tick; ++tick) scan(WheelBucket(tick));
             }
+            m_wheel_tick = now_tick;
         }
 
-        while (!m_index.empty()) {
+        // Convert them to CANDIDATE_READY and COMPLETED respectively. The order does not matter: promotions do not
+        // affect other CANDIDATE_DELAYED or REQUESTED announcements, and expiries only delete the announcements of
+        // a txhash that has no other non-COMPLETED ones.
+        for (const AnnouncementIndex index : due) {
+            const Announcement& ann = m_announcements[index];
+            if (ann.GetState() == State::CANDIDATE_DELAYED) {
+                PromoteCandidateReady(index);
+            } else {
+                assert(ann.GetState() == State::REQUESTED);
+                if (expired) expired->emplace_back(ann.m_peer, ToGenTxid(ann));
+                MakeCompleted(index);
+            }
+        }
+
+        if (now < m_max_selectable_time) {
             // If time went backwards, we may need to demote CANDIDATE_BEST and CANDIDATE_READY announcements back
             // to CANDIDATE_DELAYED. This is an unusual edge case, and unlikely to matter in production. However,
             // it makes it much easier to specify and test TxRequestTracker::Impl's behaviour.
-            auto it = std::prev(m_index.get<ByTime>().end());
-            if (it->IsSelectable() && it->m_time > now) {
-                ChangeAndReselect(m_index.project<ByTxHash>(it), State::CANDIDATE_DELAYED);
-            } else {
-                break;
+            std::vector<AnnouncementIndex> demote;
+            m_max_selectable_time = std::chrono::microseconds::min();
+            for (AnnouncementIndex index = 0; index < m_announcements.size(); ++index) {
+                const Announcement& ann = m_announcements[index];
+                if (!ann.InUse() || !ann.IsSelectable()) continue;
+                if (ann.m_time > now) {
+                    demote.push_back(index);
+                } else {
+                    m_max_selectable_time = std::max(m_max_selectable_time, ann.m_time);
+                }
             }
+            for (const AnnouncementIndex index : demote) ChangeAndReselect(index, State::CANDIDATE_DELAYED);
+            // Announcements that were selected in between are still tracked, but all have a time <= now.
+            m_max_selectable_time = std::min(m_max_selectable_time, now);
         }
     }
 
 public:
     explicit Impl(bool deterministic) :
-        m_computer(deterministic),
-        // Explicitly initialize m_index as we need to pass a reference to m_computer to ByTxHashViewExtractor.
-        m_index(boost::make_tuple(
-            boost::make_tuple(ByPeerViewExtractor(), std::less<ByPeerView>()),
-            boost::make_tuple(ByTxHashViewExtractor(m_computer), std::less<ByTxHashView>()),
-            boost::make_tuple(ByTimeViewExtractor(), std::less<ByTimeView>())
-        )) {}
-
-    // Disable copying and assigning (a default copy won't work due the stateful ByTxHashViewExtractor).
+        m_computer(deterministic) {}
+
+    // Disable copying and assigning (entries point into each other).
     Impl(const Impl&) = delete;
     Impl& operator=(const Impl&) = delete;
 
     void DisconnectedPeer(NodeId peer)
     {
-        auto& index = m_index.get<ByPeer>();
-        auto it = index.lower_bound(ByPeerView{peer, false, uint256::ZERO});
-        while (it != index.end() && it->m_peer == peer) {
-            // Check what to continue with after this iteration. 'it' will be deleted in what follows, so we need to
-            // decide what to continue with afterwards. There are a number of cases to consider:
-            // - std::next(it) is end() or belongs to a different peer. In that case, this is the last iteration
-            //   of the loop (denote this by setting it_next to end()).
-            // - 'it' is not the only non-COMPLETED announcement for its txhash. This means it will be deleted, but
-            //   no other Announcement objects will be modified. Continue with std::next(it) if it belongs to the
-            //   same peer, but decide this ahead of time (as 'it' may change position in what follows).
-            // - 'it' is the only non-COMPLETED announcement for its txhash. This means it will be deleted along
-            //   with all other announcements for the same txhash - which may include std::next(it). However, other
-            //   than 'it', no announcements for the same peer can be affected (due to (peer, txhash) uniqueness).
-            //   In other words, the situation where std::next(it) is deleted can only occur if std::next(it)
-            //   belongs to a different peer but the same txhash as 'it'. This is covered by the first bulletpoint
-            //   already, and we'll have set it_next to end().
-            auto it_next = (std::next(it) == index.end() || std::next(it)->m_peer != peer) ? index.end() :
-                std::next(it);
+        const auto it = m_peers.find(peer);
+        if (it == m_peers.end()) return;
+        // Copy the announcements, as the entry is deleted with the last one. Making one COMPLETED may delete all
+        // announcements for its txhash, but no other announcement from this peer (due to (peer, txhash) uniqueness).
+        const auto announcements{it->second.m_announcements};
+        for (const AnnouncementIndex index : announcements) {
             // If the announcement isn't already COMPLETED, first make it COMPLETED (which will mark other
             // CANDIDATEs as CANDIDATE_BEST, or delete all of a txhash's announcements if no non-COMPLETED ones are
             // left).
-            if (MakeCompleted(m_index.project<ByTxHash>(it))) {
+            if (MakeCompleted(index)) {
                 // Then actually delete the announcement (unless it was already deleted by MakeCompleted).
-                Erase<ByPeer>(it);
+                Erase(index);
             }
-            it = it_next;
         }
     }
 
     void ForgetTxHash(const uint256& txhash)
     {
-        auto it = m_index.get<ByTxHash>().lower_bound(ByTxHashView{txhash, State::CANDIDATE_DELAYED, 0});
-        while (it != m_index.get<ByTxHash>().end() && it->m_txhash == txhash) {
-            it = Erase<ByTxHash>(it);
-        }
+        const auto it = m_txhashes.find(txhash);
+        if (it != m_txhashes.end()) EraseTxHash(it->second);
     }
 
     void ReceivedInv(NodeId peer, const GenTxid& gtxid, bool preferred,
         std::chrono::microseconds reqtime)
     {
-        // Bail out if we already have a CANDIDATE_BEST announcement for this (txhash, peer) combination. The case
-        // where there is a non-CANDIDATE_BEST announcement already will be caught by the uniqueness property of the
-        // ByPeer index when we try to emplace the new object below.
-        if (m_index.get<ByPeer>().count(ByPeerView{peer, true, gtxid.GetHash()})) return;
-
-        // Try creating the announcement with CANDIDATE_DELAYED state (which will fail due to the uniqueness
-        // of the ByPeer index if a non-CANDIDATE_BEST announcement already exists with the same txhash and peer).
-        // Bail out in that case.
-        auto ret = m_index.get<ByPeer>().emplace(gtxid, peer, preferred, reqtime, m_current_sequence);
-        if (!ret.second) return;
+        // Bail out if we already have an announcement for this (txhash, peer) combination.
+        auto& entry = m_txhashes.try_emplace(gtxid.GetHash()).first->second;
+        if (Find(entry, peer) != NO_ANNOUNCEMENT) return;
+
+        // Create the announcement with CANDIDATE_DELAYED state.
+        auto& peer_entry = m_peers.try_emplace(peer).first->second;
+        const Priority priority{m_computer(gtxid.GetHash(), peer, preferred)};
+        AnnouncementIndex index;
+        if (m_free.empty()) {
+            index = m_announcements.size();
+            m_announcements.emplace_back(gtxid, peer, preferred, reqtime, m_current_sequence, priority, entry, peer_entry);
+        } else {
+            index = m_free.back();
+            m_free.pop_back();
+            m_announcements[index] = Announcement{gtxid, peer, preferred, reqtime, m_current_sequence, priority, entry, peer_entry};
+        }
+        Announcement& ann = m_announcements[index];
+        ann.m_txhash_pos = entry.m_announcements.size();
+        entry.m_announcements.emplace_back(peer, index);
+        ann.m_peer_pos = peer_entry.m_announcements.size();
+        peer_entry.m_announcements.push_back(index);
+        Link(index);
 
         // Update accounting metadata.
-        ++m_peerinfo[peer].m_total;
+        ++peer_entry.m_info.m_total;
         ++m_current_sequence;
     }
 
@@ -600,13 +728,11 @@ public:
         SetTimePoint(now, expired);
 
         // Find all CANDIDATE_BEST announcements for this peer.
+        const auto it = m_peers.find(peer);
+        if (it == m_peers.end()) return {};
         std::vector<const Announcement*> selected;
-        auto it_peer = m_index.get<ByPeer>().lower_bound(ByPeerView{peer, true, uint256::ZERO});
-        while (it_peer != m_index.get<ByPeer>().end() && it_peer->m_peer == peer &&
-            it_peer->GetState() == State::CANDIDATE_BEST) {
-            selected.emplace_back(&*it_peer);
-            ++it_peer;
-        }
+        selected.reserve(it->second.m_best.size());
+        for (const AnnouncementIndex index : it->second.m_best) selected.push_back(&m_announcements[index]);
 
         // Sort by sequence number.
         std::sort(selected.begin(), selected.end(), [](const Announcement* a, const Announcement* b) {
@@ -624,16 +750,15 @@ public:
 
     void RequestedTx(NodeId peer, const uint256& txhash, std::chrono::microseconds expiry)
     {
-        auto it = m_index.get<ByPeer>().find(ByPeerView{peer, true, txhash});
-        if (it == m_index.get<ByPeer>().end()) {
+        const AnnouncementIndex index{Find(peer, txhash)};
+        if (index == NO_ANNOUNCEMENT) return;
+        const Announcement& found = m_announcements[index];
+        if (found.GetState() != State::CANDIDATE_BEST) {
             // There is no CANDIDATE_BEST announcement, look for a _READY or _DELAYED instead. If the caller only
             // ever invokes RequestedTx with the values returned by GetRequestable, and no other non-const functions
             // other than ForgetTxHash and GetRequestable in between, this branch will never execute (as txhashes
             // returned by GetRequestable always correspond to CANDIDATE_BEST announcements).
-
-            it = m_index.get<ByPeer>().find(ByPeerView{peer, false, txhash});
-            if (it == m_index.get<ByPeer>().end() || (it->GetState() != State::CANDIDATE_DELAYED &&
-                                                      it->GetState() != State::CANDIDATE_READY)) {
+            if (found.GetState() != State::CANDIDATE_DELAYED && found.GetState() != State::CANDIDATE_READY) {
                 // There is no CANDIDATE announcement tracked for this peer, so we have nothing to do. Either this
                 // txhash wasn't tracked at all (and the caller should have called ReceivedInv), or it was already
                 // requested and/or completed for other reasons and this is just a superfluous RequestedTx call.
@@ -643,25 +768,25 @@ public:
             // Look for an existing CANDIDATE_BEST or REQUESTED with the same txhash. We only need to do this if the
             // found announcement had a different state than CANDIDATE_BEST. If it did, invariants guarantee that no
             // other CANDIDATE_BEST or REQUESTED can exist.
-            auto it_old = m_index.get<ByTxHash>().lower_bound(ByTxHashView{txhash, State::CANDIDATE_BEST, 0});
-            if (it_old != m_index.get<ByTxHash>().end() && it_old->m_txhash == txhash) {
-                if (it_old->GetState() == State::CANDIDATE_BEST) {
+            const AnnouncementIndex old{found.m_txhash_entry->m_selected};
+            if (old != NO_ANNOUNCEMENT) {
+                if (m_announcements[old].GetState() == State::CANDIDATE_BEST) {
                     // The data structure's invariants require that there can be at most one CANDIDATE_BEST or one
                     // REQUESTED announcement per txhash (but not both simultaneously), so we have to convert any
                     // existing CANDIDATE_BEST to another CANDIDATE_* when constructing another REQUESTED.
                     // It doesn't matter whether we pick CANDIDATE_READY or _DELAYED here, as SetTimePoint()
                     // will correct it at GetRequestable() time. If time only goes forward, it will always be
                     // _READY, so pick that to avoid extra work in SetTimePoint().
-                    Modify<ByTxHash>(it_old, [](Announcement& ann) { ann.SetState(State::CANDIDATE_READY); });
-                } else if (it_old->GetState() == State::REQUESTED) {
+                    Modify(old, [](Announcement& ann) { ann.SetState(State::CANDIDATE_READY); });
+                } else {
                     // As we're no longer waiting for a response to the previous REQUESTED announcement, convert it
                     // to COMPLETED. This also helps guaranteeing progress.
-                    Modify<ByTxHash>(it_old, [](Announcement& ann) { ann.SetState(State::COMPLETED); });
+                    Modify(old, [](Announcement& ann) { ann.SetState(State::COMPLETED); });
                 }
             }
         }
 
-        Modify<ByPeer>(it, [expiry](Announcement& ann) {
+        Modify(index, [expiry](Announcement& ann) {
             ann.SetState(State::REQUESTED);
             ann.m_time = expiry;
         });
@@ -669,37 +794,33 @@ public:
 
     void ReceivedResponse(NodeId peer, const uint256& txhash)
     {
-        // We need to search the ByPeer index for both (peer, false, txhash) and (peer, true, txhash).
-        auto it = m_index.get<ByPeer>().find(ByPeerView{peer, false, txhash});
-        if (it == m_index.get<ByPeer>().end()) {
-            it = m_index.get<ByPeer>().find(ByPeerView{peer, true, txhash});
-        }
-        if (it != m_index.get<ByPeer>().end()) MakeCompleted(m_index.project<ByTxHash>(it));
+        const AnnouncementIndex index{Find(peer, txhash)};
+        if (index != NO_ANNOUNCEMENT) MakeCompleted(index);
     }
 
     size_t CountInFlight(NodeId peer) const
     {
-        auto it = m_peerinfo.find(peer);
-        if (it != m_peerinfo.end()) return it->second.m_requested;
+        auto it = m_peers.find(peer);
+        if (it != m_peers.end()) return it->second.m_info.m_requested;
         return 0;
     }
 
     size_t CountCandidates(NodeId peer) const
     {
-        auto it = m_peerinfo.find(peer);
-        if (it != m_peerinfo.end()) return it->second.m_total - it->second.m_requested - it->second.m_completed;
+        auto it = m_peers.find(peer);
+        if (it != m_peers.end()) return it->second.m_info.m_total - it->second.m_info.m_requested - it->second.m_info.m_completed;
         return 0;
     }
 
     size_t Count(NodeId peer) const
     {
-        auto it = m_peerinfo.find(peer);
-        if (it != m_peerinfo.end()) return it->second.m_total;
+        auto it = m_peers.find(peer);
+        if (it != m_peers.end()) return it->second.m_info.m_total;
         return 0;
     }
 
     //! Count how many announcements are being tracked in total across all peers and transactions.
-    size_t Size() const { return m_index.size(); }
+    size_t Size() const { return m_announcements.size() - m_free.size(); }
 
     uint64_t ComputePriority(const uint256& txhash, NodeId peer, bool preferred) const
     {
@@ -90,8 +90,10 @@
  * Complexity:
  * - Memory usage is proportional to the total number of tracked announcements (Size()) plus the number of
  *   peers with a nonzero number of tracked announcements.
- * - CPU usage is generally logarithmic in the total number of tracked announcements, plus the number of
- *   announcements affected by an operation (amortized O(1) per announcement).
+ * - CPU usage is generally proportional to the number of announcements affected by an operation, plus the number of
+ *   announcements for the txhashes involved (which is bounded by the number of peers). Moving time forward costs the
+ *   announcements whose reqtime or expiry passed, plus one step per 65.5ms that passed (up to 1024). Moving time
+ *   backwards past a CANDIDATE_READY reqtime costs O(Size()), which does not happen with a monotonic clock.
  */
 class TxRequestTracker {
     // Avoid littering this header file with implementation details.
@@ -9,6 +9,7 @@
 #include <logging.h>
 #include <streams.h>
 
+#include <algorithm>
 #include <cassert>
 #include <map>
 #include <vector>
@@ -126,6 +127,110 @@ uint32_t Interpret(const std::vector<bool> &asmap, const std::vector<bool> &ip)
     return 0; // 0 is not a valid ASN
 }
 
+namespace {
+
+/** count bits of ip starting at bit, most significant first, for count <= 8 */
+uint32_t GetBits(Span<const uint8_t> ip, size_t bit, uint8_t count)
+{
+    const size_t byte{bit / 8};
+    uint32_t window = uint32_t{ip[byte]} << 8;
+    if (byte + 1 < ip.size()) window |= ip[byte + 1];
+    return (window >> (16 - bit % 8 - count)) & ((1U << count) - 1);
+}
+
+}
+
+CompiledAsmap::CompiledAsmap(const std::vector<bool>& asmap)
+{
+    const std::vector<bool>::const_iterator begin = asmap.begin(), endpos = asmap.end();
+    std::vector<bool>::const_iterator pos = begin;
+    std::vector<uint32_t> offsets; // Bit offset in asmap of each instruction
+    // A sane asmap can be decoded from start to end, up to its zero padding.
+    while (pos != endpos) {
+        const uint32_t offset = pos - begin;
+        const Instruction opcode = DecodeType(pos, endpos);
+        uint32_t arg{INVALID};
+        uint8_t match_len{0};
+        if (opcode == Instruction::RETURN || opcode == Instruction::DEFAULT) {
+            arg = DecodeASN(pos, endpos);
+        } else if (opcode == Instruction::JUMP) {
+            arg = DecodeJump(pos, endpos);
+            if (arg != INVALID) arg += pos - begin; // Bit offset of the target, resolved below
+        } else if (opcode == Instruction::MATCH) {
+            arg = DecodeMatch(pos, endpos);
+            if (arg != INVALID) match_len = CountBits(arg) - 1;
+        }
+        if (arg == INVALID) break; // Padding
+        offsets.push_back(offset);
+        m_instructions.push_back({arg, static_cast<uint8_t>(opcode), match_len});
+    }
+    for (auto& instruction : m_instructions) {
+        if (Instruction{instruction.m_type} != Instruction::JUMP) continue;
+        const auto it = std::lower_bound(offsets.begin(), offsets.end(), instruction.m_arg);
+        if (it == offsets.end() || *it != instruction.m_arg) {
+            // Not a sane asmap
+            m_instructions.clear();
+            return;
+        }
+        instruction.m_arg = it - offsets.begin();
+    }
+    if (m_instructions.empty()) return;
+
+    // Most lookups start with the same few jumps, so interpret them once for
+    // every value of the first byte of an IP.
+    m_first_byte.resize(256);
+    for (size_t byte = 0; byte < m_first_byte.size(); ++byte) {
+        const uint8_t ip{static_cast<uint8_t>(byte)};
+        State& state = m_first_byte[byte];
+        if (auto asn = Run(Span{&ip, 1}, state)) {
+            state.m_done = true;
+            state.m_default_asn = *asn;
+        }
+    }
+}
+
+std::optional<uint32_t> CompiledAsmap::Run(Span<const uint8_t> ip, State& state) const
+{
+    const size_t ip_bits{ip.size() * 8};
+    while (state.m_instruction < m_instructions.size()) {
+        const DecodedInstruction& instruction = m_instructions[state.m_instruction];
+        const Instruction opcode{instruction.m_type};
+        if (opcode == Instruction::RETURN) {
+            return instruction.m_arg;
+        } else if (opcode == Instruction::JUMP) {
+            if (state.m_bit == ip_bits) break; // No input bits left
+            const bool bit = (ip[state.m_bit / 8] >> (7 - state.m_bit % 8)) & 1;
+            state.m_instruction = bit ? instruction.m_arg : state.m_instruction + 1;
+            ++state.m_bit;
+        } else if (opcode == Instruction::MATCH) {
+            const uint8_t matchlen{instruction.m_match_len};
+            if (ip_bits - state.m_bit < matchlen) break; // Not enough input bits
+            const uint32_t match_bits{instruction.m_arg & ((1U << matchlen) - 1)};
+            if (GetBits(ip, state.m_bit, matchlen) != match_bits) {
+                return state.m_default_asn;
+            }
+            ++state.m_instruction;
+            state.m_bit += matchlen;
+        } else {
+            state.m_default_asn = instruction.m_arg;
+            ++state.m_instruction;
+        }
+    }
+    return std::nullopt;
+}
+
+uint32_t CompiledAsmap::Interpret(Span<const uint8_t> ip) const
+{
+    State state;
+    if (!ip.empty() && !m_first_byte.empty()) {
+        state = m_first_byte[ip[0]];
+        if (state.m_done) return state.m_default_asn;
+    }
+    const std::optional<uint32_t> asn{Run(ip, state)};
+    assert(asn); // Only sane asmaps are compiled, and those return within the bits of ip
+    return *asn;
+}
+
 bool SanityCheckASMap(const std::vector<bool>& asmap, int bits)
 {
     const std::vector<bool>::const_iterator begin = asmap.begin(), endpos = asmap.end();
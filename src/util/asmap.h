@@ -6,8 +6,10 @@
 #define BITCOIN_UTIL_ASMAP_H
 
 #include <fs.h>
+#include <span.h>
 
 #include <cstdint>
+#include <optional>
 #include <vector>
 
 uint32_t Interpret(const std::vector<bool> &asmap, const std::vector<bool> &ip);
@@ -17,4 +19,55 @@ bool SanityCheckASMap(const std::vector<bool>& asmap, int bits);
 /** Read asmap from provided binary file */
 std::vector<bool> DecodeAsmap(fs::path path);
 
+/**
+ * An asmap decoded once into an array of instructions with resolved jump
+ * targets, so that looking up an IP does not walk the bit-level encoding of
+ * the asmap again. Lookups start from a table of where the interpretation
+ * stands after the first byte of the IP. An empty CompiledAsmap stands for no
+ * asmap.
+ */
+class CompiledAsmap
+{
+public:
+    CompiledAsmap() = default;
+    /** Compile an asmap that passes SanityCheckASMap(). */
+    explicit CompiledAsmap(const std::vector<bool>& asmap);
+
+    /**
+     * Same as Interpret(asmap, ip) on the asmap this was compiled from, for the
+     * IP bits given most significant first in ip. The asmap must not consume
+     * more than ip.size() * 8 bits.
+     */
+    uint32_t Interpret(Span<const uint8_t> ip) const;
+
+    bool empty() const { return m_instructions.empty(); }
+
+private:
+    struct DecodedInstruction {
+        //! ASN, jump target index or match bits, depending on m_type
+        uint32_t m_arg;
+        uint8_t m_type;
+        uint8_t m_match_len;
+    };
+    std::vector<DecodedInstruction> m_instructions;
+
+    /** Progress of interpreting an IP */
+    struct State {
+        size_t m_instruction{0};
+        //! Number of bits of the IP consumed
+        size_t m_bit{0};
+        //! The ASN returned if m_done
+        uint32_t m_default_asn{0};
+        bool m_done{false};
+    };
+    /** The state after the first byte of an IP, for each of its values */
+    std::vector<State> m_first_byte;
+
+    /**
+     * Interpret instructions from state until the ASN of ip is known, which
+     * is returned, or the next instruction needs more bits than ip has.
+     */
+    std::optional<uint32_t> Run(Span<const uint8_t> ip, State& state) const;
+};
+
 #endif // BITCOIN_UTIL_ASMAP_H
@@ -841,6 +841,7 @@ void SetSyscallSandboxPolicy(SyscallSandboxPolicy syscall_policy)
         //
         // SyscallSandboxPolicy::INITIALIZATION must thus be a superset of all
         // other policies.
+        seccomp_policy_builder.AllowEpoll();
         seccomp_policy_builder.AllowFileSystem();
         seccomp_policy_builder.AllowNetwork();
         break;
@@ -858,7 +859,8 @@ void SetSyscallSandboxPolicy(SyscallSandboxPolicy syscall_policy)
     case SyscallSandboxPolicy::MESSAGE_HANDLER: // Thread: msghand
         seccomp_policy_builder.AllowFileSystem();
         break;
-    case SyscallSandboxPolicy::NET: // Thread: net
+    case SyscallSandboxPolicy::NET: // Thread: net, net.<N>
+        seccomp_policy_builder.AllowEpoll();
         seccomp_policy_builder.AllowFileSystem();
         seccomp_policy_builder.AllowNetwork();
         break;
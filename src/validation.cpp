@@ -441,8 +441,10 @@ public:
     explicit MemPoolAccept(CTxMemPool& mempool, CChainState& active_chainstate) : m_pool(mempool), m_view(&m_dummy), m_viewmempool(&active_chainstate.CoinsTip(), m_pool), m_active_chainstate(active_chainstate),
         m_limit_ancestors(gArgs.GetIntArg("-limitancestorcount", DEFAULT_ANCESTOR_LIMIT)),
         m_limit_ancestor_size(gArgs.GetIntArg("-limitancestorsize", DEFAULT_ANCESTOR_SIZE_LIMIT)*1000),
-        m_limit_descendants(gArgs.GetIntArg("-limitdescendantcount", DEFAULT_DESCENDANT_LIMIT)),
-        m_limit_descendant_size(gArgs.GetIntArg("-limitdescendantsize", DEFAULT_DESCENDANT_SIZE_LIMIT)*1000) {
+        m_default_limit_descendants(gArgs.GetIntArg("-limitdescendantcount", DEFAULT_DESCENDANT_LIMIT)),
+        m_default_limit_descendant_size(gArgs.GetIntArg("-limitdescendantsize", DEFAULT_DESCENDANT_SIZE_LIMIT)*1000),
+        m_limit_descendants(m_default_limit_descendants),
+        m_limit_descendant_size(m_default_limit_descendant_size) {
     }
 
     // We put the arguments we're handed into a struct, so we can pass them
@@ -498,6 +500,15 @@ public:
     // Single transaction acceptance
     MempoolAcceptResult AcceptSingleTransaction(const CTransactionRef& ptx, ATMPArgs& args) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+    /**
+    * Acceptance of a batch of transactions under a single mempool lock, reusing the coins view.
+    * Each transaction is validated and submitted on its own, exactly as if
+    * AcceptSingleTransaction() had been called for each of them in order, so a failure does not
+    * affect the others. Coins pulled into the coins tip cache by a rejected transaction are
+    * uncached right away.
+    */
+    std::vector<MempoolAcceptResult> AcceptTransactionBatch(const std::vector<CTransactionRef>& txns, ATMPArgs& args) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
     /**
     * Multiple transaction acceptance. Transactions may or may not be interdependent,
     * but must not conflict with each other. Parents must come before children if any
@@ -602,6 +613,8 @@ private:
     // The package limits in effect at the time of invocation.
     const size_t m_limit_ancestors;
     const size_t m_limit_ancestor_size;
+    const size_t m_default_limit_descendants;
+    const size_t m_default_limit_descendant_size;
     // These may be modified while evaluating a transaction (eg to account for
     // in-mempool conflicts; see below).
     size_t m_limit_descendants;
@@ -1033,6 +1046,34 @@ MempoolAcceptResult MemPoolAccept::AcceptSingleTransaction(const CTransactionRef
     return MempoolAcceptResult::Success(std::move(ws.m_replaced_transactions), ws.m_vsize, ws.m_base_fees);
 }
 
+std::vector<MempoolAcceptResult> MemPoolAccept::AcceptTransactionBatch(const std::vector<CTransactionRef>& txns, ATMPArgs& args)
+{
+    AssertLockHeld(cs_main);
+    LOCK(m_pool.cs);
+
+    std::vector<MempoolAcceptResult> results;
+    results.reserve(txns.size());
+    for (const CTransactionRef& ptx : txns) {
+        results.push_back(AcceptSingleTransaction(ptx, args));
+        if (results.back().m_result_type != MempoolAcceptResult::ResultType::VALID) {
+            for (const COutPoint& outpoint : args.m_coins_to_uncache) {
+                m_active_chainstate.CoinsTip().Uncache(outpoint);
+            }
+        }
+        args.m_coins_to_uncache.clear();
+
+        // Drop the state this transaction left behind, so that the next one sees the mempool as
+        // updated by it (spent or replaced inputs) rather than stale cached coins.
+        for (const CTxIn& txin : ptx->vin) {
+            m_view.Uncache(txin.prevout);
+        }
+        m_rbf = false;
+        m_limit_descendants = m_default_limit_descendants;
+        m_limit_descendant_size = m_default_limit_descendant_size;
+    }
+    return results;
+}
+
 PackageMempoolAcceptResult MemPoolAccept::AcceptMultipleTransactions(const std::vector<CTransactionRef>& txns, ATMPArgs& args)
 {
     AssertLockHeld(cs_main);
@@ -1117,6 +1158,20 @@ MempoolAcceptResult AcceptToMemoryPool(CTxMemPool& pool, CChainState& active_cha
     return result;
 }
 
+std::vector<MempoolAcceptResult> AcceptToMemoryPoolBatch(CTxMemPool& pool, CChainState& active_chainstate,
+                                                         const std::vector<CTransactionRef>& txns, int64_t accept_time)
+{
+    AssertLockHeld(cs_main);
+    const CChainParams& chainparams{active_chainstate.m_params};
+    std::vector<COutPoint> coins_to_uncache;
+    auto args = MemPoolAccept::ATMPArgs::SingleAccept(chainparams, accept_time, /* bypass_limits */ false, coins_to_uncache, /* test_accept */ false);
+    std::vector<MempoolAcceptResult> results = MemPoolAccept(pool, active_chainstate).AcceptTransactionBatch(txns, args);
+    // After we've (potentially) uncached entries, ensure our coins cache is still within its size limits
+    BlockValidationState state_dummy;
+    active_chainstate.FlushStateToDisk(state_dummy, FlushStateMode::PERIODIC);
+    return results;
+}
+
 PackageMempoolAcceptResult ProcessNewPackage(CChainState& active_chainstate, CTxMemPool& pool,
                                                    const Package& package, bool test_accept)
 {
@@ -3505,6 +3560,19 @@ MempoolAcceptResult ChainstateManager::ProcessTransaction(const CTransactionRef&
     return result;
 }
 
+std::vector<MempoolAcceptResult> ChainstateManager::ProcessTransactions(const std::vector<CTransactionRef>& txns)
+{
+    CChainState& active_chainstate = ActiveChainstate();
+    if (!active_chainstate.m_mempool) {
+        TxValidationState state;
+        state.Invalid(TxValidationResult::TX_NO_MEMPOOL, "no-mempool");
+        return std::vector<MempoolAcceptResult>(txns.size(), MempoolAcceptResult::Failure(state));
+    }
+    auto results = AcceptToMemoryPoolBatch(*active_chainstate.m_mempool, active_chainstate, txns, GetTime());
+    active_chainstate.m_mempool->check(active_chainstate.CoinsTip(), active_chainstate.m_chain.Height() + 1);
+    return results;
+}
+
 bool TestBlockValidity(BlockValidationState& state,
                        const CChainParams& chainparams,
                        CChainState& chainstate,
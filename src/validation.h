@@ -226,6 +226,21 @@ MempoolAcceptResult AcceptToMemoryPool(CTxMemPool& pool, CChainState& active_cha
                                        int64_t accept_time, bool bypass_limits, bool test_accept)
     EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+/**
+ * Try to add several transactions to the mempool, one after the other, under a single mempool
+ * lock. The result is the same as calling AcceptToMemoryPool() on each transaction in order
+ * (without bypass_limits or test_accept), but the per-call setup and the coins cache flush
+ * check are only done once for the whole batch.
+ *
+ * @param[in]  txns         The transactions to submit, parents before children.
+ * @param[in]  accept_time  The timestamp for adding the transactions to the mempool.
+ *
+ * @returns a MempoolAcceptResult for each transaction, in the same order as txns.
+ */
+std::vector<MempoolAcceptResult> AcceptToMemoryPoolBatch(CTxMemPool& pool, CChainState& active_chainstate,
+                                                         const std::vector<CTransactionRef>& txns, int64_t accept_time)
+    EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
 /**
 * Atomically test acceptance of a package. If the package only contains one tx, package rules still
 * apply. Package validation does not allow BIP125 replacements, so the transaction(s) cannot spend
@@ -1005,6 +1020,16 @@ public:
     [[nodiscard]] MempoolAcceptResult ProcessTransaction(const CTransactionRef& tx, bool test_accept=false)
         EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+    /**
+     * Try to add several transactions to the memory pool, as if ProcessTransaction() was called
+     * for each of them in order, while only setting up validation once.
+     *
+     * @param[in]  txns            The transactions to submit for mempool acceptance.
+     * @returns one result per transaction, in the same order as txns.
+     */
+    [[nodiscard]] std::vector<MempoolAcceptResult> ProcessTransactions(const std::vector<CTransactionRef>& txns)
+        EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
     //! Load the block tree and coins database from disk, initializing state if we're running with -reindex
     bool LoadBlockIndex() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
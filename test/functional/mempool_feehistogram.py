@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+# Copyright (c) 2021 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the mempool fee rate histogram exposed by getmempoolfeehistogram and
+the /rest/mempool/feehistogram endpoint."""
+
+from decimal import Decimal
+import http.client
+import json
+import urllib.parse
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal
+from test_framework.wallet import MiniWallet
+
+
+class MempoolFeeHistogramTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+        self.setup_clean_chain = True
+        self.extra_args = [["-rest"]]
+
+    def rest_histogram(self):
+        url = urllib.parse.urlparse(self.nodes[0].url)
+        conn = http.client.HTTPConnection(url.hostname, url.port)
+        conn.request('GET', '/rest/mempool/feehistogram.json')
+        resp = conn.getresponse()
+        assert_equal(resp.status, 200)
+        return json.loads(resp.read().decode('utf-8'), parse_float=Decimal)
+
+    def run_test(self):
+        node = self.nodes[0]
+        wallet = MiniWallet(node)
+        self.generate(wallet, 10)
+        self.generate(node, 100)
+
+        self.log.info("Test that an empty mempool has empty buckets")
+        histogram = node.getmempoolfeehistogram()
+        assert 'history' not in histogram
+        assert_equal(histogram['buckets'][0]['min_feerate'], 0)
+        assert all(b['count'] == 0 and b['vsize'] == 0 for b in histogram['buckets'])
+
+        self.log.info("Test that transactions are counted in the bucket of their fee rate")
+        fee_rates = [Decimal("0.00001"), Decimal("0.00005"), Decimal("0.00005"), Decimal("0.001")]
+        for fee_rate in fee_rates:
+            wallet.send_self_transfer(from_node=node, fee_rate=fee_rate)
+        histogram = node.getmempoolfeehistogram()
+        mempool_info = node.getmempoolinfo()
+        assert_equal(sum(b['count'] for b in histogram['buckets']), mempool_info['size'])
+        assert_equal(sum(b['vsize'] for b in histogram['buckets']), mempool_info['bytes'])
+        assert_equal(sum(b['fees'] for b in histogram['buckets']), mempool_info['total_fee'])
+        assert_equal(sorted(b['count'] for b in histogram['buckets'] if b['count'] > 0), [1, 1, 2])
+
+        self.log.info("Test that snapshots are recorded by the scheduler")
+        assert_equal(node.getmempoolfeehistogram(True)['history'], [])
+        node.mockscheduler(60)
+        self.wait_until(lambda: len(node.getmempoolfeehistogram(True)['history']) == 1)
+        history = node.getmempoolfeehistogram(True)['history']
+        assert_equal(history[0]['count'], [b['count'] for b in histogram['buckets']])
+
+        self.log.info("Test that mined transactions leave the histogram")
+        self.generate(node, 1)
+        histogram = node.getmempoolfeehistogram(True)
+        assert all(b['count'] == 0 for b in histogram['buckets'])
+        assert_equal(len(histogram['history']), 1)
+
+        self.log.info("Test the REST endpoint")
+        rest = self.rest_histogram()
+        assert_equal(rest['buckets'], histogram['buckets'])
+        assert_equal(rest['history'], histogram['history'])
+
+
+if __name__ == '__main__':
+    MempoolFeeHistogramTest().main()
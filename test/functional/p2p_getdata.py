@@ -7,20 +7,25 @@ from collections import defaultdict
 
 from test_framework.messages import (
     CInv,
+    MSG_BLOCK,
+    MSG_WITNESS_FLAG,
     msg_getdata,
 )
 from test_framework.p2p import P2PInterface
 from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal
 
 
 class P2PStoreBlock(P2PInterface):
     def __init__(self):
         super().__init__()
         self.blocks = defaultdict(int)
+        self.last_block = None
 
     def on_block(self, message):
         message.block.calc_sha256()
         self.blocks[message.block.sha256] += 1
+        self.last_block = message.block
 
 
 class GetdataTest(BitcoinTestFramework):
@@ -44,6 +49,25 @@ class GetdataTest(BitcoinTestFramework):
         p2p_block_store.send_and_ping(good_getdata)
         p2p_block_store.wait_until(lambda: p2p_block_store.blocks[best_block] == 1)
 
+        self.log.info("test that blocks served repeatedly are taken from the block cache")
+        cache = self.nodes[0].getnetworkinfo()['blockcache']
+        assert_equal(cache['blocks'], 1)
+        assert cache['bytes'] > 0
+        assert_equal(cache['maxbytes'], 32 << 20)
+        old_block = int(self.nodes[0].getblockhash(1), 16)
+        served = []
+        for inv_type in [MSG_BLOCK | MSG_WITNESS_FLAG, MSG_BLOCK | MSG_WITNESS_FLAG, MSG_BLOCK]:
+            p2p_block_store.send_and_ping(msg_getdata([CInv(t=inv_type, h=old_block)]))
+            served.append(p2p_block_store.last_block)
+        assert_equal(p2p_block_store.blocks[old_block], 3)
+        assert_equal(served[0].serialize(), served[1].serialize())
+        assert served[2].serialize() != served[0].serialize()
+        assert_equal(served[2].serialize(), served[0].serialize(with_witness=False))
+        new_cache = self.nodes[0].getnetworkinfo()['blockcache']
+        assert_equal(new_cache['blocks'], 2)
+        assert_equal(new_cache['misses'], cache['misses'] + 1)
+        assert_equal(new_cache['hits'], cache['hits'] + 2)
+
 
 if __name__ == '__main__':
     GetdataTest().main()
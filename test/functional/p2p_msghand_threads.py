@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+# Copyright (c) 2021 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test message processing with multiple message handler threads (-msghandthreads).
+
+Peers are processed concurrently, but each peer's messages must still be
+handled in the order they were received."""
+
+from collections import defaultdict
+
+from test_framework.messages import (
+    CInv,
+    MSG_BLOCK,
+    MSG_WITNESS_FLAG,
+    msg_getdata,
+    msg_ping,
+)
+from test_framework.p2p import P2PInterface
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal
+
+NUM_PEERS = 8
+PINGS_PER_PEER = 50
+
+
+class P2PRecorder(P2PInterface):
+    def __init__(self):
+        super().__init__()
+        self.pong_nonces = []
+        self.blocks = defaultdict(int)
+
+    def on_inv(self, message):
+        # Only fetch the blocks requested by the test
+        pass
+
+    def on_pong(self, message):
+        self.pong_nonces.append(message.nonce)
+
+    def on_block(self, message):
+        message.block.calc_sha256()
+        self.blocks[message.block.sha256] += 1
+
+
+class MsgHandThreadsTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+        self.extra_args = [["-msghandthreads=4"]]
+
+    def run_test(self):
+        node = self.nodes[0]
+        peers = [node.add_p2p_connection(P2PRecorder()) for _ in range(NUM_PEERS)]
+
+        self.log.info("Test that each peer's messages are processed in order")
+        for peer in peers:
+            peer.pong_nonces.clear()
+        for nonce in range(1, PINGS_PER_PEER + 1):
+            for peer in peers:
+                peer.send_message(msg_ping(nonce=nonce))
+        for peer in peers:
+            peer.wait_until(lambda peer=peer: len(peer.pong_nonces) == PINGS_PER_PEER)
+            assert_equal(peer.pong_nonces, list(range(1, PINGS_PER_PEER + 1)))
+
+        self.log.info("Test that all peers can fetch a new block")
+        tip = int(self.generate(node, 1)[0], 16)
+        for i, peer in enumerate(peers):
+            inv_type = MSG_BLOCK | MSG_WITNESS_FLAG if i % 2 else MSG_BLOCK
+            peer.send_message(msg_getdata([CInv(t=inv_type, h=tip)]))
+        for peer in peers:
+            peer.wait_until(lambda peer=peer: peer.blocks[tip] == 1)
+            peer.sync_with_ping()
+
+        self.log.info("Test that disconnecting peers while others are processed is handled")
+        for peer in peers[:NUM_PEERS // 2]:
+            for nonce in range(PINGS_PER_PEER):
+                peer.send_message(msg_ping(nonce=nonce))
+            peer.peer_disconnect()
+        for peer in peers[NUM_PEERS // 2:]:
+            peer.sync_with_ping()
+        self.wait_until(lambda: len(node.getpeerinfo()) == NUM_PEERS - NUM_PEERS // 2)
+
+
+if __name__ == '__main__':
+    MsgHandThreadsTest().main()
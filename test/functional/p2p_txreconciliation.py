@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+# Copyright (c) 2021 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test transaction relay by set reconciliation (BIP330, -txreconciliation).
+
+Peers that negotiate reconciliation with SENDTXRCNCL between VERSION and
+VERACK do not get transactions announced right away, but learn about them
+when reconciling. Other peers still get inv messages."""
+
+import time
+
+from test_framework.messages import (
+    MSG_WTX,
+    msg_reconcildiff,
+    msg_reqtxrcncl,
+    msg_sendtxrcncl,
+    msg_verack,
+    msg_version,
+    msg_wtxidrelay,
+)
+from test_framework.p2p import (
+    P2PInterface,
+    P2P_SERVICES,
+    P2P_SUBVERSION,
+    P2P_VERSION,
+)
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal
+from test_framework.wallet import MiniWallet
+
+TXRECONCILIATION_VERSION = 1
+# Interval between reconciliations with each outbound peer
+RECON_REQUEST_INTERVAL = 8
+
+
+class ReconciliationPeer(P2PInterface):
+    """A peer that sends SENDTXRCNCL with the given version during the handshake."""
+    def __init__(self, recon_version=TXRECONCILIATION_VERSION):
+        super().__init__()
+        self.recon_version = recon_version
+
+    def on_version(self, message):
+        self.send_message(msg_wtxidrelay())
+        self.send_message(msg_sendtxrcncl(version=self.recon_version, salt=1))
+        self.send_message(msg_verack())
+        self.nServices = message.nServices
+
+
+def announced(peer, wtxid):
+    inv = peer.last_message.get("inv")
+    return inv is not None and any(i.type == MSG_WTX and i.hash == wtxid for i in inv.inv)
+
+
+def version_msg(*, relay):
+    version = msg_version()
+    version.nVersion = P2P_VERSION
+    version.strSubVer = P2P_SUBVERSION
+    version.nServices = P2P_SERVICES
+    version.relay = relay
+    return version
+
+
+class TxReconciliationTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 4
+        # The last node does not support reconciliation, and gets transactions announced by inv messages.
+        self.extra_args = [["-txreconciliation"]] * 3 + [[]]
+
+    def test_handshake(self):
+        node = self.nodes[0]
+
+        self.log.info("Test that sendtxrcncl is sent to peers that relay transactions")
+        peer = node.add_p2p_connection(P2PInterface())
+        assert_equal(peer.message_count["sendtxrcncl"], 1)
+        assert_equal(peer.last_message["sendtxrcncl"].version, TXRECONCILIATION_VERSION)
+        no_relay_peer = node.add_p2p_connection(P2PInterface(), send_version=False, wait_for_verack=False)
+        no_relay_peer.send_message(version_msg(relay=0))
+        no_relay_peer.wait_for_verack()
+        assert_equal(no_relay_peer.message_count["sendtxrcncl"], 0)
+
+        self.log.info("Test that sendtxrcncl after verack is a protocol violation")
+        with node.assert_debug_log(["sendtxrcncl received after verack"]):
+            peer.send_message(msg_sendtxrcncl())
+            peer.wait_for_disconnect()
+
+        self.log.info("Test that an unsupported version is a protocol violation")
+        peer = node.add_p2p_connection(ReconciliationPeer(recon_version=0), send_version=False, wait_for_verack=False)
+        with node.assert_debug_log(["invalid sendtxrcncl"]):
+            peer.send_message(version_msg(relay=1))
+            peer.wait_for_disconnect()
+        node.disconnect_p2ps()
+
+    def test_reconcile_with_peer(self):
+        node = self.nodes[0]
+        recon_peer = node.add_p2p_connection(ReconciliationPeer())
+        flood_peer = node.add_p2p_connection(P2PInterface())
+
+        self.log.info("Test that transactions are announced to peers that do not reconcile")
+        tx = self.wallet.send_self_transfer(from_node=node)
+        wtxid = int(tx["wtxid"], 16)
+        flood_peer.wait_until(lambda: announced(flood_peer, wtxid))
+        assert not announced(recon_peer, wtxid)
+
+        self.log.info("Test that reconciling peers get a sketch when they request a reconciliation")
+        recon_peer.send_message(msg_reqtxrcncl(set_size=0, q=0))
+        recon_peer.wait_until(lambda: "sketch" in recon_peer.last_message)
+        # The capacity is the difference of the set sizes plus one, as q is zero.
+        assert_equal(len(recon_peer.last_message["sketch"].skdata), 4 * 2)
+        assert not announced(recon_peer, wtxid)
+
+        self.log.info("Test that the set is announced when the reconciliation fails")
+        recon_peer.send_message(msg_reconcildiff(success=False))
+        recon_peer.wait_until(lambda: announced(recon_peer, wtxid))
+
+        self.log.info("Test that a reconciliation difference without a sketch is a protocol violation")
+        recon_peer.send_message(msg_reconcildiff(success=True))
+        recon_peer.wait_for_disconnect()
+        node.disconnect_p2ps()
+
+    def test_relay_between_nodes(self):
+        self.log.info("Test that nodes relay transactions by reconciliation")
+        mocktime = int(time.time())
+        txids = self.nodes[0].getrawmempool()
+        txids += [self.wallet.send_self_transfer(from_node=self.nodes[i % 3])["txid"] for i in range(9)]
+
+        def synced():
+            nonlocal mocktime
+            if all(set(txids) <= set(node.getrawmempool()) for node in self.nodes):
+                return True
+            mocktime += RECON_REQUEST_INTERVAL // 2
+            for node in self.nodes:
+                node.setmocktime(mocktime)
+            return False
+        self.wait_until(synced)
+        self.sync_mempools()
+
+        recon_msgs = {"reqtxrcncl", "sketch", "reconcildiff"}
+        for initiator, responder in [(self.nodes[1], self.nodes[0]), (self.nodes[2], self.nodes[1])]:
+            # The node that made the connection requests reconciliations, and the other one sends sketches.
+            outbound = next(peer for peer in initiator.getpeerinfo() if not peer["inbound"])
+            assert {"reqtxrcncl", "reconcildiff"} <= set(outbound["bytessent_per_msg"])
+            inbound = next(peer for peer in responder.getpeerinfo() if peer["inbound"])
+            assert "sketch" in inbound["bytessent_per_msg"]
+        # Nodes that do not reconcile do not exchange reconciliation messages.
+        inbound = next(peer for peer in self.nodes[2].getpeerinfo() if peer["inbound"])
+        assert not recon_msgs & set(inbound["bytessent_per_msg"])
+        assert not recon_msgs & set(self.nodes[3].getpeerinfo()[0]["bytessent_per_msg"])
+
+    def run_test(self):
+        self.wallet = MiniWallet(self.nodes[0])
+        self.wallet.rescan_utxos()
+
+        self.test_handshake()
+        self.test_reconcile_with_peer()
+        self.test_relay_between_nodes()
+
+
+if __name__ == '__main__':
+    TxReconciliationTest().main()
@@ -45,7 +45,7 @@ class NetTest(BitcoinTestFramework):
     def set_test_params(self):
         self.setup_clean_chain = True
         self.num_nodes = 2
-        self.extra_args = [["-minrelaytxfee=0.00001000"], ["-minrelaytxfee=0.00000500"]]
+        self.extra_args = [["-minrelaytxfee=0.00001000", "-socketthreads=2"], ["-minrelaytxfee=0.00000500"]]
         self.supports_cli = False
 
     def run_test(self):
@@ -104,6 +104,11 @@ class NetTest(BitcoinTestFramework):
         assert_equal(peer_info[1][0]['connection_type'], 'manual')
         assert_equal(peer_info[1][1]['connection_type'], 'inbound')
 
+        # Small messages reuse the payload buffers of earlier ones from the
+        # shared receive buffer pool.
+        for info in peer_info:
+            assert info[0]['recvbuffer']['poolhits'] > 0
+
         # Check dynamically generated networks list in getpeerinfo help output.
         assert "(ipv4, ipv6, onion, i2p, cjdns, not_publicly_routable)" in self.nodes[0].help("getpeerinfo")
 
@@ -124,6 +129,12 @@ class NetTest(BitcoinTestFramework):
             self.wait_until(lambda: peer_after()['bytesrecv_per_msg'].get('pong', 0) >= peer_before['bytesrecv_per_msg'].get('pong', 0) + 32, timeout=1)
             self.wait_until(lambda: peer_after()['bytessent_per_msg'].get('ping', 0) >= peer_before['bytessent_per_msg'].get('ping', 0) + 32, timeout=1)
 
+        # Each ping is sent with at least one send call, and its 8 byte payload
+        # is serialized for the peer it is sent to.
+        net_totals_after = self.nodes[0].getnettotals()
+        assert net_totals_after['sendcalls'] >= net_totals_before['sendcalls'] + len(peer_info_before)
+        assert net_totals_after['bytescopied'] >= net_totals_before['bytescopied'] + 8 * len(peer_info_before)
+
     def test_getnetworkinfo(self):
         self.log.info("Test getnetworkinfo")
         info = self.nodes[0].getnetworkinfo()
@@ -150,6 +161,12 @@ class NetTest(BitcoinTestFramework):
         assert_equal(info['connections_in'], 1)
         assert_equal(info['connections_out'], 1)
 
+        self.log.info("Test that connections are spread over the socket threads")
+        assert_equal(len(info['socketthreads']), 2)
+        assert_equal([thread['connections'] for thread in info['socketthreads']], [1, 1])
+        self.wait_until(lambda: all(thread['bytesrecv'] > 0 for thread in self.nodes[0].getnetworkinfo()['socketthreads']))
+        assert_equal(len(self.nodes[1].getnetworkinfo()['socketthreads']), 1)
+
         # check the `servicesnames` field
         network_info = [node.getnetworkinfo() for node in self.nodes]
         for info in network_info:
@@ -1267,6 +1267,90 @@ class msg_wtxidrelay:
         return "msg_wtxidrelay()"
 
 
+class msg_sendtxrcncl:
+    __slots__ = ("version", "salt")
+    msgtype = b"sendtxrcncl"
+
+    def __init__(self, version=1, salt=0):
+        self.version = version
+        self.salt = salt
+
+    def deserialize(self, f):
+        self.version = struct.unpack("<I", f.read(4))[0]
+        self.salt = struct.unpack("<Q", f.read(8))[0]
+
+    def serialize(self):
+        r = b""
+        r += struct.pack("<I", self.version)
+        r += struct.pack("<Q", self.salt)
+        return r
+
+    def __repr__(self):
+        return "msg_sendtxrcncl(version=%lu, salt=%lu)" % (self.version, self.salt)
+
+
+class msg_reqtxrcncl:
+    __slots__ = ("set_size", "q")
+    msgtype = b"reqtxrcncl"
+
+    def __init__(self, set_size=0, q=0):
+        self.set_size = set_size
+        self.q = q
+
+    def deserialize(self, f):
+        self.set_size = struct.unpack("<H", f.read(2))[0]
+        self.q = struct.unpack("<H", f.read(2))[0]
+
+    def serialize(self):
+        r = b""
+        r += struct.pack("<H", self.set_size)
+        r += struct.pack("<H", self.q)
+        return r
+
+    def __repr__(self):
+        return "msg_reqtxrcncl(set_size=%lu, q=%lu)" % (self.set_size, self.q)
+
+
+class msg_sketch:
+    __slots__ = ("skdata",)
+    msgtype = b"sketch"
+
+    def __init__(self, skdata=b""):
+        self.skdata = skdata
+
+    def deserialize(self, f):
+        self.skdata = deser_string(f)
+
+    def serialize(self):
+        return ser_string(self.skdata)
+
+    def __repr__(self):
+        return "msg_sketch(skdata=%s)" % self.skdata.hex()
+
+
+class msg_reconcildiff:
+    __slots__ = ("success", "ask_shortids")
+    msgtype = b"reconcildiff"
+
+    def __init__(self, success=False, ask_shortids=None):
+        self.success = success
+        self.ask_shortids = ask_shortids if ask_shortids is not None else []
+
+    def deserialize(self, f):
+        self.success = struct.unpack("<?", f.read(1))[0]
+        self.ask_shortids = [struct.unpack("<I", f.read(4))[0] for _ in range(deser_compact_size(f))]
+
+    def serialize(self):
+        r = b""
+        r += struct.pack("<?", self.success)
+        r += ser_compact_size(len(self.ask_shortids))
+        r += b"".join(struct.pack("<I", shortid) for shortid in self.ask_shortids)
+        return r
+
+    def __repr__(self):
+        return "msg_reconcildiff(success=%s, ask_shortids=%s)" % (self.success, self.ask_shortids)
+
+
 class msg_no_witness_tx(msg_tx):
     __slots__ = ()
 
@@ -191,6 +191,8 @@ BASE_SCRIPTS = [
     'p2p_addr_relay.py',
     'p2p_getaddr_caching.py',
     'p2p_getdata.py',
+    'p2p_msghand_threads.py',
+    'p2p_txreconciliation.py',
     'p2p_addrfetch.py',
     'rpc_net.py',
     'wallet_keypool.py --legacy-wallet',
@@ -292,6 +294,7 @@ BASE_SCRIPTS = [
     'feature_addrman.py',
     'feature_asmap.py',
     'mempool_unbroadcast.py',
+    'mempool_feehistogram.py',
     'mempool_compatibility.py',
     'mempool_accept_wtxid.py',
     'rpc_deriveaddresses.py',